@@ -2,5 +2,7 @@ set(CMAKE_BUILD_TYPE RelWithDebInfo)
 set(XGRAMMAR_BUILD_PYTHON_BINDINGS ON)
 set(XGRAMMAR_ENABLE_COVERAGE OFF)
 set(XGRAMMAR_BUILD_CXX_TESTS OFF)
+set(XGRAMMAR_BUILD_CXX_BENCHMARKS OFF)
 set(XGRAMMAR_ENABLE_CPPTRACE OFF)
 set(XGRAMMAR_ENABLE_INTERNAL_CHECK OFF)
+set(XGRAMMAR_ENABLE_DEBUG_PRINT ON)
@@ -0,0 +1,33 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/builtin_grammars.cc
+ */
+
+#include "builtin_grammars.h"
+
+#include <string>
+#include <variant>
+
+#include "grammar_functor.h"
+#include "support/logging.h"
+#include "support/utils.h"
+
+namespace xgrammar {
+
+Grammar BuiltinJSONGrammarOptimized() {
+  static const Grammar grammar = [] {
+    if (kBuiltinJSONGrammarSerializedSize == 0) {
+      return GrammarOptimizer::Apply(Grammar::BuiltinJSONGrammar());
+    }
+    auto result = Grammar::DeserializeJSON(
+        std::string(kBuiltinJSONGrammarSerialized, kBuiltinJSONGrammarSerializedSize)
+    );
+    XGRAMMAR_CHECK(std::holds_alternative<Grammar>(result))
+        << "Failed to load the embedded builtin JSON grammar: "
+        << GetMessageFromVariantError(std::get<1>(result));
+    return std::get<0>(result);
+  }();
+  return grammar;
+}
+
+}  // namespace xgrammar
@@ -0,0 +1,33 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/builtin_grammars.h
+ * \brief The optimized builtin grammars embedded in the library at build time.
+ */
+
+#ifndef XGRAMMAR_BUILTIN_GRAMMARS_H_
+#define XGRAMMAR_BUILTIN_GRAMMARS_H_
+
+#include <xgrammar/grammar.h>
+
+#include <cstddef>
+
+namespace xgrammar {
+
+/*!
+ * \brief The serialized JSON of the optimized builtin JSON grammar. It is generated at build time
+ * by cpp/tools/generate_builtin_grammars.cc. Empty if the builtin grammars are not embedded, e.g.
+ * in the generator itself or when cross-compiling.
+ */
+extern const char kBuiltinJSONGrammarSerialized[];
+extern const std::size_t kBuiltinJSONGrammarSerializedSize;
+
+/*!
+ * \brief Get the optimized builtin JSON grammar. It is loaded from the embedded JSON without
+ * parsing the EBNF or running the optimizer, and falls back to optimizing
+ * Grammar::BuiltinJSONGrammar() if the grammar is not embedded.
+ */
+Grammar BuiltinJSONGrammarOptimized();
+
+}  // namespace xgrammar
+
+#endif  // XGRAMMAR_BUILTIN_GRAMMARS_H_
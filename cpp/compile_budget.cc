@@ -0,0 +1,122 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/compile_budget.cc
+ */
+
+#include "compile_budget.h"
+
+#include <string>
+
+#include "support/logging.h"
+
+namespace xgrammar {
+
+/******************* CompileBudget::Impl *******************/
+
+namespace {
+
+thread_local CompileBudget::Impl* current_compile_budget = nullptr;
+
+std::optional<std::chrono::steady_clock::time_point> GetDeadline(int64_t timeout_ms) {
+  if (timeout_ms == -1) return std::nullopt;
+  return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+}
+
+std::optional<int64_t> GetLimit(int64_t limit) {
+  if (limit == -1) return std::nullopt;
+  return limit;
+}
+
+}  // namespace
+
+CompileBudget::Impl::Impl(int64_t timeout_ms, int64_t max_memory_bytes, int64_t max_fsm_states)
+    : deadline_(GetDeadline(timeout_ms)),
+      max_memory_bytes_(GetLimit(max_memory_bytes)),
+      max_fsm_states_(GetLimit(max_fsm_states)) {
+  XGRAMMAR_CHECK(timeout_ms >= -1)
+      << "timeout_ms should be -1 (no deadline) or non-negative, but got " << timeout_ms;
+  XGRAMMAR_CHECK(max_memory_bytes >= -1)
+      << "max_memory_bytes should be -1 (unlimited) or non-negative, but got " << max_memory_bytes;
+  XGRAMMAR_CHECK(max_fsm_states >= -1)
+      << "max_fsm_states should be -1 (unlimited) or non-negative, but got " << max_fsm_states;
+}
+
+void CompileBudget::Impl::Check() const {
+  if (IsCancelled()) {
+    throw CompileBudgetExceededError(
+        CompileBudgetExceededError::Reason::kCancelled, "The compilation is cancelled"
+    );
+  }
+  if (deadline_.has_value() && std::chrono::steady_clock::now() > deadline_.value()) {
+    throw CompileBudgetExceededError(
+        CompileBudgetExceededError::Reason::kDeadline, "The compilation passes its deadline"
+    );
+  }
+  // The exceeded budgets stop the remaining tasks of the compilation early.
+  if (max_memory_bytes_.has_value() && GetMemoryBytes() > max_memory_bytes_.value()) {
+    ThrowMemoryExceeded(GetMemoryBytes());
+  }
+  if (max_fsm_states_.has_value() && GetFSMStates() > max_fsm_states_.value()) {
+    ThrowFSMStatesExceeded(GetFSMStates());
+  }
+}
+
+void CompileBudget::Impl::AddMemoryBytes(int64_t bytes) {
+  auto total = memory_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  if (max_memory_bytes_.has_value() && total > max_memory_bytes_.value()) {
+    ThrowMemoryExceeded(total);
+  }
+}
+
+void CompileBudget::Impl::AddFSMStates(int64_t num_states) {
+  auto total = fsm_states_.fetch_add(num_states, std::memory_order_relaxed) + num_states;
+  if (max_fsm_states_.has_value() && total > max_fsm_states_.value()) {
+    ThrowFSMStatesExceeded(total);
+  }
+}
+
+void CompileBudget::Impl::ThrowMemoryExceeded(int64_t total) const {
+  throw CompileBudgetExceededError(
+      CompileBudgetExceededError::Reason::kMemory,
+      "The token mask cache takes " + std::to_string(total) + " bytes, exceeding the budget of " +
+          std::to_string(max_memory_bytes_.value()) + " bytes"
+  );
+}
+
+void CompileBudget::Impl::ThrowFSMStatesExceeded(int64_t total) const {
+  throw CompileBudgetExceededError(
+      CompileBudgetExceededError::Reason::kFSMStates,
+      "The FSMs have " + std::to_string(total) + " states, exceeding the budget of " +
+          std::to_string(max_fsm_states_.value()) + " states"
+  );
+}
+
+CompileBudget::Impl* CompileBudget::Impl::Current() { return current_compile_budget; }
+
+CompileBudget::Impl* CompileBudget::Impl::SetCurrent(Impl* budget) {
+  auto* prev_budget = current_compile_budget;
+  current_compile_budget = budget;
+  return prev_budget;
+}
+
+/******************* CompileBudget *******************/
+
+CompileBudget::CompileBudget(int64_t timeout_ms, int64_t max_memory_bytes, int64_t max_fsm_states)
+    : pimpl_(std::make_shared<Impl>(timeout_ms, max_memory_bytes, max_fsm_states)) {}
+
+void CompileBudget::Cancel() { pimpl_->Cancel(); }
+
+bool CompileBudget::IsCancelled() const { return pimpl_->IsCancelled(); }
+
+int64_t CompileBudget::GetMemoryBytes() const { return pimpl_->GetMemoryBytes(); }
+
+int64_t CompileBudget::GetFSMStates() const { return pimpl_->GetFSMStates(); }
+
+/******************* CompileBudgetScope *******************/
+
+CompileBudgetScope::CompileBudgetScope(const CompileBudget& budget)
+    : budget_(budget), prev_budget_(CompileBudget::Impl::SetCurrent(budget_.ImplPtr())) {}
+
+CompileBudgetScope::~CompileBudgetScope() { CompileBudget::Impl::SetCurrent(prev_budget_); }
+
+}  // namespace xgrammar
@@ -0,0 +1,95 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/compile_budget.h
+ * \brief The implementation of the cancellation token, deadline and resource budgets of grammar
+ * compilations.
+ */
+
+#ifndef XGRAMMAR_COMPILE_BUDGET_H_
+#define XGRAMMAR_COMPILE_BUDGET_H_
+
+#include <xgrammar/compiler.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace xgrammar {
+
+class CompileBudget::Impl : public std::enable_shared_from_this<CompileBudget::Impl> {
+ public:
+  Impl(int64_t timeout_ms, int64_t max_memory_bytes, int64_t max_fsm_states);
+
+  void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+  bool IsCancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+  int64_t GetMemoryBytes() const { return memory_bytes_.load(std::memory_order_relaxed); }
+
+  int64_t GetFSMStates() const { return fsm_states_.load(std::memory_order_relaxed); }
+
+  /*!
+   * \brief Check whether the budget is cancelled, its deadline has passed, or its memory or FSM
+   * state budget has been exceeded.
+   * \throws CompileBudgetExceededError if so.
+   */
+  void Check() const;
+
+  /*!
+   * \brief Account the bytes of the computed token masks.
+   * \throws CompileBudgetExceededError if the memory budget is exceeded.
+   */
+  void AddMemoryBytes(int64_t bytes);
+
+  /*!
+   * \brief Account the states of the built FSMs.
+   * \throws CompileBudgetExceededError if the FSM state budget is exceeded.
+   */
+  void AddFSMStates(int64_t num_states);
+
+  /*! \brief Get the budget applied to the current thread. nullptr if there is no budget. */
+  static Impl* Current();
+
+  /*! \brief Apply the budget to the current thread. Return the previous one. */
+  static Impl* SetCurrent(Impl* budget);
+
+ private:
+  [[noreturn]] void ThrowMemoryExceeded(int64_t total) const;
+  [[noreturn]] void ThrowFSMStatesExceeded(int64_t total) const;
+
+  /*! \brief The deadline of the compilation. */
+  const std::optional<std::chrono::steady_clock::time_point> deadline_;
+  /*! \brief The maximum bytes of the token mask cache. */
+  const std::optional<int64_t> max_memory_bytes_;
+  /*! \brief The maximum number of FSM states. */
+  const std::optional<int64_t> max_fsm_states_;
+  /*! \brief Whether the budget is cancelled. */
+  std::atomic<bool> cancelled_{false};
+  /*! \brief The accounted bytes of the token mask cache. */
+  std::atomic<int64_t> memory_bytes_{0};
+  /*! \brief The accounted number of FSM states. */
+  std::atomic<int64_t> fsm_states_{0};
+};
+
+/*!
+ * \brief Get the budget applied to the current thread, so it can be applied to the tasks of the
+ * compilation running in the worker threads.
+ */
+inline std::optional<CompileBudget> CurrentCompileBudget() {
+  auto* budget = CompileBudget::Impl::Current();
+  if (budget == nullptr) return std::nullopt;
+  return CompileBudget(budget->shared_from_this());
+}
+
+/*!
+ * \brief Check the budget of the current thread. Do nothing if no budget is applied.
+ */
+inline void CheckCompileBudget() {
+  if (auto* budget = CompileBudget::Impl::Current()) budget->Check();
+}
+
+}  // namespace xgrammar
+
+#endif  // XGRAMMAR_COMPILE_BUDGET_H_
@@ -0,0 +1,379 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/compile_server.cc
+ */
+
+#include "compile_server.h"
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <variant>
+
+#include "support/logging.h"
+#include "support/utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#define XGRAMMAR_COMPILE_SERVER_SUPPORTED 1
+#else
+#define XGRAMMAR_COMPILE_SERVER_SUPPORTED 0
+#endif
+
+namespace xgrammar {
+
+namespace {
+
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+
+#if defined(MSG_NOSIGNAL)
+// A closed peer should fail the write instead of killing the process with SIGPIPE.
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+/*! \brief The maximum size of a frame, to reject the corrupted lengths. */
+constexpr uint64_t kMaxFrameSize = uint64_t(1) << 36;
+
+void DisableSigPipe(int fd) {
+#if defined(SO_NOSIGPIPE)
+  int value = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &value, sizeof(value));
+#else
+  (void)fd;
+#endif
+}
+
+/*! \brief Make the sends and receives on the socket fail with EAGAIN after the timeout. */
+void SetSocketTimeout(int fd, int64_t timeout_ms) {
+  if (timeout_ms <= 0) return;
+  timeval timeout;
+  timeout.tv_sec = static_cast<decltype(timeout.tv_sec)>(timeout_ms / 1000);
+  timeout.tv_usec = static_cast<decltype(timeout.tv_usec)>(timeout_ms % 1000 * 1000);
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+/*! \brief Whether the last failed send or receive timed out. */
+bool IsTimeout() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+
+bool GetSocketAddress(const std::string& socket_path, sockaddr_un* address) {
+  std::memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address->sun_path)) return false;
+  std::memcpy(address->sun_path, socket_path.c_str(), socket_path.size() + 1);
+  return true;
+}
+
+/*!
+ * \brief Connect to the Unix domain socket, with the timeout of SetSocketTimeout. Return -1 on
+ * failure.
+ */
+int ConnectSocket(const std::string& socket_path, int64_t timeout_ms = 0) {
+  sockaddr_un address;
+  if (!GetSocketAddress(socket_path, &address)) return -1;
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  DisableSigPipe(fd);
+  SetSocketTimeout(fd, timeout_ms);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool WriteAll(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    auto num_written = ::send(fd, data, size, kSendFlags);
+    if (num_written < 0 && errno == EINTR) continue;
+    if (num_written <= 0) return false;
+    data += num_written;
+    size -= static_cast<std::size_t>(num_written);
+  }
+  return true;
+}
+
+bool ReadAll(int fd, char* data, std::size_t size) {
+  while (size > 0) {
+    auto num_read = ::recv(fd, data, size, 0);
+    if (num_read < 0 && errno == EINTR) continue;
+    if (num_read <= 0) return false;
+    data += num_read;
+    size -= static_cast<std::size_t>(num_read);
+  }
+  return true;
+}
+
+/*! \brief Write a frame of the length followed by the payload. Both ends are on the same host. */
+bool WriteFrame(int fd, const std::string& payload) {
+  uint64_t size = payload.size();
+  return WriteAll(fd, reinterpret_cast<const char*>(&size), sizeof(size)) &&
+         WriteAll(fd, payload.data(), payload.size());
+}
+
+bool ReadFrame(int fd, std::string* payload) {
+  uint64_t size = 0;
+  if (!ReadAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) || size > kMaxFrameSize) {
+    return false;
+  }
+  payload->resize(size);
+  return ReadAll(fd, payload->data(), size);
+}
+
+/*!
+ * \brief Send a request and receive its response on a connection. On failure, IsTimeout() tells
+ * whether it timed out.
+ */
+bool Exchange(int connection, const std::string& request, std::string* response) {
+  errno = 0;
+  return WriteFrame(connection, request) && ReadFrame(connection, response) && !response->empty();
+}
+
+#endif  // XGRAMMAR_COMPILE_SERVER_SUPPORTED
+
+}  // namespace
+
+/******************* CompileServerClient *******************/
+
+CompileServerClient::CompileServerClient(
+    std::string socket_path, TokenizerInfo tokenizer_info, int64_t timeout_ms
+)
+    : socket_path_(std::move(socket_path)),
+      tokenizer_info_(std::move(tokenizer_info)),
+      tokenizer_info_json_(tokenizer_info_.SerializeJSON()),
+      timeout_ms_(timeout_ms) {}
+
+CompileServerClient::~CompileServerClient() {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  for (int connection : idle_connections_) {
+    ::close(connection);
+  }
+#endif
+}
+
+int CompileServerClient::Connect() {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  int connection = ConnectSocket(socket_path_, timeout_ms_);
+  if (connection < 0) return -1;
+  std::string response;
+  if (!WriteFrame(connection, tokenizer_info_json_) || !ReadFrame(connection, &response)) {
+    ::close(connection);
+    return -1;
+  }
+  return connection;
+#else
+  return -1;
+#endif
+}
+
+std::optional<CompiledGrammar> CompileServerClient::Compile(const std::string& entry_json) {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  int connection = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_connections_.empty()) {
+      connection = idle_connections_.back();
+      idle_connections_.pop_back();
+    }
+  }
+  const std::string timeout_message = "The compile server at " + socket_path_ +
+                                      " does not respond in " + std::to_string(timeout_ms_) + " ms";
+  std::string response;
+  if (connection >= 0 && !Exchange(connection, entry_json, &response)) {
+    bool is_timeout = IsTimeout();
+    // The late response would be read by the next request, so the connection is dropped.
+    ::close(connection);
+    if (is_timeout) {
+      ReportFailure(timeout_message);
+      return std::nullopt;
+    }
+    // The server may have been restarted since the connection was opened. Retry with a new one.
+    connection = -1;
+  }
+  if (connection < 0) {
+    connection = Connect();
+    if (connection < 0) {
+      ReportFailure("Cannot connect to the compile server at " + socket_path_);
+      return std::nullopt;
+    }
+    if (!Exchange(connection, entry_json, &response)) {
+      bool is_timeout = IsTimeout();
+      ::close(connection);
+      ReportFailure(
+          is_timeout ? timeout_message
+                     : "The connection to the compile server at " + socket_path_ + " is lost"
+      );
+      return std::nullopt;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_connections_.push_back(connection);
+    is_available_ = true;
+  }
+
+  // The grammars failed on the server are compiled again by the caller to throw the same error.
+  if (response[0] != '0') return std::nullopt;
+  auto result = CompiledGrammar::DeserializeJSON(response.substr(1), tokenizer_info_);
+  if (std::holds_alternative<SerializationError>(result)) {
+    ReportFailure(
+        "Cannot deserialize the compiled grammar from the compile server: " +
+        GetMessageFromVariantError(std::get<SerializationError>(result))
+    );
+    return std::nullopt;
+  }
+  return std::get<CompiledGrammar>(std::move(result));
+#else
+  ReportFailure("The compile server is not supported on this platform");
+  return std::nullopt;
+#endif
+}
+
+void CompileServerClient::ReportFailure(const std::string& message) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!is_available_) return;
+  is_available_ = false;
+  XGRAMMAR_LOG(WARNING) << message << ". The grammars are compiled in this process.";
+}
+
+/******************* CompileServer::Impl *******************/
+
+CompileServer::Impl::Impl(const std::string& socket_path, int max_threads, int64_t max_memory_bytes)
+    : socket_path_(socket_path), max_threads_(max_threads), max_memory_bytes_(max_memory_bytes) {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  sockaddr_un address;
+  XGRAMMAR_CHECK(GetSocketAddress(socket_path_, &address))
+      << "The socket path is too long: " << socket_path_;
+  listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  XGRAMMAR_CHECK(listen_fd_ >= 0) << "Failed to create the socket: " << std::strerror(errno);
+  DisableSigPipe(listen_fd_);
+  ::unlink(socket_path_.c_str());
+  if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      ::listen(listen_fd_, SOMAXCONN) != 0) {
+    auto error = errno;
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    XGRAMMAR_LOG(FATAL) << "Failed to listen at " << socket_path_ << ": " << std::strerror(error);
+  }
+#else
+  XGRAMMAR_LOG(FATAL) << "The compile server is not supported on this platform";
+#endif
+}
+
+CompileServer::Impl::~Impl() {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  if (listen_fd_ >= 0) {
+    ::close(listen_fd_);
+    ::unlink(socket_path_.c_str());
+  }
+#endif
+}
+
+void CompileServer::Impl::Serve() {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  while (!is_shutdown_.load()) {
+    int connection = ::accept(listen_fd_, nullptr, nullptr);
+    if (connection < 0) {
+      if (errno != EINTR && errno != ECONNABORTED) {
+        // E.g. out of file descriptors. Wait for the other connections to be closed.
+        XGRAMMAR_LOG(WARNING) << "Failed to accept a connection: " << std::strerror(errno);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      continue;
+    }
+    if (is_shutdown_.load()) {
+      ::close(connection);
+      break;
+    }
+    DisableSigPipe(connection);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      connections_.insert(connection);
+    }
+    std::thread([this, connection] { HandleConnection(connection); }).detach();
+  }
+
+  // Stop reading the next requests of the connections, and wait for their threads.
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (int connection : connections_) {
+    ::shutdown(connection, SHUT_RD);
+  }
+  connection_closed_.wait(lock, [this] { return connections_.empty(); });
+#endif
+}
+
+void CompileServer::Impl::Shutdown() {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  if (is_shutdown_.exchange(true)) return;
+  // Wake up the accept() of Serve() with a connection.
+  int connection = ConnectSocket(socket_path_);
+  if (connection >= 0) ::close(connection);
+#endif
+}
+
+void CompileServer::Impl::HandleConnection(int connection) {
+#if XGRAMMAR_COMPILE_SERVER_SUPPORTED
+  std::string message;
+  std::optional<GrammarCompiler> compiler;
+  if (ReadFrame(connection, &message)) {
+    try {
+      compiler = GetCompiler(message);
+    } catch (const std::exception& e) {
+      XGRAMMAR_LOG(WARNING) << "Rejected a client with an invalid tokenizer info: " << e.what();
+    }
+  }
+  if (compiler.has_value() && WriteFrame(connection, "")) {
+    while (ReadFrame(connection, &message)) {
+      std::string response;
+      try {
+        response = "0" + CompileCacheManifestEntry(compiler.value(), message).SerializeJSON();
+      } catch (const std::exception& e) {
+        response = std::string("1") + e.what();
+      }
+      if (!WriteFrame(connection, response)) break;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  connections_.erase(connection);
+  ::close(connection);
+  connection_closed_.notify_all();
+#endif
+}
+
+GrammarCompiler CompileServer::Impl::GetCompiler(const std::string& tokenizer_info_json) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = compilers_.find(tokenizer_info_json);
+  if (it != compilers_.end()) return it->second;
+  auto tokenizer_info = TokenizerInfo::DeserializeJSON(tokenizer_info_json);
+  if (std::holds_alternative<SerializationError>(tokenizer_info)) {
+    ThrowVariantError(std::get<SerializationError>(tokenizer_info));
+  }
+  GrammarCompiler compiler(
+      std::get<TokenizerInfo>(tokenizer_info), max_threads_, true, max_memory_bytes_
+  );
+  compilers_.emplace(tokenizer_info_json, compiler);
+  return compiler;
+}
+
+/******************* CompileServer *******************/
+
+CompileServer::CompileServer(
+    const std::string& socket_path, int max_threads, int64_t max_memory_bytes
+)
+    : pimpl_(std::make_shared<Impl>(socket_path, max_threads, max_memory_bytes)) {}
+
+void CompileServer::Serve() { pimpl_->Serve(); }
+
+void CompileServer::Shutdown() { pimpl_->Shutdown(); }
+
+}  // namespace xgrammar
@@ -0,0 +1,113 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/compile_server.h
+ * \brief The compile server sharing the grammar compilation of the processes of a host, and its
+ * client used by GrammarCompiler.
+ */
+
+#ifndef XGRAMMAR_COMPILE_SERVER_H_
+#define XGRAMMAR_COMPILE_SERVER_H_
+
+#include <xgrammar/compiler.h>
+#include <xgrammar/tokenizer_info.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace xgrammar {
+
+/*!
+ * \brief Compile an entry of a cache manifest with the compiler. See GrammarCompiler::Prewarm for
+ * the format of the entries. Used by the compile server to compile the requests of its clients.
+ * \throws SerializationError if the entry is invalid.
+ */
+CompiledGrammar CompileCacheManifestEntry(GrammarCompiler compiler, const std::string& entry_json);
+
+/*!
+ * \brief The client of a CompileServer. The connections are kept for the later compilations, and
+ * a new connection is opened when all of them are in use, so it can be used by multiple threads.
+ *
+ * The messages are frames of a 64-bit length followed by the bytes. A connection starts with the
+ * serialized tokenizer info sent by the client, answered by an empty frame. Then every request
+ * is a cache manifest entry, and the response is "0" followed by the serialized compiled grammar,
+ * or "1" followed by the error message.
+ *
+ * Every send and receive times out after timeout_ms, so a hung server only delays the compilation,
+ * which then falls back to this process.
+ */
+class CompileServerClient {
+ public:
+  CompileServerClient(std::string socket_path, TokenizerInfo tokenizer_info, int64_t timeout_ms);
+  ~CompileServerClient();
+
+  CompileServerClient(const CompileServerClient&) = delete;
+  CompileServerClient& operator=(const CompileServerClient&) = delete;
+
+  /*!
+   * \brief Compile an entry of a cache manifest on the server.
+   * \return The compiled grammar, or std::nullopt if the server is unavailable or fails to compile
+   * it.
+   */
+  std::optional<CompiledGrammar> Compile(const std::string& entry_json);
+
+ private:
+  /*! \brief Open a connection and send the tokenizer info. Return -1 on failure. */
+  int Connect();
+
+  /*! \brief Log the failure when the server becomes unavailable. */
+  void ReportFailure(const std::string& message);
+
+  const std::string socket_path_;
+  const TokenizerInfo tokenizer_info_;
+  const std::string tokenizer_info_json_;
+  /*! \brief The timeout of every send and receive on the connections. 0 means no timeout. */
+  const int64_t timeout_ms_;
+  /*! \brief Protects idle_connections_ and is_available_. */
+  std::mutex mutex_;
+  /*! \brief The open connections not used by any compilation. */
+  std::vector<int> idle_connections_;
+  /*! \brief Whether the last request succeeded, so only the first failure is logged. */
+  bool is_available_ = true;
+};
+
+class CompileServer::Impl {
+ public:
+  Impl(const std::string& socket_path, int max_threads, int64_t max_memory_bytes);
+  ~Impl();
+
+  void Serve();
+
+  void Shutdown();
+
+ private:
+  /*! \brief Serve the requests of a connection until it is closed. */
+  void HandleConnection(int connection);
+
+  /*! \brief Get the compiler of the tokenizer, or construct it for the first client. */
+  GrammarCompiler GetCompiler(const std::string& tokenizer_info_json);
+
+  const std::string socket_path_;
+  const int max_threads_;
+  const int64_t max_memory_bytes_;
+  int listen_fd_ = -1;
+  std::atomic<bool> is_shutdown_{false};
+  /*! \brief Protects the members below. */
+  std::mutex mutex_;
+  /*! \brief Notified when a connection is closed. */
+  std::condition_variable connection_closed_;
+  /*! \brief The compilers of the tokenizers, keyed by the serialized tokenizer info. */
+  std::unordered_map<std::string, GrammarCompiler> compilers_;
+  /*! \brief The open connections, each served by a detached thread. */
+  std::unordered_set<int> connections_;
+};
+
+}  // namespace xgrammar
+
+#endif  // XGRAMMAR_COMPILE_SERVER_H_
@@ -5,8 +5,19 @@
 
 #include <xgrammar/compiler.h>
 
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "compiled_grammar_impl.h"
+#include "grammar_functor.h"
 #include "support/json_serializer.h"
+#include "support/logging.h"
+#include "support/utils.h"
 #include "testing.h"
 #include "tokenizer_info_impl.h"
 #include "xgrammar/exception.h"
@@ -20,7 +31,8 @@ AdaptiveTokenMask::AdaptiveTokenMask(
     const std::vector<std::pair<int32_t, std::string>>& sorted_decoded_vocab,
     const std::vector<int32_t>& accepted_indices,
     const std::vector<int32_t>& rejected_indices,
-    const std::vector<int32_t>& uncertain_indices
+    const std::vector<int32_t>& uncertain_indices,
+    const std::vector<uint32_t>& uncertain_boundary_masks
 ) {
   auto size_acc = accepted_indices.size();
   auto size_rej = rejected_indices.size();
@@ -42,13 +54,15 @@ AdaptiveTokenMask::AdaptiveTokenMask(
   }
 
   this->uncertain_indices = uncertain_indices;
+  this->uncertain_boundary_masks = uncertain_boundary_masks;
 }
 
 AdaptiveTokenMask::AdaptiveTokenMask(
     size_t vocab_size,
     const std::vector<std::pair<int32_t, std::string>>& sorted_decoded_vocab,
     const std::vector<int32_t>& accepted_indices,
-    const std::vector<int32_t>& uncertain_indices
+    const std::vector<int32_t>& uncertain_indices,
+    const std::vector<uint32_t>& uncertain_boundary_masks
 ) {
   auto size_acc = accepted_indices.size();
 
@@ -64,6 +78,7 @@ AdaptiveTokenMask::AdaptiveTokenMask(
     this->accepted_indices = accepted_indices;
   }
   this->uncertain_indices = uncertain_indices;
+  this->uncertain_boundary_masks = uncertain_boundary_masks;
 }
 
 std::string AdaptiveTokenMask::Print(const TokenizerInfo& tokenizer_info) const {
@@ -168,7 +183,7 @@ picojson::value SerializeJSONValue(const CompiledGrammar::Impl& impl) {
   auto result = picojson::object{};
   result["grammar"] = AutoSerializeJSONValue(impl.grammar);
   result["tokenizer_metadata"] = impl.tokenizer_info->DumpMetadataValue();
-  result["adaptive_token_mask_cache"] = AutoSerializeJSONValue(impl.adaptive_token_mask_cache);
+  result["adaptive_token_mask_cache"] = AutoSerializeJSONValue(impl.GetAdaptiveTokenMaskCache());
   return picojson::value(result);
 }
 
@@ -185,7 +200,9 @@ std::optional<SerializationError> DeserializeJSONValue(
   if (object.find("grammar") == object.end()) {
     return ConstructDeserializeError("Expect a 'grammar' field", type_name);
   }
-  AutoDeserializeJSONValue(&(impl->grammar), object["grammar"], type_name);
+  if (auto error = AutoDeserializeJSONValue(&(impl->grammar), object["grammar"], type_name)) {
+    return error;
+  }
   if (object.find("tokenizer_metadata") == object.end()) {
     return ConstructDeserializeError("Expect a 'tokenizer_metadata' field", type_name);
   }
@@ -199,14 +216,215 @@ std::optional<SerializationError> DeserializeJSONValue(
   if (object.find("adaptive_token_mask_cache") == object.end()) {
     return ConstructDeserializeError("Expect a 'adaptive_token_mask_cache' field", type_name);
   }
-  AutoDeserializeJSONValue(&(impl->adaptive_token_mask_cache), object["adaptive_token_mask_cache"]);
+  if (auto error = AutoDeserializeJSONValue(
+          &(impl->adaptive_token_mask_cache), object["adaptive_token_mask_cache"], type_name
+      )) {
+    return error;
+  }
+  auto first_follow_bytes = FirstFollowBytesAnalyzer::Apply(impl->grammar);
+  impl->rule_first_bytes = std::move(first_follow_bytes.first_bytes);
+  impl->rule_follow_bytes = std::move(first_follow_bytes.follow_bytes);
   return std::nullopt;
 }
 
+namespace {
+
+/*! \brief Decode a serialized mask of a deserialized grammar. */
+void DecodeAdaptiveTokenMask(
+    const std::string& serialized_json,
+    CompiledGrammar::Impl::SerializedAdaptiveTokenMask* serialized_mask,
+    AdaptiveTokenMask* mask
+) {
+  std::call_once(serialized_mask->decoded, [&] {
+    // The syntax and the structure of the mask are checked when the grammar is deserialized, so
+    // the checks below are internal invariants.
+    picojson::value json_value;
+    std::string error;
+    picojson::parse(
+        json_value,
+        serialized_json.begin() + serialized_mask->begin,
+        serialized_json.begin() + serialized_mask->end,
+        &error
+    );
+    XGRAMMAR_CHECK(error.empty()) << "Failed to parse the adaptive token mask: " << error;
+    if (auto error = AutoDeserializeJSONValue(mask, json_value, "AdaptiveTokenMask")) {
+      XGRAMMAR_LOG(FATAL) << "Failed to decode the adaptive token mask: "
+                          << GetMessageFromVariantError(error.value());
+    }
+  });
+}
+
+}  // namespace
+
+const AdaptiveTokenMask* CompiledGrammar::Impl::GetAdaptiveTokenMask(const ParserState& state
+) const {
+  if (mask_owner != nullptr) return mask_owner->GetAdaptiveTokenMask(state);
+  auto it = adaptive_token_mask_cache.find(state);
+  if (it == adaptive_token_mask_cache.end()) return nullptr;
+  if (serialized_json != nullptr) {
+    auto serialized_it = serialized_adaptive_token_masks.find(state);
+    if (serialized_it != serialized_adaptive_token_masks.end()) {
+      DecodeAdaptiveTokenMask(*serialized_json, serialized_it->second.get(), &it->second);
+    }
+  }
+  return &it->second;
+}
+
+void CompiledGrammar::Impl::DecodeAllAdaptiveTokenMasks() const {
+  if (mask_owner != nullptr) return mask_owner->DecodeAllAdaptiveTokenMasks();
+  if (serialized_json == nullptr) return;
+  for (const auto& [state, serialized_mask] : serialized_adaptive_token_masks) {
+    DecodeAdaptiveTokenMask(
+        *serialized_json, serialized_mask.get(), &adaptive_token_mask_cache.at(state)
+    );
+  }
+}
+
+const std::unordered_map<ParserState, AdaptiveTokenMask, StateHashForCache>&
+CompiledGrammar::Impl::GetAdaptiveTokenMaskCache() const {
+  if (mask_owner != nullptr) return mask_owner->GetAdaptiveTokenMaskCache();
+  DecodeAllAdaptiveTokenMasks();
+  return adaptive_token_mask_cache;
+}
+
+CompiledGrammar CompiledGrammar::Impl::WithTokenizerInfo(const TokenizerInfo& tokenizer_info
+) const {
+  auto result = std::make_shared<Impl>();
+  result->grammar = grammar;
+  result->tokenizer_info = tokenizer_info;
+  result->rule_first_bytes = rule_first_bytes;
+  result->rule_follow_bytes = rule_follow_bytes;
+  result->mask_owner = mask_owner != nullptr ? mask_owner : shared_from_this();
+  result->mask_owner->num_mask_sharers.fetch_add(1);
+  return CompiledGrammar(std::move(result));
+}
+
+CompiledGrammar::Impl::~Impl() {
+  if (mask_owner == nullptr) return;
+  mask_owner->num_mask_sharers.fetch_sub(1);
+  const Impl* counter = this;
+  mask_owner->shared_mask_counter.compare_exchange_strong(counter, nullptr);
+}
+
+std::optional<CompiledGrammar> CompiledGrammar::Impl::Compact() const {
+  XGRAMMAR_DCHECK(!IsCompacted());
+  // The compacted copy would copy the masks shared with the owner, or decode the masks left
+  // serialized, and take more memory than it saves.
+  if (mask_owner != nullptr || serialized_json != nullptr) return std::nullopt;
+  const auto& sorted_decoded_vocab = tokenizer_info.GetSortedDecodedVocab();
+  auto result = std::make_shared<Impl>();
+  result->grammar = grammar;
+  result->tokenizer_info = tokenizer_info;
+  result->adaptive_token_mask_cache = GetAdaptiveTokenMaskCache();
+  result->rule_first_bytes = rule_first_bytes;
+  result->rule_follow_bytes = rule_follow_bytes;
+
+  for (auto& [state, mask] : result->adaptive_token_mask_cache) {
+    if (mask.store_type != AdaptiveTokenMask::StoreType::kAcceptedBitset) continue;
+    std::vector<std::pair<int32_t, int32_t>> ranges;
+    for (int32_t i = 0; i < static_cast<int32_t>(sorted_decoded_vocab.size()); ++i) {
+      if (!mask.accepted_bitset[sorted_decoded_vocab[i].first]) continue;
+      if (!ranges.empty() && ranges.back().second == i) {
+        ++ranges.back().second;
+      } else {
+        ranges.emplace_back(i, i + 1);
+      }
+    }
+    // Tokens sharing a prefix are adjacent in the sorted vocabulary, so the accepted tokens usually
+    // form a few long ranges. Keep the bitset if it is still smaller.
+    if (MemorySize(ranges) >= MemorySize(mask.accepted_bitset)) continue;
+    mask.accepted_bitset = DynamicBitset();
+    result->compacted_accepted_ranges.emplace(state, std::move(ranges));
+  }
+
+  if (!result->IsCompacted()) return std::nullopt;
+  CopyInitialMatcherStateTo(result.get());
+  return CompiledGrammar(std::move(result));
+}
+
+CompiledGrammar CompiledGrammar::Impl::Restore() const {
+  XGRAMMAR_DCHECK(IsCompacted());
+  const auto& sorted_decoded_vocab = tokenizer_info.GetSortedDecodedVocab();
+  auto result = std::make_shared<Impl>();
+  result->grammar = grammar;
+  result->tokenizer_info = tokenizer_info;
+  result->adaptive_token_mask_cache = adaptive_token_mask_cache;
+  result->rule_first_bytes = rule_first_bytes;
+  result->rule_follow_bytes = rule_follow_bytes;
+
+  for (const auto& [state, ranges] : compacted_accepted_ranges) {
+    auto& mask = result->adaptive_token_mask_cache.at(state);
+    mask.accepted_bitset = DynamicBitset(tokenizer_info.GetVocabSize());
+    for (const auto& [begin, end] : ranges) {
+      for (int32_t i = begin; i < end; ++i) {
+        mask.accepted_bitset.Set(sorted_decoded_vocab[i].first, true);
+      }
+    }
+  }
+  CopyInitialMatcherStateTo(result.get());
+  return CompiledGrammar(std::move(result));
+}
+
+void CompiledGrammar::Impl::CopyInitialMatcherStateTo(Impl* result) const {
+  auto initial_matcher_state = std::atomic_load(&initial_matcher_state_);
+  if (initial_matcher_state == nullptr) return;
+  std::call_once(result->initial_matcher_state_computed_, [&] {
+    std::atomic_store(&result->initial_matcher_state_, std::move(initial_matcher_state));
+  });
+}
+
 /************** CompiledGrammar **************/
 
+namespace {
+
+/*! \brief The memory of the masks owned by the compiled grammar, decoded or serialized. */
+std::size_t OwnedMaskMemorySize(const CompiledGrammar::Impl& impl) {
+  // The masks not decoded yet are counted as empty ones, and their serialized form is counted.
+  std::size_t serialized_size = 0;
+  if (impl.serialized_json != nullptr) {
+    using SerializedAdaptiveTokenMask = CompiledGrammar::Impl::SerializedAdaptiveTokenMask;
+    serialized_size = impl.serialized_json->size() +
+                      impl.serialized_adaptive_token_masks.size() *
+                          (sizeof(ParserState) + sizeof(SerializedAdaptiveTokenMask));
+  }
+  return MemorySize(impl.adaptive_token_mask_cache) + MemorySize(impl.compacted_accepted_ranges) +
+         serialized_size;
+}
+
+/*!
+ * \brief Whether the sharer counts the masks of its mask_owner. The owner counts its masks while
+ * anything but its sharers holds it, e.g. the cache of its compiler. After that, the first sharer
+ * sized counts them, so they are counted once, and still counted after the owner is evicted or its
+ * compiler is destroyed.
+ */
+bool CountsSharedMasks(const CompiledGrammar::Impl& sharer) {
+  const auto& owner = *sharer.mask_owner;
+  const CompiledGrammar::Impl* counter = &sharer;
+  if (sharer.mask_owner.use_count() > owner.num_mask_sharers.load()) {
+    owner.shared_mask_counter.compare_exchange_strong(counter, nullptr);
+    return false;
+  }
+  counter = nullptr;
+  return owner.shared_mask_counter.compare_exchange_strong(counter, &sharer) || counter == &sharer;
+}
+
+}  // namespace
+
 std::size_t MemorySize(const CompiledGrammar::Impl& impl) {
-  return MemorySize(impl.grammar) + MemorySize(impl.adaptive_token_mask_cache);
+  std::size_t shared_mask_size = 0;
+  if (impl.mask_owner != nullptr && CountsSharedMasks(impl)) {
+    shared_mask_size = OwnedMaskMemorySize(*impl.mask_owner);
+  }
+  std::size_t initial_matcher_state_size = 0;
+  if (auto initial_matcher_state = std::atomic_load(&impl.initial_matcher_state_)) {
+    const auto& parser_snapshot = initial_matcher_state->parser_snapshot;
+    initial_matcher_state_size = MemorySize(parser_snapshot.completable_states) +
+                                 MemorySize(parser_snapshot.scanable_states) +
+                                 MemorySize(initial_matcher_state->token_bitmask);
+  }
+  return MemorySize(impl.grammar) + MemorySize(impl.rule_first_bytes) +
+         MemorySize(impl.rule_follow_bytes) + OwnedMaskMemorySize(impl) + shared_mask_size +
+         initial_matcher_state_size;
 }
 
 std::size_t CompiledGrammar::MemorySizeBytes() const { return MemorySize(*pimpl_); }
@@ -218,13 +436,329 @@ TokenizerInfo CompiledGrammar::GetTokenizerInfo() const { return pimpl_->GetToke
 /*! \brief Return the serialized JSON string of the compiled grammar. */
 std::string CompiledGrammar::SerializeJSON() const { return AutoSerializeJSON(*this, true); }
 
-/*! \brief Deserialize a compiled grammar from a JSON string and tokenizer info. */
+namespace {
+
+/*!
+ * \brief The location of a serialized adaptive token mask found when parsing the JSON, and the
+ * first problem found in its structure, if any.
+ */
+struct SerializedAdaptiveTokenMaskEntry {
+  picojson::value state;
+  std::size_t begin = 0;
+  std::size_t end = 0;
+  std::string error;
+
+  void SetError(const std::string& message) {
+    if (error.empty()) error = message;
+  }
+};
+
+using JSONIterator = std::string::const_iterator;
+
+/*! \brief Parses an integer, and checks that it is in [min_value, max_value]. */
+class IntegerCheckContext : public picojson::deny_parse_context {
+ public:
+  IntegerCheckContext(
+      SerializedAdaptiveTokenMaskEntry* entry,
+      const std::string& name,
+      int64_t min_value,
+      int64_t max_value,
+      int64_t* value
+  )
+      : entry_(entry), name_(name), min_value_(min_value), max_value_(max_value), value_(value) {}
+
+  bool set_int64(int64_t value) {
+    if (value < min_value_ || value > max_value_) {
+      entry_->SetError(
+          name_ + " should be in [" + std::to_string(min_value_) + ", " +
+          std::to_string(max_value_) + "], but got " + std::to_string(value)
+      );
+    }
+    *value_ = value;
+    return true;
+  }
+
+ private:
+  SerializedAdaptiveTokenMaskEntry* entry_;
+  const std::string& name_;
+  int64_t min_value_;
+  int64_t max_value_;
+  int64_t* value_;
+};
+
+/*!
+ * \brief Parses an array of integers, and checks that they are in [min_value, max_value]. Keeps
+ * the first two integers for the header of a DynamicBitset.
+ */
+class IntegerArrayCheckContext : public picojson::deny_parse_context {
+ public:
+  IntegerArrayCheckContext(
+      SerializedAdaptiveTokenMaskEntry* entry,
+      const std::string& name,
+      int64_t min_value,
+      int64_t max_value
+  )
+      : entry_(entry), name_(name), min_value_(min_value), max_value_(max_value) {}
+
+  bool parse_array_start() { return true; }
+
+  bool parse_array_item(picojson::input<JSONIterator>& in, size_t idx) {
+    int64_t value = 0;
+    IntegerCheckContext ctx(entry_, name_, min_value_, max_value_, &value);
+    if (!picojson::_parse(ctx, in)) return false;
+    if (idx < 2) header_[idx] = value;
+    return true;
+  }
+
+  bool parse_array_stop(size_t size) {
+    size_ = size;
+    return true;
+  }
+
+  std::size_t Size() const { return size_; }
+  int64_t Header(int idx) const { return header_[idx]; }
+
+ private:
+  SerializedAdaptiveTokenMaskEntry* entry_;
+  const std::string& name_;
+  int64_t min_value_;
+  int64_t max_value_;
+  std::size_t size_ = 0;
+  int64_t header_[2] = {-1, -1};
+};
+
+/*!
+ * \brief Parses a serialized AdaptiveTokenMask without building it, and checks the structure the
+ * matcher relies on: the member types, the token indices against the tokenizer, the accepted
+ * bitset against the vocabulary size, and one boundary mask per uncertain token. Problems are
+ * recorded in the entry, so they are reported by DeserializeJSON instead of the first lookup.
+ */
+class AdaptiveTokenMaskCheckContext : public picojson::deny_parse_context {
+ public:
+  AdaptiveTokenMaskCheckContext(
+      SerializedAdaptiveTokenMaskEntry* entry, int32_t vocab_size, int32_t sorted_vocab_size
+  )
+      : entry_(entry), vocab_size_(vocab_size), sorted_vocab_size_(sorted_vocab_size) {}
+
+  bool parse_object_start() { return true; }
+
+  bool parse_object_item(picojson::input<JSONIterator>& in, const std::string& key) {
+    bool parsed = true;
+    if (key == "store_type") {
+      IntegerCheckContext ctx(
+          entry_,
+          key,
+          static_cast<int64_t>(AdaptiveTokenMask::StoreType::kAccepted),
+          static_cast<int64_t>(AdaptiveTokenMask::StoreType::kAcceptedBitset),
+          &store_type_
+      );
+      parsed = picojson::_parse(ctx, in);
+    } else if (key == "accepted_indices" || key == "rejected_indices" ||
+               key == "uncertain_indices") {
+      IntegerArrayCheckContext ctx(entry_, key, 0, sorted_vocab_size_ - 1);
+      parsed = picojson::_parse(ctx, in);
+      if (key == "uncertain_indices") num_uncertain_indices_ = ctx.Size();
+    } else if (key == "uncertain_boundary_masks") {
+      IntegerArrayCheckContext ctx(entry_, key, 0, std::numeric_limits<uint32_t>::max());
+      parsed = picojson::_parse(ctx, in);
+      num_uncertain_boundary_masks_ = ctx.Size();
+    } else if (key == "accepted_bitset") {
+      IntegerArrayCheckContext ctx(entry_, key, 0, std::numeric_limits<uint32_t>::max());
+      parsed = picojson::_parse(ctx, in);
+      bitset_num_elements_ = ctx.Size();
+      bitset_size_ = ctx.Header(0);
+      bitset_buffer_size_ = ctx.Header(1);
+    } else {
+      // Unknown members are ignored by the deserializer.
+      picojson::null_parse_context ctx;
+      parsed = picojson::_parse(ctx, in);
+    }
+    if (!parsed) {
+      entry_->SetError("Invalid member " + key);
+    }
+    members_.insert(key);
+    return parsed;
+  }
+
+  /*! \brief Check the relations between the members after the mask is parsed. */
+  void Finish() {
+    for (const char* name :
+         {"store_type",
+          "accepted_indices",
+          "rejected_indices",
+          "accepted_bitset",
+          "uncertain_indices",
+          "uncertain_boundary_masks"}) {
+      if (members_.count(name) == 0) {
+        entry_->SetError("Missing member " + std::string(name));
+        return;
+      }
+    }
+    if (num_uncertain_boundary_masks_ != num_uncertain_indices_) {
+      entry_->SetError(
+          "The number of uncertain_boundary_masks (" +
+          std::to_string(num_uncertain_boundary_masks_) + ") differs from uncertain_indices (" +
+          std::to_string(num_uncertain_indices_) + ")"
+      );
+    }
+    if (bitset_num_elements_ < 2 || bitset_size_ < 0 ||
+        bitset_size_ > std::numeric_limits<int32_t>::max() ||
+        bitset_buffer_size_ != DynamicBitset::GetBufferSize(static_cast<int>(bitset_size_)) ||
+        static_cast<int64_t>(bitset_num_elements_) != 2 + bitset_buffer_size_) {
+      entry_->SetError("Invalid accepted_bitset");
+    }
+    if (store_type_ == static_cast<int64_t>(AdaptiveTokenMask::StoreType::kAcceptedBitset) &&
+        bitset_size_ != vocab_size_) {
+      entry_->SetError(
+          "The size of accepted_bitset (" + std::to_string(bitset_size_) +
+          ") differs from the vocabulary size (" + std::to_string(vocab_size_) + ")"
+      );
+    }
+  }
+
+ private:
+  SerializedAdaptiveTokenMaskEntry* entry_;
+  int32_t vocab_size_;
+  int32_t sorted_vocab_size_;
+  std::unordered_set<std::string> members_;
+  int64_t store_type_ = -1;
+  std::size_t num_uncertain_indices_ = 0;
+  std::size_t num_uncertain_boundary_masks_ = 0;
+  std::size_t bitset_num_elements_ = 0;
+  int64_t bitset_size_ = -1;
+  int64_t bitset_buffer_size_ = -1;
+};
+
+/*!
+ * \brief Parses a [state, mask] entry of adaptive_token_mask_cache. The state is parsed, and the
+ * mask is only checked and located.
+ */
+class AdaptiveTokenMaskEntryParseContext : public picojson::deny_parse_context {
+ public:
+  AdaptiveTokenMaskEntryParseContext(
+      SerializedAdaptiveTokenMaskEntry* entry,
+      JSONIterator first,
+      int32_t vocab_size,
+      int32_t sorted_vocab_size
+  )
+      : entry_(entry), first_(first), vocab_size_(vocab_size), sorted_vocab_size_(sorted_vocab_size) {}
+
+  bool parse_array_start() { return true; }
+
+  bool parse_array_item(picojson::input<JSONIterator>& in, size_t idx) {
+    if (idx == 0) {
+      picojson::default_parse_context ctx(&entry_->state);
+      return picojson::_parse(ctx, in);
+    }
+    if (idx != 1) return false;
+    in.skip_ws();
+    entry_->begin = in.cur() - first_;
+    AdaptiveTokenMaskCheckContext ctx(entry_, vocab_size_, sorted_vocab_size_);
+    if (!picojson::_parse(ctx, in)) {
+      entry_->SetError("Expect an object");
+      return false;
+    }
+    ctx.Finish();
+    entry_->end = in.cur() - first_;
+    return true;
+  }
+
+  bool parse_array_stop(size_t size) { return size == 2; }
+
+ private:
+  SerializedAdaptiveTokenMaskEntry* entry_;
+  JSONIterator first_;
+  int32_t vocab_size_;
+  int32_t sorted_vocab_size_;
+};
+
+/*! \brief Parses the adaptive_token_mask_cache array into the locations of the masks. */
+class AdaptiveTokenMaskCacheParseContext : public picojson::deny_parse_context {
+ public:
+  AdaptiveTokenMaskCacheParseContext(
+      std::vector<SerializedAdaptiveTokenMaskEntry>* entries,
+      JSONIterator first,
+      const TokenizerInfo& tokenizer_info
+  )
+      : entries_(entries), first_(first), tokenizer_info_(tokenizer_info) {}
+
+  bool parse_array_start() { return true; }
+
+  bool parse_array_item(picojson::input<JSONIterator>& in, size_t) {
+    entries_->emplace_back();
+    AdaptiveTokenMaskEntryParseContext ctx(
+        &entries_->back(),
+        first_,
+        tokenizer_info_.GetVocabSize(),
+        static_cast<int32_t>(tokenizer_info_.GetSortedDecodedVocab().size())
+    );
+    return picojson::_parse(ctx, in);
+  }
+
+  bool parse_array_stop(size_t) { return true; }
+
+ private:
+  std::vector<SerializedAdaptiveTokenMaskEntry>* entries_;
+  JSONIterator first_;
+  const TokenizerInfo& tokenizer_info_;
+};
+
+/*!
+ * \brief Parses the serialized compiled grammar like picojson::default_parse_context, except the
+ * masks in adaptive_token_mask_cache are left serialized. The field is parsed as an empty array.
+ */
+class CompiledGrammarParseContext : public picojson::default_parse_context {
+ public:
+  CompiledGrammarParseContext(
+      picojson::value* out,
+      std::vector<SerializedAdaptiveTokenMaskEntry>* entries,
+      JSONIterator first,
+      const TokenizerInfo& tokenizer_info
+  )
+      : picojson::default_parse_context(out),
+        entries_(entries),
+        first_(first),
+        tokenizer_info_(tokenizer_info) {}
+
+  bool parse_object_item(picojson::input<JSONIterator>& in, const std::string& key) {
+    if (key != "adaptive_token_mask_cache") {
+      return picojson::default_parse_context::parse_object_item(in, key);
+    }
+    out_->get<picojson::object>()[key] = picojson::value(picojson::array_type, false);
+    AdaptiveTokenMaskCacheParseContext ctx(entries_, first_, tokenizer_info_);
+    return picojson::_parse(ctx, in);
+  }
+
+ private:
+  std::vector<SerializedAdaptiveTokenMaskEntry>* entries_;
+  JSONIterator first_;
+  const TokenizerInfo& tokenizer_info_;
+};
+
+}  // namespace
+
+/*!
+ * \brief Deserialize a compiled grammar from a JSON string and tokenizer info. The adaptive token
+ * masks are only checked and located, and decoded on their first lookup. See
+ * CompiledGrammar::Impl::GetAdaptiveTokenMask.
+ */
 std::variant<CompiledGrammar, SerializationError> CompiledGrammar::DeserializeJSON(
     const std::string& json_string, const TokenizerInfo& tokenizer_info
 ) {
+  auto serialized_json = std::make_shared<const std::string>(json_string);
   picojson::value json_value;
-  if (auto error = picojson::parse(json_value, json_string); !error.empty()) {
-    return InvalidJSONError("Failed to parse JSON: " + error);
+  std::vector<SerializedAdaptiveTokenMaskEntry> entries;
+  CompiledGrammarParseContext ctx(
+      &json_value, &entries, serialized_json->begin(), tokenizer_info
+  );
+  std::string parse_error;
+  picojson::_parse(ctx, serialized_json->begin(), serialized_json->end(), &parse_error);
+  if (!parse_error.empty()) {
+    // A mask of a wrong shape stops the parsing.
+    if (!entries.empty() && !entries.back().error.empty()) {
+      return ConstructDeserializeError(entries.back().error, "AdaptiveTokenMask");
+    }
+    return InvalidJSONError("Failed to parse JSON: " + parse_error);
   }
   if (!json_value.is<picojson::object>()) {
     return DeserializeFormatError("Expect an object");
@@ -237,6 +771,27 @@ std::variant<CompiledGrammar, SerializationError> CompiledGrammar::DeserializeJS
   if (auto error = DeserializeJSONValue(impl.get(), json_value, tokenizer_info)) {
     return error.value();
   }
+
+  impl->adaptive_token_mask_cache.reserve(entries.size());
+  impl->serialized_adaptive_token_masks.reserve(entries.size());
+  for (auto& entry : entries) {
+    // The masks are checked against the tokenizer after its metadata is checked.
+    if (!entry.error.empty()) {
+      return ConstructDeserializeError(entry.error, "AdaptiveTokenMask");
+    }
+    ParserState state;
+    if (auto error = AutoDeserializeJSONValue(&state, entry.state, "CompiledGrammar")) {
+      return error.value();
+    }
+    impl->adaptive_token_mask_cache.try_emplace(state);
+    auto serialized_mask = std::make_unique<Impl::SerializedAdaptiveTokenMask>();
+    serialized_mask->begin = entry.begin;
+    serialized_mask->end = entry.end;
+    impl->serialized_adaptive_token_masks.try_emplace(state, std::move(serialized_mask));
+  }
+  if (!entries.empty()) {
+    impl->serialized_json = std::move(serialized_json);
+  }
   return CompiledGrammar(std::move(impl));
 }
 
@@ -8,8 +8,13 @@
 
 #include <xgrammar/grammar.h>
 
+#include <atomic>
+#include <bitset>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -59,6 +64,14 @@ struct AdaptiveTokenMask {
 
   std::vector<int32_t> uncertain_indices;
 
+  /*!
+   * \brief The positions where the rule can end inside each uncertain token, parallel to
+   * uncertain_indices. Bit k is set if the rule can end after the first k bytes of the token, so
+   * the token can only be accepted if its k-th byte can follow the rule. 0 means the positions are
+   * unknown (e.g. beyond 31 bytes), and the token is always checked by the parser.
+   */
+  std::vector<uint32_t> uncertain_boundary_masks;
+
   /*! \brief Default constructor. Only for deserialization. */
   AdaptiveTokenMask() = default;
 
@@ -67,21 +80,24 @@ struct AdaptiveTokenMask {
       const std::vector<std::pair<int32_t, std::string>>& sorted_decoded_vocab,
       const std::vector<int32_t>& accepted_indices,
       const std::vector<int32_t>& rejected_indices,
-      const std::vector<int32_t>& uncertain_indices
+      const std::vector<int32_t>& uncertain_indices,
+      const std::vector<uint32_t>& uncertain_boundary_masks
   );
 
   AdaptiveTokenMask(
       size_t vocab_size,
       const std::vector<std::pair<int32_t, std::string>>& sorted_decoded_vocab,
       const std::vector<int32_t>& accepted_indices,
-      const std::vector<int32_t>& uncertain_indices
+      const std::vector<int32_t>& uncertain_indices,
+      const std::vector<uint32_t>& uncertain_boundary_masks
   );
 
   std::string Print(const TokenizerInfo& tokenizer_info) const;
 
   friend std::size_t MemorySize(const AdaptiveTokenMask& mask) {
-    return MemorySize(mask.uncertain_indices) + MemorySize(mask.accepted_indices) +
-           MemorySize(mask.rejected_indices) + MemorySize(mask.accepted_bitset);
+    return MemorySize(mask.uncertain_indices) + MemorySize(mask.uncertain_boundary_masks) +
+           MemorySize(mask.accepted_indices) + MemorySize(mask.rejected_indices) +
+           MemorySize(mask.accepted_bitset);
   }
 };
 
@@ -96,15 +112,49 @@ XGRAMMAR_MEMBER_TABLE(
     "accepted_bitset",
     &AdaptiveTokenMask::accepted_bitset,
     "uncertain_indices",
-    &AdaptiveTokenMask::uncertain_indices
+    &AdaptiveTokenMask::uncertain_indices,
+    "uncertain_boundary_masks",
+    &AdaptiveTokenMask::uncertain_boundary_masks
 );
 
+/*!
+ * \brief Get the first bytes of the tokens that can be accepted from the given state. The tokens
+ * starting with the other bytes are rejected without matching them.
+ */
+std::bitset<256> GetFirstCharacterMask(const Grammar& grammar, const ParserState& state);
+
+/*!
+ * \brief The tokenizer-independent stage of the compilation. See PreparedGrammar.
+ */
+class PreparedGrammar::Impl {
+ public:
+  /*! \brief The optimized grammar. */
+  Grammar grammar{NullObj{}};
+
+  /*! \brief The bytes that can start each rule of the grammar. */
+  std::vector<std::bitset<256>> rule_first_bytes;
+
+  /*! \brief The bytes that can follow each rule of the grammar. */
+  std::vector<std::bitset<256>> rule_follow_bytes;
+
+  /*!
+   * \brief The parser states whose token masks are computed, and whether they are in the root
+   * rule.
+   */
+  std::vector<std::pair<ParserState, bool>> token_mask_states;
+
+  friend std::size_t MemorySize(const Impl& impl) {
+    return MemorySize(impl.grammar) + MemorySize(impl.rule_first_bytes) +
+           MemorySize(impl.rule_follow_bytes) + MemorySize(impl.token_mask_states);
+  }
+};
+
 /*!
  * \brief All information that we need to match tokens in the tokenizer to the specified grammar.
  * It is the result of preprocessing.
  * \sa xgrammar::GrammarMatcher
  */
-class CompiledGrammar::Impl {
+class CompiledGrammar::Impl : public std::enable_shared_from_this<CompiledGrammar::Impl> {
  public:
   /*! \brief The grammar for the GrammarMatcher. */
   Grammar grammar{NullObj{}};
@@ -115,8 +165,124 @@ class CompiledGrammar::Impl {
   /*! \brief Default constructor. */
   Impl() = default;
 
-  /*! \brief Mapping from the parser state to the adaptive token mask. */
-  std::unordered_map<ParserState, AdaptiveTokenMask, StateHashForCache> adaptive_token_mask_cache;
+  ~Impl();
+
+  /*!
+   * \brief Mapping from the parser state to the adaptive token mask. The masks of a deserialized
+   * grammar are decoded on their first lookup, so they should be accessed by
+   * GetAdaptiveTokenMask(), or after DecodeAllAdaptiveTokenMasks(). Mutable for the lazy decoding.
+   */
+  mutable std::unordered_map<ParserState, AdaptiveTokenMask, StateHashForCache>
+      adaptive_token_mask_cache;
+
+  /*! \brief The location of a mask not decoded yet in serialized_json. */
+  struct SerializedAdaptiveTokenMask {
+    std::size_t begin;
+    std::size_t end;
+    std::once_flag decoded;
+  };
+
+  /*!
+   * \brief The serialized JSON the grammar is deserialized from, holding the masks not decoded
+   * yet. nullptr if all masks are decoded when the grammar is constructed.
+   */
+  std::shared_ptr<const std::string> serialized_json;
+
+  /*! \brief The serialized masks of the states. Empty if serialized_json is nullptr. */
+  std::unordered_map<
+      ParserState,
+      std::unique_ptr<SerializedAdaptiveTokenMask>,
+      StateHashForCache>
+      serialized_adaptive_token_masks;
+
+  /*!
+   * \brief The compiled grammar of another tokenizer with the same vocabulary, whose masks are used
+   * instead of adaptive_token_mask_cache. nullptr if the masks are owned. See WithTokenizerInfo().
+   */
+  std::shared_ptr<const Impl> mask_owner;
+
+  /*! \brief The number of the grammars whose mask_owner is this one. */
+  mutable std::atomic<int> num_mask_sharers{0};
+
+  /*!
+   * \brief The sharer counting the masks of this grammar in its MemorySize, once nothing but the
+   * sharers holds this grammar. nullptr if this grammar counts them itself.
+   */
+  mutable std::atomic<const Impl*> shared_mask_counter{nullptr};
+
+  /*!
+   * \brief Get the adaptive token mask of the state, and decode it if it is not decoded yet. It is
+   * thread-safe. Return nullptr if the state has no mask.
+   */
+  const AdaptiveTokenMask* GetAdaptiveTokenMask(const ParserState& state) const;
+
+  /*! \brief Decode all the masks not decoded yet. It is thread-safe. */
+  void DecodeAllAdaptiveTokenMasks() const;
+
+  /*! \brief Get all the adaptive token masks, decoded, including the ones of mask_owner. */
+  const std::unordered_map<ParserState, AdaptiveTokenMask, StateHashForCache>&
+  GetAdaptiveTokenMaskCache() const;
+
+  /*!
+   * \brief Return a compiled grammar of another tokenizer with the same vocabulary hash, sharing
+   * the grammar and the masks of this one. See TokenizerInfo::Impl::ComputeVocabHash.
+   */
+  CompiledGrammar WithTokenizerInfo(const TokenizerInfo& tokenizer_info) const;
+
+  /*!
+   * \brief The bytes that can start each rule of the grammar. Used to find the bytes that can
+   * follow the live states when filling the token mask. Not serialized, since it is derived from
+   * the grammar.
+   */
+  std::vector<std::bitset<256>> rule_first_bytes;
+
+  /*! \brief The bytes that can follow each rule of the grammar. Not serialized. */
+  std::vector<std::bitset<256>> rule_follow_bytes;
+
+  /*!
+   * \brief The accepted tokens of the kAcceptedBitset masks whose accepted_bitset is dropped by
+   * Compact(), as the sorted [begin, end) ranges of their indices in sorted_decoded_vocab. Only
+   * non-empty in a compacted grammar. Not serialized.
+   */
+  std::unordered_map<ParserState, std::vector<std::pair<int32_t, int32_t>>, StateHashForCache>
+      compacted_accepted_ranges;
+
+  /*!
+   * \brief Return a compacted copy of the compiled grammar, where the accepted bitsets are replaced
+   * with the ranges of the accepted indices if that takes less memory. It is used to keep cold
+   * grammars in the compiler cache under memory pressure, and cannot be used for matching before
+   * Restore(). Return std::nullopt if no bitset can be compacted, or the masks are shared with
+   * mask_owner or not decoded from serialized_json yet.
+   */
+  std::optional<CompiledGrammar> Compact() const;
+
+  /*! \brief Whether the compiled grammar is compacted by Compact(). */
+  bool IsCompacted() const { return !compacted_accepted_ranges.empty(); }
+
+  /*! \brief Return a copy of the compacted grammar with the accepted bitsets restored. */
+  CompiledGrammar Restore() const;
+
+  /*!
+   * \brief The state of a matcher right after construction, i.e. the expanded initial states of
+   * the parser and the first token bitmask. The matchers are constructed and reset from it, so the
+   * root rule is expanded and the first bitmask is computed once per compiled grammar.
+   */
+  struct InitialMatcherState {
+    EarleyParser::Snapshot parser_snapshot;
+    /*!
+     * \brief The first token bitmask with the stop tokens of the tokenizer. Empty if the vocabulary
+     * is empty.
+     */
+    std::vector<int32_t> token_bitmask;
+    bool is_token_bitmask_all_true = false;
+  };
+
+  /*!
+   * \brief Get the initial matcher state, and compute it if it is not computed yet. It is
+   * thread-safe. It is computed when the token masks are compiled, and on the first construction of
+   * a matcher for the deserialized grammars. Defined in grammar_matcher.cc.
+   */
+  const InitialMatcherState& GetInitialMatcherState() const;
 
   Grammar GetGrammar() const { return grammar; }
 
@@ -130,6 +296,14 @@ class CompiledGrammar::Impl {
       const TokenizerInfo& tokenizer_info
   );
   friend std::size_t MemorySize(const Impl& impl);
+
+ private:
+  /*! \brief Set the initial matcher state of a new compiled grammar copied from this one. */
+  void CopyInitialMatcherStateTo(Impl* result) const;
+
+  mutable std::once_flag initial_matcher_state_computed_;
+  /*! \brief Not serialized, since it is derived from the grammar and the tokenizer. */
+  mutable std::shared_ptr<const InitialMatcherState> initial_matcher_state_;
 };
 
 XGRAMMAR_MEMBER_TABLE(
@@ -39,17 +39,18 @@ void EarleyParser::PopLastStates(int32_t cnt) {
   scanable_state_history_.PopBack(cnt);
 }
 
-void EarleyParser::Complete(const ParserState& state, bool debug_print) {
+template <bool kDebugPrint>
+void EarleyParser::Complete(const ParserState& state) {
   // Check if a rule is completed.
   if (state.rule_start_pos == ParserState::kNoPrevInputPos) {
     // assert: if a root rule can achieve here, then it must be completed.
-    if (debug_print) {
+    if constexpr (kDebugPrint) {
       XGRAMMAR_LOG(INFO) << "The root rule is completed.";
     }
-    tmp_accept_stop_token_ = true;
+    workspace_->accept_stop_token = true;
     return;
   }
-  if (debug_print) {
+  if constexpr (kDebugPrint) {
     XGRAMMAR_LOG(INFO) << "The rule " << state.rule_id << ": "
                        << grammar_->GetRule(state.rule_id).name
                        << " is completed, trying to complete its parent states.";
@@ -109,13 +110,14 @@ void EarleyParser::Complete(const ParserState& state, bool debug_print) {
   }
 }
 
+template <bool kDebugPrint>
 std::pair</* scanable */ bool, /* completable */ bool> EarleyParser::Predict(
-    const ParserState& state, bool debug_print
+    const ParserState& state
 ) {
   // Check if the rule has a corresponding FSM.
   if (state.rule_id != -1 && grammar_->per_rule_fsms[state.rule_id].has_value()) {
     // Try to expand the fsm.
-    ExpandNextRuleRefElementOnFSM(state, debug_print);
+    ExpandNextRuleRefElementOnFSM<kDebugPrint>(state);
     const auto& fsm = grammar_->per_rule_fsms[state.rule_id].value();
     return std::make_pair(fsm.IsScanableState(state.element_id), fsm.IsEndState(state.element_id));
   }
@@ -131,7 +133,7 @@ std::pair</* scanable */ bool, /* completable */ bool> EarleyParser::Predict(
   const auto& element_expr = grammar_->GetGrammarExpr(grammar_expr[state.element_id]);
   switch (element_expr.type) {
     case GrammarExprType::kRuleRef: {
-      ExpandNextRuleRefElement(state, grammar_expr, &element_expr, debug_print);
+      ExpandNextRuleRefElement<kDebugPrint>(state, grammar_expr, &element_expr);
       return std::make_pair(false, false);
     }
     case GrammarExprType::kCharacterClassStar: {
@@ -148,7 +150,7 @@ std::pair</* scanable */ bool, /* completable */ bool> EarleyParser::Predict(
       // If the current repeat count is less than the max repeat count,
       // we can expand the next rule reference element.
       XGRAMMAR_DCHECK(state.repeat_count <= max_repeat_count);
-      ExpandNextRuleRefElement(state, grammar_expr, &element_expr, debug_print);
+      ExpandNextRuleRefElement<kDebugPrint>(state, grammar_expr, &element_expr);
       if (state.repeat_count >= min_repeat_count) {
         Enqueue(ParserState{
             state.rule_id, state.sequence_id, state.element_id + 1, state.rule_start_pos, 0
@@ -208,13 +210,10 @@ void EarleyParser::Scan(const ParserState& state, const uint8_t ch) {
   \note Thus, when initializing the Earley parser, we need to add the initial state
   to the history_states[0], and perform prediction and completion on the initial state.
 */
-bool EarleyParser::Advance(const uint8_t ch, bool debug_print) {
+template <bool kDebugPrint>
+bool EarleyParser::AdvanceImpl(const uint8_t ch) {
   // Initialize the containers.
-  XGRAMMAR_DCHECK(tmp_process_state_queue_.empty())
-      << "The tmp_process_state_queue_ should be empty before the scan.";
-  tmp_states_visited_in_queue_.Clear();
-  tmp_states_to_be_added_.clear();
-  tmp_accept_stop_token_ = false;
+  BindWorkspace();
   const auto& latest_states = scanable_state_history_[scanable_state_history_.size() - 1];
   // Scan all the scanable states.
   for (const auto& state : latest_states) {
@@ -222,30 +221,38 @@ bool EarleyParser::Advance(const uint8_t ch, bool debug_print) {
   }
 
   // Check if the character is accepted.
-  if (tmp_process_state_queue_.empty() && tmp_states_to_be_added_.empty()) {
+  if (workspace_->process_state_queue.empty() && workspace_->states_to_be_added.empty()) {
     return false;
   }
 
   // execute Predict and Complete for all states in the queue until empty.
   rule_id_to_completable_states_.PushBack(std::vector<std::pair<int32_t, ParserState>>());
-  while (!tmp_process_state_queue_.empty()) {
-    const auto state = std::move(tmp_process_state_queue_.front());
-    tmp_process_state_queue_.pop();
-    auto [scanable, completable] = Predict(state, debug_print);
+  ParserState state;
+  while (workspace_->PopProcessState(&state)) {
+    auto [scanable, completable] = Predict<kDebugPrint>(state);
     if (completable) {
-      Complete(state, debug_print);
+      Complete<kDebugPrint>(state);
     }
     if (scanable) {
-      tmp_states_to_be_added_.push_back(state);
+      workspace_->states_to_be_added.push_back(state);
     }
   }
 
   // Check if the grammar is completed, and add the scannable states to the history.
-  is_completed_.push_back(tmp_accept_stop_token_);
-  scanable_state_history_.PushBack(tmp_states_to_be_added_);
+  is_completed_.push_back(workspace_->accept_stop_token);
+  scanable_state_history_.PushBack(workspace_->states_to_be_added);
   return true;
 }
 
+bool EarleyParser::Advance(const uint8_t ch, bool debug_print) {
+#if XGRAMMAR_ENABLE_DEBUG_PRINT
+  if (debug_print) {
+    return AdvanceImpl<true>(ch);
+  }
+#endif  // XGRAMMAR_ENABLE_DEBUG_PRINT
+  return AdvanceImpl<false>(ch);
+}
+
 EarleyParser::EarleyParser(
     const Grammar& grammar, const ParserState& init_state, const bool need_expand
 )
@@ -281,28 +288,41 @@ EarleyParser::EarleyParser(
   PushStateAndExpand(init);
 }
 
+EarleyParser::EarleyParser(const Grammar& grammar, const Snapshot& snapshot) : grammar_(grammar) {
+  XGRAMMAR_DCHECK(grammar->optimized);
+  Reset(snapshot);
+}
+
+void EarleyParser::BindWorkspace() {
+  static thread_local Workspace workspace;
+  workspace_ = &workspace;
+  workspace_->states_visited_in_queue.Clear();
+  workspace_->states_to_be_added.clear();
+  // The queue is not empty only if the last call of the thread is interrupted by an exception.
+  workspace_->process_state_queue.clear();
+  workspace_->process_state_queue_front = 0;
+  workspace_->accept_stop_token = false;
+}
+
 void EarleyParser::PushStateAndExpand(const ParserState& state) {
-  tmp_states_visited_in_queue_.Clear();
-  tmp_accept_stop_token_ = false;
-  tmp_states_to_be_added_.clear();
+  BindWorkspace();
   // If the rule can't be expanded, we need to add it to the queue.
   if (!ExpandAndEnqueueUnexpandedState(state)) {
     Enqueue(state);
   }
   rule_id_to_completable_states_.PushBack(std::vector<std::pair<int32_t, ParserState>>());
-  while (!tmp_process_state_queue_.empty()) {
-    const auto state = tmp_process_state_queue_.front();
-    tmp_process_state_queue_.pop();
-    auto [scanable, completable] = Predict(state);
+  ParserState cur_state;
+  while (workspace_->PopProcessState(&cur_state)) {
+    auto [scanable, completable] = Predict<false>(cur_state);
     if (completable) {
-      Complete(state);
+      Complete<false>(cur_state);
     }
     if (scanable) {
-      tmp_states_to_be_added_.push_back(state);
+      workspace_->states_to_be_added.push_back(cur_state);
     }
   }
-  is_completed_.push_back(tmp_accept_stop_token_);
-  scanable_state_history_.PushBack(tmp_states_to_be_added_);
+  is_completed_.push_back(workspace_->accept_stop_token);
+  scanable_state_history_.PushBack(workspace_->states_to_be_added);
 }
 
 void EarleyParser::Reset() {
@@ -310,7 +330,6 @@ void EarleyParser::Reset() {
   scanable_state_history_.PopBack(scanable_state_history_.size());
   is_completed_.clear();
   stop_token_is_accepted_ = false;
-  XGRAMMAR_DCHECK(tmp_process_state_queue_.empty());
   PushStateAndExpand(ParserState(
       grammar_->GetRootRuleId(),
       ParserState::kUnexpandedRuleStartSequenceId,
@@ -320,6 +339,29 @@ void EarleyParser::Reset() {
   ));
 }
 
+void EarleyParser::Reset(const Snapshot& snapshot) {
+  rule_id_to_completable_states_.PopBack(rule_id_to_completable_states_.size());
+  scanable_state_history_.PopBack(scanable_state_history_.size());
+  is_completed_.clear();
+  stop_token_is_accepted_ = false;
+  rule_id_to_completable_states_.PushBack(snapshot.completable_states);
+  is_completed_.push_back(snapshot.is_completed);
+  scanable_state_history_.PushBack(snapshot.scanable_states);
+}
+
+EarleyParser::Snapshot EarleyParser::GetInitialSnapshot() const {
+  XGRAMMAR_DCHECK(scanable_state_history_.size() == 1);
+  Snapshot snapshot;
+  for (const auto& completable_state : rule_id_to_completable_states_[0]) {
+    snapshot.completable_states.push_back(completable_state);
+  }
+  for (const auto& state : scanable_state_history_[0]) {
+    snapshot.scanable_states.push_back(state);
+  }
+  snapshot.is_completed = is_completed_[0];
+  return snapshot;
+}
+
 bool EarleyParser::ExpandAndEnqueueUnexpandedState(const ParserState& state) {
   if (state.sequence_id != ParserState::kUnexpandedRuleStartSequenceId) {
     return false;
@@ -348,11 +390,9 @@ bool EarleyParser::ExpandAndEnqueueUnexpandedState(const ParserState& state) {
   return true;
 }
 
+template <bool kDebugPrint>
 void EarleyParser::ExpandNextRuleRefElement(
-    const ParserState& state,
-    const GrammarExpr& grammar_expr,
-    const GrammarExpr* sub_grammar_expr,
-    bool debug_print
+    const ParserState& state, const GrammarExpr& grammar_expr, const GrammarExpr* sub_grammar_expr
 ) {
   // Path A. The rule has a corresponding FSM.
   XGRAMMAR_DCHECK(!(state.rule_id != -1 && grammar_->per_rule_fsms[state.rule_id].has_value()));
@@ -363,7 +403,7 @@ void EarleyParser::ExpandNextRuleRefElement(
   );
   auto ref_rule_id = (*sub_grammar_expr)[0];
 
-  if (debug_print) {
+  if constexpr (kDebugPrint) {
     XGRAMMAR_LOG(INFO) << "The rule " << state.rule_id << ": "
                        << grammar_->GetRule(state.rule_id).name << " predict the new rule "
                        << ref_rule_id << ": " << grammar_->GetRule(ref_rule_id).name << ".";
@@ -390,7 +430,8 @@ void EarleyParser::ExpandNextRuleRefElement(
                ) != rule_id_to_completable_states_.Back().end();
       };
       const auto& parent_states_map = rule_id_to_completable_states_[state.rule_start_pos];
-      std::vector<std::pair<int32_t, ParserState>> to_added_states;
+      auto& to_added_states = workspace_->completable_states_to_be_added;
+      to_added_states.clear();
       for (const auto& parent_state_iter : parent_states_map) {
         if (parent_state_iter.first != state.rule_id) continue;
         const auto& parent_state = parent_state_iter.second;
@@ -460,7 +501,8 @@ void EarleyParser::ExpandNextRuleRefElement(
   }
 }
 
-void EarleyParser::ExpandNextRuleRefElementOnFSM(const ParserState& state, bool debug_print) {
+template <bool kDebugPrint>
+void EarleyParser::ExpandNextRuleRefElementOnFSM(const ParserState& state) {
   XGRAMMAR_DCHECK(state.rule_id != -1 && grammar_->per_rule_fsms[state.rule_id].has_value());
   const auto& fsm = grammar_->per_rule_fsms[state.rule_id].value();
 
@@ -476,7 +518,7 @@ void EarleyParser::ExpandNextRuleRefElementOnFSM(const ParserState& state, bool
     const int& target = edge.target;
     const int& ref_rule_id = edge.GetRefRuleId();
     bool right_recursion_to_root = false;
-    if (debug_print) {
+    if constexpr (kDebugPrint) {
       XGRAMMAR_LOG(INFO) << "The rule " << state.rule_id << ": "
                          << grammar_->GetRule(state.rule_id).name << " predict the new rule "
                          << ref_rule_id << ": " << grammar_->GetRule(ref_rule_id).name << ".";
@@ -499,7 +541,8 @@ void EarleyParser::ExpandNextRuleRefElementOnFSM(const ParserState& state, bool
                  ) != rule_id_to_completable_states_.Back().end();
         };
         const auto& parent_states_map = rule_id_to_completable_states_[state.rule_start_pos];
-        std::vector<std::pair<int32_t, ParserState>> to_added_states;
+        auto& to_added_states = workspace_->completable_states_to_be_added;
+        to_added_states.clear();
         for (const auto& parent_state_iter : parent_states_map) {
           if (parent_state_iter.first != state.rule_id) continue;
           const auto& parent_state = parent_state_iter.second;
@@ -584,7 +627,7 @@ void EarleyParser::AdvanceByteString(
       Enqueue(new_state);
       // Assert: In a sequence, the bytestring can't be skipped. So the state can't be repeated.
     } else {
-      tmp_states_to_be_added_.push_back(new_state);
+      workspace_->states_to_be_added.push_back(new_state);
     }
   }
   return;
@@ -659,7 +702,7 @@ void EarleyParser::AdvanceCharacterClass(
         // For positive classes: only continue if some range could match
         bool should_continue = is_negative ? true : could_match;
         if (should_continue) {
-          tmp_states_to_be_added_.push_back(new_state);
+          workspace_->states_to_be_added.push_back(new_state);
         }
       }
     }
@@ -699,7 +742,7 @@ void EarleyParser::AdvanceCharacterClass(
       auto new_state = state;
       new_state.sub_element_id = num_bytes - 1;
       new_state.partial_codepoint = partial;
-      tmp_states_to_be_added_.push_back(new_state);
+      workspace_->states_to_be_added.push_back(new_state);
     }
     return;
   }
@@ -792,7 +835,7 @@ void EarleyParser::AdvanceCharacterClassStar(
         // For positive classes: only continue if some range could match
         bool should_continue = is_negative ? true : could_match;
         if (should_continue) {
-          tmp_states_to_be_added_.push_back(new_state);
+          workspace_->states_to_be_added.push_back(new_state);
         }
       }
     }
@@ -832,7 +875,7 @@ void EarleyParser::AdvanceCharacterClassStar(
       auto new_state = state;
       new_state.sub_element_id = num_bytes - 1;
       new_state.partial_codepoint = partial;
-      tmp_states_to_be_added_.push_back(new_state);
+      workspace_->states_to_be_added.push_back(new_state);
     }
     return;
   }
@@ -871,9 +914,16 @@ void EarleyParser::AdvanceFsm(const ParserState& state, const uint8_t ch) {
 }
 
 bool RepeatDetector::IsVisited(const ParserState& state) const {
-  // If the size is larger than the threshold, then we use the set to check.
+  // If the size is larger than the threshold, then we use the table to check.
   if (size_ > transition_threshold_) {
-    return visited_set_.find(state) != visited_set_.end();
+    std::size_t mask = table_.size() - 1;
+    for (std::size_t i = StateHashForParsing()(state) & mask; table_generations_[i] == generation_;
+         i = (i + 1) & mask) {
+      if (StateEqualForParsing()(table_[i], state)) {
+        return true;
+      }
+    }
+    return false;
   }
   return std::find_if(
              visited_vector_.begin(),
@@ -882,23 +932,58 @@ bool RepeatDetector::IsVisited(const ParserState& state) const {
          ) != visited_vector_.begin() + size_;
 }
 
-void RepeatDetector::Insert(const ParserState& state) {
-  if (size_ == transition_threshold_) {
-    for (const auto& s : visited_vector_) {
-      visited_set_.insert(s);
+void RepeatDetector::InsertIntoTable(const ParserState& state) {
+  std::size_t mask = table_.size() - 1;
+  std::size_t i = StateHashForParsing()(state) & mask;
+  while (table_generations_[i] == generation_) {
+    i = (i + 1) & mask;
+  }
+  table_[i] = state;
+  table_generations_[i] = generation_;
+}
+
+void RepeatDetector::GrowTable() {
+  auto old_table = std::move(table_);
+  auto old_table_generations = std::move(table_generations_);
+  std::size_t capacity = std::max<std::size_t>(old_table.size(), 16);
+  while (capacity < static_cast<std::size_t>(size_) * 2) {
+    capacity *= 2;
+  }
+  table_.assign(capacity, ParserState());
+  table_generations_.assign(capacity, 0);
+  auto old_generation = generation_;
+  generation_ = 1;
+  for (std::size_t i = 0; i < old_table.size(); ++i) {
+    if (old_table_generations[i] == old_generation) {
+      InsertIntoTable(old_table[i]);
     }
   }
+}
+
+void RepeatDetector::Insert(const ParserState& state) {
   size_++;
-  if (size_ > transition_threshold_) {
-    visited_set_.insert(state);
-  } else {
+  if (size_ <= transition_threshold_) {
     visited_vector_[size_ - 1] = state;
+    return;
   }
+  if (static_cast<std::size_t>(size_) * 2 > table_.size()) {
+    GrowTable();
+  }
+  if (size_ == transition_threshold_ + 1) {
+    for (const auto& s : visited_vector_) {
+      InsertIntoTable(s);
+    }
+  }
+  InsertIntoTable(state);
 }
 
 void RepeatDetector::Clear() {
   if (size_ > transition_threshold_) {
-    visited_set_.clear();
+    // Empty all the slots by advancing the generation.
+    if (++generation_ == 0) {
+      std::fill(table_generations_.begin(), table_generations_.end(), 0);
+      generation_ = 1;
+    }
   }
   size_ = 0;
 }
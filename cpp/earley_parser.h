@@ -8,8 +8,6 @@
 #define XGRAMMAR_EARLEY_PARSER_H_
 #include <cstdint>
 #include <ostream>
-#include <queue>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -183,17 +181,34 @@ class StateHashForParsing {
   }
 };
 
-/*! \brief This class is used to detect the repeated states. */
+/*!
+ * \brief This class is used to detect the repeated states. The states are kept in a vector while
+ * they are few, and in an open-addressing hash table otherwise. Clear() keeps the memory, so a
+ * detector reused across the calls does not allocate after warm-up.
+ */
 class RepeatDetector {
  private:
   const int transition_threshold_;
 
   std::vector<ParserState> visited_vector_;
 
-  std::unordered_set<ParserState, StateHashForParsing, StateEqualForParsing> visited_set_;
+  /*! \brief The slots of the hash table. The size is 0 or a power of 2. */
+  std::vector<ParserState> table_;
+
+  /*! \brief The generation of every slot. A slot is occupied if it is generation_. */
+  std::vector<uint32_t> table_generations_;
+
+  /*! \brief Increased by Clear(), so the slots are emptied without touching them. */
+  uint32_t generation_ = 1;
 
   int size_ = 0;
 
+  /*! \brief Insert the state into the table, which has an empty slot. */
+  void InsertIntoTable(const ParserState& state);
+
+  /*! \brief Grow the table so its load factor is at most 1/2 after inserting a state. */
+  void GrowTable();
+
  public:
   RepeatDetector(const int transition_threshold = 50)
       : transition_threshold_(transition_threshold), size_(0) {
@@ -235,9 +250,6 @@ class EarleyParser {
   /*! \brief The grammar to be parsed. */
   Grammar grammar_;
 
-  /*! \brief In this round of advancing, check if the stop token can be accepted. */
-  bool tmp_accept_stop_token_ = false;
-
   /*! \brief store when accepting i characters, if the stop token can be accepted. */
   std::vector<bool> is_completed_;
 
@@ -254,16 +266,50 @@ class EarleyParser {
   Compact2DArray<ParserState> scanable_state_history_;
 
   /*!
-   * \brief A temperate vector only used in Advance, used to add states in the
-   * scanable_state_history.
+   * \brief The temporary data of advancing and expanding the states. They are shared by the
+   * parsers of the same thread, so an idle parser only holds its history.
    */
-  std::vector<ParserState> tmp_states_to_be_added_;
+  struct Workspace {
+    /*! \brief In this round of advancing, check if the stop token can be accepted. */
+    bool accept_stop_token = false;
+
+    /*! \brief The states to be added in the scanable_state_history. */
+    std::vector<ParserState> states_to_be_added;
+
+    /*!
+     * \brief It's the processing queue of the earley parser. The states before
+     * process_state_queue_front are popped. It is cleared when all the states are popped, so the
+     * memory is reused instead of allocated block by block like std::queue.
+     */
+    std::vector<ParserState> process_state_queue;
+    std::size_t process_state_queue_front = 0;
+
+    /*! \brief The parent states to be added as completable states of the right recursion. */
+    std::vector<std::pair<int32_t, ParserState>> completable_states_to_be_added;
+
+    /*! \brief Pop the front of the processing queue. Return false if the queue is empty. */
+    bool PopProcessState(ParserState* state) {
+      if (process_state_queue_front == process_state_queue.size()) {
+        process_state_queue.clear();
+        process_state_queue_front = 0;
+        return false;
+      }
+      *state = process_state_queue[process_state_queue_front++];
+      return true;
+    }
+
+    /*! \brief The class is used to check if a state has been added into the queue. */
+    RepeatDetector states_visited_in_queue;
+  };
 
-  /*! \brief It's the processing queue of the earley parser. */
-  std::queue<ParserState> tmp_process_state_queue_;
+  /*!
+   * \brief The workspace of the current thread. Only valid in Advance() and PushStateAndExpand(),
+   * after BindWorkspace().
+   */
+  Workspace* workspace_ = nullptr;
 
-  /*! \brief The class is used to check if a state has been added into the queue. */
-  RepeatDetector tmp_states_visited_in_queue_;
+  /*! \brief Bind the workspace of the current thread to the parser, and clear it. */
+  void BindWorkspace();
 
   /*! \brief Check if the stop token is accepted. */
   bool stop_token_is_accepted_ = false;
@@ -274,7 +320,7 @@ class EarleyParser {
    * \return True if in the vector, false otherwise.
    */
   bool IsStateVisitedInQueue(const ParserState& state) const {
-    return tmp_states_visited_in_queue_.IsVisited(state);
+    return workspace_->states_visited_in_queue.IsVisited(state);
   }
 
   /*!
@@ -284,24 +330,26 @@ class EarleyParser {
 
   /*!
    * \brief The completion operation of the Earley parser.
+   * \tparam kDebugPrint Whether to print the debug information.
    * \param state The state to be completed.
-   * \param debug_print Whether to print the debug information.
    * \details The reason is that if the state can't be scanned, then
    * add it into the next states is useless. Moreover, the end
    * of the grammar is used to check if the grammar is completed,
    * so it should be added into the next states.
    */
-  void Complete(const ParserState& state, bool debug_print = false);
+  template <bool kDebugPrint>
+  void Complete(const ParserState& state);
 
   /*!
    * \brief The prediction operation of the Earley parser.
+   * \tparam kDebugPrint Whether to print the debug information.
    * \param state The state to be predicted.
-   * \param debug_print Whether to print the debug information.
    * \return First: If the state scanable, or the state is the end of the grammar,
    * then return true, otherwise return false.
    * \return Second: If the state is completable, then return true, otherwise return false.
    */
-  std::pair<bool, bool> Predict(const ParserState& state, bool debug_print = false);
+  template <bool kDebugPrint>
+  std::pair<bool, bool> Predict(const ParserState& state);
 
   /*!
    * \brief Handle the unexpanded rule, used for pushing initial state.
@@ -319,21 +367,27 @@ class EarleyParser {
    * \param grammar_expr The grammar expression to be expanded.
    * \param sub_grammar_expr The sub grammar expression to be expanded, especially
    * when the rule is a kSequence, and the sub rule is a kRuleRef.
-   * \param debug_print Whether to print the debug information.
+   * \tparam kDebugPrint Whether to print the debug information.
    */
+  template <bool kDebugPrint>
   void ExpandNextRuleRefElement(
-      const ParserState& state,
-      const GrammarExpr& grammar_expr,
-      const GrammarExpr* sub_grammar_expr,
-      bool debug_print = false
+      const ParserState& state, const GrammarExpr& grammar_expr, const GrammarExpr* sub_grammar_expr
   );
 
   /*!
    * \brief Expand the rule, used for RuleRef and kTagDispatch.
    * \param state The state to be expanded, and it's should be on the FSM.
-   * \param debug_print Whether to print the debug information.
+   * \tparam kDebugPrint Whether to print the debug information.
+   */
+  template <bool kDebugPrint>
+  void ExpandNextRuleRefElementOnFSM(const ParserState& state);
+
+  /*!
+   * \brief The implementation of Advance(). The debug mode is a template parameter, so that
+   * Advance() dispatches on it once per character instead of once per predicted state.
    */
-  void ExpandNextRuleRefElementOnFSM(const ParserState& state, bool debug_print = false);
+  template <bool kDebugPrint>
+  bool AdvanceImpl(const uint8_t ch);
 
   /*!
    * \brief Advance the parser to the next state, with the sub sequence is kCharacterClass.
@@ -384,8 +438,8 @@ class EarleyParser {
    */
   void Enqueue(const ParserState& state) {
     if (!IsStateVisitedInQueue(state)) {
-      tmp_process_state_queue_.push(state);
-      tmp_states_visited_in_queue_.Insert(state);
+      workspace_->process_state_queue.push_back(state);
+      workspace_->states_visited_in_queue.Insert(state);
     }
   }
 
@@ -395,12 +449,23 @@ class EarleyParser {
    */
   void EnqueueWithoutProcessing(const ParserState& state) {
     if (!IsStateVisitedInQueue(state)) {
-      tmp_states_visited_in_queue_.Insert(state);
-      tmp_states_to_be_added_.push_back(state);
+      workspace_->states_visited_in_queue.Insert(state);
+      workspace_->states_to_be_added.push_back(state);
     }
   }
 
  public:
+  /*!
+   * \brief The states of a parser with only the expanded initial states, i.e. the parser right
+   * after construction. The parsers of the same grammar can be constructed or reset from it
+   * without expanding the root rule again.
+   */
+  struct Snapshot {
+    std::vector<std::pair<int32_t, ParserState>> completable_states;
+    std::vector<ParserState> scanable_states;
+    bool is_completed = false;
+  };
+
   /*!
    * \brief Constructor of the Earley parser.
    * \param grammar The grammar to be parsed.
@@ -410,10 +475,18 @@ class EarleyParser {
       const Grammar& grammar, const ParserState& initial_state, const bool need_expand = true
   );
 
+  /*!
+   * \brief Construct the parser from a snapshot of a parser of the same grammar.
+   * \param grammar The grammar to be parsed.
+   * \param snapshot The snapshot from GetInitialSnapshot().
+   */
+  EarleyParser(const Grammar& grammar, const Snapshot& snapshot);
+
   /*!
    * \brief From the current states, advance to the next state.
    * \param ch The character to be advanced.
-   * \param debug_print Whether to print the debug information.
+   * \param debug_print Whether to print the debug information. Ignored if the library is built
+   * without XGRAMMAR_ENABLE_DEBUG_PRINT.
    * \return True if the character is accepted, false otherwise.
    * \note If the character isn't accepted, then the states won't be changed.
    */
@@ -446,6 +519,18 @@ class EarleyParser {
    */
   void Reset();
 
+  /*!
+   * \brief Reset the parser to the snapshot of a parser of the same grammar.
+   * \param snapshot The snapshot from GetInitialSnapshot().
+   */
+  void Reset(const Snapshot& snapshot);
+
+  /*!
+   * \brief Get the snapshot of the initial states.
+   * \note Only valid when no character is accepted since the construction or the last reset.
+   */
+  Snapshot GetInitialSnapshot() const;
+
   /*!
    * \brief Get the current scanable states.
    * \return The scanable states.
@@ -207,12 +207,12 @@ class FSM::Impl : public FSMImplBase<std::vector<std::vector<FSMEdge>>> {
     return edges_.size() - 1;
   }
 
-  void AddEdge(int from, int to, int16_t min, int16_t max) {
+  void AddEdge(int from, int to, int32_t min, int32_t max) {
     XGRAMMAR_DCHECK(from < static_cast<int>(edges_.size()));
     edges_[from].push_back({min, max, to});
   }
 
-  void AddRuleEdge(int from, int to, int16_t rule_id) {
+  void AddRuleEdge(int from, int to, int32_t rule_id) {
     AddEdge(from, to, FSMEdge::EdgeType::kRuleRef, rule_id);
   }
 
@@ -382,13 +382,13 @@ int FSM::NumStates() const { return pimpl_->NumStates(); }
 
 int FSM::AddState() { return pimpl_->AddState(); }
 
-void FSM::AddEdge(int from, int to, int16_t min, int16_t max) {
+void FSM::AddEdge(int from, int to, int32_t min, int32_t max) {
   pimpl_->AddEdge(from, to, min, max);
 }
 
 void FSM::AddEpsilonEdge(int from, int to) { pimpl_->AddEpsilonEdge(from, to); }
 
-void FSM::AddRuleEdge(int from, int to, int16_t rule_id) { pimpl_->AddRuleEdge(from, to, rule_id); }
+void FSM::AddRuleEdge(int from, int to, int32_t rule_id) { pimpl_->AddRuleEdge(from, to, rule_id); }
 
 void FSM::AddEOSEdge(int from, int to) { pimpl_->AddEOSEdge(from, to); }
 
@@ -654,10 +654,10 @@ struct CompactFSMWithStartEndSerializeHelper {
       : fsm(compact_fsm_with_se.fsm_),
         start(compact_fsm_with_se.start_),
         is_dfa(compact_fsm_with_se.is_dfa_) {
-    end_index.reserve(compact_fsm_with_se.NumStates());
+    end_index.reserve(compact_fsm_with_se.ends_.size());
     for (int i = 0; i < static_cast<int>(compact_fsm_with_se.ends_.size()); ++i) {
       if (compact_fsm_with_se.ends_[i]) {
-        end_index.push_back(i);
+        end_index.push_back(i + compact_fsm_with_se.ends_offset_);
       }
     }
   }
@@ -688,9 +688,18 @@ std::optional<SerializationError> DeserializeJSONValue(
   result->start_ = tmp.start;
   result->is_dfa_ = tmp.is_dfa;
   const auto& end_index = tmp.end_index;
-  result->ends_.resize(result->fsm_.NumStates(), false);
+  // Only the range covering the end states is kept, so the FSM of a rule in the complete FSM stays
+  // small.
+  if (end_index.empty()) {
+    result->ends_offset_ = 0;
+    result->ends_.clear();
+    return std::nullopt;
+  }
+  auto [min_it, max_it] = std::minmax_element(end_index.begin(), end_index.end());
+  result->ends_offset_ = *min_it;
+  result->ends_.assign(*max_it - *min_it + 1, false);
   for (const auto& idx : end_index) {
-    result->ends_[idx] = true;
+    result->ends_[idx - result->ends_offset_] = true;
   }
   return std::nullopt;
 }
@@ -729,7 +738,7 @@ std::ostream& operator<<(std::ostream& os, const FSMWithStartEnd& fsm) {
 }
 
 FSMWithStartEnd FSMWithStartEnd::Copy() const {
-  return FSMWithStartEnd(fsm_.Copy(), start_, ends_, is_dfa_);
+  return FSMWithStartEnd(fsm_.Copy(), start_, ends_, ends_offset_, is_dfa_);
 }
 
 FSMWithStartEnd FSMWithStartEnd::RebuildWithMapping(
@@ -747,22 +756,25 @@ FSMWithStartEnd FSMWithStartEnd::RebuildWithMapping(
 }
 
 CompactFSMWithStartEnd FSMWithStartEnd::ToCompact() {
-  return CompactFSMWithStartEnd(fsm_.ToCompact(), start_, ends_);
+  return CompactFSMWithStartEnd(fsm_.ToCompact(), start_, ends_, ends_offset_, false);
 }
 
 FSMWithStartEnd FSMWithStartEnd::AddToCompleteFSM(
     FSM* complete_fsm, std::vector<int>* state_mapping
 ) {
   XGRAMMAR_DCHECK(state_mapping != nullptr) << "state_mapping cannot be nullptr";
+  // The states are appended to the complete FSM, so the end states only cover the new range. This
+  // keeps adding many rules linear in the total number of states.
+  int ends_offset = complete_fsm->NumStates();
   complete_fsm->AddFSM(fsm_, state_mapping);
   int new_start = (*state_mapping)[start_];
-  std::vector<bool> new_ends(complete_fsm->NumStates(), false);
+  std::vector<bool> new_ends(complete_fsm->NumStates() - ends_offset, false);
   for (int end = 0; end < NumStates(); ++end) {
     if (IsEndState(end)) {
-      new_ends[(*state_mapping)[end]] = true;
+      new_ends[(*state_mapping)[end] - ends_offset] = true;
     }
   }
-  return FSMWithStartEnd(*complete_fsm, new_start, new_ends, is_dfa_);
+  return FSMWithStartEnd(*complete_fsm, new_start, new_ends, ends_offset, is_dfa_);
 }
 
 FSMWithStartEnd FSMWithStartEnd::Star() const {
@@ -786,7 +798,7 @@ FSMWithStartEnd FSMWithStartEnd::Plus() const {
       fsm.AddEpsilonEdge(end, start_);
     }
   }
-  return FSMWithStartEnd(fsm, start_, ends_);
+  return FSMWithStartEnd(fsm, start_, ends_, ends_offset_, false);
 }
 
 FSMWithStartEnd FSMWithStartEnd::Optional() const {
@@ -797,7 +809,7 @@ FSMWithStartEnd FSMWithStartEnd::Optional() const {
       break;
     }
   }
-  return FSMWithStartEnd(fsm, start_, ends_);
+  return FSMWithStartEnd(fsm, start_, ends_, ends_offset_, false);
 }
 
 Result<FSMWithStartEnd> FSMWithStartEnd::Not(int max_result_num_states) const {
@@ -1269,7 +1281,7 @@ Result<FSMWithStartEnd> FSMWithStartEnd::MinimizeDFA(int max_num_states) const {
   }
 
   // Initialize the precursors of nodes.
-  std::vector<std::vector<std::pair<std::pair<int16_t, int16_t>, int>>> precursors;
+  std::vector<std::vector<std::pair<std::pair<int32_t, int32_t>, int>>> precursors;
   precursors.resize(now_fsm.NumStates());
   for (int i = 0; i < now_fsm.NumStates(); ++i) {
     const auto& edges = now_fsm.GetFsm().GetEdges(i);
@@ -1297,7 +1309,7 @@ Result<FSMWithStartEnd> FSMWithStartEnd::MinimizeDFA(int max_num_states) const {
   working_set.push_back(std::move(non_final_states));
 
   while (!working_set.empty()) {
-    std::map<std::pair<int16_t, int16_t>, std::unordered_set<int>> possible_transitions;
+    std::map<std::pair<int32_t, int32_t>, std::unordered_set<int>> possible_transitions;
     auto current_partition = std::move(working_set.back());
     working_set.pop_back();
 
@@ -1539,7 +1551,7 @@ std::size_t MemorySize(const CompactFSMWithStartEnd& self) {
 }
 
 FSMWithStartEnd CompactFSMWithStartEnd::ToFSM() const {
-  return FSMWithStartEnd(fsm_.ToFSM(), start_, ends_);
+  return FSMWithStartEnd(fsm_.ToFSM(), start_, ends_, ends_offset_, false);
 }
 
 }  // namespace xgrammar
@@ -30,12 +30,12 @@ namespace xgrammar {
 /*!
  * \brief The edge of a FSM.
  */
-struct alignas(8) FSMEdge {
+struct FSMEdge {
   /*!
    * \brief The min field of the edge stores the type of the edge. When min >= 0, it represents a
    * range of characters [min, max]. When min < 0, it represents a special edge type.
    */
-  enum EdgeType : int16_t {
+  enum EdgeType : int32_t {
     kCharRange = 0,  // When min >= kCharRange, it represents a range of characters.
     kEpsilon = -1,
     kRuleRef = -2,
@@ -50,8 +50,10 @@ struct alignas(8) FSMEdge {
    * When min == EdgeType::kRuleRef, it represents a reference to a rule. max is the rule id.
    * When min == EdgeType::kEpsilon, it means the edge is an epsilon transition.
    * When min == EdgeType::kEOS, it means the edge accepts an EOS token.
+   * \note max is 32-bit so that a rule edge can refer to any rule of a large grammar, e.g. a tag
+   * dispatch over tens of thousands of tools.
    */
-  int16_t min, max;
+  int32_t min, max;
 
   /*!
    * \brief The target state id of the edge.
@@ -61,7 +63,7 @@ struct alignas(8) FSMEdge {
   // for serialization only
   FSMEdge() = default;
 
-  FSMEdge(int16_t min, int16_t max, int32_t target) : min(min), max(max), target(target) {
+  FSMEdge(int32_t min, int32_t max, int32_t target) : min(min), max(max), target(target) {
     XGRAMMAR_DCHECK(!IsCharRange() || min <= max)
         << "Invalid FSMEdge: min > max. min=" << min << ", max=" << max;
   }
@@ -262,7 +264,7 @@ class FSM {
    * \param min The min value of the range.
    * \param max The max value of the range.
    */
-  void AddEdge(int from, int to, int16_t min, int16_t max);
+  void AddEdge(int from, int to, int32_t min, int32_t max);
 
   /*!
    * \brief Add an epsilon transition between two states.
@@ -277,7 +279,7 @@ class FSM {
    * \param to The target state.
    * \param rule_id The rule id to reference.
    */
-  void AddRuleEdge(int from, int to, int16_t rule_id);
+  void AddRuleEdge(int from, int to, int32_t rule_id);
 
   /*!
    * \brief Add an EOS transition between two states.
@@ -477,6 +479,15 @@ class FSMWithStartEndBase {
   )
       : fsm_(fsm), start_(start), ends_(ends), is_dfa_(is_dfa) {}
 
+  /*!
+   * \brief Construct with the end states of the range starting from ends_offset. It keeps the FSM
+   * of a rule small when it only covers a range of the states of a large complete FSM.
+   */
+  FSMWithStartEndBase(
+      const FSMType& fsm, int start, const std::vector<bool>& ends, int ends_offset, bool is_dfa
+  )
+      : fsm_(fsm), start_(start), ends_(ends), ends_offset_(ends_offset), is_dfa_(is_dfa) {}
+
   /****************** Member Accessors and Mutators ******************/
 
   /*! \brief Returns the underlying FSM. */
@@ -485,15 +496,21 @@ class FSMWithStartEndBase {
   /*! \brief Returns the start state of the FSM. */
   int GetStart() const { return start_; }
 
-  /*! \brief Returns the end states of the FSM. */
+  /*! \brief Returns the end states of the FSM, starting from the state GetEndsOffset(). */
   const std::vector<bool>& GetEnds() const { return ends_; }
 
+  /*! \brief Returns the first state covered by GetEnds(). */
+  int GetEndsOffset() const { return ends_offset_; }
+
   /*!
    * \brief Checks if a given state is an end/accepting state.
    * \param state The state to check.
    * \return True if the state is an end state, false otherwise.
    */
-  bool IsEndState(int state) const { return ends_[state]; }
+  bool IsEndState(int state) const {
+    state -= ends_offset_;
+    return state >= 0 && state < static_cast<int>(ends_.size()) && ends_[state];
+  }
 
   /*! \brief Check if a state is scanable.
    *  \param state The state to check.
@@ -536,8 +553,11 @@ class FSMWithStartEndBase {
    * \param state The state to add as an end state.
    */
   void AddEndState(int state) {
-    XGRAMMAR_DCHECK(state < NumStates());
-    ends_[state] = true;
+    XGRAMMAR_DCHECK(state < NumStates() && state >= ends_offset_);
+    if (state - ends_offset_ >= static_cast<int>(ends_.size())) {
+      ends_.resize(state - ends_offset_ + 1, false);
+    }
+    ends_[state - ends_offset_] = true;
   }
 
   /*!
@@ -553,7 +573,10 @@ class FSMWithStartEndBase {
    * \brief Sets the end states of the FSM.
    * \param ends The new end states.
    */
-  void SetEndStates(const std::vector<bool>& ends) { ends_ = ends; }
+  void SetEndStates(const std::vector<bool>& ends) {
+    ends_ = ends;
+    ends_offset_ = 0;
+  }
 
   /*! \brief Returns the total number of states in the FSM. */
   int NumStates() const { return fsm_.NumStates(); }
@@ -590,9 +613,15 @@ class FSMWithStartEndBase {
   /*! \brief The start state of the FSM. */
   int start_;
 
-  /*! \brief The set of accepting/end states. */
+  /*!
+   * \brief The set of accepting/end states. ends_[i] is whether the state ends_offset_ + i is an
+   * end state. The states out of the range are not end states.
+   */
   std::vector<bool> ends_;
 
+  /*! \brief The first state covered by ends_. */
+  int ends_offset_ = 0;
+
  protected:
   /*! \brief Whether this FSM is a deterministic finite automaton. */
   bool is_dfa_ = false;
@@ -790,6 +819,7 @@ XGRAMMAR_MEMBER_ARRAY(
     &CompactFSMWithStartEnd::fsm_,
     &CompactFSMWithStartEnd::start_,
     &CompactFSMWithStartEnd::ends_,
+    &CompactFSMWithStartEnd::ends_offset_,
     &CompactFSMWithStartEnd::is_dfa_
 );
 
@@ -815,7 +845,7 @@ inline bool FSMWithStartEndBase<FSMType>::AcceptString(const std::string& str) c
     start_states = result_states;
   }
   return std::any_of(start_states.begin(), start_states.end(), [&](int state) {
-    return ends_[state];
+    return IsEndState(state);
   });
 }
 
@@ -9,7 +9,9 @@
 
 #include <xgrammar/xgrammar.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -316,7 +318,10 @@ class GrammarBuilder {
     if (rule_name_to_id_.count(name_hint) == 0) {
       return name_hint;
     } else {
-      int cnt = 1;
+      // Rules are never removed, so the suffixes before the last returned one are still taken.
+      // Continuing from it keeps generating many rules with the same hint linear.
+      int& cnt = last_rule_name_suffix_[name_hint];
+      cnt = std::max(cnt, 1);
       while (rule_name_to_id_.count(name_hint + "_" + std::to_string(cnt)) != 0) {
         ++cnt;
       }
@@ -341,6 +346,8 @@ class GrammarBuilder {
   std::shared_ptr<Grammar::Impl> grammar_;
   // Map from rule name to rule id.
   std::unordered_map<std::string, int32_t> rule_name_to_id_;
+  // Map from name hint to the last suffix returned by GetNewRuleName.
+  std::unordered_map<std::string, int> last_rule_name_suffix_;
 };
 
 }  // namespace xgrammar
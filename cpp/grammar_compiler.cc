@@ -6,26 +6,38 @@
 #include <xgrammar/compiler.h>
 
 #include <algorithm>
+#include <atomic>
 #include <bitset>
 #include <cctype>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "builtin_grammars.h"
+#include "compile_budget.h"
+#include "compile_server.h"
 #include "compiled_grammar_impl.h"
 #include "earley_parser.h"
 #include "fsm.h"
 #include "grammar_functor.h"
 #include "grammar_impl.h"
+#include "shared_grammar_cache.h"
 #include "support/dynamic_bitset.h"
+#include "support/executor.h"
+#include "support/json_serializer.h"
 #include "support/logging.h"
-#include "support/thread_pool.h"
 #include "support/thread_safe_cache.h"
 #include "support/utils.h"
+#include "tokenizer_info_impl.h"
 #include "xgrammar/grammar.h"
 
 namespace xgrammar {
@@ -40,13 +52,15 @@ class GrammarMatcherForTokenMaskCache : public EarleyParser {
       const ParserState& init_state,
       const std::unordered_map<int32_t, DynamicBitset>&
           tag_dispatch_rule_id_to_second_slicing_bitset,
+      const std::bitset<256>& follow_bytes,
       const bool& need_expand = true
   )
       : EarleyParser(grammar, init_state),
         init_rule_id(init_state.rule_id),
         initial_state(init_state),
         tag_dispatch_rule_id_to_second_slicing_bitset(tag_dispatch_rule_id_to_second_slicing_bitset
-        ) {}
+        ),
+        follow_bytes(follow_bytes) {}
   /*!
    * \brief Get the adaptive token mask for the given ParserState.
    * \param is_root_rule Whether to consider the parent rule. If false, there will be
@@ -91,6 +105,15 @@ class GrammarMatcherForTokenMaskCache : public EarleyParser {
       const std::vector<std::pair<int32_t, std::string>>& sorted_decoded_vocab
   );
 
+  /*!
+   * \brief Check if the byte after any position where the initial rule can end inside the token
+   * can follow the rule.
+   * \param matched_size The number of bytes of the token matched by the initial rule.
+   * \param boundary_mask Return value. Bit k is set if the rule can end after the first k bytes of
+   * the token. 0 if any such position is larger than 31.
+   */
+  bool IsTokenPassFollowBytes(const std::string& token, int matched_size, uint32_t* boundary_mask);
+
   // The id of the initial rule.
   int32_t init_rule_id;
 
@@ -108,10 +131,14 @@ class GrammarMatcherForTokenMaskCache : public EarleyParser {
   */
   const std::unordered_map<int32_t, DynamicBitset>& tag_dispatch_rule_id_to_second_slicing_bitset;
 
+  // The bytes that can follow the initial rule.
+  const std::bitset<256>& follow_bytes;
+
   // Temporary data for GetAdaptiveTokenMask.
   std::vector<int32_t> tmp_accepted_indices_;
   std::vector<int32_t> tmp_rejected_indices_;
   std::vector<int32_t> tmp_uncertain_indices_;
+  std::vector<uint32_t> tmp_uncertain_boundary_masks_;
   std::vector<bool> tmp_can_reach_end_stack_;
   std::vector<bool> tmp_can_reach_end_prefix_or_stack_;
 };
@@ -181,6 +208,57 @@ class IntStringPairComparator {
   }
 };
 
+std::bitset<256> GetFirstCharacterMask(const Grammar& grammar, const ParserState& state) {
+  std::bitset<256> first_character_mask;
+  const auto& sequence = grammar->GetGrammarExpr(state.sequence_id);
+  if (!grammar->per_rule_fsms[state.rule_id].has_value()) {
+    const auto& sub_sequence = grammar->GetGrammarExpr(sequence[state.element_id]);
+    switch (sub_sequence.type) {
+      case Grammar::Impl::GrammarExprType::kByteString: {
+        first_character_mask[sub_sequence[state.sub_element_id]] = true;
+        break;
+      }
+      case xgrammar::Grammar::Impl::GrammarExprType::kCharacterClass:
+      case xgrammar::Grammar::Impl::GrammarExprType::kCharacterClassStar: {
+        if (state.sub_element_id == 0) {
+          bool is_negative = sub_sequence[0];
+          for (int i = 1; i < sub_sequence.size(); i += 2) {
+            int left_char = static_cast<uint8_t>(sub_sequence[i]);
+            int right_char = static_cast<uint8_t>(sub_sequence[i + 1]);
+            for (int c = left_char; c <= right_char; ++c) {
+              first_character_mask[c] = true;
+            }
+          }
+          if (is_negative) {
+            first_character_mask = ~first_character_mask;
+          }
+          break;
+        }
+        // Otherwise, it's matching a UTF-8 character. We can optimize the matching process
+        // here.
+        for (size_t i = 0x80; i < 0xC0; ++i) {
+          first_character_mask[i] = true;
+        }
+        break;
+      }
+      default: {
+        XGRAMMAR_LOG(FATAL) << "Unsupported grammar expr type: " << static_cast<int>(sequence.type);
+      }
+    }
+  } else {
+    const auto& fsm = grammar->per_rule_fsms[state.rule_id].value();
+    const auto& edges = fsm.GetFsm().GetEdges(state.element_id);
+    for (const auto& edge : edges) {
+      if (edge.IsCharRange()) {
+        for (int c = edge.min; c <= edge.max; ++c) {
+          first_character_mask[c] = true;
+        }
+      }
+    }
+  }
+  return first_character_mask;
+}
+
 int GetPossibleTokenIntervals(
     const std::vector<std::pair<int32_t, std::string>>& sorted_decoded_vocab,
     const std::bitset<256>& first_char_mask,
@@ -235,6 +313,32 @@ int GetPossibleTokenIntervals(
   return possible_token_num;
 }
 
+bool GrammarMatcherForTokenMaskCache::IsTokenPassFollowBytes(
+    const std::string& token, int matched_size, uint32_t* boundary_mask
+) {
+  XGRAMMAR_DCHECK(matched_size < static_cast<int>(token.size()));
+  XGRAMMAR_DCHECK(static_cast<int>(tmp_can_reach_end_stack_.size()) == matched_size + 1);
+  bool passed = false;
+  bool is_mask_overflow = false;
+  *boundary_mask = 0;
+  for (int k = 1; k <= matched_size; ++k) {
+    if (!tmp_can_reach_end_stack_[k]) {
+      continue;
+    }
+    passed = passed || follow_bytes[static_cast<uint8_t>(token[k])];
+    if (k < 32) {
+      *boundary_mask |= 1u << k;
+    } else {
+      is_mask_overflow = true;
+    }
+  }
+  if (is_mask_overflow) {
+    // The positions cannot be stored in the mask. The matcher will check the token directly.
+    *boundary_mask = 0;
+  }
+  return passed;
+}
+
 std::pair<bool, std::bitset<256>> GrammarMatcherForTokenMaskCache::GetSpeculativeCalculation(
     const std::vector<std::pair<int32_t, std::string>>& sorted_decoded_vocab
 ) {
@@ -472,19 +576,26 @@ bool GrammarMatcherForTokenMaskCache::GetTokenMaskWithFirstCharacterCheck(
         tmp_accepted_indices_.push_back(i);
       } else {
         auto lookahead_result_pair = IsTokenPassLookaheadAssertion(token, tmp_can_reach_end_stack_);
+        uint32_t boundary_mask = 0;
         if (can_reach_end && !is_root_rule && lookahead_result_pair.first &&
-            prev_matched_size > 0) {
+            prev_matched_size > 0 &&
+            ((!lookahead_result_pair.second && is_exact_lookahead) ||
+             IsTokenPassFollowBytes(token, prev_matched_size, &boundary_mask))) {
           // 1. If the current rule is the root rule (is_root_rule=true), there are no
           // uncertain tokens. Not accepted tokens are just rejected.
           // 2. If a token cannot pass the lookahead assertion, it is rejected.
+          // 3. If no byte after the possible ends of the rule can follow the rule, it is rejected.
           if ((!lookahead_result_pair.second) && is_exact_lookahead) {
             tmp_accepted_indices_.push_back(i);
           } else {
             tmp_uncertain_indices_.push_back(i);
-            // On the subtree, they are all uncertain tokens.
+            tmp_uncertain_boundary_masks_.push_back(boundary_mask);
+            // On the subtree, they are all uncertain tokens. They share the matched prefix, so the
+            // boundary mask is the same.
             if (lookahead_result_pair.second) {
               for (int j = i + 1; j < subtree_nodes_range[i]; ++j) {
                 tmp_uncertain_indices_.push_back(j);
+                tmp_uncertain_boundary_masks_.push_back(boundary_mask);
               }
               i = subtree_nodes_range[i] - 1;  // Skip the subtree nodes.
             }
@@ -535,57 +646,12 @@ AdaptiveTokenMask GrammarMatcherForTokenMaskCache::GetAdaptiveTokenMask(
   tmp_accepted_indices_.clear();
   tmp_rejected_indices_.clear();
   tmp_uncertain_indices_.clear();
+  tmp_uncertain_boundary_masks_.clear();
   // For every character in the current token, stores whether it is possible to reach the end of
   // the rule when matching until this character. Store it in a stack for later rollback.
   tmp_can_reach_end_stack_.push_back(false);
   tmp_can_reach_end_prefix_or_stack_.push_back(false);
-  std::bitset<256> first_character_mask;
-  const auto& sequence = grammar_->GetGrammarExpr(initial_state.sequence_id);
-  if (!grammar_->per_rule_fsms[init_rule_id].has_value()) {
-    const auto& sub_sequence = grammar_->GetGrammarExpr(sequence[initial_state.element_id]);
-    switch (sub_sequence.type) {
-      case Grammar::Impl::GrammarExprType::kByteString: {
-        first_character_mask[sub_sequence[initial_state.sub_element_id]] = true;
-        break;
-      }
-      case xgrammar::Grammar::Impl::GrammarExprType::kCharacterClass:
-      case xgrammar::Grammar::Impl::GrammarExprType::kCharacterClassStar: {
-        if (initial_state.sub_element_id == 0) {
-          bool is_negative = sub_sequence[0];
-          for (int i = 1; i < sub_sequence.size(); i += 2) {
-            int left_char = static_cast<uint8_t>(sub_sequence[i]);
-            int right_char = static_cast<uint8_t>(sub_sequence[i + 1]);
-            for (int c = left_char; c <= right_char; ++c) {
-              first_character_mask[c] = true;
-            }
-          }
-          if (is_negative) {
-            first_character_mask = ~first_character_mask;
-          }
-          break;
-        }
-        // Otherwise, it's matching a UTF-8 character. We can optimize the matching process
-        // here.
-        for (size_t i = 0x80; i < 0xC0; ++i) {
-          first_character_mask[i] = true;
-        }
-        break;
-      }
-      default: {
-        XGRAMMAR_LOG(FATAL) << "Unsupported grammar expr type: " << static_cast<int>(sequence.type);
-      }
-    }
-  } else {
-    const auto& fsm = grammar_->per_rule_fsms[init_rule_id].value();
-    const auto& edges = fsm.GetFsm().GetEdges(initial_state.element_id);
-    for (const auto& edge : edges) {
-      if (edge.IsCharRange()) {
-        for (int c = edge.min; c <= edge.max; ++c) {
-          first_character_mask[c] = true;
-        }
-      }
-    }
-  }
+  auto first_character_mask = GetFirstCharacterMask(grammar_, initial_state);
   bool rejected_indices_are_filled = GetTokenMaskWithFirstCharacterCheck(
       sorted_decoded_vocab, first_character_mask, subtree_nodes_range, is_root_rule
   );
@@ -595,15 +661,175 @@ AdaptiveTokenMask GrammarMatcherForTokenMaskCache::GetAdaptiveTokenMask(
         sorted_decoded_vocab,
         tmp_accepted_indices_,
         tmp_rejected_indices_,
-        tmp_uncertain_indices_
+        tmp_uncertain_indices_,
+        tmp_uncertain_boundary_masks_
     );
   } else {
     return AdaptiveTokenMask(
-        vocab_size, sorted_decoded_vocab, tmp_accepted_indices_, tmp_uncertain_indices_
+        vocab_size,
+        sorted_decoded_vocab,
+        tmp_accepted_indices_,
+        tmp_uncertain_indices_,
+        tmp_uncertain_boundary_masks_
     );
   }
 }
 
+/*!
+ * \brief Get the rules reachable from the root rule through the rule edges of the FSMs, and the
+ * rule references and repetitions of the rules without an FSM. The parser never predicts the other
+ * rules, e.g. the rules fused into the FSMs of all the rules referencing them, so no token mask is
+ * needed for them.
+ */
+std::vector<bool> GetReachableRules(const Grammar& grammar) {
+  using GrammarExprType = Grammar::Impl::GrammarExprType;
+  std::vector<bool> is_reachable(grammar->NumRules(), false);
+  std::vector<int32_t> rule_stack = {grammar->GetRootRuleId()};
+  is_reachable[grammar->GetRootRuleId()] = true;
+  auto visit = [&](int32_t rule_id) {
+    if (!is_reachable[rule_id]) {
+      is_reachable[rule_id] = true;
+      rule_stack.push_back(rule_id);
+    }
+  };
+  std::unordered_set<int> reachable_states;
+  while (!rule_stack.empty()) {
+    auto rule_id = rule_stack.back();
+    rule_stack.pop_back();
+    const auto& rule_fsm = grammar->per_rule_fsms[rule_id];
+    if (rule_fsm.has_value()) {
+      rule_fsm->GetReachableStates(&reachable_states);
+      for (int state : reachable_states) {
+        for (const auto& edge : rule_fsm->GetFsm().GetEdges(state)) {
+          if (edge.IsRuleRef()) {
+            visit(edge.GetRefRuleId());
+          }
+        }
+      }
+      continue;
+    }
+    const auto& rule_body = grammar->GetGrammarExpr(grammar->GetRule(rule_id).body_expr_id);
+    for (auto sequence_id : rule_body) {
+      const auto& sequence = grammar->GetGrammarExpr(sequence_id);
+      if (sequence.type != GrammarExprType::kSequence) {
+        continue;
+      }
+      for (auto element_id : sequence) {
+        const auto& element = grammar->GetGrammarExpr(element_id);
+        if (element.type == GrammarExprType::kRuleRef || element.type == GrammarExprType::kRepeat) {
+          visit(element[0]);
+        }
+      }
+    }
+  }
+  return is_reachable;
+}
+
+/*!
+ * \brief Call visit_state(state, is_root_rule) for every parser state whose token mask is
+ * computed in the compilation. These are the scanable states of the reachable rules: the scanable
+ * states of the FSMs, every byte of the byte strings and the character classes with 0-3 remaining
+ * UTF-8 bytes.
+ */
+template <typename VisitState>
+void ForEachTokenMaskState(const Grammar& grammar, const VisitState& visit_state) {
+  using GrammarExprType = Grammar::Impl::GrammarExprType;
+  auto root_rule_id = grammar->GetRootRuleId();
+  auto is_reachable_rule = GetReachableRules(grammar);
+
+  for (int32_t rule_id = 0; rule_id < static_cast<int>(grammar->NumRules()); ++rule_id) {
+    if (!is_reachable_rule[rule_id]) {
+      continue;
+    }
+    auto rule = grammar->GetRule(rule_id);
+    auto rule_body = grammar->GetGrammarExpr(rule.body_expr_id);
+    const auto& rule_fsm = grammar->per_rule_fsms[rule_id];
+    if (rule_fsm.has_value()) {
+      auto cur_stack_element =
+          ParserState(rule_id, rule.body_expr_id, 0, ParserState::kNoPrevInputPos, 0);
+      std::unordered_set<int> reachable_states;
+      rule_fsm->GetReachableStates(&reachable_states);
+      for (int i : reachable_states) {
+        cur_stack_element.element_id = i;
+        if (!rule_fsm->IsScanableState(i)) {
+          continue;
+        }
+        visit_state(cur_stack_element, rule_id == root_rule_id);
+      }
+      continue;
+    }
+    XGRAMMAR_DCHECK(rule_body.type == GrammarExprType::kChoices);
+    for (auto sequence_id : rule_body) {
+      const auto& sequence = grammar->GetGrammarExpr(sequence_id);
+      if (sequence.type == GrammarExprType::kEmptyStr) {
+        continue;
+      }
+      XGRAMMAR_DCHECK(sequence.type == GrammarExprType::kSequence);
+      auto state = ParserState(rule_id, sequence_id, 0, ParserState::kNoPrevInputPos, 0);
+      for (int element_id = 0; element_id < sequence.size(); ++element_id) {
+        state.element_id = element_id;
+        auto element = grammar->GetGrammarExpr(sequence[element_id]);
+        if (element.type == GrammarExprType::kRuleRef || element.type == GrammarExprType::kRepeat) {
+          continue;
+        }
+        if (element.type == GrammarExprType::kByteString) {
+          for (int idx = 0; idx < element.size(); ++idx) {
+            state.sub_element_id = idx;
+            visit_state(state, rule_id == root_rule_id);
+          }
+        } else {
+          XGRAMMAR_DCHECK(
+              element.type == GrammarExprType::kCharacterClassStar ||
+              element.type == GrammarExprType::kCharacterClass
+          );
+          for (int left_utf8_bytes = 0; left_utf8_bytes <= 3; ++left_utf8_bytes) {
+            state.sub_element_id = left_utf8_bytes;
+            visit_state(state, rule_id == root_rule_id);
+          }
+        }
+      }
+    }
+  }
+}
+
+/******************* PreparedGrammar *******************/
+
+/*! \brief Run the tokenizer-independent stage of the compilation after the grammar is optimized. */
+PreparedGrammar PrepareOptimizedGrammar(const Grammar& optimized_grammar) {
+  XGRAMMAR_DCHECK(optimized_grammar->optimized);
+  auto prepared_grammar_impl = std::make_shared<PreparedGrammar::Impl>();
+  prepared_grammar_impl->grammar = optimized_grammar;
+  auto first_follow_bytes = FirstFollowBytesAnalyzer::Apply(prepared_grammar_impl->grammar);
+  prepared_grammar_impl->rule_first_bytes = std::move(first_follow_bytes.first_bytes);
+  prepared_grammar_impl->rule_follow_bytes = std::move(first_follow_bytes.follow_bytes);
+  ForEachTokenMaskState(
+      prepared_grammar_impl->grammar,
+      [&](const ParserState& state, bool is_root_rule) {
+        prepared_grammar_impl->token_mask_states.emplace_back(state, is_root_rule);
+      }
+  );
+  return PreparedGrammar(std::move(prepared_grammar_impl));
+}
+
+/*! \brief The prepared builtin JSON grammar, loaded from the embedded optimized grammar. */
+PreparedGrammar BuiltinJSONPreparedGrammar() {
+  static const PreparedGrammar prepared_grammar =
+      PrepareOptimizedGrammar(BuiltinJSONGrammarOptimized());
+  return prepared_grammar;
+}
+
+PreparedGrammar PreparedGrammar::FromGrammar(const Grammar& grammar) {
+  return PrepareOptimizedGrammar(GrammarOptimizer::Apply(grammar));
+}
+
+Grammar PreparedGrammar::GetGrammar() const { return pimpl_->grammar; }
+
+int64_t PreparedGrammar::NumTokenMaskStates() const {
+  return static_cast<int64_t>(pimpl_->token_mask_states.size());
+}
+
+std::size_t PreparedGrammar::MemorySizeBytes() const { return MemorySize(*pimpl_); }
+
 /******************* GrammarCompilerNoCache *******************/
 
 /*!
@@ -633,16 +859,34 @@ class GrammarCompilerNoCache {
 
   CompiledGrammar CompileGrammar(const std::string& ebnf_str, std::string root_rule_name);
 
+  CompiledGrammar CompileGrammar(const PreparedGrammar& prepared_grammar);
+
+  CompileCostEstimate EstimateCost(const Grammar& grammar) const;
+
+  const TokenizerInfo& GetTokenizerInfo() const { return tokenizer_info_; }
+
+  /*!
+   * \brief The per-tokenizer stage of the compilation. Compute the token masks of the prepared
+   * grammar for every tokenizer with multi-threading.
+   */
+  static std::vector<CompiledGrammar> CompileTokenMasks(
+      const PreparedGrammar& prepared_grammar,
+      const std::vector<TokenizerInfo>& tokenizer_infos,
+      int max_threads
+  );
+
  private:
   /*! \brief The main logic. Compile the grammar with multi-threading. */
   CompiledGrammar MultiThreadCompileGrammar(Grammar grammar);
   /*! \brief Optimization for TagDispatch.
-   *  \param compiled_grammar_impl the compiled_grammar to be optimized.
+   *  \param grammar The optimized grammar.
+   *  \param tokenizer_info The tokenizer info of the vocabulary.
    *  \param tag_dispatch_rule_id_to_second_slicing_bitset Return value. Mapping from the rule_id to
    * the definite accepted token mask.
    */
-  void TagDispatchOptimization(
-      std::shared_ptr<CompiledGrammar::Impl> compiled_grammar_impl,
+  static void TagDispatchOptimization(
+      Grammar grammar,
+      const TokenizerInfo& tokenizer_info,
       std::unordered_map<int32_t, DynamicBitset>* tag_dispatch_rule_id_to_second_slicing_bitset
   );
 
@@ -653,125 +897,180 @@ class GrammarCompilerNoCache {
 };
 
 CompiledGrammar GrammarCompilerNoCache::MultiThreadCompileGrammar(Grammar grammar_unoptimized) {
-  using GrammarExprType = Grammar::Impl::GrammarExprType;
-
-  auto compiled_grammar_impl = std::make_shared<CompiledGrammar::Impl>();
+  return CompileTokenMasks(
+      PreparedGrammar::FromGrammar(grammar_unoptimized), {tokenizer_info_}, max_threads_
+  )[0];
+}
 
-  compiled_grammar_impl->grammar = GrammarOptimizer::Apply(grammar_unoptimized);
-  compiled_grammar_impl->tokenizer_info = tokenizer_info_;
-  if (tokenizer_info_.GetVocabSize() == 0) {
-    return CompiledGrammar(compiled_grammar_impl);
+std::vector<CompiledGrammar> GrammarCompilerNoCache::CompileTokenMasks(
+    const PreparedGrammar& prepared_grammar,
+    const std::vector<TokenizerInfo>& tokenizer_infos,
+    int max_threads
+) {
+  // The tokenizer-independent data are shared by the compiled grammars of all the tokenizers.
+  std::vector<std::shared_ptr<CompiledGrammar::Impl>> compiled_grammar_impls;
+  std::vector<std::unordered_map<int32_t, DynamicBitset>>
+      tag_dispatch_rule_id_to_second_slicing_bitsets(tokenizer_infos.size());
+  for (std::size_t i = 0; i < tokenizer_infos.size(); ++i) {
+    auto compiled_grammar_impl = std::make_shared<CompiledGrammar::Impl>();
+    compiled_grammar_impl->grammar = prepared_grammar->grammar;
+    compiled_grammar_impl->rule_first_bytes = prepared_grammar->rule_first_bytes;
+    compiled_grammar_impl->rule_follow_bytes = prepared_grammar->rule_follow_bytes;
+    compiled_grammar_impl->tokenizer_info = tokenizer_infos[i];
+    if (tokenizer_infos[i].GetVocabSize() != 0) {
+      TagDispatchOptimization(
+          prepared_grammar->grammar,
+          tokenizer_infos[i],
+          &tag_dispatch_rule_id_to_second_slicing_bitsets[i]
+      );
+    }
+    compiled_grammar_impls.push_back(std::move(compiled_grammar_impl));
   }
-  std::unordered_map<int32_t, DynamicBitset> tag_dispatch_rule_id_to_second_slicing_bitset;
-  TagDispatchOptimization(compiled_grammar_impl, &tag_dispatch_rule_id_to_second_slicing_bitset);
+
   // Step 3. Compute the adaptive token mask cache
   // The token mask cache is computed for these positions in the grammar:
   // 1. All character class or character class star (with last_utf8_bytes=0, 1, 2, 3)
   // 2. All byte strings (with element_in_string=0, 1, 2, ...)
   // since other positions will be expanded to the above positions
 
-  // TODO(Charlie): Figure out how to support ThreadPool and std::mutex in WebAssembly.
-  // Only declare ThreadPool and mutex if max_threads > 1, so when max_threads = 1, we do
-  // not need ThreadPool or std::mutex, which throws error in runtime in WebAssembly.
-  std::optional<ThreadPool> thread_pool;
+  // TODO(Charlie): Figure out how to support threads and std::mutex in WebAssembly.
+  // Only declare TaskGroup and mutex if max_threads > 1, so when max_threads = 1, we do
+  // not need threads or std::mutex, which throws error in runtime in WebAssembly.
+  // The tasks run on the executor shared with the batch matchers, with a lower priority than the
+  // decoding tasks.
+  std::optional<TaskGroup> task_group;
   std::optional<std::mutex> adaptive_token_mask_cache_mutex;
-  if (max_threads_ > 1) {
-    thread_pool.emplace(max_threads_);
+  if (max_threads > 1) {
+    task_group.emplace(TaskPriority::kCompile, max_threads);
     adaptive_token_mask_cache_mutex.emplace();
   }
 
-  auto add_adaptive_token_mask = [&](const ParserState& state, bool is_root_rule) {
-    auto grammar_matcher = GrammarMatcherForTokenMaskCache(
-        compiled_grammar_impl->grammar, state, tag_dispatch_rule_id_to_second_slicing_bitset, false
-    );
-    auto cur_adaptive_token_mask_cache = grammar_matcher.GetAdaptiveTokenMask(
-        tokenizer_info_.GetVocabSize(),
-        tokenizer_info_.GetSortedDecodedVocab(),
-        tokenizer_info_.GetTrieSubtreeNodesRange(),
-        is_root_rule
-    );
-    if (max_threads_ > 1) {
-      std::lock_guard<std::mutex> lock(adaptive_token_mask_cache_mutex.value());
-      compiled_grammar_impl->adaptive_token_mask_cache[state] = cur_adaptive_token_mask_cache;
-    } else {
-      compiled_grammar_impl->adaptive_token_mask_cache[state] = cur_adaptive_token_mask_cache;
-    }
-  };
-
-  auto add_task_adaptive_token_mask = [&](const ParserState& state, bool is_root_rule) {
-    // Execute depending on whether we use thread_pool
-    if (max_threads_ > 1) {
-      thread_pool->Execute([add_adaptive_token_mask, state, is_root_rule]() {
-        add_adaptive_token_mask(state, is_root_rule);
-      });
-    } else {
-      add_adaptive_token_mask(state, is_root_rule);
-    }
-  };
-
-  auto root_rule_id = compiled_grammar_impl->grammar->GetRootRuleId();
+  // The budget of the current thread is applied to the tasks running in the worker threads.
+  auto budget = CurrentCompileBudget();
 
-  for (int32_t rule_id = 0; rule_id < static_cast<int>(compiled_grammar_impl->grammar->NumRules());
-       ++rule_id) {
-    auto rule = compiled_grammar_impl->grammar->GetRule(rule_id);
-    auto rule_body = compiled_grammar_impl->grammar->GetGrammarExpr(rule.body_expr_id);
-    const auto& rule_fsm = compiled_grammar_impl->grammar->per_rule_fsms[rule_id];
-    if (rule_fsm.has_value()) {
-      auto cur_stack_element =
-          ParserState(rule_id, rule.body_expr_id, 0, ParserState::kNoPrevInputPos, 0);
-      std::unordered_set<int> reachable_states;
-      rule_fsm->GetReachableStates(&reachable_states);
-      for (int i : reachable_states) {
-        cur_stack_element.element_id = i;
-        if (!rule_fsm->IsScanableState(i)) {
-          continue;
+  auto add_adaptive_token_mask =
+      [&](std::size_t tokenizer_idx, const ParserState& state, bool is_root_rule) {
+        if (budget.has_value()) {
+          (*budget)->Check();
         }
-        add_task_adaptive_token_mask(cur_stack_element, rule_id == root_rule_id);
-      }
-      continue;
-    }
-    XGRAMMAR_DCHECK(rule_body.type == GrammarExprType::kChoices);
-    for (auto sequence_id : rule_body) {
-      const auto& sequence = compiled_grammar_impl->grammar->GetGrammarExpr(sequence_id);
-      if (sequence.type == GrammarExprType::kEmptyStr) {
-        continue;
-      }
-      XGRAMMAR_DCHECK(sequence.type == GrammarExprType::kSequence);
-      auto state = ParserState(rule_id, sequence_id, 0, ParserState::kNoPrevInputPos, 0);
-      for (int element_id = 0; element_id < sequence.size(); ++element_id) {
-        state.element_id = element_id;
-        auto element = compiled_grammar_impl->grammar->GetGrammarExpr(sequence[element_id]);
-        if (element.type == GrammarExprType::kRuleRef || element.type == GrammarExprType::kRepeat) {
-          continue;
+        const auto& tokenizer_info = tokenizer_infos[tokenizer_idx];
+        auto grammar_matcher = GrammarMatcherForTokenMaskCache(
+            prepared_grammar->grammar,
+            state,
+            tag_dispatch_rule_id_to_second_slicing_bitsets[tokenizer_idx],
+            prepared_grammar->rule_follow_bytes[state.rule_id],
+            false
+        );
+        auto cur_adaptive_token_mask_cache = grammar_matcher.GetAdaptiveTokenMask(
+            tokenizer_info.GetVocabSize(),
+            tokenizer_info.GetSortedDecodedVocab(),
+            tokenizer_info.GetTrieSubtreeNodesRange(),
+            is_root_rule
+        );
+        if (budget.has_value()) {
+          (*budget)->AddMemoryBytes(MemorySize(cur_adaptive_token_mask_cache));
         }
-        if (element.type == GrammarExprType::kByteString) {
-          for (int idx = 0; idx < element.size(); ++idx) {
-            state.sub_element_id = idx;
-            add_task_adaptive_token_mask(state, rule_id == root_rule_id);
-          }
+        auto& adaptive_token_mask_cache =
+            compiled_grammar_impls[tokenizer_idx]->adaptive_token_mask_cache;
+        if (max_threads > 1) {
+          std::lock_guard<std::mutex> lock(adaptive_token_mask_cache_mutex.value());
+          adaptive_token_mask_cache[state] = cur_adaptive_token_mask_cache;
         } else {
-          XGRAMMAR_DCHECK(
-              element.type == GrammarExprType::kCharacterClassStar ||
-              element.type == GrammarExprType::kCharacterClass
-          );
-          for (int left_utf8_bytes = 0; left_utf8_bytes <= 3; ++left_utf8_bytes) {
-            state.sub_element_id = left_utf8_bytes;
-            add_task_adaptive_token_mask(state, rule_id == root_rule_id);
-          }
+          adaptive_token_mask_cache[state] = cur_adaptive_token_mask_cache;
         }
+      };
+
+  for (std::size_t i = 0; i < tokenizer_infos.size(); ++i) {
+    if (tokenizer_infos[i].GetVocabSize() == 0) {
+      continue;
+    }
+    for (const auto& mask_state : prepared_grammar->token_mask_states) {
+      // Execute depending on whether we use task_group
+      if (max_threads > 1) {
+        task_group->Execute([add_adaptive_token_mask, i, mask_state]() {
+          add_adaptive_token_mask(i, mask_state.first, mask_state.second);
+        });
+      } else {
+        add_adaptive_token_mask(i, mask_state.first, mask_state.second);
       }
     }
   }
 
-  if (max_threads_ > 1) {
-    thread_pool->Join();
+  if (max_threads > 1) {
+    task_group->Wait();
+  }
+
+  std::vector<CompiledGrammar> compiled_grammars;
+  for (auto& compiled_grammar_impl : compiled_grammar_impls) {
+    // Step 4. Compute the initial matcher state, so constructing the matchers does not expand the
+    // root rule or compute the first token mask.
+    compiled_grammar_impl->GetInitialMatcherState();
+    compiled_grammars.emplace_back(std::move(compiled_grammar_impl));
+  }
+  return compiled_grammars;
+}
+
+CompileCostEstimate GrammarCompilerNoCache::EstimateCost(const Grammar& grammar_unoptimized
+) const {
+  // The states accepting at least kWideFirstBytes first bytes, e.g. the states in strings, usually
+  // match the tokens to their ends and accept most of them, while the other states reject most
+  // tokens after a few bytes. The ratios and times below are rough heuristics that depend on the
+  // vocabulary and the machine. cpp/tools/calibrate_compile_cost.cc compares the estimate with the
+  // real compilations of a corpus and fits them; the estimate is meant to rank grammars by cost,
+  // and its memory is within about 3x of the compiled one on that corpus.
+  constexpr int kWideFirstBytes = 32;
+  constexpr double kWideAcceptedRatio = 0.5;
+  constexpr double kNarrowAcceptedRatio = 0.04;
+  constexpr double kUncertainRatio = 0.005;
+  constexpr double kStateTimeUs = 10;
+  constexpr double kWideTokenCheckTimeUs = 0.6;
+  constexpr double kNarrowTokenCheckTimeUs = 0.045;
+
+  auto grammar = GrammarOptimizer::Apply(grammar_unoptimized);
+  CompileCostEstimate estimate;
+  estimate.memory_bytes = MemorySize(grammar) + 2 * sizeof(std::bitset<256>) * grammar->NumRules();
+  if (tokenizer_info_.GetVocabSize() == 0) {
+    return estimate;
   }
 
-  return CompiledGrammar(compiled_grammar_impl);
+  // Estimate the size of every token mask as in the constructor of AdaptiveTokenMask.
+  const auto& sorted_decoded_vocab = tokenizer_info_.GetSortedDecodedVocab();
+  const int64_t num_tokens = static_cast<int64_t>(sorted_decoded_vocab.size());
+  const int64_t bitset_bytes =
+      DynamicBitset::GetBufferSize(tokenizer_info_.GetVocabSize()) * sizeof(uint32_t);
+  double compile_time_us = 0;
+  std::vector<std::pair<int32_t, int32_t>> possible_intervals;
+  ForEachTokenMaskState(grammar, [&](const ParserState& state, bool is_root_rule) {
+    auto first_character_mask = GetFirstCharacterMask(grammar, state);
+    bool is_wide = static_cast<int>(first_character_mask.count()) >= kWideFirstBytes;
+    possible_intervals.clear();
+    int64_t num_checks =
+        GetPossibleTokenIntervals(sorted_decoded_vocab, first_character_mask, possible_intervals);
+    int64_t num_accepted = static_cast<int64_t>(
+        num_checks * (is_wide ? kWideAcceptedRatio : kNarrowAcceptedRatio)
+    );
+    int64_t num_uncertain = is_root_rule ? 0 : static_cast<int64_t>(num_checks * kUncertainRatio);
+    int64_t num_rejected = num_tokens - num_accepted - num_uncertain;
+    int64_t mask_bytes =
+        num_accepted >= AdaptiveTokenMask::USE_BITSET_THRESHOLD &&
+                num_rejected >= AdaptiveTokenMask::USE_BITSET_THRESHOLD
+            ? bitset_bytes
+            : std::min(num_accepted, num_rejected) * static_cast<int64_t>(sizeof(int32_t));
+    mask_bytes += num_uncertain * static_cast<int64_t>(sizeof(int32_t) + sizeof(uint32_t));
+
+    ++estimate.num_mask_states;
+    estimate.num_token_checks += num_checks;
+    estimate.num_uncertain_tokens += num_uncertain;
+    estimate.memory_bytes += sizeof(std::pair<const ParserState, AdaptiveTokenMask>) + mask_bytes;
+    compile_time_us += kStateTimeUs + num_checks * (is_wide ? kWideTokenCheckTimeUs
+                                                            : kNarrowTokenCheckTimeUs);
+  });
+  estimate.compile_time_ms = compile_time_us / 1000;
+  return estimate;
 }
 
 CompiledGrammar GrammarCompilerNoCache::CompileBuiltinJSONGrammar() {
-  return MultiThreadCompileGrammar(Grammar::BuiltinJSONGrammar());
+  return CompileTokenMasks(BuiltinJSONPreparedGrammar(), {tokenizer_info_}, max_threads_)[0];
 }
 
 CompiledGrammar GrammarCompilerNoCache::CompileJSONSchema(
@@ -809,24 +1108,28 @@ CompiledGrammar GrammarCompilerNoCache::CompileGrammar(
   return MultiThreadCompileGrammar(Grammar::FromEBNF(ebnf_str, root_rule_name));
 }
 
+CompiledGrammar GrammarCompilerNoCache::CompileGrammar(const PreparedGrammar& prepared_grammar) {
+  return CompileTokenMasks(prepared_grammar, {tokenizer_info_}, max_threads_)[0];
+}
+
 void GrammarCompilerNoCache::TagDispatchOptimization(
-    std::shared_ptr<CompiledGrammar::Impl> compiled_grammar_impl,
+    Grammar grammar,
+    const TokenizerInfo& tokenizer_info,
     std::unordered_map<int32_t, DynamicBitset>* tag_dispatch_rule_id_to_second_slicing_bitset
 ) {
   using GrammarExprType = Grammar::Impl::GrammarExprType;
   tag_dispatch_rule_id_to_second_slicing_bitset->clear();
 
   // Optimization for TagDispatch: Precompute the definitely accepted tokens.
-  for (int i = 0; i < compiled_grammar_impl->grammar->NumRules(); i++) {
-    const auto& rule = compiled_grammar_impl->grammar->GetRule(i);
-    const auto& rule_body = compiled_grammar_impl->grammar->GetGrammarExpr(rule.body_expr_id);
+  for (int i = 0; i < grammar->NumRules(); i++) {
+    const auto& rule = grammar->GetRule(i);
+    const auto& rule_body = grammar->GetGrammarExpr(rule.body_expr_id);
     if (rule_body.type != GrammarExprType::kTagDispatch) {
       continue;
     }
     XGRAMMAR_DCHECK(rule_body.type == GrammarExprType::kTagDispatch);
-    Grammar::Impl::TagDispatch tag_dispatch =
-        compiled_grammar_impl->GetGrammar()->GetTagDispatch(rule.body_expr_id);
-    const auto& sorted_decoded_vocab = tokenizer_info_.GetSortedDecodedVocab();
+    Grammar::Impl::TagDispatch tag_dispatch = grammar->GetTagDispatch(rule.body_expr_id);
+    const auto& sorted_decoded_vocab = tokenizer_info.GetSortedDecodedVocab();
     DynamicBitset definite_accepted_tokens_since_second_char(sorted_decoded_vocab.size());
     for (int i = 0; i < static_cast<int32_t>(sorted_decoded_vocab.size()); i++) {
       bool definite_accept_since_second_char = true;
@@ -916,8 +1219,25 @@ class GrammarCompilerCacheKeys {
     XGRAMMAR_EQUAL_BY_MEMBERS_EMPTY(BuiltinJSONGrammarKey);
   };
 
-  using UnionKey =
-      std::variant<SchemaKey, StructuralTagKey, GrammarKey, RegexKey, BuiltinJSONGrammarKey>;
+  struct PreparedGrammarKey {
+    // The prepared grammar is identified by its address, and kept alive by the key.
+    PreparedGrammar prepared_grammar;
+
+    friend bool operator==(const PreparedGrammarKey& lhs, const PreparedGrammarKey& rhs) noexcept {
+      return lhs.prepared_grammar.ImplPtr() == rhs.prepared_grammar.ImplPtr();
+    }
+    friend bool operator!=(const PreparedGrammarKey& lhs, const PreparedGrammarKey& rhs) noexcept {
+      return !(lhs == rhs);
+    }
+  };
+
+  using UnionKey = std::variant<
+      SchemaKey,
+      StructuralTagKey,
+      GrammarKey,
+      RegexKey,
+      BuiltinJSONGrammarKey,
+      PreparedGrammarKey>;
 };
 
 }  // namespace xgrammar
@@ -950,8 +1270,263 @@ XGRAMMAR_HASH_BY_MEMBERS(
 
 XGRAMMAR_HASH_BY_MEMBERS_EMPTY(xgrammar::GrammarCompilerCacheKeys::BuiltinJSONGrammarKey);
 
+namespace std {
+template <>
+struct hash<xgrammar::GrammarCompilerCacheKeys::PreparedGrammarKey> {
+  size_t operator()(const xgrammar::GrammarCompilerCacheKeys::PreparedGrammarKey& key) const {
+    return hash<const xgrammar::PreparedGrammar::Impl*>()(key.prepared_grammar.ImplPtr());
+  }
+};
+}  // namespace std
+
 namespace xgrammar {
 
+/******************* Cache manifest *******************/
+
+XGRAMMAR_MEMBER_TABLE(
+    GrammarCompilerCacheKeys::SchemaKey,
+    "schema",
+    &GrammarCompilerCacheKeys::SchemaKey::schema,
+    "any_whitespace",
+    &GrammarCompilerCacheKeys::SchemaKey::any_whitespace,
+    "indent",
+    &GrammarCompilerCacheKeys::SchemaKey::indent,
+    "separators",
+    &GrammarCompilerCacheKeys::SchemaKey::separators,
+    "strict_mode",
+    &GrammarCompilerCacheKeys::SchemaKey::strict_mode,
+    "max_whitespace_cnt",
+    &GrammarCompilerCacheKeys::SchemaKey::max_whitespace_cnt
+);
+
+XGRAMMAR_MEMBER_TABLE(
+    GrammarCompilerCacheKeys::StructuralTagKey,
+    "structural_tag_json",
+    &GrammarCompilerCacheKeys::StructuralTagKey::structural_tag_json
+);
+
+XGRAMMAR_MEMBER_TABLE(
+    GrammarCompilerCacheKeys::GrammarKey,
+    "ebnf_str",
+    &GrammarCompilerCacheKeys::GrammarKey::ebnf_str,
+    "root_rule_name",
+    &GrammarCompilerCacheKeys::GrammarKey::root_rule_name
+);
+
+XGRAMMAR_MEMBER_TABLE(
+    GrammarCompilerCacheKeys::RegexKey, "regex", &GrammarCompilerCacheKeys::RegexKey::regex
+);
+
+namespace {
+
+/*! \brief A cache key of the manifest to prewarm, with its priority. */
+struct CacheManifestEntry {
+  GrammarCompilerCacheKeys::UnionKey key;
+  double priority;
+};
+
+/*! \brief The "type" of the manifest entries of the key type. */
+template <typename KeyType>
+constexpr const char* GetCacheManifestEntryType() {
+  if constexpr (std::is_same_v<KeyType, GrammarCompilerCacheKeys::SchemaKey>) {
+    return "json_schema";
+  } else if constexpr (std::is_same_v<KeyType, GrammarCompilerCacheKeys::StructuralTagKey>) {
+    return "structural_tag";
+  } else if constexpr (std::is_same_v<KeyType, GrammarCompilerCacheKeys::GrammarKey>) {
+    return "grammar";
+  } else if constexpr (std::is_same_v<KeyType, GrammarCompilerCacheKeys::RegexKey>) {
+    return "regex";
+  } else if constexpr (std::is_same_v<KeyType, GrammarCompilerCacheKeys::BuiltinJSONGrammarKey>) {
+    return "builtin_json_grammar";
+  } else {
+    return nullptr;
+  }
+}
+
+/*!
+ * \brief Serialize a cache key to a manifest entry. Return std::nullopt if the key cannot be
+ * serialized, i.e. the key of a prepared grammar.
+ */
+std::optional<picojson::value> SerializeCacheManifestEntry(
+    const GrammarCompilerCacheKeys::UnionKey& union_key
+) {
+  return std::visit(
+      [](const auto& key) -> std::optional<picojson::value> {
+        using KeyType = std::decay_t<decltype(key)>;
+        constexpr const char* type = GetCacheManifestEntryType<KeyType>();
+        if constexpr (type == nullptr) {
+          return std::nullopt;
+        } else {
+          auto entry = picojson::object{};
+          if constexpr (!std::is_same_v<KeyType, GrammarCompilerCacheKeys::BuiltinJSONGrammarKey>) {
+            entry = AutoSerializeJSONValue(key).template get<picojson::object>();
+          }
+          entry["type"] = picojson::value(type);
+          return picojson::value(std::move(entry));
+        }
+      },
+      union_key
+  );
+}
+
+const char kCacheManifestTypeName[] = "CacheManifest";
+
+/*! \brief Parse an entry of a cache manifest. See GrammarCompiler::Prewarm for the format. */
+std::variant<CacheManifestEntry, SerializationError> ParseCacheManifestEntry(
+    const picojson::value& value
+) {
+  using Keys = GrammarCompilerCacheKeys;
+  if (!value.is<picojson::object>()) {
+    return ConstructDeserializeError("Expect an object for each entry", kCacheManifestTypeName);
+  }
+  const auto& object = value.get<picojson::object>();
+  auto type_it = object.find("type");
+  if (type_it == object.end() || !type_it->second.is<std::string>()) {
+    return ConstructDeserializeError(
+        "Expect a string \"type\" for each entry", kCacheManifestTypeName
+    );
+  }
+  const auto& type = type_it->second.get<std::string>();
+  double priority = 0;
+  if (auto priority_it = object.find("priority"); priority_it != object.end()) {
+    if (!priority_it->second.is<double>()) {
+      return ConstructDeserializeError("Expect a numeric \"priority\"", kCacheManifestTypeName);
+    }
+    priority = priority_it->second.get<double>();
+  }
+
+  auto make_entry = [&](auto key) -> std::variant<CacheManifestEntry, SerializationError> {
+    if (auto error = AutoDeserializeJSONValue(&key, value, kCacheManifestTypeName)) {
+      return error.value();
+    }
+    return CacheManifestEntry{std::move(key), priority};
+  };
+  if (type == GetCacheManifestEntryType<Keys::SchemaKey>()) {
+    return make_entry(Keys::SchemaKey{});
+  } else if (type == GetCacheManifestEntryType<Keys::StructuralTagKey>()) {
+    return make_entry(Keys::StructuralTagKey{});
+  } else if (type == GetCacheManifestEntryType<Keys::GrammarKey>()) {
+    return make_entry(Keys::GrammarKey{});
+  } else if (type == GetCacheManifestEntryType<Keys::RegexKey>()) {
+    return make_entry(Keys::RegexKey{});
+  } else if (type == GetCacheManifestEntryType<Keys::BuiltinJSONGrammarKey>()) {
+    return CacheManifestEntry{Keys::BuiltinJSONGrammarKey{}, priority};
+  } else {
+    return ConstructDeserializeError("Unknown entry type " + type, kCacheManifestTypeName);
+  }
+}
+
+/*! \brief Parse the entries of a cache manifest. */
+std::variant<std::vector<CacheManifestEntry>, SerializationError> ParseCacheManifest(
+    const std::string& manifest_json
+) {
+  picojson::value manifest;
+  if (auto error = picojson::parse(manifest, manifest_json); !error.empty()) {
+    return InvalidJSONError(error);
+  }
+  if (!manifest.is<picojson::array>()) {
+    return ConstructDeserializeError("Expect an array of entries", kCacheManifestTypeName);
+  }
+  std::vector<CacheManifestEntry> entries;
+  for (const auto& value : manifest.get<picojson::array>()) {
+    auto entry = ParseCacheManifestEntry(value);
+    if (std::holds_alternative<SerializationError>(entry)) {
+      return std::get<SerializationError>(std::move(entry));
+    }
+    entries.push_back(std::get<CacheManifestEntry>(std::move(entry)));
+  }
+  return entries;
+}
+
+}  // namespace
+
+/******************* Vocabulary sharing *******************/
+
+namespace {
+
+/*!
+ * \brief The live compiled grammars of all the compilers of the process, by the vocabulary hash of
+ * their tokenizers and their cache keys. The token masks only depend on the vocabulary, so a
+ * compiler reuses the masks compiled by the compiler of another tokenizer with the same vocabulary,
+ * e.g. a fine-tuned variant with different stop tokens. The vocabulary hash only selects the
+ * candidate, and the vocabularies are compared before a grammar is reused, so a hash collision
+ * cannot share wrong masks. The grammars are weakly referenced, and dropped when no cache or
+ * matcher holds them.
+ */
+class VocabSharedGrammars {
+ public:
+  using UnionKey = GrammarCompilerCacheKeys::UnionKey;
+
+  static VocabSharedGrammars& Global() {
+    static VocabSharedGrammars instance;
+    return instance;
+  }
+
+  /*!
+   * \brief Get the grammar of the key compiled for a tokenizer with the vocabulary hash, bound to
+   * the tokenizer info. std::nullopt if there is no live one, or its vocabulary differs from the
+   * one of the tokenizer info.
+   */
+  std::optional<CompiledGrammar> Get(
+      std::size_t vocab_hash, const UnionKey& key, const TokenizerInfo& tokenizer_info
+  ) {
+    std::shared_ptr<CompiledGrammar::Impl> compiled_grammar;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = grammars_.find({vocab_hash, key});
+      if (it == grammars_.end() || it->second.vocab_size != tokenizer_info.GetVocabSize()) {
+        return std::nullopt;
+      }
+      compiled_grammar = it->second.compiled_grammar.lock();
+    }
+    if (compiled_grammar == nullptr) return std::nullopt;
+    const auto& owner_tokenizer_info = compiled_grammar->tokenizer_info;
+    if (owner_tokenizer_info.ImplPtr() == tokenizer_info.ImplPtr()) {
+      return CompiledGrammar(std::move(compiled_grammar));
+    }
+    if (owner_tokenizer_info.GetSortedDecodedVocab() != tokenizer_info.GetSortedDecodedVocab()) {
+      return std::nullopt;
+    }
+    return compiled_grammar->WithTokenizerInfo(tokenizer_info);
+  }
+
+  void Put(std::size_t vocab_hash, const UnionKey& key, CompiledGrammar compiled_grammar) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    grammars_.insert_or_assign(
+        {vocab_hash, key},
+        Entry{compiled_grammar->tokenizer_info.GetVocabSize(), compiled_grammar->weak_from_this()}
+    );
+    // Drop the expired grammars when the map doubles, so the cost is amortized.
+    if (grammars_.size() >= 2 * num_grammars_after_prune_) {
+      for (auto it = grammars_.begin(); it != grammars_.end();) {
+        it = it->second.compiled_grammar.expired() ? grammars_.erase(it) : std::next(it);
+      }
+      num_grammars_after_prune_ = std::max<std::size_t>(grammars_.size(), 64);
+    }
+  }
+
+ private:
+  using VocabKey = std::pair<std::size_t, UnionKey>;
+
+  struct Entry {
+    /*! \brief The vocabulary size of the tokenizer the grammar is compiled for. */
+    int vocab_size;
+    std::weak_ptr<CompiledGrammar::Impl> compiled_grammar;
+  };
+
+  struct VocabKeyHash {
+    std::size_t operator()(const VocabKey& key) const {
+      return HashCombine(key.first, std::hash<UnionKey>{}(key.second));
+    }
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<VocabKey, Entry, VocabKeyHash> grammars_;
+  std::size_t num_grammars_after_prune_ = 64;
+};
+
+}  // namespace
+
 /*!
  * \brief The implementation of the grammar compiler with cache. It calls the no cache compiler
  * to compile the grammar, and implements the cache logic upon it.
@@ -965,6 +1540,7 @@ class GrammarCompiler::Impl {
       int64_t max_memory_bytes
   )
       : no_cache_compiler_(tokenizer_info, max_threads),
+        vocab_hash_(tokenizer_info->ComputeVocabHash()),
         cache_enabled_(cache_enabled),
         compile_cache_(static_cast<std::size_t>(max_memory_bytes), Computer(*this)) {
     if (max_memory_bytes < -1) {
@@ -973,6 +1549,12 @@ class GrammarCompiler::Impl {
     }
   }
 
+  ~Impl() {
+    // The queued prewarm tasks refer to this compiler. Skip their compilation and wait for them.
+    prewarm_stopped_.store(true, std::memory_order_relaxed);
+    WaitForPrewarm();
+  }
+
   CompiledGrammar CompileBuiltinJSONGrammar();
 
   CompiledGrammar CompileJSONSchema(
@@ -992,9 +1574,26 @@ class GrammarCompiler::Impl {
 
   CompiledGrammar CompileGrammar(const std::string& ebnf_str, std::string root_rule_name);
 
+  CompiledGrammar CompileGrammar(const PreparedGrammar& prepared_grammar);
+
+  CompileCostEstimate EstimateCost(const Grammar& grammar) const;
+
+  void Prewarm(const std::string& manifest_json);
+
+  void WaitForPrewarm();
+
+  std::string ExportCacheManifest();
+
+  void SetCompileServer(const std::string& socket_path, int64_t timeout_ms);
+
+  void SetSharedCache(const SharedGrammarCache& shared_cache);
+
+  /*! \brief Get the compiled grammar of the key, from the cache if it is enabled. */
+  CompiledGrammar CompileKey(const GrammarCompilerCacheKeys::UnionKey& key);
+
   void ClearCache();
 
-  int64_t GetCacheSizeBytes() const;
+  int64_t GetCacheSizeBytes();
 
   int64_t CacheLimitBytes() const;
 
@@ -1004,10 +1603,31 @@ class GrammarCompiler::Impl {
   using GrammarKey = GrammarCompilerCacheKeys::GrammarKey;
   using RegexKey = GrammarCompilerCacheKeys::RegexKey;
   using BuiltinJSONGrammarKey = GrammarCompilerCacheKeys::BuiltinJSONGrammarKey;
+  using PreparedGrammarKey = GrammarCompilerCacheKeys::PreparedGrammarKey;
   using UnionKey = GrammarCompilerCacheKeys::UnionKey;
 
+  /*!
+   * \brief Get the compiled grammar of the key from the compilers of the same vocabulary, or the
+   * shared cache, or compile it. The compilers of the same vocabulary are skipped if the cache is
+   * disabled.
+   */
   CompiledGrammar Compute(const UnionKey& key);
 
+  /*! \brief Get the compiled grammar of the key from the shared cache, or compile it. */
+  CompiledGrammar ComputeFromSharedCache(const UnionKey& key);
+
+  /*! \brief Compile the key with the compile server, or in this process. */
+  CompiledGrammar CompileUncached(const UnionKey& key);
+
+  /*!
+   * \brief Compile the key with the compile server. Return std::nullopt if it cannot be compiled
+   * there, so it should be compiled in this process.
+   */
+  std::optional<CompiledGrammar> CompileWithServer(const UnionKey& key);
+
+  /*! \brief Compile the key of a manifest into the cache. Run by the executor. */
+  void RunPrewarmTask(const UnionKey& key);
+
   struct Computer {
     Computer(Impl& compiler) : compiler(compiler) {}
     // Forward the key to GrammarCompiler::Impl::Compute(key)
@@ -1019,17 +1639,92 @@ class GrammarCompiler::Impl {
     std::size_t operator()(const CompiledGrammar& value) const { return value.MemorySizeBytes(); }
   };
 
+  /*!
+   * \brief Update the sizes of the cached grammars sharing the masks of another compiler's grammar,
+   * which count the masks once the owner is evicted. See MemorySize of CompiledGrammar::Impl.
+   */
+  void UpdateSharedMaskSizes() {
+    compile_cache_.UpdateMemorySize([](const CompiledGrammar& value) {
+      return value->mask_owner != nullptr;
+    });
+  }
+
+  // Keep the cold grammars in a compact form under memory pressure, instead of evicting them.
+  struct Compactor {
+    std::optional<CompiledGrammar> Compact(const CompiledGrammar& value) const {
+      return value->Compact();
+    }
+    bool IsCompacted(const CompiledGrammar& value) const { return value->IsCompacted(); }
+    CompiledGrammar Restore(const CompiledGrammar& value) const { return value->Restore(); }
+  };
+
   /*! \brief The no cache compiler. */
   GrammarCompilerNoCache no_cache_compiler_;
 
+  /*! \brief The vocabulary hash of the tokenizer. See VocabSharedGrammars. */
+  const std::size_t vocab_hash_;
+
   /*! \brief Whether the cache is enabled. */
   const bool cache_enabled_;
 
+  /*! \brief The client of the compile server. nullptr if the grammars are compiled locally. */
+  std::unique_ptr<CompileServerClient> compile_server_client_;
+
+  /*! \brief The cache shared by the processes of the host. std::nullopt if it is not set. */
+  std::optional<SharedGrammarCache> shared_cache_;
+  /*! \brief Prefixed to the keys of the shared cache to distinguish the tokenizers. */
+  std::string shared_cache_key_prefix_;
+
   /*! \brief The cache for compiled grammars. */
-  ThreadSafeLRUCache<UnionKey, CompiledGrammar, Computer, SizeEstimator> compile_cache_;
+  ThreadSafeLRUCache<UnionKey, CompiledGrammar, Computer, SizeEstimator, Compactor> compile_cache_;
+
+  /*! \brief Protects num_prewarm_tasks_. */
+  std::mutex prewarm_mutex_;
+  /*! \brief Notified when all the prewarm tasks finish. */
+  std::condition_variable prewarm_done_;
+  /*! \brief The number of prewarm tasks queued or running on the executor. */
+  int64_t num_prewarm_tasks_ = 0;
+  /*! \brief Whether the compiler is being destroyed, so the queued prewarm tasks are skipped. */
+  std::atomic<bool> prewarm_stopped_{false};
 };
 
 CompiledGrammar GrammarCompiler::Impl::Compute(const UnionKey& key) {
+  // The grammars of other compilers are not reused if the cache is disabled.
+  if (!cache_enabled_) return ComputeFromSharedCache(key);
+  UpdateSharedMaskSizes();
+  const auto& tokenizer_info = no_cache_compiler_.GetTokenizerInfo();
+  if (auto compiled_grammar = VocabSharedGrammars::Global().Get(vocab_hash_, key, tokenizer_info)) {
+    return compiled_grammar.value();
+  }
+  auto compiled_grammar = ComputeFromSharedCache(key);
+  VocabSharedGrammars::Global().Put(vocab_hash_, key, compiled_grammar);
+  return compiled_grammar;
+}
+
+CompiledGrammar GrammarCompiler::Impl::ComputeFromSharedCache(const UnionKey& key) {
+  if (!shared_cache_.has_value()) return CompileUncached(key);
+  auto entry = SerializeCacheManifestEntry(key);
+  if (!entry.has_value()) return CompileUncached(key);
+
+  auto shared_cache_key = shared_cache_key_prefix_ + entry->serialize();
+  if (auto compiled_grammar_json = (*shared_cache_)->Get(shared_cache_key)) {
+    // The grammars stored by another version of the library are compiled again.
+    auto result = CompiledGrammar::DeserializeJSON(
+        compiled_grammar_json.value(), no_cache_compiler_.GetTokenizerInfo()
+    );
+    if (std::holds_alternative<CompiledGrammar>(result)) {
+      return std::get<CompiledGrammar>(std::move(result));
+    }
+  }
+  auto compiled_grammar = CompileUncached(key);
+  (*shared_cache_)->Put(shared_cache_key, compiled_grammar.SerializeJSON());
+  return compiled_grammar;
+}
+
+CompiledGrammar GrammarCompiler::Impl::CompileUncached(const UnionKey& key) {
+  if (compile_server_client_ != nullptr) {
+    if (auto compiled_grammar = CompileWithServer(key)) return compiled_grammar.value();
+  }
   return std::visit(
       [this](const auto& key) -> CompiledGrammar {
         using KeyType = std::decay_t<decltype(key)>;
@@ -1050,6 +1745,8 @@ CompiledGrammar GrammarCompiler::Impl::Compute(const UnionKey& key) {
           return this->no_cache_compiler_.CompileRegex(regex);
         } else if constexpr (std::is_same_v<KeyType, BuiltinJSONGrammarKey>) {
           return this->no_cache_compiler_.CompileBuiltinJSONGrammar();
+        } else if constexpr (std::is_same_v<KeyType, PreparedGrammarKey>) {
+          return this->no_cache_compiler_.CompileGrammar(key.prepared_grammar);
         } else {
           XGRAMMAR_UNREACHABLE();
         }
@@ -1058,11 +1755,23 @@ CompiledGrammar GrammarCompiler::Impl::Compute(const UnionKey& key) {
   );
 }
 
-CompiledGrammar GrammarCompiler::Impl::CompileBuiltinJSONGrammar() {
+std::optional<CompiledGrammar> GrammarCompiler::Impl::CompileWithServer(const UnionKey& key) {
+  // The budget cannot be applied to the compilation on the server.
+  if (CompileBudget::Impl::Current() != nullptr) return std::nullopt;
+  auto entry = SerializeCacheManifestEntry(key);
+  if (!entry.has_value()) return std::nullopt;
+  return compile_server_client_->Compile(entry->serialize());
+}
+
+CompiledGrammar GrammarCompiler::Impl::CompileKey(const UnionKey& key) {
   if (!cache_enabled_) {
-    return no_cache_compiler_.CompileBuiltinJSONGrammar();
+    return Compute(key);
   }
-  return compile_cache_.Get(BuiltinJSONGrammarKey{});
+  return compile_cache_.Get(key);
+}
+
+CompiledGrammar GrammarCompiler::Impl::CompileBuiltinJSONGrammar() {
+  return CompileKey(BuiltinJSONGrammarKey{});
 }
 
 CompiledGrammar GrammarCompiler::Impl::CompileJSONSchema(
@@ -1073,50 +1782,114 @@ CompiledGrammar GrammarCompiler::Impl::CompileJSONSchema(
     bool strict_mode,
     std::optional<int> max_whitespace_cnt
 ) {
-  if (!cache_enabled_) {
-    return no_cache_compiler_.CompileJSONSchema(
-        schema, any_whitespace, indent, separators, strict_mode, max_whitespace_cnt
-    );
-  }
-  return compile_cache_.Get(
+  return CompileKey(
       SchemaKey{schema, any_whitespace, indent, separators, strict_mode, max_whitespace_cnt}
   );
 }
 
 CompiledGrammar GrammarCompiler::Impl::CompileStructuralTag(const std::string& structural_tag_json
 ) {
-  if (!cache_enabled_) {
-    return no_cache_compiler_.CompileStructuralTag(structural_tag_json);
-  }
-  return compile_cache_.Get(StructuralTagKey{structural_tag_json});
+  return CompileKey(StructuralTagKey{structural_tag_json});
 }
 
 CompiledGrammar GrammarCompiler::Impl::CompileRegex(const std::string& regex) {
-  if (!cache_enabled_) {
-    return no_cache_compiler_.CompileRegex(regex);
-  }
-  return compile_cache_.Get(RegexKey{regex});
+  return CompileKey(RegexKey{regex});
 }
 
 CompiledGrammar GrammarCompiler::Impl::CompileGrammar(const Grammar& grammar) {
-  if (!cache_enabled_) {
+  if (!cache_enabled_ && compile_server_client_ == nullptr && !shared_cache_.has_value()) {
     return no_cache_compiler_.CompileGrammar(grammar);
   }
-  return compile_cache_.Get(GrammarKey{grammar.ToString(), grammar->GetRootRule().name});
+  return CompileKey(GrammarKey{grammar.ToString(), grammar->GetRootRule().name});
 }
 
 CompiledGrammar GrammarCompiler::Impl::CompileGrammar(
     const std::string& ebnf_str, std::string root_rule_name
 ) {
-  if (!cache_enabled_) {
-    return no_cache_compiler_.CompileGrammar(ebnf_str, root_rule_name);
+  return CompileKey(GrammarKey{ebnf_str, root_rule_name});
+}
+
+CompiledGrammar GrammarCompiler::Impl::CompileGrammar(const PreparedGrammar& prepared_grammar) {
+  return CompileKey(PreparedGrammarKey{prepared_grammar});
+}
+
+CompileCostEstimate GrammarCompiler::Impl::EstimateCost(const Grammar& grammar) const {
+  return no_cache_compiler_.EstimateCost(grammar);
+}
+
+void GrammarCompiler::Impl::Prewarm(const std::string& manifest_json) {
+  auto result = ParseCacheManifest(manifest_json);
+  if (std::holds_alternative<SerializationError>(result)) {
+    ThrowVariantError(std::get<SerializationError>(result));
+  }
+  if (!cache_enabled_) return;
+
+  auto entries = std::get<std::vector<CacheManifestEntry>>(std::move(result));
+  std::stable_sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.priority > rhs.priority;
+  });
+  {
+    std::lock_guard<std::mutex> lock(prewarm_mutex_);
+    num_prewarm_tasks_ += static_cast<int64_t>(entries.size());
+  }
+  // The executor queue is FIFO, so the entries are started in the order of their priorities.
+  for (auto& entry : entries) {
+    Executor::Global().Execute(TaskPriority::kPrewarm, [this, key = std::move(entry.key)] {
+      RunPrewarmTask(key);
+    });
+  }
+}
+
+void GrammarCompiler::Impl::RunPrewarmTask(const UnionKey& key) {
+  // The compilation runs on an executor worker and waits for its own task group. This is safe even
+  // if all the workers are prewarming, since TaskGroup::Wait runs the queued tasks of the group
+  // itself instead of waiting for a free worker.
+  if (!prewarm_stopped_.load(std::memory_order_relaxed)) {
+    try {
+      compile_cache_.Get(key);
+    } catch (const std::exception& e) {
+      XGRAMMAR_LOG(WARNING) << "Failed to prewarm an entry of the cache manifest: " << e.what();
+    }
+  }
+  std::lock_guard<std::mutex> lock(prewarm_mutex_);
+  if (--num_prewarm_tasks_ == 0) {
+    prewarm_done_.notify_all();
   }
-  return compile_cache_.Get(GrammarKey{ebnf_str, root_rule_name});
+}
+
+void GrammarCompiler::Impl::WaitForPrewarm() {
+  std::unique_lock<std::mutex> lock(prewarm_mutex_);
+  prewarm_done_.wait(lock, [this] { return num_prewarm_tasks_ == 0; });
+}
+
+void GrammarCompiler::Impl::SetCompileServer(const std::string& socket_path, int64_t timeout_ms) {
+  compile_server_client_ = std::make_unique<CompileServerClient>(
+      socket_path, no_cache_compiler_.GetTokenizerInfo(), timeout_ms
+  );
+}
+
+void GrammarCompiler::Impl::SetSharedCache(const SharedGrammarCache& shared_cache) {
+  shared_cache_ = shared_cache;
+  auto tokenizer_hash = SharedGrammarCache::Impl::HashKey(
+      no_cache_compiler_.GetTokenizerInfo().SerializeJSON()
+  );
+  shared_cache_key_prefix_ = std::to_string(tokenizer_hash) + "\n";
+}
+
+std::string GrammarCompiler::Impl::ExportCacheManifest() {
+  auto manifest = picojson::array{};
+  for (const auto& key : compile_cache_.GetKeys()) {
+    if (auto entry = SerializeCacheManifestEntry(key)) {
+      manifest.push_back(std::move(entry.value()));
+    }
+  }
+  return picojson::value(std::move(manifest)).serialize();
 }
 
 void GrammarCompiler::Impl::ClearCache() { compile_cache_.Clear(); }
 
-int64_t GrammarCompiler::Impl::GetCacheSizeBytes() const {
+int64_t GrammarCompiler::Impl::GetCacheSizeBytes() {
+  if (cache_enabled_) UpdateSharedMaskSizes();
   return static_cast<int64_t>(compile_cache_.MemorySize());
 }
 
@@ -1172,8 +1945,52 @@ CompiledGrammar GrammarCompiler::CompileGrammar(
   return pimpl_->CompileGrammar(ebnf_str, root_rule_name);
 }
 
+CompiledGrammar GrammarCompiler::CompileGrammar(const PreparedGrammar& prepared_grammar) {
+  return pimpl_->CompileGrammar(prepared_grammar);
+}
+
+std::vector<CompiledGrammar> GrammarCompiler::CompileGrammarForTokenizers(
+    const PreparedGrammar& prepared_grammar,
+    const std::vector<TokenizerInfo>& tokenizer_infos,
+    int max_threads
+) {
+  return GrammarCompilerNoCache::CompileTokenMasks(prepared_grammar, tokenizer_infos, max_threads);
+}
+
+CompileCostEstimate GrammarCompiler::EstimateCost(const Grammar& grammar) const {
+  return pimpl_->EstimateCost(grammar);
+}
+
+void GrammarCompiler::Prewarm(const std::string& manifest_json) { pimpl_->Prewarm(manifest_json); }
+
+void GrammarCompiler::WaitForPrewarm() { pimpl_->WaitForPrewarm(); }
+
+std::string GrammarCompiler::ExportCacheManifest() const { return pimpl_->ExportCacheManifest(); }
+
+void GrammarCompiler::SetCompileServer(const std::string& socket_path, int64_t timeout_ms) {
+  pimpl_->SetCompileServer(socket_path, timeout_ms);
+}
+
+void GrammarCompiler::SetSharedCache(const SharedGrammarCache& shared_cache) {
+  pimpl_->SetSharedCache(shared_cache);
+}
+
 void GrammarCompiler::ClearCache() { pimpl_->ClearCache(); }
 
+/******************* Compile server *******************/
+
+CompiledGrammar CompileCacheManifestEntry(GrammarCompiler compiler, const std::string& entry_json) {
+  picojson::value value;
+  if (auto error = picojson::parse(value, entry_json); !error.empty()) {
+    throw InvalidJSONError(error);
+  }
+  auto entry = ParseCacheManifestEntry(value);
+  if (std::holds_alternative<SerializationError>(entry)) {
+    ThrowVariantError(std::get<SerializationError>(entry));
+  }
+  return compiler->CompileKey(std::get<CacheManifestEntry>(entry).key);
+}
+
 int64_t GrammarCompiler::GetCacheSizeBytes() const { return pimpl_->GetCacheSizeBytes(); }
 
 int64_t GrammarCompiler::CacheLimitBytes() const { return pimpl_->CacheLimitBytes(); }
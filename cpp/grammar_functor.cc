@@ -7,17 +7,23 @@
 
 #include <xgrammar/xgrammar.h>
 
+#include <algorithm>
 #include <bitset>
 #include <cstdint>
+#include <optional>
 #include <queue>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "compile_budget.h"
 #include "fsm_builder.h"
 #include "grammar_builder.h"
 #include "grammar_impl.h"
 #include "support/encoding.h"
 #include "support/logging.h"
+#include "support/utils.h"
 #include "xgrammar/grammar.h"
 
 namespace xgrammar {
@@ -25,6 +31,45 @@ namespace xgrammar {
 using GrammarExpr = Grammar::Impl::GrammarExpr;
 using ExprType = Grammar::Impl::GrammarExprType;
 
+/*!
+ * \brief Get the rules in the post order of the rule reference graph, so a rule comes after the
+ * rules it references unless they are in the same cycle. A fixed point computation propagating
+ * from referenced rules to referring rules visits each rule once in this order if the grammar is
+ * not recursive.
+ * \param referenced_rules The rules referenced by each rule.
+ */
+static std::vector<int32_t> GetRulePostOrder(
+    const std::vector<std::vector<int32_t>>& referenced_rules
+) {
+  auto num_rules = static_cast<int>(referenced_rules.size());
+  std::vector<int32_t> order;
+  order.reserve(num_rules);
+  std::vector<bool> visited(num_rules, false);
+  // The rule being visited and the position of its next referenced rule.
+  std::vector<std::pair<int32_t, int32_t>> dfs_stack;
+  for (int start = 0; start < num_rules; ++start) {
+    if (visited[start]) {
+      continue;
+    }
+    visited[start] = true;
+    dfs_stack.emplace_back(start, 0);
+    while (!dfs_stack.empty()) {
+      auto& [rule_id, ref_pos] = dfs_stack.back();
+      if (ref_pos < static_cast<int32_t>(referenced_rules[rule_id].size())) {
+        auto ref_rule_id = referenced_rules[rule_id][ref_pos++];
+        if (!visited[ref_rule_id]) {
+          visited[ref_rule_id] = true;
+          dfs_stack.emplace_back(ref_rule_id, 0);
+        }
+        continue;
+      }
+      order.push_back(rule_id);
+      dfs_stack.pop_back();
+    }
+  }
+  return order;
+}
+
 /*************************** Impl of grammar constructors ***************************/
 
 /*!
@@ -516,10 +561,13 @@ class RuleInlinerImpl : public GrammarMutator {
         continue;
       }
       auto rule_ref_id = first_element[0];
-      if (can_rule_be_inlined_.count(rule_ref_id) == 0) {
-        can_rule_be_inlined_[rule_ref_id] = CheckIfRuleCanBeInlined(rule_ref_id);
+      if (can_rule_be_inlined_.empty()) {
+        can_rule_be_inlined_.assign(base_grammar_->NumRules(), kUnknown);
+      }
+      if (can_rule_be_inlined_[rule_ref_id] == kUnknown) {
+        can_rule_be_inlined_[rule_ref_id] = CheckIfRuleCanBeInlined(rule_ref_id) ? kYes : kNo;
       }
-      if (!can_rule_be_inlined_[rule_ref_id]) {
+      if (can_rule_be_inlined_[rule_ref_id] == kNo) {
         new_choice_ids.push_back(VisitExpr(choice_expr));
         continue;
       }
@@ -575,7 +623,9 @@ class RuleInlinerImpl : public GrammarMutator {
     return true;
   }
 
-  std::unordered_map<int32_t, bool> can_rule_be_inlined_;
+  enum CanBeInlined : int8_t { kUnknown, kYes, kNo };
+  // Indexed by rule id. It is filled lazily, so each rule is only checked once.
+  std::vector<CanBeInlined> can_rule_be_inlined_;
 };
 
 /*!
@@ -589,7 +639,7 @@ class UsedRulesAnalyzer : public GrammarVisitor<std::vector<int32_t>> {
   std::vector<int32_t> Apply(const Grammar& grammar) final {
     InitGrammar(grammar);
 
-    std::set<int32_t> visited;
+    std::vector<bool> visited(base_grammar_->NumRules(), false);
 
     std::queue<int32_t>().swap(visit_queue_);
 
@@ -597,10 +647,10 @@ class UsedRulesAnalyzer : public GrammarVisitor<std::vector<int32_t>> {
     while (!visit_queue_.empty()) {
       auto rule_id = visit_queue_.front();
       visit_queue_.pop();
-      if (visited.count(rule_id)) {
+      if (visited[rule_id]) {
         continue;
       }
-      visited.insert(rule_id);
+      visited[rule_id] = true;
       auto rule = base_grammar_->GetRule(rule_id);
       VisitExpr(rule.body_expr_id);
       if (rule.lookahead_assertion_id != -1) {
@@ -608,7 +658,13 @@ class UsedRulesAnalyzer : public GrammarVisitor<std::vector<int32_t>> {
       }
     }
 
-    return std::vector<int32_t>(visited.begin(), visited.end());
+    std::vector<int32_t> used_rules;
+    for (int i = 0; i < static_cast<int>(visited.size()); ++i) {
+      if (visited[i]) {
+        used_rules.push_back(i);
+      }
+    }
+    return used_rules;
   }
 
   void VisitTagDispatch(const GrammarExpr& grammar_expr) {
@@ -636,7 +692,7 @@ class DeadCodeEliminatorImpl : public GrammarMutator {
     InitGrammar(grammar);
     InitBuilder();
     auto used_rules = UsedRulesAnalyzer().Apply(grammar);
-    rule_id_map_.clear();
+    rule_id_map_.assign(grammar->NumRules(), -1);
     for (auto rule_id : used_rules) {
       rule_id_map_[rule_id] = builder_->AddEmptyRule(grammar->GetRule(rule_id).name);
     }
@@ -647,15 +703,16 @@ class DeadCodeEliminatorImpl : public GrammarMutator {
       builder_->UpdateLookaheadAssertion(
           rule_id_map_[rule_id], VisitLookaheadAssertion(rule.lookahead_assertion_id)
       );
+      builder_->UpdateLookaheadExact(rule_id_map_[rule_id], rule.is_exact_lookahead);
     }
-    XGRAMMAR_CHECK(rule_id_map_.count(grammar->GetRootRuleId()) > 0);
+    XGRAMMAR_CHECK(rule_id_map_[grammar->GetRootRuleId()] != -1);
     return builder_->Get(rule_id_map_[grammar->GetRootRuleId()]);
   }
 
   int32_t VisitTagDispatch(const GrammarExpr& grammar_expr) final {
     Grammar::Impl::TagDispatch tag_dispatch = base_grammar_->GetTagDispatch(grammar_expr);
     for (auto& [tag, rule_id] : tag_dispatch.tag_rule_pairs) {
-      XGRAMMAR_DCHECK(rule_id_map_.count(rule_id) > 0);
+      XGRAMMAR_DCHECK(rule_id_map_[rule_id] != -1);
       rule_id = rule_id_map_[rule_id];
     }
 
@@ -663,19 +720,20 @@ class DeadCodeEliminatorImpl : public GrammarMutator {
   }
 
   int32_t VisitRuleRef(const GrammarExpr& grammar_expr) final {
-    XGRAMMAR_DCHECK(rule_id_map_.count(grammar_expr[0]) > 0);
+    XGRAMMAR_DCHECK(rule_id_map_[grammar_expr[0]] != -1);
     auto new_rule_id = rule_id_map_[grammar_expr[0]];
     return builder_->AddRuleRef(new_rule_id);
   }
 
   int32_t VisitRepeat(const GrammarExpr& grammar_expr) final {
-    XGRAMMAR_DCHECK(rule_id_map_.count(grammar_expr[0]) > 0);
+    XGRAMMAR_DCHECK(rule_id_map_[grammar_expr[0]] != -1);
     auto new_rule_id = rule_id_map_[grammar_expr[0]];
     return builder_->AddRepeat(new_rule_id, grammar_expr[1], grammar_expr[2]);
   }
 
  private:
-  std::unordered_map<int32_t, int32_t> rule_id_map_;
+  // Map from old rule id to new rule id. -1 for eliminated rules.
+  std::vector<int32_t> rule_id_map_;
 };
 
 class LookaheadAssertionAnalyzerImpl : public GrammarMutator {
@@ -690,37 +748,65 @@ class LookaheadAssertionAnalyzerImpl : public GrammarMutator {
     if (root_grammar_expr.type == GrammarExprType::kTagDispatch) {
       return grammar;
     }
+    BuildReferenceIndex();
     for (int i = 0; i < static_cast<int>(grammar->NumRules()); ++i) {
-      auto rule = grammar->GetRule(i);
-      if (i == grammar->GetRootRuleId()) {
-        continue;
-      }
-      if (rule.lookahead_assertion_id != -1) {
+      if (i != grammar->GetRootRuleId() && grammar->GetRule(i).lookahead_assertion_id != -1) {
         builder_->UpdateLookaheadExact(i, IsExactLookaheadAssertion(i));
-        continue;
-      }
-      auto look_head_assertion_id = DetectLookaheadAssertion(i);
-      if (look_head_assertion_id != -1) {
-        builder_->UpdateLookaheadAssertion(i, look_head_assertion_id);
-        builder_->UpdateLookaheadExact(i);
       }
     }
+    InferLookaheadAssertions();
     return builder_->Get(grammar->GetRootRuleId());
   }
 
-  bool IsExactLookaheadAssertion(int32_t rule_id) {
-    XGRAMMAR_DCHECK(base_grammar_->GetRule(rule_id).lookahead_assertion_id != -1);
-    bool found = false;
-    for (int i = 0; i < static_cast<int>(base_grammar_->NumRules()); ++i) {
-      auto rule = base_grammar_->GetRule(i);
-      auto grammar_expr = base_grammar_->GetGrammarExpr(rule.body_expr_id);
+ private:
+  using CharacterClassElement = GrammarBuilder::CharacterClassElement;
+
+  /*! \brief A reference to a rule from the element_index-th element of a sequence. */
+  struct RuleReference {
+    int32_t parent_rule_id;
+    int32_t sequence_id;
+    int32_t element_index;
+  };
+
+  /*!
+   * \brief The set of the first characters of the strings accepted by a grammar expr. ranges are
+   * sorted and disjoint. unknown means the set cannot be represented by a character class, e.g.
+   * the expr starts with an invalid UTF-8 byte or a tag dispatch.
+   */
+  struct FirstCharSet {
+    std::vector<CharacterClassElement> ranges;
+    bool nullable = false;
+    bool unknown = false;
+
+    bool operator==(const FirstCharSet& other) const {
+      return nullable == other.nullable && unknown == other.unknown &&
+             ranges.size() == other.ranges.size() &&
+             std::equal(
+                 ranges.begin(),
+                 ranges.end(),
+                 other.ranges.begin(),
+                 [](const CharacterClassElement& lhs, const CharacterClassElement& rhs) {
+                   return lhs.lower == rhs.lower && lhs.upper == rhs.upper;
+                 }
+             );
+    }
+  };
+
+  static constexpr TCodepoint kMaxCodepoint = 0x10FFFF;
+
+  /*! \brief Collect the references of every rule in one pass over the grammar. */
+  void BuildReferenceIndex() {
+    auto num_rules = base_grammar_->NumRules();
+    references_.assign(num_rules, {});
+    has_tag_dispatch_reference_.assign(num_rules, false);
+    has_repeat_reference_.assign(num_rules, false);
+    for (int i = 0; i < static_cast<int>(num_rules); ++i) {
+      auto grammar_expr = base_grammar_->GetGrammarExpr(base_grammar_->GetRule(i).body_expr_id);
       if (grammar_expr.type == GrammarExprType::kTagDispatch) {
         for (int j = 1;
              j < grammar_expr.size() - Grammar::Impl::TagDispatch::kTagDispatchExtraParameter;
              j += 2) {
-          if (grammar_expr[j] == rule_id) {
-            return false;
-          }
+          has_tag_dispatch_reference_[grammar_expr[j]] = true;
         }
         continue;
       }
@@ -730,125 +816,775 @@ class LookaheadAssertionAnalyzerImpl : public GrammarMutator {
         if (sequence_expr.type != GrammarExprType::kSequence) {
           continue;
         }
-        auto last_element = base_grammar_->GetGrammarExpr(sequence_expr.end()[-1]);
-        if (last_element.type == GrammarExprType::kRuleRef && last_element[0] == rule_id &&
-            i != rule_id) {
-          return false;
-        }
-
-        for (int j = 0; j < sequence_expr.size() - 1; ++j) {
+        for (int j = 0; j < sequence_expr.size(); ++j) {
           auto element_expr = base_grammar_->GetGrammarExpr(sequence_expr[j]);
-          if (element_expr.type != GrammarExprType::kRuleRef || element_expr[0] != rule_id) {
-            continue;
-          }
-          if (found) {
-            return false;
+          if (element_expr.type == GrammarExprType::kRuleRef) {
+            references_[element_expr[0]].push_back({i, sequence_id, j});
+          } else if (element_expr.type == GrammarExprType::kRepeat) {
+            has_repeat_reference_[element_expr[0]] = true;
           }
-          found = true;
         }
       }
     }
-    return found;
   }
 
-  int32_t DetectLookaheadAssertion(int32_t rule_id) {
-    std::vector<int32_t> found_sequence;  // Element ids
-    bool found = false;
-    for (int i = 0; i < static_cast<int>(base_grammar_->NumRules()); ++i) {
-      auto rule = base_grammar_->GetRule(i);
-      auto grammar_expr = base_grammar_->GetGrammarExpr(rule.body_expr_id);
-      if (grammar_expr.type == GrammarExprType::kTagDispatch) {
-        for (int j = 1;
-             j < grammar_expr.size() - Grammar::Impl::TagDispatch::kTagDispatchExtraParameter;
-             j += 2) {
-          if (grammar_expr[j] == rule_id) {
-            return -1;
+  bool IsEndReference(const RuleReference& reference) {
+    return reference.element_index ==
+           base_grammar_->GetGrammarExpr(reference.sequence_id).size() - 1;
+  }
+
+  /*!
+   * \brief A user-specified lookahead assertion is exact only if the rule is referenced exactly
+   * once, and not at the end of another rule.
+   */
+  bool IsExactLookaheadAssertion(int32_t rule_id) {
+    XGRAMMAR_DCHECK(base_grammar_->GetRule(rule_id).lookahead_assertion_id != -1);
+    if (has_tag_dispatch_reference_[rule_id]) {
+      return false;
+    }
+    int num_references = 0;
+    for (const auto& reference : references_[rule_id]) {
+      if (!IsEndReference(reference)) {
+        ++num_references;
+      } else if (reference.parent_rule_id != rule_id) {
+        return false;
+      }
+    }
+    return num_references == 1;
+  }
+
+  /*!
+   * \brief Infer the lookahead assertions of the rules without one from their FOLLOW sets. A rule
+   * referenced at the end of another rule inherits the lookahead assertion of that rule, so every
+   * rule is inferred once after all the rules it ends are decided. The rules ending each other in
+   * a cycle are never decided, and cannot be inferred anyway.
+   */
+  void InferLookaheadAssertions() {
+    auto num_rules = base_grammar_->NumRules();
+    auto root_rule_id = base_grammar_->GetRootRuleId();
+    lookahead_ids_.resize(num_rules);
+    lookahead_exact_.resize(num_rules);
+    std::vector<std::vector<int32_t>> end_referenced_rules(num_rules);
+    // The number of references at the end of the rules that are not decided yet.
+    std::vector<int> num_pending_parents(num_rules, 0);
+    // The root rule and the rules with user-specified lookahead assertions are decided already.
+    std::vector<bool> is_decided(num_rules, false);
+    for (int i = 0; i < static_cast<int>(num_rules); ++i) {
+      lookahead_ids_[i] = base_grammar_->GetRule(i).lookahead_assertion_id;
+      lookahead_exact_[i] = builder_->GetRule(i).is_exact_lookahead;
+      is_decided[i] = i == root_rule_id || lookahead_ids_[i] != -1;
+    }
+    for (int i = 0; i < static_cast<int>(num_rules); ++i) {
+      for (const auto& reference : references_[i]) {
+        if (reference.parent_rule_id != i && IsEndReference(reference)) {
+          end_referenced_rules[reference.parent_rule_id].push_back(i);
+          if (!is_decided[reference.parent_rule_id]) {
+            ++num_pending_parents[i];
           }
         }
+      }
+    }
+
+    std::vector<int32_t> worklist;
+    auto decide = [&](int32_t rule_id) {
+      for (auto child_rule_id : end_referenced_rules[rule_id]) {
+        if (--num_pending_parents[child_rule_id] == 0 && !is_decided[child_rule_id]) {
+          worklist.push_back(child_rule_id);
+        }
+      }
+    };
+    for (int i = static_cast<int>(num_rules) - 1; i >= 0; --i) {
+      if (!is_decided[i] && num_pending_parents[i] == 0) {
+        worklist.push_back(i);
+      }
+    }
+    while (!worklist.empty()) {
+      auto rule_id = worklist.back();
+      worklist.pop_back();
+      if (InferLookaheadAssertion(rule_id)) {
+        builder_->UpdateLookaheadAssertion(rule_id, lookahead_ids_[rule_id]);
+        builder_->UpdateLookaheadExact(rule_id, lookahead_exact_[rule_id]);
+      }
+      decide(rule_id);
+    }
+  }
+
+  /*!
+   * \brief Infer the lookahead assertion of a rule from the sequences following its references.
+   * If all references are followed by the same sequence, the sequence is the lookahead assertion,
+   * and it is exact if the sequence is the whole FOLLOW set of every reference. Otherwise, the
+   * lookahead assertion is the union of the first characters of the sequences if they are all
+   * ASCII. It is not exact, but still rejects tokens crossing the end of the rule with a wrong
+   * character.
+   * \return Whether the lookahead assertion is inferred.
+   */
+  bool InferLookaheadAssertion(int32_t rule_id) {
+    if (has_tag_dispatch_reference_[rule_id] || has_repeat_reference_[rule_id]) {
+      return false;
+    }
+    std::vector<std::vector<int32_t>> follow_sequences;
+    bool is_exact = true;
+    for (const auto& reference : references_[rule_id]) {
+      auto sequence_expr = base_grammar_->GetGrammarExpr(reference.sequence_id);
+      if (!IsEndReference(reference)) {
+        follow_sequences.emplace_back(
+            sequence_expr.begin() + reference.element_index + 1, sequence_expr.end()
+        );
+        continue;
+      }
+      if (reference.parent_rule_id == rule_id) {
+        // The FOLLOW set of a rule ending with itself is its own FOLLOW set.
+        continue;
+      }
+      auto parent_lookahead_id = lookahead_ids_[reference.parent_rule_id];
+      if (parent_lookahead_id == -1) {
+        return false;
+      }
+      auto lookahead_expr = builder_->GetGrammarExpr(parent_lookahead_id);
+      follow_sequences.emplace_back(lookahead_expr.begin(), lookahead_expr.end());
+      is_exact = is_exact && lookahead_exact_[reference.parent_rule_id];
+    }
+    if (follow_sequences.empty()) {
+      return false;
+    }
+
+    auto first_key = GetSequenceKey(follow_sequences[0]);
+    bool is_same = std::all_of(
+        follow_sequences.begin() + 1,
+        follow_sequences.end(),
+        [&](const std::vector<int32_t>& sequence) { return GetSequenceKey(sequence) == first_key; }
+    );
+    if (is_same) {
+      lookahead_ids_[rule_id] = builder_->AddSequence(follow_sequences[0]);
+      lookahead_exact_[rule_id] = is_exact;
+      return true;
+    }
+
+    if (rule_first_char_sets_.empty()) {
+      ComputeRuleFirstCharSets();
+    }
+    FirstCharSet first_char_set;
+    for (const auto& sequence : follow_sequences) {
+      auto sequence_first_char_set = GetSequenceFirstCharSet(sequence);
+      if (sequence_first_char_set.nullable || sequence_first_char_set.unknown) {
+        return false;
+      }
+      UnionFirstCharSet(sequence_first_char_set, &first_char_set);
+    }
+    // Only a small set of ASCII characters is worth checking.
+    if (first_char_set.ranges.empty() || first_char_set.ranges.back().upper >= 0x80) {
+      return false;
+    }
+    lookahead_ids_[rule_id] =
+        builder_->AddSequence({builder_->AddCharacterClass(first_char_set.ranges)});
+    lookahead_exact_[rule_id] = false;
+    return true;
+  }
+
+  std::vector<int32_t> GetSequenceKey(const std::vector<int32_t>& sequence) {
+    std::vector<int32_t> key;
+    for (auto element_id : sequence) {
+      auto grammar_expr = builder_->GetGrammarExpr(element_id);
+      key.push_back(static_cast<int32_t>(grammar_expr.type));
+      key.push_back(grammar_expr.size());
+      key.insert(key.end(), grammar_expr.begin(), grammar_expr.end());
+    }
+    return key;
+  }
+
+  /*!
+   * \brief Compute the first character sets of all rules until a fixed point is reached. A rule is
+   * only recomputed when the first character set of a rule it references changes.
+   */
+  void ComputeRuleFirstCharSets() {
+    auto num_rules = base_grammar_->NumRules();
+    rule_first_char_sets_.assign(num_rules, FirstCharSet());
+    std::vector<std::vector<int32_t>> referenced_rules(num_rules);
+    std::vector<std::vector<int32_t>> referencing_rules(num_rules);
+    for (int i = 0; i < static_cast<int>(num_rules); ++i) {
+      auto grammar_expr = base_grammar_->GetGrammarExpr(base_grammar_->GetRule(i).body_expr_id);
+      if (grammar_expr.type != GrammarExprType::kChoices) {
         continue;
       }
-      XGRAMMAR_DCHECK(grammar_expr.type == GrammarExprType::kChoices);
       for (auto sequence_id : grammar_expr) {
         auto sequence_expr = base_grammar_->GetGrammarExpr(sequence_id);
         if (sequence_expr.type != GrammarExprType::kSequence) {
           continue;
         }
-        auto last_element = base_grammar_->GetGrammarExpr(sequence_expr.end()[-1]);
-        if (last_element.type == GrammarExprType::kRuleRef && last_element[0] == rule_id &&
-            i != rule_id) {
-          return -1;
+        for (auto element_id : sequence_expr) {
+          auto element_expr = base_grammar_->GetGrammarExpr(element_id);
+          if (element_expr.type == GrammarExprType::kRuleRef ||
+              element_expr.type == GrammarExprType::kRepeat) {
+            referenced_rules[i].push_back(element_expr[0]);
+            referencing_rules[element_expr[0]].push_back(i);
+          }
         }
+      }
+    }
 
-        for (int j = 0; j < sequence_expr.size() - 1; ++j) {
-          auto element_expr = base_grammar_->GetGrammarExpr(sequence_expr[j]);
-          if (element_expr.type != GrammarExprType::kRuleRef || element_expr[0] != rule_id) {
-            continue;
-          }
-          if (found) {
-            return -1;
+    // Visit the referenced rules first.
+    auto worklist = GetRulePostOrder(referenced_rules);
+    std::reverse(worklist.begin(), worklist.end());
+    std::vector<bool> in_worklist(num_rules, true);
+    while (!worklist.empty()) {
+      auto rule_id = worklist.back();
+      worklist.pop_back();
+      in_worklist[rule_id] = false;
+      auto first_char_set = GetFirstCharSet(base_grammar_->GetRule(rule_id).body_expr_id);
+      if (first_char_set == rule_first_char_sets_[rule_id]) {
+        continue;
+      }
+      rule_first_char_sets_[rule_id] = std::move(first_char_set);
+      for (auto referencing_rule_id : referencing_rules[rule_id]) {
+        if (!in_worklist[referencing_rule_id]) {
+          in_worklist[referencing_rule_id] = true;
+          worklist.push_back(referencing_rule_id);
+        }
+      }
+    }
+  }
+
+  FirstCharSet GetFirstCharSet(int32_t grammar_expr_id) {
+    auto grammar_expr = builder_->GetGrammarExpr(grammar_expr_id);
+    FirstCharSet result;
+    switch (grammar_expr.type) {
+      case GrammarExprType::kByteString: {
+        if (grammar_expr.size() == 0) {
+          result.nullable = true;
+          break;
+        }
+        std::string bytes;
+        for (int i = 0; i < std::min(grammar_expr.size(), 4); ++i) {
+          bytes.push_back(static_cast<char>(grammar_expr[i]));
+        }
+        auto [codepoint, num_bytes] = ParseNextUTF8(bytes.c_str());
+        if (codepoint < 0) {
+          result.unknown = true;
+        } else {
+          result.ranges.push_back({codepoint, codepoint});
+        }
+        break;
+      }
+      case GrammarExprType::kCharacterClass:
+      case GrammarExprType::kCharacterClassStar: {
+        std::vector<CharacterClassElement> ranges;
+        for (int i = 1; i < grammar_expr.size(); i += 2) {
+          ranges.push_back({grammar_expr[i], grammar_expr[i + 1]});
+        }
+        UnionFirstCharSet({ranges, false, false}, &result);
+        if (grammar_expr[0]) {
+          std::vector<CharacterClassElement> complement;
+          TCodepoint next = 0;
+          for (const auto& range : result.ranges) {
+            if (range.lower > next) {
+              complement.push_back({next, range.lower - 1});
+            }
+            next = range.upper + 1;
           }
-          found = true;
-          for (int k = j + 1; k < sequence_expr.size(); ++k) {
-            found_sequence.push_back(sequence_expr[k]);
+          if (next <= kMaxCodepoint) {
+            complement.push_back({next, kMaxCodepoint});
           }
+          result.ranges = std::move(complement);
         }
+        result.nullable = grammar_expr.type == GrammarExprType::kCharacterClassStar;
+        break;
       }
+      case GrammarExprType::kEmptyStr:
+        result.nullable = true;
+        break;
+      case GrammarExprType::kRuleRef:
+        result = rule_first_char_sets_[grammar_expr[0]];
+        break;
+      case GrammarExprType::kRepeat:
+        result = rule_first_char_sets_[grammar_expr[0]];
+        result.nullable = result.nullable || grammar_expr[1] == 0;
+        break;
+      case GrammarExprType::kSequence:
+        result = GetSequenceFirstCharSet(
+            std::vector<int32_t>(grammar_expr.begin(), grammar_expr.end())
+        );
+        break;
+      case GrammarExprType::kChoices:
+        for (auto choice_id : grammar_expr) {
+          auto choice_first_char_set = GetFirstCharSet(choice_id);
+          result.nullable = result.nullable || choice_first_char_set.nullable;
+          UnionFirstCharSet(choice_first_char_set, &result);
+        }
+        break;
+      case GrammarExprType::kTagDispatch:
+        result.unknown = true;
+        break;
     }
+    return result;
+  }
 
-    if (!found) {
-      return -1;
+  FirstCharSet GetSequenceFirstCharSet(const std::vector<int32_t>& sequence) {
+    FirstCharSet result;
+    result.nullable = true;
+    for (auto element_id : sequence) {
+      auto element_first_char_set = GetFirstCharSet(element_id);
+      UnionFirstCharSet(element_first_char_set, &result);
+      if (!element_first_char_set.nullable) {
+        result.nullable = false;
+        break;
+      }
+    }
+    return result;
+  }
+
+  /*! \brief Union the ranges and the unknown flag of src into dst. The nullable flag is kept. */
+  static void UnionFirstCharSet(const FirstCharSet& src, FirstCharSet* dst) {
+    dst->unknown = dst->unknown || src.unknown;
+    if (src.ranges.empty()) {
+      return;
+    }
+    auto ranges = dst->ranges;
+    ranges.insert(ranges.end(), src.ranges.begin(), src.ranges.end());
+    std::sort(
+        ranges.begin(),
+        ranges.end(),
+        [](const CharacterClassElement& lhs, const CharacterClassElement& rhs) {
+          return lhs.lower < rhs.lower;
+        }
+    );
+    dst->ranges.clear();
+    for (const auto& range : ranges) {
+      if (!dst->ranges.empty() && range.lower <= dst->ranges.back().upper + 1) {
+        dst->ranges.back().upper = std::max(dst->ranges.back().upper, range.upper);
+      } else {
+        dst->ranges.push_back(range);
+      }
     }
-    return builder_->AddSequence(found_sequence);
   }
+
+  std::vector<std::vector<RuleReference>> references_;
+  std::vector<bool> has_tag_dispatch_reference_;
+  std::vector<bool> has_repeat_reference_;
+  std::vector<int32_t> lookahead_ids_;
+  std::vector<bool> lookahead_exact_;
+  std::vector<FirstCharSet> rule_first_char_sets_;
 };
 
 /*!
- * \brief Finds the rule reference graph of a grammar.
+ * \brief Reduce the local ambiguity of the grammar, so that fewer Earley states stay alive while
+ * matching. Grammars generated from schemas often contain optional whitespace rules, duplicated
+ * alternatives and alternatives with common prefixes, which keep several parser states alive for
+ * one byte and widen the uncertain token sets.
  *
- * The rule reference graph shows which rules reference which other rules.
- * The returned graph is inverted: it points from referee to referer.
+ * The following transformations are applied to the body of each rule. The language of every rule
+ * is unchanged.
+ * 1. References to small nullable rules without rule references (e.g. optional whitespaces or
+ *    signs) are expanded in place, so the empty path is merged into the referring rule. This is
+ *    only done when the referring rule can be built into a FSM, which absorbs the expanded
+ *    alternatives.
+ * 2. Adjacent identical character class stars are merged, since [a]* [a]* matches the same
+ *    language as [a]*.
+ * 3. Duplicated alternatives are removed. The empty alternative is removed if another alternative
+ *    already matches the empty string.
+ * 4. Alternatives consisting of one single character are merged into one character class.
+ * 5. For rules that cannot be built into a FSM (e.g. containing repetitions), the alternatives
+ *    sharing the same leading element or the same leading bytes are left-factored into a new rule.
+ *    Rules with FSMs are already determinized by GrammarFSMBuilder, so they are not factored.
+ *
+ * \note The grammar should be normalized. The rule ids are kept, and the new rules inherit the
+ * lookahead assertion of the rule they are factored from, since they are always referenced at the
+ * end of that rule.
  */
-class RuleRefGraphFinder : public GrammarVisitor<std::vector<std::vector<int32_t>>> {
+class AmbiguityReducerImpl : public GrammarMutator {
  public:
-  RuleRefGraphFinder() = default;
+  using GrammarMutator::GrammarMutator;
+
+  Grammar Apply(const Grammar& grammar) final {
+    // Expanding a rule may make the referring rule expandable, so apply it for a few rounds.
+    Grammar result = grammar;
+    for (int i = 0; i < kMaxRounds; ++i) {
+      result = ApplyOnce(result);
+      if (!has_expanded_rule_ref_) {
+        break;
+      }
+    }
+    return result;
+  }
+
+ private:
+  /*! \brief An alternative is a sequence of element ids. An empty vector means the empty string. */
+  using Alternative = std::vector<int32_t>;
+
+  /*! \brief The max number of rounds to expand the rule references. */
+  static constexpr int kMaxRounds = 4;
+  /*! \brief The max number of alternatives a rule can have to be expanded in place. */
+  static constexpr int kMaxExpandedRuleAlternatives = 8;
+  /*! \brief The max number of alternatives a rule can have after expanding rule references. */
+  static constexpr int kMaxExpandedAlternatives = 16;
 
-  std::vector<std::vector<int32_t>> Apply(const Grammar& grammar) {
+  Grammar ApplyOnce(const Grammar& grammar) {
     InitGrammar(grammar);
-    rule_visit_graph_ = std::vector<std::vector<int32_t>>(base_grammar_->NumRules());
+    InitBuilder(grammar);
+    FindExpandableRules();
+    has_expanded_rule_ref_ = false;
+
+    bool changed = false;
     for (int i = 0; i < static_cast<int>(base_grammar_->NumRules()); ++i) {
       auto rule = base_grammar_->GetRule(i);
       auto grammar_expr = base_grammar_->GetGrammarExpr(rule.body_expr_id);
+      if (grammar_expr.type != GrammarExprType::kChoices || grammar_expr.size() == 0) {
+        continue;
+      }
       cur_rule_id_ = i;
-      VisitExpr(grammar_expr);
+      auto alternatives = GetAlternatives(grammar_expr);
+      auto new_alternatives = ReduceAlternatives(alternatives, /*expand_rule_refs=*/true);
+      if (new_alternatives == alternatives) {
+        continue;
+      }
+      builder_->UpdateRuleBody(i, AddAlternatives(new_alternatives));
+      changed = true;
     }
+
+    if (!changed) {
+      return grammar;
+    }
+    auto result = builder_->Get(base_grammar_->GetRootRuleId());
+    // The expanded rules may not be referenced anymore.
+    return has_expanded_rule_ref_ ? DeadCodeEliminator::Apply(result) : result;
+  }
+
+  std::vector<Alternative> GetAlternatives(const GrammarExpr& choices_expr) {
+    std::vector<Alternative> alternatives;
+    for (auto choice_id : choices_expr) {
+      auto choice_expr = builder_->GetGrammarExpr(choice_id);
+      if (choice_expr.type == GrammarExprType::kEmptyStr) {
+        alternatives.emplace_back();
+        continue;
+      }
+      XGRAMMAR_DCHECK(choice_expr.type == GrammarExprType::kSequence);
+      alternatives.emplace_back(choice_expr.begin(), choice_expr.end());
+    }
+    return alternatives;
+  }
+
+  int32_t AddAlternatives(const std::vector<Alternative>& alternatives) {
+    std::vector<int32_t> choice_ids;
+    if (std::any_of(alternatives.begin(), alternatives.end(), [](const Alternative& alternative) {
+          return alternative.empty();
+        })) {
+      // The empty string should be the first choice.
+      choice_ids.push_back(builder_->AddEmptyStr());
+    }
+    for (const auto& alternative : alternatives) {
+      if (!alternative.empty()) {
+        choice_ids.push_back(builder_->AddSequence(alternative));
+      }
+    }
+    return builder_->AddChoices(choice_ids);
+  }
+
+  /*!
+   * \brief Find the rules that can be expanded in place: the rule is nullable, does not refer to
+   * other rules, has a few alternatives, and has no lookahead assertion, which would be lost when
+   * its body is copied into the referencing sequence.
+   */
+  void FindExpandableRules() {
+    expandable_rules_.assign(base_grammar_->NumRules(), std::nullopt);
     for (int i = 0; i < static_cast<int>(base_grammar_->NumRules()); ++i) {
-      std::sort(rule_visit_graph_[i].begin(), rule_visit_graph_[i].end());
-      auto end_it = std::unique(rule_visit_graph_[i].begin(), rule_visit_graph_[i].end());
-      rule_visit_graph_[i].erase(end_it, rule_visit_graph_[i].end());
+      const auto& rule = base_grammar_->GetRule(i);
+      if (rule.lookahead_assertion_id != -1) {
+        continue;
+      }
+      auto grammar_expr = base_grammar_->GetGrammarExpr(rule.body_expr_id);
+      if (grammar_expr.type != GrammarExprType::kChoices || grammar_expr.size() == 0 ||
+          grammar_expr.size() > kMaxExpandedRuleAlternatives) {
+        continue;
+      }
+      auto alternatives = GetAlternatives(grammar_expr);
+      bool is_leaf = std::all_of(alternatives.begin(), alternatives.end(), [&](const auto& alt) {
+        return std::all_of(alt.begin(), alt.end(), [&](int32_t element_id) {
+          auto type = builder_->GetGrammarExpr(element_id).type;
+          return type == GrammarExprType::kByteString ||
+                 type == GrammarExprType::kCharacterClass ||
+                 type == GrammarExprType::kCharacterClassStar;
+        });
+      });
+      bool is_nullable =
+          std::any_of(alternatives.begin(), alternatives.end(), [&](const Alternative& alt) {
+            return IsStarOnly(alt);
+          });
+      if (is_leaf && is_nullable) {
+        expandable_rules_[i] = std::move(alternatives);
+      }
     }
-    return std::move(rule_visit_graph_);
   }
 
- private:
-  void VisitRuleRef(const GrammarExpr& grammar_expr) {
-    rule_visit_graph_[grammar_expr[0]].push_back(cur_rule_id_);
+  /*! \brief Whether all elements of the alternative are character class stars. True if empty. */
+  bool IsStarOnly(const Alternative& alternative) {
+    return std::all_of(alternative.begin(), alternative.end(), [&](int32_t element_id) {
+      return builder_->GetGrammarExpr(element_id).type == GrammarExprType::kCharacterClassStar;
+    });
   }
 
-  void VisitRepeat(const GrammarExpr& grammar_expr) {
-    rule_visit_graph_[grammar_expr[0]].push_back(cur_rule_id_);
+  /*! \brief Append the structural key of an expr to key. Equal keys mean equal exprs. */
+  void AppendExprKey(int32_t expr_id, std::vector<int32_t>* key) {
+    auto grammar_expr = builder_->GetGrammarExpr(expr_id);
+    key->push_back(static_cast<int32_t>(grammar_expr.type));
+    key->push_back(grammar_expr.size());
+    key->insert(key->end(), grammar_expr.begin(), grammar_expr.end());
   }
 
-  void VisitTagDispatch(const GrammarExpr& grammar_expr) {
-    for (int i = 1;
-         i < grammar_expr.size() - Grammar::Impl::TagDispatch::kTagDispatchExtraParameter;
-         i += 2) {
-      rule_visit_graph_[grammar_expr[i]].push_back(cur_rule_id_);
+  bool IsSameExpr(int32_t lhs_id, int32_t rhs_id) {
+    if (lhs_id == rhs_id) {
+      return true;
     }
+    auto lhs = builder_->GetGrammarExpr(lhs_id);
+    auto rhs = builder_->GetGrammarExpr(rhs_id);
+    return lhs.type == rhs.type && lhs.size() == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin());
   }
 
-  // Inversed reference graph: pointing from referee to referer
-  std::vector<std::vector<int32_t>> rule_visit_graph_;
-  int32_t cur_rule_id_;
+  std::vector<Alternative> ReduceAlternatives(
+      const std::vector<Alternative>& alternatives, bool expand_rule_refs
+  ) {
+    bool can_build_fsm =
+        std::none_of(alternatives.begin(), alternatives.end(), [&](const Alternative& alt) {
+          return std::any_of(alt.begin(), alt.end(), [&](int32_t element_id) {
+            return builder_->GetGrammarExpr(element_id).type == GrammarExprType::kRepeat;
+          });
+        });
+
+    std::vector<Alternative> result;
+    for (int i = 0; i < static_cast<int>(alternatives.size()); ++i) {
+      if (can_build_fsm && expand_rule_refs) {
+        int max_num_expanded = kMaxExpandedAlternatives - static_cast<int>(result.size()) -
+                               (static_cast<int>(alternatives.size()) - i - 1);
+        for (auto& expanded : ExpandRuleRefs(alternatives[i], max_num_expanded)) {
+          result.push_back(MergeAdjacentStars(expanded));
+        }
+      } else {
+        result.push_back(MergeAdjacentStars(alternatives[i]));
+      }
+    }
+    result = RemoveRedundantAlternatives(result);
+    result = MergeSingleCharacterAlternatives(result);
+    if (!can_build_fsm) {
+      result = LeftFactor(result);
+    }
+    return result;
+  }
+
+  /*!
+   * \brief Expand the references to the expandable rules in the alternative, as long as the
+   * number of the expanded alternatives does not exceed max_num_expanded.
+   */
+  std::vector<Alternative> ExpandRuleRefs(const Alternative& alternative, int max_num_expanded) {
+    std::vector<Alternative> results(1);
+    for (auto element_id : alternative) {
+      auto element_expr = builder_->GetGrammarExpr(element_id);
+      if (element_expr.type != GrammarExprType::kRuleRef ||
+          !expandable_rules_[element_expr[0]].has_value() ||
+          static_cast<int>(results.size() * expandable_rules_[element_expr[0]]->size()) >
+              max_num_expanded) {
+        for (auto& result : results) {
+          result.push_back(element_id);
+        }
+        continue;
+      }
+      std::vector<Alternative> new_results;
+      for (const auto& result : results) {
+        for (const auto& ref_alternative : *expandable_rules_[element_expr[0]]) {
+          new_results.push_back(result);
+          new_results.back().insert(
+              new_results.back().end(), ref_alternative.begin(), ref_alternative.end()
+          );
+        }
+      }
+      results = std::move(new_results);
+      has_expanded_rule_ref_ = true;
+    }
+    return results;
+  }
+
+  Alternative MergeAdjacentStars(const Alternative& alternative) {
+    Alternative result;
+    for (auto element_id : alternative) {
+      if (!result.empty() &&
+          builder_->GetGrammarExpr(element_id).type == GrammarExprType::kCharacterClassStar &&
+          IsSameExpr(result.back(), element_id)) {
+        continue;
+      }
+      result.push_back(element_id);
+    }
+    return result;
+  }
+
+  std::vector<Alternative> RemoveRedundantAlternatives(const std::vector<Alternative>& alternatives
+  ) {
+    std::vector<Alternative> result;
+    std::unordered_set<std::vector<int32_t>> visited_keys;
+    for (const auto& alternative : alternatives) {
+      std::vector<int32_t> key;
+      for (auto element_id : alternative) {
+        AppendExprKey(element_id, &key);
+      }
+      if (visited_keys.insert(std::move(key)).second) {
+        result.push_back(alternative);
+      }
+    }
+    // The empty alternative is redundant if another alternative can match the empty string.
+    bool has_nullable_sequence = std::any_of(result.begin(), result.end(), [&](const auto& alt) {
+      return !alt.empty() && IsStarOnly(alt);
+    });
+    if (has_nullable_sequence) {
+      result.erase(
+          std::remove_if(
+              result.begin(), result.end(), [](const Alternative& alt) { return alt.empty(); }
+          ),
+          result.end()
+      );
+    }
+    return result;
+  }
+
+  std::vector<Alternative> MergeSingleCharacterAlternatives(
+      const std::vector<Alternative>& alternatives
+  ) {
+    std::vector<GrammarBuilder::CharacterClassElement> ranges;
+    int first_index = -1;
+    int num_merged = 0;
+    std::vector<bool> is_merged(alternatives.size(), false);
+    for (int i = 0; i < static_cast<int>(alternatives.size()); ++i) {
+      if (alternatives[i].size() != 1) {
+        continue;
+      }
+      auto element_expr = builder_->GetGrammarExpr(alternatives[i][0]);
+      if (element_expr.type == GrammarExprType::kCharacterClass && element_expr[0] == 0) {
+        for (int j = 1; j < element_expr.size(); j += 2) {
+          ranges.push_back({element_expr[j], element_expr[j + 1]});
+        }
+      } else if (element_expr.type == GrammarExprType::kByteString && element_expr.size() == 1 &&
+                 element_expr[0] < 0x80) {
+        ranges.push_back({element_expr[0], element_expr[0]});
+      } else {
+        continue;
+      }
+      is_merged[i] = true;
+      ++num_merged;
+      if (first_index == -1) {
+        first_index = i;
+      }
+    }
+    if (num_merged < 2) {
+      return alternatives;
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const auto& lhs, const auto& rhs) {
+      return lhs.lower < rhs.lower || (lhs.lower == rhs.lower && lhs.upper < rhs.upper);
+    });
+    std::vector<GrammarBuilder::CharacterClassElement> merged_ranges;
+    for (const auto& range : ranges) {
+      if (!merged_ranges.empty() && range.lower <= merged_ranges.back().upper + 1) {
+        merged_ranges.back().upper = std::max(merged_ranges.back().upper, range.upper);
+      } else {
+        merged_ranges.push_back(range);
+      }
+    }
+
+    std::vector<Alternative> result;
+    for (int i = 0; i < static_cast<int>(alternatives.size()); ++i) {
+      if (i == first_index) {
+        result.push_back({builder_->AddCharacterClass(merged_ranges)});
+      } else if (!is_merged[i]) {
+        result.push_back(alternatives[i]);
+      }
+    }
+    return result;
+  }
+
+  /*!
+   * \brief Left-factor the alternatives. The alternatives sharing the same leading element, or
+   * leading byte strings with the same first byte, are replaced by one alternative: the common
+   * prefix followed by a reference to a new rule matching the remaining parts.
+   */
+  std::vector<Alternative> LeftFactor(const std::vector<Alternative>& alternatives) {
+    // Group the alternatives by their leading element, keeping the order of first appearance.
+    std::vector<std::vector<int>> groups;
+    std::unordered_map<std::vector<int32_t>, int> key_to_group;
+    for (int i = 0; i < static_cast<int>(alternatives.size()); ++i) {
+      std::vector<int32_t> key;
+      if (!alternatives[i].empty()) {
+        auto first_expr = builder_->GetGrammarExpr(alternatives[i][0]);
+        if (first_expr.type == GrammarExprType::kByteString) {
+          key = {static_cast<int32_t>(GrammarExprType::kByteString), first_expr[0]};
+        } else {
+          AppendExprKey(alternatives[i][0], &key);
+        }
+      }
+      auto [it, inserted] = key_to_group.try_emplace(std::move(key), groups.size());
+      if (inserted) {
+        groups.emplace_back();
+      }
+      groups[it->second].push_back(i);
+    }
+
+    if (groups.size() == alternatives.size()) {
+      return alternatives;
+    }
+
+    std::vector<Alternative> result;
+    for (const auto& group : groups) {
+      if (group.size() == 1 || alternatives[group[0]].empty()) {
+        for (auto i : group) {
+          result.push_back(alternatives[i]);
+        }
+        continue;
+      }
+
+      // Find the common prefix and the remaining parts.
+      int32_t prefix_id;
+      std::vector<Alternative> suffixes;
+      auto first_expr = builder_->GetGrammarExpr(alternatives[group[0]][0]);
+      if (first_expr.type == GrammarExprType::kByteString) {
+        std::vector<int32_t> prefix(first_expr.begin(), first_expr.end());
+        for (auto i : group) {
+          auto expr = builder_->GetGrammarExpr(alternatives[i][0]);
+          auto mismatch = std::mismatch(prefix.begin(), prefix.end(), expr.begin(), expr.end());
+          prefix.erase(mismatch.first, prefix.end());
+        }
+        prefix_id = builder_->AddByteString(prefix);
+        for (auto i : group) {
+          auto expr = builder_->GetGrammarExpr(alternatives[i][0]);
+          Alternative suffix;
+          if (expr.size() > static_cast<int>(prefix.size())) {
+            suffix.push_back(builder_->AddByteString(
+                std::vector<int32_t>(expr.begin() + prefix.size(), expr.end())
+            ));
+          }
+          suffix.insert(suffix.end(), alternatives[i].begin() + 1, alternatives[i].end());
+          suffixes.push_back(std::move(suffix));
+        }
+      } else {
+        prefix_id = alternatives[group[0]][0];
+        for (auto i : group) {
+          suffixes.emplace_back(alternatives[i].begin() + 1, alternatives[i].end());
+        }
+      }
+
+      const auto& cur_rule = builder_->GetRule(cur_rule_id_);
+      auto cur_rule_name = cur_rule.name;
+      auto lookahead_assertion_id = cur_rule.lookahead_assertion_id;
+      auto is_exact_lookahead = cur_rule.is_exact_lookahead;
+      auto body_expr_id = AddAlternatives(ReduceAlternatives(suffixes, false));
+      auto new_rule_id = builder_->AddRuleWithHint(cur_rule_name, body_expr_id);
+      builder_->UpdateLookaheadAssertion(new_rule_id, lookahead_assertion_id);
+      builder_->UpdateLookaheadExact(new_rule_id, is_exact_lookahead);
+      result.push_back({prefix_id, builder_->AddRuleRef(new_rule_id)});
+    }
+    return result;
+  }
+
+  /*! \brief The alternatives of the rules that can be expanded in place. */
+  std::vector<std::optional<std::vector<Alternative>>> expandable_rules_;
+  /*! \brief The id of the rule being reduced. */
+  int32_t cur_rule_id_ = -1;
+  /*! \brief Whether any rule reference is expanded. */
+  bool has_expanded_rule_ref_ = false;
 };
 
 /*!
@@ -858,101 +1594,92 @@ class AllowEmptyRuleAnalyzerImpl : public GrammarVisitor<std::vector<int32_t>> {
  public:
   AllowEmptyRuleAnalyzerImpl() = default;
 
+  /*!
+   * \brief Find the rules that allow the empty string. Every sequence keeps the number of its
+   * elements that are not known to allow the empty string yet, and a rule allows the empty string
+   * once the number of any of its sequences drops to zero. So each element is visited only once.
+   */
   std::vector<int32_t> Apply(const Grammar& grammar) final {
     InitGrammar(grammar);
-
-    // Step 1: Find rules that explicitly allow empty string
-    std::unordered_set<int32_t> empty_rule_id_set;
-    FindExplicitEmptyRules(&empty_rule_id_set);
-
-    // Step 2: Find rules that indirectly allow empty string. Using the Bellman-Ford algorithm
-    // on the rule reference graph.
-    std::vector<std::vector<int32_t>> rule_ref_graph = RuleRefGraphFinder().Apply(grammar);
-    FindIndirectEmptyRules(&empty_rule_id_set, rule_ref_graph);
-
-    auto result = std::vector<int32_t>(empty_rule_id_set.begin(), empty_rule_id_set.end());
-    std::sort(result.begin(), result.end());
-    return result;
-  }
-
-  void FindExplicitEmptyRules(std::unordered_set<int32_t>* empty_rule_id_set) {
-    for (int i = 0; i < static_cast<int>(base_grammar_->NumRules()); ++i) {
-      auto rule = base_grammar_->GetRule(i);
-      auto grammar_expr = base_grammar_->GetGrammarExpr(rule.body_expr_id);
+    auto num_rules = static_cast<int>(base_grammar_->NumRules());
+    std::vector<bool> is_empty_rule(num_rules, false);
+    std::vector<int32_t> worklist;
+    auto add_empty_rule = [&](int32_t rule_id) {
+      if (!is_empty_rule[rule_id]) {
+        is_empty_rule[rule_id] = true;
+        worklist.push_back(rule_id);
+      }
+    };
+
+    // Step 1: Find rules that explicitly allow empty string, and count the rules the other
+    // sequences depend on.
+    std::vector<int32_t> sequence_rule_ids;
+    std::vector<int32_t> num_pending_elements;
+    std::vector<std::vector<int32_t>> dependent_sequences(num_rules);
+    for (int i = 0; i < num_rules; ++i) {
+      auto grammar_expr = base_grammar_->GetGrammarExpr(base_grammar_->GetRule(i).body_expr_id);
       if (grammar_expr.type == GrammarExprType::kTagDispatch) {
         continue;
       }
 
       XGRAMMAR_DCHECK(grammar_expr.type == GrammarExprType::kChoices);
-      if (base_grammar_->GetGrammarExpr(grammar_expr[0]).type == GrammarExprType::kEmptyStr) {
-        empty_rule_id_set->insert(i);
-        continue;
-      }
-
       for (auto seq_id : grammar_expr) {
         auto seq_expr = base_grammar_->GetGrammarExpr(seq_id);
-        if (std::all_of(seq_expr.begin(), seq_expr.end(), [&](int32_t i) {
-              return base_grammar_->GetGrammarExpr(i).type == GrammarExprType::kCharacterClassStar;
+        if (seq_expr.type == GrammarExprType::kEmptyStr) {
+          add_empty_rule(i);
+          continue;
+        }
+        XGRAMMAR_DCHECK(seq_expr.type == GrammarExprType::kSequence);
+        if (!std::all_of(seq_expr.begin(), seq_expr.end(), [&](int32_t element_id) {
+              return MayBeEpsilon(base_grammar_->GetGrammarExpr(element_id));
             })) {
-          empty_rule_id_set->insert(i);
-          break;
+          continue;
         }
+        int32_t seq_index = static_cast<int32_t>(sequence_rule_ids.size());
+        int32_t num_pending = 0;
+        for (auto element_id : seq_expr) {
+          auto element_expr = base_grammar_->GetGrammarExpr(element_id);
+          if (element_expr.type == GrammarExprType::kRuleRef ||
+              (element_expr.type == GrammarExprType::kRepeat && element_expr[1] != 0)) {
+            dependent_sequences[element_expr[0]].push_back(seq_index);
+            ++num_pending;
+          }
+        }
+        if (num_pending == 0) {
+          add_empty_rule(i);
+          continue;
+        }
+        sequence_rule_ids.push_back(i);
+        num_pending_elements.push_back(num_pending);
       }
     }
-  }
-
-  bool SeqExprIsEpsilon(
-      const GrammarExpr& seq_expr, const std::unordered_set<int32_t>& empty_rule_id_set
-  ) {
-    if (seq_expr.type == GrammarExprType::kEmptyStr) {
-      return true;
-    }
-    XGRAMMAR_DCHECK(seq_expr.type == GrammarExprType::kSequence);
-
-    return std::all_of(seq_expr.begin(), seq_expr.end(), [&](int32_t i) {
-      auto element_expr = base_grammar_->GetGrammarExpr(i);
-      return (element_expr.type == GrammarExprType::kRuleRef &&
-              empty_rule_id_set.count(element_expr[0])) ||
-             element_expr.type == GrammarExprType::kCharacterClassStar ||
-             (element_expr.type == GrammarExprType::kRepeat &&
-              (empty_rule_id_set.count(element_expr[0]) || element_expr[1] == 0));
-    });
-  }
-
-  void FindIndirectEmptyRules(
-      std::unordered_set<int32_t>* empty_rule_id_set,
-      const std::vector<std::vector<int32_t>>& rule_ref_graph
-  ) {
-    std::queue<int32_t> queue;
-    for (auto i : *empty_rule_id_set) {
-      queue.push(i);
-    }
 
-    while (!queue.empty()) {
-      auto rule_id = queue.front();
-      queue.pop();
-      XGRAMMAR_DCHECK(rule_id >= 0 && rule_id < static_cast<int>(rule_ref_graph.size()));
-      for (auto referer_rule_id : rule_ref_graph[rule_id]) {
-        if (empty_rule_id_set->count(referer_rule_id)) {
-          continue;
+    // Step 2: Find rules that indirectly allow empty string by propagating along the references.
+    while (!worklist.empty()) {
+      auto rule_id = worklist.back();
+      worklist.pop_back();
+      for (auto seq_index : dependent_sequences[rule_id]) {
+        if (--num_pending_elements[seq_index] == 0) {
+          add_empty_rule(sequence_rule_ids[seq_index]);
         }
-        auto rule = base_grammar_->GetRule(referer_rule_id);
-        auto grammar_expr = base_grammar_->GetGrammarExpr(rule.body_expr_id);
-
-        XGRAMMAR_DCHECK(grammar_expr.type != GrammarExprType::kTagDispatch)
-            << "TagDispatch rules should already exist in empty_rule_id_set";
-
-        bool is_epsilon = std::any_of(grammar_expr.begin(), grammar_expr.end(), [&](int32_t i) {
-          auto seq_expr = base_grammar_->GetGrammarExpr(i);
-          return SeqExprIsEpsilon(seq_expr, *empty_rule_id_set);
-        });
+      }
+    }
 
-        if (is_epsilon) {
-          empty_rule_id_set->insert(referer_rule_id);
-          queue.push(referer_rule_id);
-        }
+    std::vector<int32_t> result;
+    for (int i = 0; i < num_rules; ++i) {
+      if (is_empty_rule[i]) {
+        result.push_back(i);
       }
     }
+    return result;
+  }
+
+ private:
+  /*! \brief Whether the element may match the empty string, depending on the rules it refers to. */
+  static bool MayBeEpsilon(const GrammarExpr& element_expr) {
+    return element_expr.type == GrammarExprType::kRuleRef ||
+           element_expr.type == GrammarExprType::kCharacterClassStar ||
+           element_expr.type == GrammarExprType::kRepeat;
   }
 };
 
@@ -995,24 +1722,64 @@ class GrammarFSMBuilderImpl {
   const static uint32_t kMin4BytesUnicode = 0xF0808080;
   const static uint32_t kMax4BytesUnicode = 0xF7BFBFBF;
 
+  /*! \brief The maximum number of states of a rule FSM after fusing referenced rules into it. */
+  const static int kMaxFusedFSMStates = 256;
+  /*!
+   * \brief The maximum number of states of a rule FSM before minimizing the fused FSM. Larger
+   * fusions are skipped without being built, which bounds the work of each fusion.
+   */
+  const static int kMaxInlinedFSMStates = 4 * kMaxFusedFSMStates;
+  /*! \brief The maximum number of failed fusions into a rule before giving up the rule. */
+  const static int kMaxFusionFailures = 4;
+  /*! \brief The minimum number of mask states that fusion may add to the whole grammar. */
+  const static int kMinAddedMaskStatesBudget = 64;
+
+  /*!
+   * \brief The estimated cost of a rule FSM. It decides whether fusing a referenced rule into the
+   * FSM pays off.
+   */
+  struct FSMCost {
+    /*! \brief The number of reachable DFA states. */
+    int num_states = 0;
+    /*! \brief The number of scanable states, i.e. the adaptive token masks to compile. */
+    int num_mask_states = 0;
+    /*!
+     * \brief The number of rule edges. Every traversed rule edge adds a predicted state and a
+     * completion to the live states of the Earley parser.
+     */
+    int num_rule_edges = 0;
+  };
+
   void Apply(Grammar* grammar) {
     FSM complete_fsm;
+    std::vector<std::optional<FSMWithStartEnd>> rule_fsms((*grammar)->NumRules());
     std::vector<std::optional<FSMWithStartEnd>> per_rule_fsms((*grammar)->NumRules());
+    std::vector<bool> is_tag_dispatch((*grammar)->NumRules(), false);
     std::vector<int> state_mapping;
 
     for (int i = 0; i < (*grammar)->NumRules(); ++i) {
       auto rule = (*grammar)->GetRule(i);
       auto grammar_expr = (*grammar)->GetGrammarExpr(rule.body_expr_id);
       if (grammar_expr.type == Grammar::Impl::GrammarExprType::kTagDispatch) {
-        auto rule_fsm = TagDispatch((*grammar)->GetTagDispatch(grammar_expr));
-        XGRAMMAR_CHECK(rule_fsm.has_value()) << "Failed to build tag dispatch fsm for rule " << i;
-        per_rule_fsms[i] = rule_fsm->AddToCompleteFSM(&complete_fsm, &state_mapping);
+        rule_fsms[i] = TagDispatch((*grammar)->GetTagDispatch(grammar_expr));
+        XGRAMMAR_CHECK(rule_fsms[i].has_value())
+            << "Failed to build tag dispatch fsm for rule " << i;
+        is_tag_dispatch[i] = true;
       } else {
         XGRAMMAR_DCHECK(grammar_expr.type == Grammar::Impl::GrammarExprType::kChoices);
-        auto rule_fsm = Choices(grammar_expr, *grammar);
-        if (rule_fsm.has_value()) {
-          per_rule_fsms[i] = rule_fsm->AddToCompleteFSM(&complete_fsm, &state_mapping);
-        }
+        rule_fsms[i] = Choices(grammar_expr, *grammar);
+      }
+      if (auto* budget = CompileBudget::Impl::Current()) {
+        budget->Check();
+        if (rule_fsms[i].has_value()) budget->AddFSMStates(rule_fsms[i]->NumStates());
+      }
+    }
+
+    FuseRuleFSMs(*grammar, is_tag_dispatch, &rule_fsms);
+
+    for (int i = 0; i < (*grammar)->NumRules(); ++i) {
+      if (rule_fsms[i].has_value()) {
+        per_rule_fsms[i] = rule_fsms[i]->AddToCompleteFSM(&complete_fsm, &state_mapping);
       }
     }
 
@@ -1023,7 +1790,11 @@ class GrammarFSMBuilderImpl {
     for (int i = 0; i < (*grammar)->NumRules(); ++i) {
       if (per_rule_fsms[i]) {
         compact_per_rule_fsms[i] = CompactFSMWithStartEnd(
-            compact_complete_fsm, per_rule_fsms[i]->GetStart(), per_rule_fsms[i]->GetEnds()
+            compact_complete_fsm,
+            per_rule_fsms[i]->GetStart(),
+            per_rule_fsms[i]->GetEnds(),
+            per_rule_fsms[i]->GetEndsOffset(),
+            false
         );
       }
     }
@@ -1053,6 +1824,18 @@ class GrammarFSMBuilderImpl {
       const std::vector<std::string>& excluded_strings
   );
   static FSMWithStartEnd BuildNegativeCharacterClass(const GrammarExpr& expr);
+  /* Rule fusion functions.*/
+  static FSMCost EstimateCost(const FSMWithStartEnd& fsm);
+  static std::optional<FSMWithStartEnd> InlineRuleFSMs(
+      const FSMWithStartEnd& fsm,
+      const std::vector<int32_t>& rule_ids,
+      const std::vector<std::optional<FSMWithStartEnd>>& rule_fsms
+  );
+  static void FuseRuleFSMs(
+      const Grammar& grammar,
+      const std::vector<bool>& is_tag_dispatch,
+      std::vector<std::optional<FSMWithStartEnd>>* rule_fsms
+  );
 };
 
 // This function will add a range [min, max] of characters to the FSM, and the length
@@ -1585,6 +2368,286 @@ std::optional<FSMWithStartEnd> GrammarFSMBuilderImpl::BuildTagDispatchWithEOSSto
   return FSMWithStartEnd(trie_fsm, start, ends);
 }
 
+GrammarFSMBuilderImpl::FSMCost GrammarFSMBuilderImpl::EstimateCost(const FSMWithStartEnd& fsm) {
+  FSMCost cost;
+  std::unordered_set<int> reachable_states;
+  fsm.GetReachableStates(&reachable_states);
+  cost.num_states = static_cast<int>(reachable_states.size());
+  for (int state : reachable_states) {
+    if (fsm.IsScanableState(state)) {
+      ++cost.num_mask_states;
+    }
+    for (const auto& edge : fsm.GetFsm().GetEdges(state)) {
+      if (edge.IsRuleRef()) {
+        ++cost.num_rule_edges;
+      }
+    }
+  }
+  return cost;
+}
+
+std::optional<FSMWithStartEnd> GrammarFSMBuilderImpl::InlineRuleFSMs(
+    const FSMWithStartEnd& fsm,
+    const std::vector<int32_t>& rule_ids,
+    const std::vector<std::optional<FSMWithStartEnd>>& rule_fsms
+) {
+  FSMWithStartEnd result(fsm.GetFsm().Copy(), fsm.GetStart(), fsm.GetEnds());
+  auto& result_fsm = result.GetFsm();
+  auto is_inlined_edge = [&](const FSMEdge& edge) {
+    return edge.IsRuleRef() &&
+           std::find(rule_ids.begin(), rule_ids.end(), edge.GetRefRuleId()) != rule_ids.end();
+  };
+
+  // Detach the rule edges referring to the inlined rules.
+  std::vector<FSMEdge> rule_edges;
+  std::vector<int> rule_edge_sources;
+  for (int state = 0; state < result.NumStates(); ++state) {
+    auto& edges = result_fsm.GetEdges(state);
+    for (const auto& edge : edges) {
+      if (is_inlined_edge(edge)) {
+        rule_edges.push_back(edge);
+        rule_edge_sources.push_back(state);
+      }
+    }
+    edges.erase(std::remove_if(edges.begin(), edges.end(), is_inlined_edge), edges.end());
+  }
+  if (rule_edges.empty()) {
+    return std::nullopt;
+  }
+
+  // Replace every rule edge with a copy of the rule FSM linked by epsilon edges.
+  std::vector<int> state_mapping;
+  for (int i = 0; i < static_cast<int>(rule_edges.size()); ++i) {
+    const auto& rule_fsm = *rule_fsms[rule_edges[i].GetRefRuleId()];
+    int from = rule_edge_sources[i];
+    int to = rule_edges[i].target;
+    result_fsm.AddFSM(rule_fsm.GetFsm(), &state_mapping);
+    result_fsm.AddEpsilonEdge(from, state_mapping[rule_fsm.GetStart()]);
+    for (int end = 0; end < rule_fsm.NumStates(); ++end) {
+      if (rule_fsm.IsEndState(end)) {
+        result_fsm.AddEpsilonEdge(state_mapping[end], to);
+      }
+    }
+  }
+  std::vector<bool> ends = fsm.GetEnds();
+  ends.resize(result.NumStates(), false);
+  result.SetEndStates(ends);
+
+  result = result.SimplifyEpsilon();
+  result = result.MergeEquivalentSuccessors();
+  auto result_raw = result.MinimizeDFA();
+  if (!result_raw.IsOk()) {
+    return std::nullopt;
+  }
+  return std::move(result_raw).Unwrap();
+}
+
+void GrammarFSMBuilderImpl::FuseRuleFSMs(
+    const Grammar& grammar,
+    const std::vector<bool>& is_tag_dispatch,
+    std::vector<std::optional<FSMWithStartEnd>>* rule_fsms
+) {
+  int num_rules = grammar->NumRules();
+
+  // Step 1. Collect the rules referenced by every rule. A rule with an FSM references rules by its
+  // rule edges, and the other rules by the rule references and repetitions in their bodies.
+  std::vector<std::vector<int32_t>> referenced_rules(num_rules);
+  for (int i = 0; i < num_rules; ++i) {
+    auto& refs = referenced_rules[i];
+    if ((*rule_fsms)[i].has_value()) {
+      const auto& fsm = (*rule_fsms)[i]->GetFsm();
+      for (int state = 0; state < fsm.NumStates(); ++state) {
+        for (const auto& edge : fsm.GetEdges(state)) {
+          if (edge.IsRuleRef()) {
+            refs.push_back(edge.GetRefRuleId());
+          }
+        }
+      }
+    } else {
+      const auto& body = grammar->GetGrammarExpr(grammar->GetRule(i).body_expr_id);
+      for (auto sequence_id : body) {
+        const auto& sequence = grammar->GetGrammarExpr(sequence_id);
+        if (sequence.type != ExprType::kSequence) {
+          continue;
+        }
+        for (auto element_id : sequence) {
+          const auto& element = grammar->GetGrammarExpr(element_id);
+          if (element.type == ExprType::kRuleRef || element.type == ExprType::kRepeat) {
+            refs.push_back(element[0]);
+          }
+        }
+      }
+    }
+    std::sort(refs.begin(), refs.end());
+    refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+  }
+
+  // Step 2. Find the recursive rules with Tarjan's algorithm. The strongly connected components
+  // are emitted in reverse topological order, so a rule comes after the rules it references
+  // outside its own component.
+  std::vector<int> index(num_rules, -1);
+  std::vector<int> low_link(num_rules, 0);
+  std::vector<bool> on_stack(num_rules, false);
+  std::vector<bool> is_recursive(num_rules, false);
+  std::vector<int> component_stack;
+  std::vector<int> order;
+  // The rule being visited and the position of its next referenced rule.
+  std::vector<std::pair<int, int>> dfs_stack;
+  int next_index = 0;
+  auto visit = [&](int rule_id) {
+    index[rule_id] = low_link[rule_id] = next_index++;
+    component_stack.push_back(rule_id);
+    on_stack[rule_id] = true;
+    dfs_stack.emplace_back(rule_id, 0);
+  };
+  for (int start = 0; start < num_rules; ++start) {
+    if (index[start] != -1) {
+      continue;
+    }
+    visit(start);
+    while (!dfs_stack.empty()) {
+      auto [rule_id, ref_pos] = dfs_stack.back();
+      if (ref_pos < static_cast<int>(referenced_rules[rule_id].size())) {
+        ++dfs_stack.back().second;
+        int ref_rule_id = referenced_rules[rule_id][ref_pos];
+        if (ref_rule_id == rule_id) {
+          is_recursive[rule_id] = true;
+        }
+        if (index[ref_rule_id] == -1) {
+          visit(ref_rule_id);
+        } else if (on_stack[ref_rule_id]) {
+          low_link[rule_id] = std::min(low_link[rule_id], index[ref_rule_id]);
+        }
+        continue;
+      }
+      dfs_stack.pop_back();
+      if (!dfs_stack.empty()) {
+        int parent_rule_id = dfs_stack.back().first;
+        low_link[parent_rule_id] = std::min(low_link[parent_rule_id], low_link[rule_id]);
+      }
+      if (low_link[rule_id] != index[rule_id]) {
+        continue;
+      }
+      int component_begin = static_cast<int>(order.size());
+      while (true) {
+        int member = component_stack.back();
+        component_stack.pop_back();
+        on_stack[member] = false;
+        order.push_back(member);
+        if (member == rule_id) {
+          break;
+        }
+      }
+      if (static_cast<int>(order.size()) - component_begin > 1) {
+        for (int i = component_begin; i < static_cast<int>(order.size()); ++i) {
+          is_recursive[order[i]] = true;
+        }
+      }
+    }
+  }
+
+  // Step 3. Fuse the FSMs of the non-recursive rules into the FSMs referencing them, referenced
+  // rules first. A fusion is kept only if the fused DFA stays under the size budget, the mask
+  // states it adds fit in the budget of the whole grammar, and it reduces the rule edges the
+  // Earley parser has to traverse at runtime.
+  auto root_rule_id = grammar->GetRootRuleId();
+  std::vector<FSMCost> costs(num_rules);
+  int total_mask_states = 0;
+  for (int i = 0; i < num_rules; ++i) {
+    if ((*rule_fsms)[i].has_value()) {
+      costs[i] = EstimateCost(*(*rule_fsms)[i]);
+      total_mask_states += costs[i].num_mask_states;
+    }
+  }
+  int added_mask_states_budget = std::max(total_mask_states, kMinAddedMaskStatesBudget);
+
+  std::vector<int32_t> fusable_rules;
+  // The number of rule edges referring to each rule in the FSM being fused.
+  std::vector<int> num_ref_edges(num_rules, 0);
+  for (int rule_id : order) {
+    auto& fsm = (*rule_fsms)[rule_id];
+    if (!fsm.has_value() || is_tag_dispatch[rule_id]) {
+      continue;
+    }
+    fusable_rules.clear();
+    for (int32_t ref_rule_id : referenced_rules[rule_id]) {
+      if ((*rule_fsms)[ref_rule_id].has_value() && !is_recursive[ref_rule_id] &&
+          !is_tag_dispatch[ref_rule_id] && ref_rule_id != root_rule_id) {
+        fusable_rules.push_back(ref_rule_id);
+      }
+    }
+    if (fusable_rules.empty()) {
+      continue;
+    }
+    auto count_ref_edges = [&](int delta) {
+      for (int state = 0; state < fsm->NumStates(); ++state) {
+        for (const auto& edge : fsm->GetFsm().GetEdges(state)) {
+          if (edge.IsRuleRef()) {
+            num_ref_edges[edge.GetRefRuleId()] += delta;
+          }
+        }
+      }
+    };
+    count_ref_edges(1);
+
+    // An upper bound of the states of the fused FSM before minimization. Every rule edge is
+    // replaced with a copy of the referenced FSM.
+    auto get_inlined_states = [&](const std::vector<int32_t>& ref_rule_ids) {
+      int64_t num_states = fsm->NumStates();
+      for (int32_t ref_rule_id : ref_rule_ids) {
+        num_states += static_cast<int64_t>(num_ref_edges[ref_rule_id]) *
+                      (*rule_fsms)[ref_rule_id]->NumStates();
+      }
+      return num_states;
+    };
+
+    auto try_fuse = [&](const std::vector<int32_t>& ref_rule_ids) {
+      if (get_inlined_states(ref_rule_ids) > kMaxInlinedFSMStates) {
+        return false;
+      }
+      auto fused_fsm = InlineRuleFSMs(*fsm, ref_rule_ids, *rule_fsms);
+      if (!fused_fsm.has_value()) {
+        return false;
+      }
+      auto fused_cost = EstimateCost(*fused_fsm);
+      int added_mask_states = fused_cost.num_mask_states - costs[rule_id].num_mask_states;
+      int num_rule_edges = costs[rule_id].num_rule_edges;
+      for (int32_t ref_rule_id : ref_rule_ids) {
+        num_rule_edges += costs[ref_rule_id].num_rule_edges;
+      }
+      if (fused_cost.num_states > kMaxFusedFSMStates ||
+          added_mask_states > added_mask_states_budget ||
+          fused_cost.num_rule_edges >= num_rule_edges) {
+        return false;
+      }
+      added_mask_states_budget -= std::max(added_mask_states, 0);
+      count_ref_edges(-1);
+      fsm = std::move(fused_fsm);
+      count_ref_edges(1);
+      costs[rule_id] = fused_cost;
+      return true;
+    };
+
+    // Fuse all the referenced rules at once in the common case, and one by one if that exceeds
+    // the budgets. The smaller rules are fused first, and the rule stops fusing after a few
+    // failures, so a rule referencing many rules does not rebuild its FSM for each of them.
+    if (fusable_rules.size() <= 1 || !try_fuse(fusable_rules)) {
+      std::vector<std::pair<int64_t, int32_t>> sorted_rules;
+      for (int32_t ref_rule_id : fusable_rules) {
+        sorted_rules.emplace_back(get_inlined_states({ref_rule_id}), ref_rule_id);
+      }
+      std::sort(sorted_rules.begin(), sorted_rules.end());
+      int num_failures = 0;
+      for (const auto& [inlined_states, ref_rule_id] : sorted_rules) {
+        if (!try_fuse({ref_rule_id}) && ++num_failures >= kMaxFusionFailures) {
+          break;
+        }
+      }
+    }
+    count_ref_edges(-1);
+  }
+}
+
 std::optional<FSMWithStartEnd> GrammarFSMBuilderImpl::TagDispatch(
     const Grammar::Impl::TagDispatch& tag_dispatch
 ) {
@@ -1625,15 +2688,331 @@ class RepetitionNormalizerImpl {
   }
 };
 
+class FirstFollowBytesAnalyzerImpl {
+ public:
+  using GrammarExprType = Grammar::Impl::GrammarExprType;
+  using Result = FirstFollowBytesAnalyzer::Result;
+
+  static Result Apply(const Grammar& grammar) {
+    auto num_rules = grammar->NumRules();
+    Result result;
+    result.first_bytes.assign(num_rules, std::bitset<256>());
+    result.follow_bytes.assign(num_rules, std::bitset<256>());
+
+    // Step 1. Compute the FIRST sets until a fixed point is reached. A rule is only recomputed
+    // when the FIRST set of a rule it references changes.
+    std::vector<std::vector<int32_t>> referenced_rules(num_rules);
+    std::vector<std::vector<int32_t>> referencing_rules(num_rules);
+    for (int i = 0; i < static_cast<int>(num_rules); ++i) {
+      referenced_rules[i] = GetReferencedRules(grammar, i);
+      for (auto ref_rule_id : referenced_rules[i]) {
+        referencing_rules[ref_rule_id].push_back(i);
+      }
+    }
+    // Visit the referenced rules first.
+    auto worklist = GetRulePostOrder(referenced_rules);
+    std::reverse(worklist.begin(), worklist.end());
+    std::vector<bool> in_worklist(num_rules, true);
+    while (!worklist.empty()) {
+      auto rule_id = worklist.back();
+      worklist.pop_back();
+      in_worklist[rule_id] = false;
+      auto first_bytes = GetRuleFirstBytes(grammar, result.first_bytes, rule_id);
+      if (first_bytes == result.first_bytes[rule_id]) {
+        continue;
+      }
+      result.first_bytes[rule_id] = first_bytes;
+      for (auto referencing_rule_id : referencing_rules[rule_id]) {
+        if (!in_worklist[referencing_rule_id]) {
+          in_worklist[referencing_rule_id] = true;
+          worklist.push_back(referencing_rule_id);
+        }
+      }
+    }
+
+    // Step 2. Add the bytes directly following every reference, and record the references at the
+    // end of rules, whose FOLLOW sets are inherited from the referring rule.
+    std::vector<std::vector<int32_t>> end_referenced_rules(num_rules);
+    for (int i = 0; i < static_cast<int>(num_rules); ++i) {
+      auto body_expr = grammar->GetGrammarExpr(grammar->GetRule(i).body_expr_id);
+      if (body_expr.type == GrammarExprType::kTagDispatch) {
+        for (int j = 1;
+             j < body_expr.size() - Grammar::Impl::TagDispatch::kTagDispatchExtraParameter;
+             j += 2) {
+          result.follow_bytes[body_expr[j]].set();
+        }
+        continue;
+      }
+      if (grammar->per_rule_fsms[i].has_value()) {
+        const auto& fsm = grammar->per_rule_fsms[i].value();
+        std::vector<int32_t> nodes = {fsm.GetStart()};
+        std::unordered_set<int32_t> visited = {fsm.GetStart()};
+        for (int k = 0; k < static_cast<int>(nodes.size()); ++k) {
+          for (const auto& edge : fsm.GetFsm().GetEdges(nodes[k])) {
+            if (visited.insert(edge.target).second) {
+              nodes.push_back(edge.target);
+            }
+            if (!edge.IsRuleRef()) {
+              continue;
+            }
+            auto ref_rule_id = edge.GetRefRuleId();
+            if (GetFSMFirstBytes(
+                    grammar, result.first_bytes, i, edge.target, &result.follow_bytes[ref_rule_id]
+                )) {
+              end_referenced_rules[i].push_back(ref_rule_id);
+            }
+          }
+        }
+        continue;
+      }
+      for (auto sequence_id : body_expr) {
+        auto sequence_expr = grammar->GetGrammarExpr(sequence_id);
+        if (sequence_expr.type != GrammarExprType::kSequence) {
+          continue;
+        }
+        for (int j = 0; j < sequence_expr.size(); ++j) {
+          auto element_expr = grammar->GetGrammarExpr(sequence_expr[j]);
+          if (element_expr.type != GrammarExprType::kRuleRef &&
+              element_expr.type != GrammarExprType::kRepeat) {
+            continue;
+          }
+          auto ref_rule_id = element_expr[0];
+          if (element_expr.type == GrammarExprType::kRepeat) {
+            result.follow_bytes[ref_rule_id] |= result.first_bytes[ref_rule_id];
+          }
+          if (GetSequenceFirstBytes(
+                  grammar, result.first_bytes, sequence_id, j + 1, &result.follow_bytes[ref_rule_id]
+              )) {
+            end_referenced_rules[i].push_back(ref_rule_id);
+          }
+        }
+      }
+    }
+
+    // Step 3. Propagate the FOLLOW sets through the end references until a fixed point is reached.
+    // A rule is only propagated again when its FOLLOW set changes. The referring rules are visited
+    // first.
+    worklist = GetRulePostOrder(end_referenced_rules);
+    in_worklist.assign(num_rules, true);
+    while (!worklist.empty()) {
+      auto parent_rule_id = worklist.back();
+      worklist.pop_back();
+      in_worklist[parent_rule_id] = false;
+      for (auto rule_id : end_referenced_rules[parent_rule_id]) {
+        auto follow_bytes = result.follow_bytes[rule_id] | result.follow_bytes[parent_rule_id];
+        if (follow_bytes != result.follow_bytes[rule_id]) {
+          result.follow_bytes[rule_id] = follow_bytes;
+          if (!in_worklist[rule_id]) {
+            in_worklist[rule_id] = true;
+            worklist.push_back(rule_id);
+          }
+        }
+      }
+    }
+    return result;
+  }
+
+  static bool GetSequenceFirstBytes(
+      const Grammar& grammar,
+      const std::vector<std::bitset<256>>& rule_first_bytes,
+      int32_t sequence_id,
+      int32_t element_id,
+      std::bitset<256>* result
+  ) {
+    auto sequence_expr = grammar->GetGrammarExpr(sequence_id);
+    for (int i = element_id; i < sequence_expr.size(); ++i) {
+      if (!GetElementFirstBytes(grammar, rule_first_bytes, sequence_expr[i], result)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static bool GetFSMFirstBytes(
+      const Grammar& grammar,
+      const std::vector<std::bitset<256>>& rule_first_bytes,
+      int32_t rule_id,
+      int32_t node,
+      std::bitset<256>* result
+  ) {
+    XGRAMMAR_DCHECK(grammar->per_rule_fsms[rule_id].has_value());
+    const auto& fsm = grammar->per_rule_fsms[rule_id].value();
+    // The nodes reachable from the given node without consuming any byte. Reused by the calls of
+    // the thread, since it is called when filling the token masks.
+    thread_local std::vector<int32_t> nodes;
+    nodes.assign({node});
+    bool can_reach_end = false;
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+      can_reach_end = can_reach_end || fsm.IsEndState(nodes[i]);
+      for (const auto& edge : fsm.GetFsm().GetEdges(nodes[i])) {
+        if (edge.IsCharRange()) {
+          for (int c = edge.min; c <= edge.max; ++c) {
+            result->set(c);
+          }
+          continue;
+        }
+        if (edge.IsRuleRef()) {
+          *result |= rule_first_bytes[edge.GetRefRuleId()];
+          if (!IsRuleNullable(grammar, edge.GetRefRuleId())) {
+            continue;
+          }
+        } else if (!edge.IsEpsilon()) {
+          continue;
+        }
+        if (std::find(nodes.begin(), nodes.end(), edge.target) == nodes.end()) {
+          nodes.push_back(edge.target);
+        }
+      }
+    }
+    return can_reach_end;
+  }
+
+ private:
+  /*!
+   * \brief Get the rules whose FIRST sets the FIRST set of the given rule depends on, i.e. the
+   * rules referenced by the reachable rule edges of its FSM, or by its body.
+   */
+  static std::vector<int32_t> GetReferencedRules(const Grammar& grammar, int32_t rule_id) {
+    std::vector<int32_t> result;
+    auto body_expr = grammar->GetGrammarExpr(grammar->GetRule(rule_id).body_expr_id);
+    if (body_expr.type == GrammarExprType::kTagDispatch) {
+      return result;
+    }
+    if (grammar->per_rule_fsms[rule_id].has_value()) {
+      const auto& fsm = grammar->per_rule_fsms[rule_id].value();
+      std::vector<int32_t> nodes = {fsm.GetStart()};
+      std::unordered_set<int32_t> visited = {fsm.GetStart()};
+      for (int k = 0; k < static_cast<int>(nodes.size()); ++k) {
+        for (const auto& edge : fsm.GetFsm().GetEdges(nodes[k])) {
+          if (visited.insert(edge.target).second) {
+            nodes.push_back(edge.target);
+          }
+          if (edge.IsRuleRef()) {
+            result.push_back(edge.GetRefRuleId());
+          }
+        }
+      }
+    } else {
+      for (auto sequence_id : body_expr) {
+        auto sequence_expr = grammar->GetGrammarExpr(sequence_id);
+        if (sequence_expr.type != GrammarExprType::kSequence) {
+          continue;
+        }
+        for (auto element_id : sequence_expr) {
+          auto element_expr = grammar->GetGrammarExpr(element_id);
+          if (element_expr.type == GrammarExprType::kRuleRef ||
+              element_expr.type == GrammarExprType::kRepeat) {
+            result.push_back(element_expr[0]);
+          }
+        }
+      }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+  static bool IsRuleNullable(const Grammar& grammar, int32_t rule_id) {
+    return std::binary_search(
+        grammar->allow_empty_rule_ids.begin(), grammar->allow_empty_rule_ids.end(), rule_id
+    );
+  }
+
+  static std::bitset<256> GetRuleFirstBytes(
+      const Grammar& grammar, const std::vector<std::bitset<256>>& rule_first_bytes, int32_t rule_id
+  ) {
+    std::bitset<256> result;
+    auto body_expr = grammar->GetGrammarExpr(grammar->GetRule(rule_id).body_expr_id);
+    if (body_expr.type == GrammarExprType::kTagDispatch) {
+      result.set();
+    } else if (grammar->per_rule_fsms[rule_id].has_value()) {
+      GetFSMFirstBytes(
+          grammar, rule_first_bytes, rule_id, grammar->per_rule_fsms[rule_id]->GetStart(), &result
+      );
+    } else {
+      for (auto sequence_id : body_expr) {
+        GetSequenceFirstBytes(grammar, rule_first_bytes, sequence_id, 0, &result);
+      }
+    }
+    return result;
+  }
+
+  /*!
+   * \brief Add the first bytes of an element to result.
+   * \return Whether the element can be empty.
+   */
+  static bool GetElementFirstBytes(
+      const Grammar& grammar,
+      const std::vector<std::bitset<256>>& rule_first_bytes,
+      int32_t element_id,
+      std::bitset<256>* result
+  ) {
+    auto element_expr = grammar->GetGrammarExpr(element_id);
+    switch (element_expr.type) {
+      case GrammarExprType::kByteString:
+        if (element_expr.size() == 0) {
+          return true;
+        }
+        result->set(static_cast<uint8_t>(element_expr[0]));
+        return false;
+      case GrammarExprType::kCharacterClass:
+      case GrammarExprType::kCharacterClassStar: {
+        // The ASCII characters are added exactly. A non-ASCII character can be matched from any
+        // UTF-8 lead byte, since the parser also accepts the overlong encodings.
+        bool is_negative = element_expr[0];
+        std::bitset<128> ascii_chars;
+        for (int i = 1; i < element_expr.size(); i += 2) {
+          for (int c = element_expr[i]; c <= std::min(element_expr[i + 1], 0x7F); ++c) {
+            ascii_chars.set(c);
+          }
+        }
+        if (is_negative) {
+          ascii_chars.flip();
+        }
+        for (int c = 0; c < 0x80; ++c) {
+          if (ascii_chars[c]) {
+            result->set(c);
+          }
+        }
+        for (int c = 0xC0; c < 0x100; ++c) {
+          result->set(c);
+        }
+        return element_expr.type == GrammarExprType::kCharacterClassStar;
+      }
+      case GrammarExprType::kEmptyStr:
+        return true;
+      case GrammarExprType::kRuleRef:
+        *result |= rule_first_bytes[element_expr[0]];
+        return IsRuleNullable(grammar, element_expr[0]);
+      case GrammarExprType::kRepeat:
+        *result |= rule_first_bytes[element_expr[0]];
+        return element_expr[1] == 0 || IsRuleNullable(grammar, element_expr[0]);
+      default:
+        XGRAMMAR_LOG(FATAL) << "Unexpected element type: " << static_cast<int>(element_expr.type);
+        XGRAMMAR_UNREACHABLE();
+    }
+  }
+};
+
 class GrammarOptimizerImpl {
  public:
   static Grammar Apply(const Grammar& grammar) {
+    // The compile budget is checked between the passes.
     Grammar result = ByteStringFuser::Apply(grammar);
+    CheckCompileBudget();
     result = RuleInliner::Apply(result);
+    CheckCompileBudget();
     result = DeadCodeEliminator::Apply(result);
+    CheckCompileBudget();
+    // The reducer runs before the lookahead analysis, so that it only keeps the rules with
+    // lookahead assertions written in the grammar from being expanded.
+    result = AmbiguityReducer::Apply(result);
+    CheckCompileBudget();
     result = LookaheadAssertionAnalyzer::Apply(result);
+    CheckCompileBudget();
     result->allow_empty_rule_ids = AllowEmptyRuleAnalyzer::Apply(result);
     RepetitionNormalizer::Apply(&result);
+    CheckCompileBudget();
     GrammarFSMBuilder::Apply(&result);
     result->optimized = true;
     return result;
@@ -1785,6 +3164,10 @@ Grammar LookaheadAssertionAnalyzer::Apply(const Grammar& grammar) {
   return LookaheadAssertionAnalyzerImpl().Apply(grammar);
 }
 
+Grammar AmbiguityReducer::Apply(const Grammar& grammar) {
+  return AmbiguityReducerImpl().Apply(grammar);
+}
+
 Grammar GrammarOptimizer::Apply(const Grammar& grammar) {
   return GrammarOptimizerImpl::Apply(grammar);
 }
@@ -1793,6 +3176,34 @@ Grammar ByteStringFuser::Apply(const Grammar& grammar) {
   return ByteStringFuserImpl().Apply(grammar);
 }
 
+FirstFollowBytesAnalyzer::Result FirstFollowBytesAnalyzer::Apply(const Grammar& grammar) {
+  return FirstFollowBytesAnalyzerImpl::Apply(grammar);
+}
+
+bool FirstFollowBytesAnalyzer::GetSequenceFirstBytes(
+    const Grammar& grammar,
+    const std::vector<std::bitset<256>>& rule_first_bytes,
+    int32_t sequence_id,
+    int32_t element_id,
+    std::bitset<256>* result
+) {
+  return FirstFollowBytesAnalyzerImpl::GetSequenceFirstBytes(
+      grammar, rule_first_bytes, sequence_id, element_id, result
+  );
+}
+
+bool FirstFollowBytesAnalyzer::GetFSMFirstBytes(
+    const Grammar& grammar,
+    const std::vector<std::bitset<256>>& rule_first_bytes,
+    int32_t rule_id,
+    int32_t node,
+    std::bitset<256>* result
+) {
+  return FirstFollowBytesAnalyzerImpl::GetFSMFirstBytes(
+      grammar, rule_first_bytes, rule_id, node, result
+  );
+}
+
 Grammar RootRuleRenamer::Apply(const Grammar& grammar) {
   return RootRuleRenamerImpl().Apply(grammar);
 }
@@ -9,7 +9,9 @@
 
 #include <xgrammar/xgrammar.h>
 
+#include <bitset>
 #include <string>
+#include <vector>
 
 #include "grammar_builder.h"
 #include "grammar_impl.h"
@@ -335,6 +337,61 @@ class LookaheadAssertionAnalyzer {
   static Grammar Apply(const Grammar& grammar);
 };
 
+/*!
+ * \brief Reduce the local ambiguity of the grammar by expanding small nullable rules, removing
+ * redundant alternatives and left-factoring alternatives with common prefixes. It reduces the
+ * number of live Earley states while matching.
+ */
+class AmbiguityReducer {
+ public:
+  static Grammar Apply(const Grammar& grammar);
+};
+
+/*!
+ * \brief Analyze the bytes that can start each rule (FIRST) and the bytes that can follow each
+ * rule in the grammar (FOLLOW). The sets are over-approximations: non-ASCII characters in character
+ * classes contribute all UTF-8 lead bytes, and rules referenced by a TagDispatch can be followed by
+ * any byte.
+ * \note The grammar should be optimized, i.e. allow_empty_rule_ids and per_rule_fsms are built.
+ */
+class FirstFollowBytesAnalyzer {
+ public:
+  struct Result {
+    /*! \brief The bytes that can start each rule. */
+    std::vector<std::bitset<256>> first_bytes;
+    /*! \brief The bytes that can follow each rule. The end of the input is not included. */
+    std::vector<std::bitset<256>> follow_bytes;
+  };
+
+  static Result Apply(const Grammar& grammar);
+
+  /*!
+   * \brief Add the first bytes of the rest of a sequence, starting from the element_id-th element,
+   * to result.
+   * \return Whether the rest of the sequence can be empty.
+   */
+  static bool GetSequenceFirstBytes(
+      const Grammar& grammar,
+      const std::vector<std::bitset<256>>& rule_first_bytes,
+      int32_t sequence_id,
+      int32_t element_id,
+      std::bitset<256>* result
+  );
+
+  /*!
+   * \brief Add the first bytes of the strings accepted from the given node of the FSM of a rule to
+   * result.
+   * \return Whether an end state can be reached from the node without consuming any byte.
+   */
+  static bool GetFSMFirstBytes(
+      const Grammar& grammar,
+      const std::vector<std::bitset<256>>& rule_first_bytes,
+      int32_t rule_id,
+      int32_t node,
+      std::bitset<256>* result
+  );
+};
+
 /*!
  * \brief Build the FSMs of the grammar.
  */
@@ -368,10 +425,11 @@ class RepetitionNormalizer {
  * 1. Byte fuser.
  * 2. Rule inliner.
  * 3. Dead code eliminator.
- * 4. Lookahead assertion analyzer.
- * 5. Allow-empty rule analyzer.
- * 6. Repetition normalizer.
- * 7. FSM builder.
+ * 4. Ambiguity reducer.
+ * 5. Lookahead assertion analyzer.
+ * 6. Allow-empty rule analyzer.
+ * 7. Repetition normalizer.
+ * 8. FSM builder.
  */
 class GrammarOptimizer {
  public:
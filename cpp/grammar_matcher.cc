@@ -7,25 +7,38 @@
  */
 
 #include <dlpack/dlpack.h>
+#include <xgrammar/config.h>
 #include <xgrammar/matcher.h>
 
 #include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <thread>
+#include <tuple>
 #include <utility>
 #include <variant>
 #include <vector>
 
 #include "compiled_grammar_impl.h"
 #include "earley_parser.h"
+#include "grammar_functor.h"
 #include "grammar_impl.h"
 #include "support/dynamic_bitset.h"
 #include "support/encoding.h"
-#include "support/int_set.h"
 #include "support/logging.h"
+#include "support/executor.h"
 #include "support/thread_pool.h"
 #include "testing.h"
+#include "tokenizer_info_impl.h"
 
 namespace xgrammar {
 
@@ -338,33 +351,88 @@ class GrammarMatcher::Impl : public EarleyParser {
       // max_rollback_tokens_ is deprecated and not used.
       int max_rollback_tokens = -1
   )
-      : EarleyParser(compiled_grammar->grammar, ParserState::GetInvalidState()),
-        compiled_grammar_(compiled_grammar),
-        tokenizer_info_(compiled_grammar->tokenizer_info),
-        stop_token_ids_(override_stop_tokens.value_or(tokenizer_info_.GetStopTokenIds())),
-        terminate_without_stop_token_(terminate_without_stop_token),
-        tmp_accepted_bitset_(tokenizer_info_.GetVocabSize()) {
+      : Impl(
+            compiled_grammar,
+            compiled_grammar->GetInitialMatcherState().parser_snapshot,
+            terminate_without_stop_token
+        ) {
     XGRAMMAR_CHECK(!override_stop_tokens.has_value() || !override_stop_tokens->empty())
         << "The override_stop_tokens should not be empty";
+    // The stop tokens of the tokenizer are shared instead of copied.
+    if (override_stop_tokens.has_value() &&
+        *override_stop_tokens != tokenizer_info_.GetStopTokenIds()) {
+      auto override_stop_token_set = std::make_unique<StopTokenSet>();
+      override_stop_token_set->ids = *override_stop_tokens;
+      override_stop_token_set->bitset = DynamicBitset(tokenizer_info_.GetVocabSize());
+      for (auto id : *override_stop_tokens) {
+        if (id >= 0 && id < tokenizer_info_.GetVocabSize()) {
+          override_stop_token_set->bitset.Set(id, true);
+        }
+      }
+      override_stop_tokens_ = std::move(override_stop_token_set);
+    }
+    initial_matcher_state_ = &compiled_grammar_->GetInitialMatcherState();
+    // The initial bitmask is computed with the stop tokens of the tokenizer.
+    if (initial_matcher_state_->token_bitmask.empty() || override_stop_tokens_ != nullptr) {
+      initial_matcher_state_ = nullptr;
+    }
   }
 
+  /*!
+   * \brief Construct a matcher starting from the parser snapshot, with the stop tokens of the
+   * tokenizer and without the initial bitmask. Only used to compute the initial matcher state of
+   * the compiled grammar.
+   */
+  Impl(
+      const CompiledGrammar& compiled_grammar,
+      const EarleyParser::Snapshot& parser_snapshot,
+      bool terminate_without_stop_token = false
+  )
+      : EarleyParser(compiled_grammar->grammar, parser_snapshot),
+        compiled_grammar_(compiled_grammar),
+        tokenizer_info_(compiled_grammar->tokenizer_info),
+        terminate_without_stop_token_(terminate_without_stop_token) {}
+
   bool AcceptToken(int32_t token_id, bool debug_print = false);
 
+  int32_t AcceptTokens(const int32_t* token_ids, int32_t num_tokens, bool debug_print = false);
+
   bool AcceptString(const std::string& input_str, bool debug_print = false);
 
   bool FillNextTokenBitmask(DLTensor* next_token_bitmask, int index, bool debug_print = false);
 
+  /*!
+   * \brief Compute the next token bitmask into the buffer of GetBitmaskSize(vocab_size) elements,
+   * without the initial bitmask of the compiled grammar.
+   * \returns Whether the bitmask is not all-true.
+   */
+  bool ComputeNextTokenBitmask(int32_t* bitmask_data_ptr, bool debug_print = false);
+
   std::string FindJumpForwardString();
 
   void Rollback(int num_tokens);
 
   bool IsTerminated() const;
 
-  void Reset() { EarleyParser::Reset(); }
+  bool IsStopTokenAccepted() const;
+
+  void Reset() {
+    EarleyParser::Reset(compiled_grammar_->GetInitialMatcherState().parser_snapshot);
+    token_length_history.clear();
+  }
 
   int GetMaxRollbackTokens() const { return -1; }
 
-  const std::vector<int>& GetStopTokenIds() const { return stop_token_ids_; }
+  const std::vector<int>& GetStopTokenIds() const {
+    return override_stop_tokens_ != nullptr ? override_stop_tokens_->ids
+                                            : tokenizer_info_.GetStopTokenIds();
+  }
+
+  /*!
+   * \brief The memory held by the matcher, excluding the compiled grammar and the tokenizer info
+   * shared with the other matchers.
+   */
+  std::size_t MemorySizeBytes() const;
 
   std::string _DebugPrintInternalState() const { return PrintStates(); }
 
@@ -385,11 +453,15 @@ class GrammarMatcher::Impl : public EarleyParser {
       const std::vector<bool>& uncertain_tokens_bitset
   );
 
-  /*! \brief Set the acceptable next token in next_token_bitmask. */
+  /*!
+   * \brief Set the acceptable next token in next_token_bitmask.
+   * \param rejected_bitset The tokens rejected by all the latest states, or nullptr if every
+   * state stores its accepted tokens, i.e. all tokens not in accepted_bitset are rejected.
+   */
   void SetTokenBitmask(
       int32_t* bitmask_data_ptr,
       const DynamicBitset& accepted_bitset,
-      const std::vector<int32_t>& rejected_indices,
+      const DynamicBitset* rejected_bitset,
       bool can_reach_end,
       bool allow_special_token = false
   );
@@ -400,48 +472,143 @@ class GrammarMatcher::Impl : public EarleyParser {
    */
   bool AcceptStopToken();
 
-  bool IsStopTokenAccepted() const;
+  /*! \brief Check if the token is a special token. The special token ids are sorted. */
+  bool IsSpecialToken(int32_t token_id) const {
+    const auto& special_token_ids = tokenizer_info_.GetSpecialTokenIds();
+    return std::binary_search(special_token_ids.begin(), special_token_ids.end(), token_id);
+  }
+
+  /*! \brief Check if the token is a stop token in O(1). The token id should be in the vocab. */
+  bool IsStopToken(int32_t token_id) const {
+    return override_stop_tokens_ != nullptr ? override_stop_tokens_->bitset[token_id]
+                                            : tokenizer_info_->IsStopToken(token_id);
+  }
+
+  /*!
+   * \brief The temporary data of FillNextTokenBitmask. They are shared by the matchers of the same
+   * thread, e.g. a worker of the batch matcher, so an idle matcher only holds its history.
+   */
+  struct FillNextTokenBitmaskWorkspace {
+    DynamicBitset accepted_bitset;
+    /*! \brief The intersection of the rejected tokens of the states checked so far. */
+    DynamicBitset rejected_bitset;
+    /*! \brief The rejected tokens of the state being checked, if it is not the first one. */
+    DynamicBitset state_rejected_bitset;
+    /*! \brief Whether a state storing its rejected tokens has been checked. */
+    bool has_rejected_bitset = false;
+    std::vector<std::pair<int32_t, int32_t>> follow_stack;
+    std::vector<std::pair<int32_t, int32_t>> follow_visited;
+    std::vector<std::pair<ParserState, const AdaptiveTokenMask*>> latest_states_with_masks;
+  };
+
+  /*! \brief Get the workspace of the current thread for the vocabulary size. */
+  static FillNextTokenBitmaskWorkspace& GetFillNextTokenBitmaskWorkspace(int vocab_size);
+
+  /*!
+   * \brief The implementation of ComputeNextTokenBitmask(). The debug mode is dispatched once per
+   * call.
+   */
+  template <bool kDebugPrint>
+  bool ComputeNextTokenBitmaskImpl(int32_t* bitmask_data_ptr);
+
+  /*!
+   * \brief Check the uncertain tokens of one latest state, and update the accepted bitset or the
+   * rejected indices of the workspace with the result. The store type of the mask of the state is
+   * dispatched once per state, instead of once per uncertain token.
+   */
+  template <StoreType kStoreType, bool kDebugPrint>
+  void CheckUncertainTokens(
+      const ParserState& state,
+      const AdaptiveTokenMask& adaptive_token_mask,
+      FillNextTokenBitmaskWorkspace* workspace
+  );
 
   /*! \brief Check if the token bitmask is all-true. */
   bool IsTokenBitmaskAllTrue(int32_t* bitmask_data_ptr);
 
+  /*!
+   * \brief Get the bytes that can follow the rule of the state when the rule is completed, i.e.
+   * the union of the continuations of the live parent states. The parents whose continuations
+   * can be empty are followed up to the root.
+   */
+  void GetLiveFollowBytes(
+      const ParserState& state,
+      FillNextTokenBitmaskWorkspace* workspace,
+      std::bitset<256>* follow_bytes
+  );
+
   std::string PrintBitmask(int32_t* bitmask_data_ptr, const TokenizerInfo& tokenizer_info);
 
   CompiledGrammar compiled_grammar_;
   TokenizerInfo tokenizer_info_;
-  std::vector<int> stop_token_ids_;
+  /*! \brief The stop token ids, and the bitset of them for the lookup. */
+  struct StopTokenSet {
+    std::vector<int> ids;
+    DynamicBitset bitset;
+  };
+  /*! \brief The override stop tokens. nullptr if the ones of the tokenizer are used. */
+  std::unique_ptr<const StopTokenSet> override_stop_tokens_;
   bool terminate_without_stop_token_;
-  std::deque<int> token_length_history;
+  std::vector<int32_t> token_length_history;
+  /*!
+   * \brief The initial matcher state of the compiled grammar, whose bitmask is the first bitmask of
+   * this matcher. nullptr if the bitmask differs, e.g. with override_stop_tokens.
+   */
+  const CompiledGrammar::Impl::InitialMatcherState* initial_matcher_state_ = nullptr;
 
-  // Temporary data for FillNextTokenBitmask. They are stored here to avoid repeated allocation.
-  DynamicBitset tmp_accepted_bitset_;
-  std::vector<int32_t> tmp_rejected_indices_;
-  std::vector<int32_t> tmp_rejected_indices_delta_;
 };
 
-class BatchGrammarMatcher::Impl {
- public:
-  Impl(std::variant<std::string, int32_t> max_threads) {
-    if (std::holds_alternative<int32_t>(max_threads)) {
-      int32_t num_threads = std::get<int32_t>(max_threads);
-      XGRAMMAR_CHECK(num_threads >= 1)
-          << "The num_threads should be at least 1, but got " << num_threads;
-      if (num_threads > 1) {
-        if (num_threads > static_cast<int32_t>(std::thread::hardware_concurrency())) {
-          XGRAMMAR_LOG(WARNING) << "The num_threads " << num_threads << " is larger than the "
-                                << "number of hardware threads. Using "
-                                << static_cast<int32_t>(std::thread::hardware_concurrency())
-                                << " instead.";
-        }
-        max_threads_ =
-            std::min(num_threads, static_cast<int32_t>(std::thread::hardware_concurrency()));
+const CompiledGrammar::Impl::InitialMatcherState& CompiledGrammar::Impl::GetInitialMatcherState(
+) const {
+  std::call_once(initial_matcher_state_computed_, [this] {
+    InitialMatcherState initial_matcher_state;
+    initial_matcher_state.parser_snapshot =
+        EarleyParser(grammar, ParserState::GetInvalidState()).GetInitialSnapshot();
+    auto vocab_size = tokenizer_info.GetVocabSize();
+    if (vocab_size > 0) {
+      GrammarMatcher::Impl matcher(
+          CompiledGrammar(std::const_pointer_cast<Impl>(shared_from_this())),
+          initial_matcher_state.parser_snapshot
+      );
+      auto& token_bitmask = initial_matcher_state.token_bitmask;
+      token_bitmask.resize(GetBitmaskSize(vocab_size));
+      initial_matcher_state.is_token_bitmask_all_true =
+          !matcher.ComputeNextTokenBitmask(token_bitmask.data());
+    }
+    std::atomic_store(
+        &initial_matcher_state_,
+        std::make_shared<const InitialMatcherState>(std::move(initial_matcher_state))
+    );
+  });
+  return *std::atomic_load(&initial_matcher_state_);
+}
+
+/*! \brief Get the number of threads of the batched matchers from the max_threads argument. */
+static int32_t GetBatchMaxThreads(std::variant<std::string, int32_t> max_threads) {
+  if (std::holds_alternative<int32_t>(max_threads)) {
+    int32_t num_threads = std::get<int32_t>(max_threads);
+    XGRAMMAR_CHECK(num_threads >= 1)
+        << "The num_threads should be at least 1, but got " << num_threads;
+    if (num_threads > 1) {
+      int32_t num_cpus = GetAvailableCPUCount();
+      if (num_threads > num_cpus) {
+        XGRAMMAR_LOG(WARNING) << "The num_threads " << num_threads << " is larger than the "
+                              << "number of available CPUs. Using " << num_cpus << " instead.";
       }
-    } else {
-      std::string str = std::get<std::string>(max_threads);
-      XGRAMMAR_CHECK(str == "auto");
-      max_threads_ = std::thread::hardware_concurrency() / 2;
+      return std::min(num_threads, num_cpus);
     }
+    return 1;
+  } else {
+    std::string str = std::get<std::string>(max_threads);
+    XGRAMMAR_CHECK(str == "auto");
+    return std::max(GetAvailableCPUCount() / 2, 1);
   }
+}
+
+class BatchGrammarMatcher::Impl {
+ public:
+  Impl(std::variant<std::string, int32_t> max_threads)
+      : max_threads_(GetBatchMaxThreads(max_threads)) {}
 
   void BatchFillNextTokenBitmask(
       std::vector<GrammarMatcher>* matchers,
@@ -460,9 +627,41 @@ class BatchGrammarMatcher::Impl {
       bool debug_print
   );
 
+  std::vector<int32_t> BatchAcceptTokens(
+      std::vector<GrammarMatcher>* matchers,
+      const std::vector<std::vector<int32_t>>& token_ids,
+      bool debug_print
+  );
+
+  BatchCompletionHandle SubmitAcceptAndFill(
+      const std::vector<GrammarMatcher>& matchers,
+      const std::vector<int32_t>& token_ids,
+      DLTensor* next_token_bitmask,
+      const std::optional<std::vector<int32_t>>& indices,
+      bool debug_print
+  );
+
  private:
-  std::optional<ThreadPool> thread_pool_ = std::nullopt;
   int32_t max_threads_ = 1;
+  /*!
+   * \brief The single thread running the asynchronous operations in the order of submission.
+   * Declared last so it is joined before the other members are destroyed.
+   */
+  std::unique_ptr<ThreadPool> async_executor_;
+};
+
+class BatchCompletionHandle::Impl {
+ public:
+  explicit Impl(std::shared_future<std::vector<uint8_t>> future) : future_(std::move(future)) {}
+
+  std::vector<uint8_t> Wait() const { return future_.get(); }
+
+  bool IsReady() const {
+    return future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+ private:
+  std::shared_future<std::vector<uint8_t>> future_;
 };
 
 bool GrammarMatcher::Impl::AcceptStopToken() {
@@ -489,6 +688,9 @@ bool GrammarMatcher::Impl::IsStopTokenAccepted() const { return stop_token_is_ac
 
 // TODO(yixin): Polish verbose logging
 bool GrammarMatcher::Impl::AcceptToken(int32_t token_id, bool debug_print) {
+  // Without XGRAMMAR_ENABLE_DEBUG_PRINT, the flag is constant false and the printing is compiled
+  // out.
+  debug_print = XGRAMMAR_ENABLE_DEBUG_PRINT && debug_print;
   if (IsStopTokenAccepted()) {
     XGRAMMAR_LOG(WARNING) << "The matcher has terminated after accepting the stop token, but is "
                           << "trying to accept new token with id " << token_id << ".";
@@ -512,8 +714,7 @@ bool GrammarMatcher::Impl::AcceptToken(int32_t token_id, bool debug_print) {
                        << states_str;
   }
   // Handle the stop token
-  if (std::find(stop_token_ids_.begin(), stop_token_ids_.end(), token_id) !=
-      stop_token_ids_.end()) {
+  if (IsStopToken(token_id)) {
     bool accepted = AcceptStopToken();
     if (debug_print) {
       XGRAMMAR_LOG(INFO) << "The token is an end token. Is accepted: " << accepted;
@@ -521,9 +722,7 @@ bool GrammarMatcher::Impl::AcceptToken(int32_t token_id, bool debug_print) {
     return accepted;
   }
 
-  const auto& special_token_ids = tokenizer_info_.GetSpecialTokenIds();
-  if (std::find(special_token_ids.begin(), special_token_ids.end(), token_id) !=
-      special_token_ids.end()) {
+  if (IsSpecialToken(token_id)) {
     XGRAMMAR_LOG(WARNING) << "GrammarMatcher cannot accept special token id " << token_id << ": "
                           << tokenizer_info_.GetDecodedVocab()[token_id]
                           << ". Rejecting the token.";
@@ -554,7 +753,66 @@ bool GrammarMatcher::Impl::AcceptToken(int32_t token_id, bool debug_print) {
   return true;
 }
 
+int32_t GrammarMatcher::Impl::AcceptTokens(
+    const int32_t* token_ids, int32_t num_tokens, bool debug_print
+) {
+  debug_print = XGRAMMAR_ENABLE_DEBUG_PRINT && debug_print;
+  if (debug_print) {
+    // Print the information of every token.
+    int32_t num_accepted = 0;
+    while (num_accepted < num_tokens && AcceptToken(token_ids[num_accepted], true)) {
+      ++num_accepted;
+    }
+    return num_accepted;
+  }
+  if (IsStopTokenAccepted()) {
+    return num_tokens == 0 ? 0 : static_cast<int32_t>(AcceptToken(token_ids[0]));
+  }
+
+  // Step 1. Validate the tokens once. The tokens before the first out-of-range, stop or special
+  // token only need to be scanned by the parser.
+  const auto& decoded_vocab = tokenizer_info_.GetDecodedVocab();
+  int32_t vocab_size = tokenizer_info_.GetVocabSize();
+  int32_t num_scanned = 0;
+  while (num_scanned < num_tokens) {
+    int32_t token_id = token_ids[num_scanned];
+    if (token_id < 0 || token_id >= vocab_size || IsStopToken(token_id) ||
+        IsSpecialToken(token_id)) {
+      break;
+    }
+    ++num_scanned;
+  }
+
+  // Step 2. Scan the bytes of the tokens through the parser, until a byte is rejected. The bytes
+  // of the rejected token are popped, so it leaves no state behind.
+  int32_t num_accepted = 0;
+  for (; num_accepted < num_scanned; ++num_accepted) {
+    const auto& token = decoded_vocab[token_ids[num_accepted]];
+    int pos = 0;
+    while (pos < static_cast<int>(token.size()) && Advance(token[pos])) {
+      ++pos;
+    }
+    if (pos < static_cast<int>(token.size())) {
+      PopLastStates(pos);
+      break;
+    }
+  }
+
+  // Step 3. Every accepted token is one step of the rollback history.
+  for (int32_t i = 0; i < num_accepted; ++i) {
+    token_length_history.push_back(decoded_vocab[token_ids[i]].size());
+  }
+
+  // Step 4. The token after the scanned ones is a stop token, or is rejected with a warning.
+  if (num_accepted == num_scanned && num_scanned < num_tokens &&
+      AcceptToken(token_ids[num_scanned])) {
+    ++num_accepted;
+  }
+  return num_accepted;
+}
+
 bool GrammarMatcher::Impl::AcceptString(const std::string& input_str, bool debug_print) {
+  debug_print = XGRAMMAR_ENABLE_DEBUG_PRINT && debug_print;
   if (IsStopTokenAccepted()) {
     XGRAMMAR_LOG(WARNING) << "The matcher has terminated after accepting the stop token, but is "
                           << "trying to accept new string \"" << EscapeString(input_str) << "\".";
@@ -614,6 +872,28 @@ std::string GrammarMatcher::Impl::PrintBitmask(
   return ss.str();
 }
 
+GrammarMatcher::Impl::FillNextTokenBitmaskWorkspace&
+GrammarMatcher::Impl::GetFillNextTokenBitmaskWorkspace(int vocab_size) {
+  static thread_local FillNextTokenBitmaskWorkspace workspace;
+  if (workspace.accepted_bitset.Size() != vocab_size) {
+    workspace.accepted_bitset = DynamicBitset(vocab_size);
+    workspace.rejected_bitset = DynamicBitset(vocab_size);
+    workspace.state_rejected_bitset = DynamicBitset(vocab_size);
+  }
+  return workspace;
+}
+
+std::size_t GrammarMatcher::Impl::MemorySizeBytes() const {
+  std::size_t override_stop_tokens_size =
+      override_stop_tokens_ != nullptr
+          ? sizeof(*override_stop_tokens_) + MemorySize(override_stop_tokens_->ids) +
+                MemorySize(override_stop_tokens_->bitset)
+          : 0;
+  return sizeof(*this) + MemorySize(rule_id_to_completable_states_) +
+         MemorySize(scanable_state_history_) + (is_completed_.capacity() + 7) / 8 +
+         MemorySize(token_length_history) + override_stop_tokens_size;
+}
+
 bool GrammarMatcher::Impl::IsTokenBitmaskAllTrue(int32_t* bitmask_data_ptr) {
   DynamicBitset next_token_bitset(
       tokenizer_info_.GetVocabSize(), reinterpret_cast<uint32_t*>(bitmask_data_ptr)
@@ -621,159 +901,314 @@ bool GrammarMatcher::Impl::IsTokenBitmaskAllTrue(int32_t* bitmask_data_ptr) {
   return next_token_bitset.All();
 }
 
+void GrammarMatcher::Impl::GetLiveFollowBytes(
+    const ParserState& state,
+    FillNextTokenBitmaskWorkspace* workspace,
+    std::bitset<256>* follow_bytes
+) {
+  const auto& rule_first_bytes = compiled_grammar_->rule_first_bytes;
+  follow_bytes->reset();
+  workspace->follow_stack.assign({{state.rule_id, state.rule_start_pos}});
+  workspace->follow_visited.assign({{state.rule_id, state.rule_start_pos}});
+  while (!workspace->follow_stack.empty()) {
+    auto [rule_id, rule_start_pos] = workspace->follow_stack.back();
+    workspace->follow_stack.pop_back();
+    // The root rule is only followed by the end of the input.
+    if (rule_start_pos == ParserState::kNoPrevInputPos) {
+      continue;
+    }
+    for (const auto& [ref_id, parent_state] : rule_id_to_completable_states_[rule_start_pos]) {
+      if (ref_id != rule_id) {
+        continue;
+      }
+      if (parent_state.rule_id == -1 ||
+          grammar_->GetGrammarExpr(grammar_->GetRule(parent_state.rule_id).body_expr_id).type ==
+              GrammarExprType::kTagDispatch) {
+        follow_bytes->set();
+        return;
+      }
+      bool can_be_empty;
+      if (grammar_->per_rule_fsms[parent_state.rule_id].has_value()) {
+        // The element id of a FSM parent is already the node after the rule reference.
+        can_be_empty = FirstFollowBytesAnalyzer::GetFSMFirstBytes(
+            grammar_, rule_first_bytes, parent_state.rule_id, parent_state.element_id, follow_bytes
+        );
+      } else {
+        const auto& sequence = grammar_->GetGrammarExpr(parent_state.sequence_id);
+        const auto& element = grammar_->GetGrammarExpr(sequence[parent_state.element_id]);
+        if (element.type == GrammarExprType::kRepeat) {
+          *follow_bytes |= rule_first_bytes[element[0]];
+        }
+        can_be_empty = FirstFollowBytesAnalyzer::GetSequenceFirstBytes(
+            grammar_,
+            rule_first_bytes,
+            parent_state.sequence_id,
+            parent_state.element_id + 1,
+            follow_bytes
+        );
+      }
+      std::pair<int32_t, int32_t> parent_key = {parent_state.rule_id, parent_state.rule_start_pos};
+      if (can_be_empty &&
+          std::find(workspace->follow_visited.begin(), workspace->follow_visited.end(), parent_key) ==
+              workspace->follow_visited.end()) {
+        workspace->follow_visited.push_back(parent_key);
+        workspace->follow_stack.push_back(parent_key);
+      }
+    }
+  }
+}
+
 bool GrammarMatcher::Impl::FillNextTokenBitmask(
     DLTensor* next_token_bitmask, int index, bool debug_print
 ) {
+  debug_print = XGRAMMAR_ENABLE_DEBUG_PRINT && debug_print;
   XGRAMMAR_CHECK(!IsStopTokenAccepted())
       << "GrammarMatcher has terminated after accepting the stop token, but is trying to "
          "find the next token mask";
   int32_t* bitmask_data_ptr =
       CheckAndGetBitmaskPtr(*next_token_bitmask, tokenizer_info_.GetVocabSize(), index);
+  if (debug_print) {
+    XGRAMMAR_LOG(INFO) << "FillNextTokenBitmask: index=" << index;
+  }
+  // No character is accepted since the construction or the last reset, so the bitmask is the
+  // initial one.
+  if (initial_matcher_state_ != nullptr && !debug_print && scanable_state_history_.size() == 1) {
+    const auto& token_bitmask = initial_matcher_state_->token_bitmask;
+    std::memcpy(bitmask_data_ptr, token_bitmask.data(), token_bitmask.size() * sizeof(int32_t));
+    return !initial_matcher_state_->is_token_bitmask_all_true;
+  }
+  return ComputeNextTokenBitmask(bitmask_data_ptr, debug_print);
+}
+
+bool GrammarMatcher::Impl::ComputeNextTokenBitmask(int32_t* bitmask_data_ptr, bool debug_print) {
+#if XGRAMMAR_ENABLE_DEBUG_PRINT
+  if (debug_print) {
+    return ComputeNextTokenBitmaskImpl<true>(bitmask_data_ptr);
+  }
+#endif  // XGRAMMAR_ENABLE_DEBUG_PRINT
+  return ComputeNextTokenBitmaskImpl<false>(bitmask_data_ptr);
+}
+
+template <bool kDebugPrint>
+bool GrammarMatcher::Impl::ComputeNextTokenBitmaskImpl(int32_t* bitmask_data_ptr) {
   const auto& sorted_decoded_vocab = tokenizer_info_.GetSortedDecodedVocab();
-  const auto& subtree_range = tokenizer_info_.GetTrieSubtreeNodesRange();
-  const auto& adaptive_token_mask_cache = compiled_grammar_->adaptive_token_mask_cache;
-  // We need to have a copy, because scanable_state_history_ will be modified during the
-  // FillNextTokenBitmask process, which can lead to undefined behavior.
-  auto latest_states = GetLatestScanableStates();
 
   // We check all the latest states of the earley parser, and check all the masks of the leaf
   // states. The final accepted token set is the union of the accepted token sets of all leaf
   // states. The final rejected token set is the intersection of the rejected token sets of all leaf
   // states.
 
-  // Note these indices store the indices in sorted_decoded_vocab, instead of the token ids.
-  tmp_accepted_bitset_.Reset();
-  // {-1} means the universal set, i.e. all tokens initially
-  tmp_rejected_indices_.assign({-1});
-
-  if (debug_print) {
-    XGRAMMAR_LOG(INFO) << "FillNextTokenBitmask: index=" << index
-                       << ", num of states=" << latest_states.size();
+  auto& workspace = GetFillNextTokenBitmaskWorkspace(tokenizer_info_.GetVocabSize());
+  auto& accepted_bitset = workspace.accepted_bitset;
+  // We need to have a copy of the latest states, because scanable_state_history_ will be modified
+  // during the FillNextTokenBitmask process, which can lead to undefined behavior.
+  auto& latest_states_with_masks = workspace.latest_states_with_masks;
+  latest_states_with_masks.clear();
+
+  // Both bitsets are indexed by the token ids. The rejected bitset is only valid after the first
+  // state storing its rejected tokens, and is the universal set before that.
+  accepted_bitset.Reset();
+  workspace.has_rejected_bitset = false;
+
+  if constexpr (kDebugPrint) {
+    XGRAMMAR_LOG(INFO) << "ComputeNextTokenBitmask: num of states="
+                       << scanable_state_history_[scanable_state_history_.size() - 1].size();
   }
 
-  std::vector<std::pair<ParserState, decltype(adaptive_token_mask_cache.cbegin())>>
-      latest_states_with_masks;
-
-  for (const auto& state : latest_states) {
-    auto adaptive_token_mask_it = adaptive_token_mask_cache.find(state);
-    XGRAMMAR_CHECK(adaptive_token_mask_it != adaptive_token_mask_cache.end()) << state;
-    const auto& adaptive_token_mask = adaptive_token_mask_it->second;
-    latest_states_with_masks.push_back(std::make_pair(state, adaptive_token_mask_it));
+  for (const auto& state : scanable_state_history_[scanable_state_history_.size() - 1]) {
+    const auto* adaptive_token_mask_ptr = compiled_grammar_->GetAdaptiveTokenMask(state);
+    XGRAMMAR_CHECK(adaptive_token_mask_ptr != nullptr) << state;
+    const auto& adaptive_token_mask = *adaptive_token_mask_ptr;
+    latest_states_with_masks.push_back(std::make_pair(state, adaptive_token_mask_ptr));
     if (adaptive_token_mask.store_type == StoreType::kAcceptedBitset) {
-      tmp_accepted_bitset_ |= adaptive_token_mask.accepted_bitset;
+      accepted_bitset |= adaptive_token_mask.accepted_bitset;
     } else if (adaptive_token_mask.store_type == StoreType::kAccepted) {
       for (auto idx : adaptive_token_mask.accepted_indices) {
-        tmp_accepted_bitset_.Set(sorted_decoded_vocab[idx].first, true);
+        accepted_bitset.Set(sorted_decoded_vocab[idx].first, true);
       }
     }
   }
 
-  for (const auto& [state, adaptive_token_mask_it] : latest_states_with_masks) {
-    const auto& adaptive_token_mask = adaptive_token_mask_it->second;
+  // The store type is dispatched once per state, so that the loop over the uncertain tokens of the
+  // state is specialized for it.
+  for (const auto& [state, adaptive_token_mask_ptr] : latest_states_with_masks) {
+    const auto& adaptive_token_mask = *adaptive_token_mask_ptr;
+    switch (adaptive_token_mask.store_type) {
+      case StoreType::kAccepted:
+        CheckUncertainTokens<StoreType::kAccepted, kDebugPrint>(
+            state, adaptive_token_mask, &workspace
+        );
+        break;
+      case StoreType::kRejected:
+        CheckUncertainTokens<StoreType::kRejected, kDebugPrint>(
+            state, adaptive_token_mask, &workspace
+        );
+        break;
+      case StoreType::kAcceptedBitset:
+        CheckUncertainTokens<StoreType::kAcceptedBitset, kDebugPrint>(
+            state, adaptive_token_mask, &workspace
+        );
+        break;
+    }
+  }
 
-    // For each ParserState, we will check every uncertain token and put them into the accepted or
-    // rejected list.
+  // Finally update the rejected_ids bitset
+  bool can_reach_end = IsCompleted();
+  SetTokenBitmask(
+      bitmask_data_ptr,
+      accepted_bitset,
+      workspace.has_rejected_bitset ? &workspace.rejected_bitset : nullptr,
+      can_reach_end,
+      false
+  );
+  if constexpr (kDebugPrint) {
+    XGRAMMAR_LOG(INFO) << "Filled bitmask: " << PrintBitmask(bitmask_data_ptr, tokenizer_info_);
+  }
+  return !IsTokenBitmaskAllTrue(bitmask_data_ptr);
+}
 
-    // Step 2. Update the accepted tokens in accepted_indices_delta, or the rejected tokens in
-    // rejected_indices_delta.
+template <AdaptiveTokenMask::StoreType kStoreType, bool kDebugPrint>
+void GrammarMatcher::Impl::CheckUncertainTokens(
+    const ParserState& state,
+    const AdaptiveTokenMask& adaptive_token_mask,
+    FillNextTokenBitmaskWorkspace* workspace
+) {
+  XGRAMMAR_DCHECK(adaptive_token_mask.store_type == kStoreType);
+  const auto& sorted_decoded_vocab = tokenizer_info_.GetSortedDecodedVocab();
+  const auto& subtree_range = tokenizer_info_.GetTrieSubtreeNodesRange();
+  auto& accepted_bitset = workspace->accepted_bitset;
+  // The rejected tokens of the first state storing them are collected in the rejected bitset
+  // directly; the ones of the later states are intersected with it at the end.
+  auto& state_rejected_bitset = workspace->has_rejected_bitset ? workspace->state_rejected_bitset
+                                                               : workspace->rejected_bitset;
 
-    // If the accepted tokens are saved, it means it is likely to be smaller than the rejected
-    // tokens, so we will just find the accepted tokens, and vice versa.
+  // For each ParserState, we will check every uncertain token and put them into the accepted or
+  // rejected set.
 
-    tmp_rejected_indices_delta_.clear();
+  // Step 2. Add the accepted tokens to accepted_bitset, or the rejected tokens to
+  // state_rejected_bitset.
 
-    // Examine only the current one ParserState
-    PushOneStateToCheck(state);
+  // If the accepted tokens are saved, it means it is likely to be smaller than the rejected
+  // tokens, so we will just find the accepted tokens, and vice versa.
 
-    const std::string* prev_token = nullptr;
-    int prev_matched_size = 0;
-    if (debug_print) {
-      XGRAMMAR_LOG(INFO) << "The ParserState is " << state << ", the mask is "
-                         << adaptive_token_mask.Print(tokenizer_info_);
+  if constexpr (kStoreType == StoreType::kRejected) {
+    state_rejected_bitset.Reset();
+    for (auto idx : adaptive_token_mask.rejected_indices) {
+      state_rejected_bitset.Set(sorted_decoded_vocab[idx].first, true);
     }
-    int last_rejected_uncertain_range = 0;
-    for (const auto& cur_token_idx : adaptive_token_mask.uncertain_indices) {
-      // Check if the current token is already accepted. If it is, we can skip it.
-      if (tmp_accepted_bitset_[sorted_decoded_vocab[cur_token_idx].first]) {
-        continue;
+  }
+
+  // Examine only the current one ParserState
+  PushOneStateToCheck(state);
+
+  const std::string* prev_token = nullptr;
+  int prev_matched_size = 0;
+  if constexpr (kDebugPrint) {
+    XGRAMMAR_LOG(INFO) << "The ParserState is " << state << ", the mask is "
+                       << adaptive_token_mask.Print(tokenizer_info_);
+  }
+  int last_rejected_uncertain_range = 0;
+  // The bytes that can follow the rule of the state. Computed lazily for the first uncertain
+  // token with known boundaries.
+  bool use_follow_bytes = !compiled_grammar_->rule_first_bytes.empty();
+  bool is_follow_bytes_computed = false;
+  std::bitset<256> follow_bytes;
+  XGRAMMAR_DCHECK(
+      adaptive_token_mask.uncertain_boundary_masks.size() ==
+      adaptive_token_mask.uncertain_indices.size()
+  );
+  for (int i = 0; i < static_cast<int>(adaptive_token_mask.uncertain_indices.size()); ++i) {
+    const auto& cur_token_idx = adaptive_token_mask.uncertain_indices[i];
+    // Check if the current token is already accepted. If it is, we can skip it.
+    if (accepted_bitset[sorted_decoded_vocab[cur_token_idx].first]) {
+      continue;
+    }
+
+    // Check if the current token is in the rejected range. i.e. check if the current token
+    // is on the subtree of the rejected token.
+    if (cur_token_idx < last_rejected_uncertain_range) {
+      if constexpr (kStoreType == StoreType::kRejected) {
+        state_rejected_bitset.Set(sorted_decoded_vocab[cur_token_idx].first, true);
       }
+      continue;
+    }
 
-      // Check if the current token is in the rejected range. i.e. check if the current token
-      // is on the subtree of the rejected token.
-      if (cur_token_idx < last_rejected_uncertain_range) {
-        if (adaptive_token_mask.store_type == StoreType::kRejected) {
-          tmp_rejected_indices_delta_.push_back(cur_token_idx);
+    const auto& cur_token = sorted_decoded_vocab[cur_token_idx].second;
+
+    // Step 2.0. The token leaves the rule of the state after one of the boundaries in its mask.
+    // If none of the bytes after the boundaries can follow the rule, reject it without running
+    // the parser.
+    uint32_t boundary_mask = adaptive_token_mask.uncertain_boundary_masks[i];
+    if (use_follow_bytes && boundary_mask != 0) {
+      if (!is_follow_bytes_computed) {
+        GetLiveFollowBytes(state, workspace, &follow_bytes);
+        is_follow_bytes_computed = true;
+      }
+      bool can_be_followed = false;
+      for (int k = 1; k < 32 && (boundary_mask >> k) != 0 && !can_be_followed; ++k) {
+        can_be_followed =
+            ((boundary_mask >> k) & 1) && follow_bytes[static_cast<uint8_t>(cur_token[k])];
+      }
+      if (!can_be_followed) {
+        if constexpr (kStoreType == StoreType::kRejected) {
+          state_rejected_bitset.Set(sorted_decoded_vocab[cur_token_idx].first, true);
         }
         continue;
       }
+    }
+
+    bool accepted = true;
+
+    // Step 2.1. Find the longest common prefix with the accepted part of the previous token.
+    // We can reuse the previous matched size to avoid unnecessary matching.
+    if (prev_token) {
+      int lcp_len =
+          std::mismatch(cur_token.begin(), cur_token.end(), prev_token->begin(), prev_token->end())
+              .first -
+          cur_token.begin();
+      if (lcp_len > prev_matched_size) {
+        last_rejected_uncertain_range = subtree_range[cur_token_idx];
+        accepted = false;
+      } else if (lcp_len < prev_matched_size) {
+        PopLastStates(prev_matched_size - lcp_len);
+      }
+      prev_matched_size = std::min(prev_matched_size, lcp_len);
+    }
 
-      const auto& cur_token = sorted_decoded_vocab[cur_token_idx].second;
-      bool accepted = true;
-
-      // Step 2.1. Find the longest common prefix with the accepted part of the previous token.
-      // We can reuse the previous matched size to avoid unnecessary matching.
-      if (prev_token) {
-        int lcp_len = std::mismatch(
-                          cur_token.begin(), cur_token.end(), prev_token->begin(), prev_token->end()
-                      )
-                          .first -
-                      cur_token.begin();
-        if (lcp_len > prev_matched_size) {
+    // Step 2.2. Find if the current token is accepted or rejected.
+    if (accepted) {
+      for (int j = prev_matched_size; j < static_cast<int>(cur_token.size()); ++j) {
+        if (!Advance(cur_token[j])) {
           last_rejected_uncertain_range = subtree_range[cur_token_idx];
           accepted = false;
-        } else if (lcp_len < prev_matched_size) {
-          PopLastStates(prev_matched_size - lcp_len);
+          break;
         }
-        prev_matched_size = std::min(prev_matched_size, lcp_len);
+        prev_matched_size = j + 1;
       }
+    }
 
-      // Step 2.2. Find if the current token is accepted or rejected.
-      if (accepted) {
-        for (int j = prev_matched_size; j < static_cast<int>(cur_token.size()); ++j) {
-          if (!Advance(cur_token[j])) {
-            last_rejected_uncertain_range = subtree_range[cur_token_idx];
-            accepted = false;
-            break;
-          }
-          prev_matched_size = j + 1;
-        }
+    // Step 2.3. Push the result to the delta list.
+    if constexpr (kStoreType == StoreType::kRejected) {
+      if (!accepted) {
+        state_rejected_bitset.Set(sorted_decoded_vocab[cur_token_idx].first, true);
       }
-
-      // Step 2.3. Push the result to the delta list.
-      if (adaptive_token_mask.store_type == StoreType::kAcceptedBitset ||
-          adaptive_token_mask.store_type == StoreType::kAccepted) {
-        if (accepted) {
-          tmp_accepted_bitset_.Set(sorted_decoded_vocab[cur_token_idx].first, true);
-        }
-      } else {
-        if (!accepted) {
-          tmp_rejected_indices_delta_.push_back(cur_token_idx);
-        }
+    } else {
+      if (accepted) {
+        accepted_bitset.Set(sorted_decoded_vocab[cur_token_idx].first, true);
       }
-
-      prev_token = &cur_token;
     }
 
-    PopLastStates(prev_matched_size + 1);
-    // Step 3. Update the accepted_indices or rejected_indices
-    if (adaptive_token_mask.store_type == StoreType::kRejected) {
-      // rejected_indices = Intersect(
-      //     rejected_indices,
-      //     adaptive_token_mask.rejected_indices + rejected_indices_delta)
-      IntsetUnion(&tmp_rejected_indices_delta_, adaptive_token_mask.rejected_indices);
-      IntsetIntersection(&tmp_rejected_indices_, tmp_rejected_indices_delta_);
-    }
+    prev_token = &cur_token;
   }
 
-  // Finally update the rejected_ids bitset
-  bool can_reach_end = IsCompleted();
-  SetTokenBitmask(
-      bitmask_data_ptr, tmp_accepted_bitset_, tmp_rejected_indices_, can_reach_end, false
-  );
-  if (debug_print) {
-    XGRAMMAR_LOG(INFO) << "Filled bitmask: " << PrintBitmask(bitmask_data_ptr, tokenizer_info_);
+  PopLastStates(prev_matched_size + 1);
+  // Step 3. Intersect the rejected tokens of all states with word-level AND.
+  if constexpr (kStoreType == StoreType::kRejected) {
+    if (workspace->has_rejected_bitset) {
+      workspace->rejected_bitset &= state_rejected_bitset;
+    }
+    workspace->has_rejected_bitset = true;
   }
-  return !IsTokenBitmaskAllTrue(bitmask_data_ptr);
 }
 
 std::string GrammarMatcher::Impl::FindJumpForwardString() {
@@ -895,23 +1330,22 @@ void GrammarMatcher::Impl::Rollback(int num_tokens) {
 void GrammarMatcher::Impl::SetTokenBitmask(
     int32_t* bitmask_data_ptr,
     const DynamicBitset& accepted_bitset,
-    const std::vector<int32_t>& rejected_indices,
+    const DynamicBitset* rejected_bitset,
     bool can_reach_end,
     bool allow_special_token
 ) {
   // next_token_bitmask = set(all accepted tokens) =
-  // 1. all_tokens - (rejected_ids / accepted_ids)
-  //    (when rejected_ids != {-1}, i.e. rejected_ids is not the universal set)
+  // 1. all_tokens - (rejected_ids - accepted_ids) = ~rejected_ids | accepted_ids
+  //    (when rejected_bitset is given)
   // 2. accepted_ids
-  //    (otherwise, when rejected_ids is the universal set)
+  //    (otherwise, when the rejected set is the universal set)
   DynamicBitset next_token_bitset(
       tokenizer_info_.GetVocabSize(), reinterpret_cast<uint32_t*>(bitmask_data_ptr)
   );
-  const auto& sorted_decoded_vocab = tokenizer_info_.GetSortedDecodedVocab();
 
-  if (rejected_indices.size() == 1 && rejected_indices[0] == -1) {
-    // If rejected_indices is the universal set, the final accepted token set is just
-    // accepted_indices
+  if (rejected_bitset == nullptr) {
+    // If the rejected set is the universal set, the final accepted token set is just
+    // accepted_bitset
     next_token_bitset = accepted_bitset;
 
     if (allow_special_token) {
@@ -922,27 +1356,22 @@ void GrammarMatcher::Impl::SetTokenBitmask(
 
     if (can_reach_end) {
       // add end tokens
-      for (int id : stop_token_ids_) {
+      for (int id : GetStopTokenIds()) {
         next_token_bitset.Set(id, true);
       }
     }
   } else {
-    // Otherwise, the final rejected token set is (rejected_indices \ accepted_indices)
-    next_token_bitset.Set();
-
-    for (auto i : rejected_indices) {
-      auto id = sorted_decoded_vocab[i].first;
-      if (!accepted_bitset[id]) {
-        next_token_bitset.Set(id, false);
-      }
-    }
+    // Otherwise, the final rejected token set is (rejected_bitset - accepted_bitset)
+    next_token_bitset = *rejected_bitset;
+    next_token_bitset.Flip();
+    next_token_bitset |= accepted_bitset;
     if (!allow_special_token) {
       for (int id : tokenizer_info_.GetSpecialTokenIds()) {
         next_token_bitset.Set(id, false);
       }
     }
     if (!can_reach_end) {
-      for (int id : stop_token_ids_) {
+      for (int id : GetStopTokenIds()) {
         next_token_bitset.Set(id, false);
       }
     }
@@ -983,12 +1412,7 @@ void BatchGrammarMatcher::Impl::BatchFillNextTokenBitmask(
   XGRAMMAR_CHECK(!indices.has_value() || indices->size() == matchers->size())
       << "The size of indices (" << (indices.has_value() ? indices->size() : 0)
       << ") should be the same as the size of matchers (" << matchers->size() << ").";
-  // Initialize the thread pool if needed. It should be initialized each time,
-  // because ThreadPool cannot be reused after Join().
-  if (max_threads_ > 1) {
-    thread_pool_.emplace(max_threads_);
-  }
-  if (!thread_pool_.has_value()) {
+  if (max_threads_ <= 1) {
     for (int i = 0; i < static_cast<int32_t>(matchers->size()); i++) {
       auto& matcher = (*matchers)[i];
       int index = indices.has_value() ? (*indices)[i] : i;
@@ -1006,10 +1430,13 @@ void BatchGrammarMatcher::Impl::BatchFillNextTokenBitmask(
           << ") for batch_id " << batch_id << ".";
       matcher->FillNextTokenBitmask(next_token_bitmask, index, debug_print);
     };
+    // The tasks run on the executor shared with the compiler, and take priority over the
+    // compiling tasks.
+    TaskGroup task_group(TaskPriority::kDecode, max_threads_);
     for (int i = 0; i < static_cast<int32_t>(matchers->size()); i++) {
-      thread_pool_->Execute([fill_next_token_mask, i]() { fill_next_token_mask(i); });
+      task_group.Execute([&fill_next_token_mask, i]() { fill_next_token_mask(i); });
     }
-    thread_pool_->Join();
+    task_group.Wait();
   }
 }
 
@@ -1043,6 +1470,270 @@ std::vector<uint8_t> BatchGrammarMatcher::Impl::BatchAcceptToken(
   return accepted;
 }
 
+std::vector<int32_t> BatchGrammarMatcher::Impl::BatchAcceptTokens(
+    std::vector<GrammarMatcher>* matchers,
+    const std::vector<std::vector<int32_t>>& token_ids,
+    bool debug_print
+) {
+  XGRAMMAR_CHECK(matchers->size() == token_ids.size())
+      << "The size of matchers (" << matchers->size() << ") and token_ids (" << token_ids.size()
+      << ") should be the same.";
+  std::vector<int32_t> num_accepted(matchers->size());
+  auto accept_tokens = [&](int32_t batch_id) {
+    num_accepted[batch_id] = (*matchers)[batch_id]->AcceptTokens(
+        token_ids[batch_id].data(), static_cast<int32_t>(token_ids[batch_id].size()), debug_print
+    );
+  };
+  if (max_threads_ <= 1 || matchers->size() <= 1) {
+    for (int i = 0; i < static_cast<int32_t>(matchers->size()); i++) {
+      accept_tokens(i);
+    }
+  } else {
+    // The matchers are independent, so their tokens are accepted in parallel on the executor
+    // shared with the compiler, like BatchFillNextTokenBitmask.
+    TaskGroup task_group(TaskPriority::kDecode, max_threads_);
+    for (int i = 0; i < static_cast<int32_t>(matchers->size()); i++) {
+      task_group.Execute([&accept_tokens, i]() { accept_tokens(i); });
+    }
+    task_group.Wait();
+  }
+  return num_accepted;
+}
+
+BatchCompletionHandle BatchGrammarMatcher::Impl::SubmitAcceptAndFill(
+    const std::vector<GrammarMatcher>& matchers,
+    const std::vector<int32_t>& token_ids,
+    DLTensor* next_token_bitmask,
+    const std::optional<std::vector<int32_t>>& indices,
+    bool debug_print
+) {
+  XGRAMMAR_CHECK(matchers.size() == token_ids.size())
+      << "The size of matchers (" << matchers.size() << ") and token_ids (" << token_ids.size()
+      << ") should be the same.";
+  XGRAMMAR_CHECK(!indices.has_value() || indices->size() == matchers.size())
+      << "The size of indices (" << (indices.has_value() ? indices->size() : 0)
+      << ") should be the same as the size of matchers (" << matchers.size() << ").";
+  if (async_executor_ == nullptr) {
+    async_executor_ = std::make_unique<ThreadPool>(1);
+  }
+  // The shape and the strides are owned by the caller's tensor object, which may be released
+  // before the operation runs, so they are copied with the tensor. The data is not copied.
+  DLTensor bitmask = *next_token_bitmask;
+  std::vector<int64_t> bitmask_shape(bitmask.shape, bitmask.shape + bitmask.ndim);
+  std::vector<int64_t> bitmask_strides;
+  if (bitmask.strides != nullptr) {
+    bitmask_strides.assign(bitmask.strides, bitmask.strides + bitmask.ndim);
+  }
+  auto task = [this,
+               matchers = matchers,
+               token_ids,
+               bitmask,
+               bitmask_shape = std::move(bitmask_shape),
+               bitmask_strides = std::move(bitmask_strides),
+               indices,
+               debug_print]() mutable {
+    bitmask.shape = bitmask_shape.data();
+    bitmask.strides = bitmask_strides.empty() ? nullptr : bitmask_strides.data();
+    std::vector<uint8_t> accepted(matchers.size());
+    std::vector<GrammarMatcher> fill_matchers;
+    std::vector<int32_t> fill_indices;
+    for (int i = 0; i < static_cast<int32_t>(matchers.size()); ++i) {
+      accepted[i] = matchers[i]->AcceptToken(token_ids[i], debug_print);
+      if (!matchers[i]->IsStopTokenAccepted()) {
+        fill_matchers.push_back(matchers[i]);
+        fill_indices.push_back(indices.has_value() ? (*indices)[i] : i);
+      }
+    }
+    BatchFillNextTokenBitmask(&fill_matchers, &bitmask, fill_indices, debug_print);
+    return accepted;
+  };
+  return BatchCompletionHandle(
+      std::make_shared<BatchCompletionHandle::Impl>(async_executor_->Submit(std::move(task)))
+  );
+}
+
+class MatcherGroup::Impl {
+ public:
+  Impl(std::variant<std::string, int32_t> max_threads)
+      : max_threads_(GetBatchMaxThreads(max_threads)) {}
+
+  int32_t AddMatcher(const GrammarMatcher& matcher) {
+    ++num_matchers_;
+    if (!free_slots_.empty()) {
+      auto slot = free_slots_.back();
+      free_slots_.pop_back();
+      matchers_[slot] = matcher;
+      return slot;
+    }
+    matchers_.push_back(matcher);
+    slot_batch_ids_.push_back(-1);
+    return static_cast<int32_t>(matchers_.size()) - 1;
+  }
+
+  void SetMatcher(int32_t slot, const GrammarMatcher& matcher) {
+    CheckSlot(slot);
+    matchers_[slot] = matcher;
+  }
+
+  void RemoveMatcher(int32_t slot) {
+    CheckSlot(slot);
+    matchers_[slot] = std::nullopt;
+    free_slots_.push_back(slot);
+    --num_matchers_;
+  }
+
+  GrammarMatcher GetMatcher(int32_t slot) const {
+    CheckSlot(slot);
+    return *matchers_[slot];
+  }
+
+  int32_t NumMatchers() const { return num_matchers_; }
+
+  void BatchFillNextTokenBitmask(
+      const DLTensor& slots, DLTensor* next_token_bitmask, const DLTensor* indices, bool debug_print
+  );
+
+  std::vector<uint8_t> BatchAcceptToken(
+      const DLTensor& slots, const DLTensor& token_ids, bool debug_print
+  );
+
+  std::vector<uint8_t> BatchAcceptString(
+      const DLTensor& slots, const std::vector<std::string>& input_strs, bool debug_print
+  );
+
+ private:
+  void CheckSlot(int32_t slot) const {
+    XGRAMMAR_CHECK(
+        slot >= 0 && slot < static_cast<int32_t>(matchers_.size()) && matchers_[slot].has_value()
+    ) << "The slot "
+      << slot << " does not hold a matcher";
+  }
+
+  /*! \brief Get the data and the size of a 1D int32 tensor on CPU without copying. */
+  static std::pair<const int32_t*, int64_t> GetInt32Array(
+      const DLTensor& tensor, const std::string& name
+  ) {
+    XGRAMMAR_CHECK(
+        tensor.dtype.code == kDLInt && tensor.dtype.bits == 32 && tensor.dtype.lanes == 1
+    ) << "The "
+      << name << " tensor's dtype is not valid: should be int32";
+    XGRAMMAR_CHECK(tensor.ndim == 1) << "The " << name << " tensor should be 1D";
+    XGRAMMAR_CHECK(
+        tensor.device.device_type == kDLCPU || tensor.device.device_type == kDLCUDAHost ||
+        tensor.device.device_type == kDLROCMHost
+    ) << "The "
+      << name << " tensor's device is not valid: should be CPU";
+    XGRAMMAR_CHECK(tensor.strides == nullptr || tensor.strides[0] == 1 || tensor.shape[0] <= 1)
+        << "The " << name << " tensor should be contiguous";
+    const char* data = static_cast<const char*>(tensor.data) + tensor.byte_offset;
+    return {reinterpret_cast<const int32_t*>(data), tensor.shape[0]};
+  }
+
+  /*!
+   * \brief Check the slots of a batch, and return the slot ids. A slot can appear at most once,
+   * so the matchers of a batch can be processed in parallel.
+   */
+  std::pair<const int32_t*, int64_t> GetBatchSlots(const DLTensor& slots) {
+    auto [slot_ids, batch_size] = GetInt32Array(slots, "slots");
+    ++batch_id_;
+    for (int64_t i = 0; i < batch_size; ++i) {
+      CheckSlot(slot_ids[i]);
+      XGRAMMAR_CHECK(slot_batch_ids_[slot_ids[i]] != batch_id_)
+          << "The slot " << slot_ids[i] << " appears more than once in the batch";
+      slot_batch_ids_[slot_ids[i]] = batch_id_;
+    }
+    return {slot_ids, batch_size};
+  }
+
+  /*!
+   * \brief Run func(i) for i in [0, batch_size) with the shared executor. The first exception
+   * thrown by the tasks is rethrown after all tasks finish.
+   */
+  template <typename Func>
+  void ParallelRun(int64_t batch_size, const Func& func);
+
+  /*! \brief The matchers of the slots. std::nullopt for the free slots. */
+  std::vector<std::optional<GrammarMatcher>> matchers_;
+  /*! \brief The free slots to be reused. */
+  std::vector<int32_t> free_slots_;
+  /*! \brief The id of the last batch containing each slot. Used to find the duplicated slots. */
+  std::vector<int64_t> slot_batch_ids_;
+  int64_t batch_id_ = 0;
+  int32_t num_matchers_ = 0;
+  int32_t max_threads_ = 1;
+};
+
+template <typename Func>
+void MatcherGroup::Impl::ParallelRun(int64_t batch_size, const Func& func) {
+  int64_t num_tasks = std::min<int64_t>(max_threads_, batch_size);
+  if (num_tasks <= 1) {
+    for (int64_t i = 0; i < batch_size; ++i) {
+      func(i);
+    }
+    return;
+  }
+  // Every item is a task of the shared executor, so the items are balanced dynamically among the
+  // workers, and the decoding tasks take priority over the compiling tasks.
+  TaskGroup task_group(TaskPriority::kDecode, max_threads_);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    task_group.Execute([&func, i]() { func(i); });
+  }
+  task_group.Wait();
+}
+
+void MatcherGroup::Impl::BatchFillNextTokenBitmask(
+    const DLTensor& slots, DLTensor* next_token_bitmask, const DLTensor* indices, bool debug_print
+) {
+  auto [slot_ids, batch_size] = GetBatchSlots(slots);
+  const int32_t* index_ids = nullptr;
+  if (indices != nullptr) {
+    int64_t num_indices;
+    std::tie(index_ids, num_indices) = GetInt32Array(*indices, "indices");
+    XGRAMMAR_CHECK(num_indices == batch_size)
+        << "The size of indices (" << num_indices << ") should be the same as the size of slots ("
+        << batch_size << ").";
+  }
+  for (int64_t i = 0; i < batch_size; ++i) {
+    int index = index_ids != nullptr ? index_ids[i] : i;
+    XGRAMMAR_CHECK(index >= 0 && index < next_token_bitmask->shape[0])
+        << "The index " << index << " is out of range [0, " << next_token_bitmask->shape[0]
+        << ") for batch_id " << i << ".";
+  }
+  ParallelRun(batch_size, [&](int64_t i) {
+    int index = index_ids != nullptr ? index_ids[i] : i;
+    (*matchers_[slot_ids[i]])->FillNextTokenBitmask(next_token_bitmask, index, debug_print);
+  });
+}
+
+std::vector<uint8_t> MatcherGroup::Impl::BatchAcceptToken(
+    const DLTensor& slots, const DLTensor& token_ids, bool debug_print
+) {
+  auto [slot_ids, batch_size] = GetBatchSlots(slots);
+  auto [token_id_data, num_token_ids] = GetInt32Array(token_ids, "token_ids");
+  XGRAMMAR_CHECK(num_token_ids == batch_size)
+      << "The size of slots (" << batch_size << ") and token_ids (" << num_token_ids
+      << ") should be the same.";
+  std::vector<uint8_t> accepted(batch_size);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    accepted[i] = (*matchers_[slot_ids[i]])->AcceptToken(token_id_data[i], debug_print);
+  }
+  return accepted;
+}
+
+std::vector<uint8_t> MatcherGroup::Impl::BatchAcceptString(
+    const DLTensor& slots, const std::vector<std::string>& input_strs, bool debug_print
+) {
+  auto [slot_ids, batch_size] = GetBatchSlots(slots);
+  XGRAMMAR_CHECK(static_cast<int64_t>(input_strs.size()) == batch_size)
+      << "The size of slots (" << batch_size << ") and input_strs (" << input_strs.size()
+      << ") should be the same.";
+  std::vector<uint8_t> accepted(batch_size);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    accepted[i] = (*matchers_[slot_ids[i]])->AcceptString(input_strs[i], debug_print);
+  }
+  return accepted;
+}
+
 GrammarMatcher::GrammarMatcher(
     const CompiledGrammar& compiled_grammar,
     std::optional<std::vector<int>> override_stop_tokens,
@@ -1057,6 +1748,12 @@ bool GrammarMatcher::AcceptToken(int32_t token_id, bool debug_print) {
   return pimpl_->AcceptToken(token_id, debug_print);
 }
 
+int32_t GrammarMatcher::AcceptTokens(const std::vector<int32_t>& token_ids, bool debug_print) {
+  return pimpl_->AcceptTokens(
+      token_ids.data(), static_cast<int32_t>(token_ids.size()), debug_print
+  );
+}
+
 bool GrammarMatcher::AcceptString(const std::string& input_str, bool debug_print) {
   return pimpl_->AcceptString(input_str, debug_print);
 }
@@ -1081,6 +1778,8 @@ const std::vector<int>& GrammarMatcher::GetStopTokenIds() const {
   return pimpl_->GetStopTokenIds();
 }
 
+std::size_t GrammarMatcher::MemorySizeBytes() const { return pimpl_->MemorySizeBytes(); }
+
 std::string GrammarMatcher::_DebugPrintInternalState() const {
   return pimpl_->_DebugPrintInternalState();
 }
@@ -1108,7 +1807,64 @@ std::vector<uint8_t> BatchGrammarMatcher::BatchAcceptToken(
   return Impl::BatchAcceptToken(matchers, token_ids, debug_print);
 }
 
+std::vector<int32_t> BatchGrammarMatcher::BatchAcceptTokens(
+    std::vector<GrammarMatcher>* matchers,
+    const std::vector<std::vector<int32_t>>& token_ids,
+    bool debug_print
+) {
+  return pimpl_->BatchAcceptTokens(matchers, token_ids, debug_print);
+}
+
+BatchCompletionHandle BatchGrammarMatcher::SubmitAcceptAndFill(
+    const std::vector<GrammarMatcher>& matchers,
+    const std::vector<int32_t>& token_ids,
+    DLTensor* next_token_bitmask,
+    const std::optional<std::vector<int32_t>>& indices,
+    bool debug_print
+) {
+  return pimpl_->SubmitAcceptAndFill(matchers, token_ids, next_token_bitmask, indices, debug_print);
+}
+
+std::vector<uint8_t> BatchCompletionHandle::Wait() const { return pimpl_->Wait(); }
+
+bool BatchCompletionHandle::IsReady() const { return pimpl_->IsReady(); }
+
 BatchGrammarMatcher::BatchGrammarMatcher(std::variant<std::string, int32_t> max_threads)
     : pimpl_(std::make_shared<BatchGrammarMatcher::Impl>(max_threads)) {}
 
+MatcherGroup::MatcherGroup(std::variant<std::string, int32_t> max_threads)
+    : pimpl_(std::make_shared<MatcherGroup::Impl>(max_threads)) {}
+
+int32_t MatcherGroup::AddMatcher(const GrammarMatcher& matcher) {
+  return pimpl_->AddMatcher(matcher);
+}
+
+void MatcherGroup::SetMatcher(int32_t slot, const GrammarMatcher& matcher) {
+  pimpl_->SetMatcher(slot, matcher);
+}
+
+void MatcherGroup::RemoveMatcher(int32_t slot) { pimpl_->RemoveMatcher(slot); }
+
+GrammarMatcher MatcherGroup::GetMatcher(int32_t slot) const { return pimpl_->GetMatcher(slot); }
+
+int32_t MatcherGroup::NumMatchers() const { return pimpl_->NumMatchers(); }
+
+void MatcherGroup::BatchFillNextTokenBitmask(
+    const DLTensor& slots, DLTensor* next_token_bitmask, const DLTensor* indices, bool debug_print
+) {
+  pimpl_->BatchFillNextTokenBitmask(slots, next_token_bitmask, indices, debug_print);
+}
+
+std::vector<uint8_t> MatcherGroup::BatchAcceptToken(
+    const DLTensor& slots, const DLTensor& token_ids, bool debug_print
+) {
+  return pimpl_->BatchAcceptToken(slots, token_ids, debug_print);
+}
+
+std::vector<uint8_t> MatcherGroup::BatchAcceptString(
+    const DLTensor& slots, const std::vector<std::string>& input_strs, bool debug_print
+) {
+  return pimpl_->BatchAcceptString(slots, input_strs, debug_print);
+}
+
 }  // namespace xgrammar
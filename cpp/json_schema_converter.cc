@@ -18,6 +18,7 @@
 #include <utility>
 #include <vector>
 
+#include "compile_budget.h"
 #include "ebnf_script_creator.h"
 #include "regex_converter.h"
 #include "support/logging.h"
@@ -843,6 +844,7 @@ std::string JSONSchemaConverter::GetSchemaCacheIndex(const picojson::value& sche
 std::string JSONSchemaConverter::VisitSchema(
     const picojson::value& schema, const std::string& rule_name, const JSONFormat json_format
 ) {
+  CheckCompileBudget();
   if (schema.is<bool>()) {
     XGRAMMAR_CHECK(schema.get<bool>()) << "Schema should not be false: it cannot accept any value";
     return VisitAny(schema, rule_name, json_format);
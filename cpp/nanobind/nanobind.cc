@@ -48,6 +48,12 @@ std::vector<std::string> CommonEncodedVocabType(
   return encoded_vocab_strs;
 }
 
+/*! \brief Get the DLTensor viewing the data of an ndarray without copying. */
+DLTensor* NDArray_GetDLTensor(nb::ndarray<>& arr) {
+  static_assert(sizeof(arr) == sizeof(void*) + sizeof(nb::dlpack::dltensor));
+  return reinterpret_cast<::DLTensor*>(reinterpret_cast<char*>(&arr) + sizeof(void*));
+}
+
 bool GrammarMatcher_FillNextTokenBitmask(
     GrammarMatcher& matcher, nb::ndarray<> arr, int32_t index, bool debug_print
 ) {
@@ -106,6 +112,28 @@ void GrammarMatcher_BatchFillNextTokenMask(
   batch_matcher.BatchFillNextTokenBitmask(matchers, bitmask_dltensor_ptr, indices, debug_print);
 }
 
+BatchCompletionHandle GrammarMatcher_SubmitAcceptAndFill(
+    BatchGrammarMatcher& batch_matcher,
+    const std::vector<GrammarMatcher>& matchers,
+    const std::vector<int32_t>& token_ids,
+    nb::ndarray<> arr,
+    const std::optional<std::vector<int32_t>>& indices,
+    bool debug_print
+) {
+  if (arr.ndim() != 2) {
+    throw std::runtime_error("batch_token_bitmask tensor must be 2D");
+  }
+  if (arr.device_type() != nb::device::cpu::value) {
+    throw std::runtime_error("token_bitmask array must be on CPU");
+  }
+  if (arr.dtype() != nb::dtype<int32_t>()) {
+    throw std::runtime_error("token_bitmask array must be int32");
+  }
+  return batch_matcher.SubmitAcceptAndFill(
+      matchers, token_ids, NDArray_GetDLTensor(arr), indices, debug_print
+  );
+}
+
 std::vector<uint8_t> GrammarMatcher_BatchAcceptString(
     std::vector<GrammarMatcher>* matchers,
     const std::vector<std::variant<nb::bytes, std::string>>& input_strs,
@@ -123,6 +151,56 @@ std::vector<uint8_t> GrammarMatcher_BatchAcceptString(
   return BatchGrammarMatcher::BatchAcceptString(matchers, input_strs_converted);
 }
 
+void MatcherGroup_BatchFillNextTokenBitmask(
+    MatcherGroup& group,
+    nb::ndarray<> slots,
+    nb::ndarray<> arr,
+    std::optional<nb::ndarray<>> indices,
+    bool debug_print
+) {
+  if (arr.ndim() != 2) {
+    throw std::runtime_error("batch_token_bitmask tensor must be 2D");
+  }
+  if (arr.device_type() != nb::device::cpu::value) {
+    throw std::runtime_error("token_bitmask array must be on CPU");
+  }
+  if (arr.dtype() != nb::dtype<int32_t>()) {
+    throw std::runtime_error("token_bitmask array must be int32");
+  }
+  group.BatchFillNextTokenBitmask(
+      *NDArray_GetDLTensor(slots),
+      NDArray_GetDLTensor(arr),
+      indices.has_value() ? NDArray_GetDLTensor(*indices) : nullptr,
+      debug_print
+  );
+}
+
+std::vector<uint8_t> MatcherGroup_BatchAcceptToken(
+    MatcherGroup& group, nb::ndarray<> slots, nb::ndarray<> token_ids, bool debug_print
+) {
+  return group.BatchAcceptToken(
+      *NDArray_GetDLTensor(slots), *NDArray_GetDLTensor(token_ids), debug_print
+  );
+}
+
+std::vector<uint8_t> MatcherGroup_BatchAcceptString(
+    MatcherGroup& group,
+    nb::ndarray<> slots,
+    const std::vector<std::variant<nb::bytes, std::string>>& input_strs,
+    bool debug_print
+) {
+  std::vector<std::string> input_strs_converted;
+  input_strs_converted.reserve(input_strs.size());
+  for (const auto& str : input_strs) {
+    if (std::holds_alternative<std::string>(str)) {
+      input_strs_converted.emplace_back(std::get<std::string>(str));
+    } else {
+      input_strs_converted.emplace_back(std::get<nb::bytes>(str).c_str());
+    }
+  }
+  return group.BatchAcceptString(*NDArray_GetDLTensor(slots), input_strs_converted, debug_print);
+}
+
 std::vector<nanobind::bytes> TokenizerInfo_GetDecodedVocab(const TokenizerInfo& tokenizer) {
   const auto& decoded_vocab = tokenizer.GetDecodedVocab();
   std::vector<nanobind::bytes> py_result;
@@ -216,6 +294,15 @@ NB_MODULE(xgrammar_bindings, m) {
       .def("serialize_json", &CompiledGrammar::SerializeJSON)
       .def_static("deserialize_json", &CompiledGrammar_DeserializeJSON);
 
+  auto pyPreparedGrammar = nb::class_<PreparedGrammar>(m, "PreparedGrammar");
+  pyPreparedGrammar
+      .def_static(
+          "from_grammar", &PreparedGrammar::FromGrammar, nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def_prop_ro("grammar", &PreparedGrammar::GetGrammar)
+      .def_prop_ro("num_token_mask_states", &PreparedGrammar::NumTokenMaskStates)
+      .def_prop_ro("memory_size_bytes", &PreparedGrammar::MemorySizeBytes);
+
   auto pyGrammarCompiler = nb::class_<GrammarCompiler>(m, "GrammarCompiler");
   pyGrammarCompiler.def(nb::init<const TokenizerInfo&, int, bool, int64_t>())
       .def(
@@ -255,9 +342,63 @@ NB_MODULE(xgrammar_bindings, m) {
           ) { return self.CompileGrammar(ebnf_str, root_rule_name); },
           nb::call_guard<nb::gil_scoped_release>()
       )
+      .def(
+          "compile_prepared_grammar",
+          [](GrammarCompiler& self, const PreparedGrammar& prepared_grammar) {
+            return self.CompileGrammar(prepared_grammar);
+          },
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def_static(
+          "compile_grammar_for_tokenizers",
+          &GrammarCompiler::CompileGrammarForTokenizers,
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def(
+          "estimate_cost",
+          &GrammarCompiler::EstimateCost,
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def("prewarm", &GrammarCompiler::Prewarm, nb::call_guard<nb::gil_scoped_release>())
+      .def(
+          "wait_for_prewarm",
+          &GrammarCompiler::WaitForPrewarm,
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def("export_cache_manifest", &GrammarCompiler::ExportCacheManifest)
+      .def("set_compile_server", &GrammarCompiler::SetCompileServer)
+      .def("set_shared_cache", &GrammarCompiler::SetSharedCache)
       .def("clear_cache", &GrammarCompiler::ClearCache)
       .def("get_cache_size_bytes", &GrammarCompiler::GetCacheSizeBytes)
       .def_prop_ro("cache_limit_bytes", &GrammarCompiler::CacheLimitBytes);
+  auto pyCompileCostEstimate = nb::class_<CompileCostEstimate>(m, "CompileCostEstimate");
+  pyCompileCostEstimate.def_ro("num_mask_states", &CompileCostEstimate::num_mask_states)
+      .def_ro("num_token_checks", &CompileCostEstimate::num_token_checks)
+      .def_ro("num_uncertain_tokens", &CompileCostEstimate::num_uncertain_tokens)
+      .def_ro("memory_bytes", &CompileCostEstimate::memory_bytes)
+      .def_ro("compile_time_ms", &CompileCostEstimate::compile_time_ms);
+  auto pyCompileBudget = nb::class_<CompileBudget>(m, "CompileBudget");
+  pyCompileBudget
+      .def(
+          nb::init<int64_t, int64_t, int64_t>(),
+          nb::arg("timeout_ms") = -1,
+          nb::arg("max_memory_bytes") = -1,
+          nb::arg("max_fsm_states") = -1
+      )
+      .def("cancel", &CompileBudget::Cancel)
+      .def("is_cancelled", &CompileBudget::IsCancelled)
+      .def_prop_ro("memory_bytes", &CompileBudget::GetMemoryBytes)
+      .def_prop_ro("fsm_states", &CompileBudget::GetFSMStates);
+  auto pyCompileBudgetScope = nb::class_<CompileBudgetScope>(m, "CompileBudgetScope");
+  pyCompileBudgetScope.def(nb::init<const CompileBudget&>());
+  auto pyCompileServer = nb::class_<CompileServer>(m, "CompileServer");
+  pyCompileServer.def(nb::init<const std::string&, int, int64_t>())
+      .def("serve", &CompileServer::Serve, nb::call_guard<nb::gil_scoped_release>())
+      .def("shutdown", &CompileServer::Shutdown);
+  auto pySharedGrammarCache = nb::class_<SharedGrammarCache>(m, "SharedGrammarCache");
+  pySharedGrammarCache.def(nb::init<const std::string&, int64_t>())
+      .def_prop_ro("memory_size_bytes", &SharedGrammarCache::MemorySizeBytes)
+      .def_static("remove", &SharedGrammarCache::Remove);
   auto pyBatchGrammarMatcher = nb::class_<BatchGrammarMatcher>(m, "BatchGrammarMatcher");
   pyBatchGrammarMatcher
       .def(nb::init<std::variant<std::string, int32_t>>(), nb::arg("max_threads") = "auto")
@@ -280,6 +421,58 @@ NB_MODULE(xgrammar_bindings, m) {
           "batch_accept_token",
           &BatchGrammarMatcher::BatchAcceptToken,
           nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def(
+          "batch_accept_tokens",
+          &BatchGrammarMatcher::BatchAcceptTokens,
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def(
+          "submit_accept_and_fill",
+          &GrammarMatcher_SubmitAcceptAndFill,
+          nb::arg("matchers"),
+          nb::arg("token_ids"),
+          nb::arg("batch_token_bitmask"),
+          nb::arg("indices").none(),
+          nb::arg("debug_print") = false,
+          nb::call_guard<nb::gil_scoped_release>()
+      );
+  auto pyBatchCompletionHandle = nb::class_<BatchCompletionHandle>(m, "BatchCompletionHandle");
+  pyBatchCompletionHandle
+      .def("wait", &BatchCompletionHandle::Wait, nb::call_guard<nb::gil_scoped_release>())
+      .def("is_ready", &BatchCompletionHandle::IsReady);
+  auto pyMatcherGroup = nb::class_<MatcherGroup>(m, "MatcherGroup");
+  pyMatcherGroup
+      .def(nb::init<std::variant<std::string, int32_t>>(), nb::arg("max_threads") = "auto")
+      .def("add_matcher", &MatcherGroup::AddMatcher)
+      .def("set_matcher", &MatcherGroup::SetMatcher)
+      .def("remove_matcher", &MatcherGroup::RemoveMatcher)
+      .def("get_matcher", &MatcherGroup::GetMatcher)
+      .def_prop_ro("num_matchers", &MatcherGroup::NumMatchers)
+      .def(
+          "batch_fill_next_token_bitmask",
+          &MatcherGroup_BatchFillNextTokenBitmask,
+          nb::arg("slots"),
+          nb::arg("batch_token_bitmask"),
+          nb::arg("indices").none(),
+          nb::arg("debug_print") = false,
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def(
+          "batch_accept_token",
+          &MatcherGroup_BatchAcceptToken,
+          nb::arg("slots"),
+          nb::arg("token_ids"),
+          nb::arg("debug_print") = false,
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def(
+          "batch_accept_string",
+          &MatcherGroup_BatchAcceptString,
+          nb::arg("slots"),
+          nb::arg("input_strs"),
+          nb::arg("debug_print") = false,
+          nb::call_guard<nb::gil_scoped_release>()
       );
   auto pyGrammarMatcher = nb::class_<GrammarMatcher>(m, "GrammarMatcher");
   pyGrammarMatcher
@@ -291,6 +484,9 @@ NB_MODULE(xgrammar_bindings, m) {
           nb::arg("max_rollback_tokens")
       )
       .def("accept_token", &GrammarMatcher::AcceptToken, nb::call_guard<nb::gil_scoped_release>())
+      .def(
+          "accept_tokens", &GrammarMatcher::AcceptTokens, nb::call_guard<nb::gil_scoped_release>()
+      )
       .def("accept_string", &GrammarMatcher::AcceptString, nb::call_guard<nb::gil_scoped_release>())
       .def(
           "accept_string",
@@ -314,6 +510,7 @@ NB_MODULE(xgrammar_bindings, m) {
       .def("reset", &GrammarMatcher::Reset, nb::call_guard<nb::gil_scoped_release>())
       .def_prop_ro("max_rollback_tokens", &GrammarMatcher::GetMaxRollbackTokens)
       .def_prop_ro("stop_token_ids", &GrammarMatcher::GetStopTokenIds)
+      .def_prop_ro("memory_size_bytes", &GrammarMatcher::MemorySizeBytes)
       .def("_debug_print_internal_state", &GrammarMatcher::_DebugPrintInternalState);
 
   auto pyTestingModule = m.def_submodule("testing");
@@ -370,6 +567,8 @@ NB_MODULE(xgrammar_bindings, m) {
           nb::arg("end").none()
       )
       .def("_print_grammar_fsms", &_PrintGrammarFSMs)
+      .def("_get_average_scanable_states_per_byte", &_GetAverageScanableStatesPerByte)
+      .def("_get_num_uncertain_tokens", &_GetNumUncertainTokens)
       .def(
           "_traverse_draft_tree",
           [](nb::ndarray<> retrieve_next_token,
@@ -409,6 +608,7 @@ NB_MODULE(xgrammar_bindings, m) {
       .def("rule_inliner", &RuleInliner::Apply)
       .def("dead_code_eliminator", &DeadCodeEliminator::Apply)
       .def("lookahead_assertion_analyzer", &LookaheadAssertionAnalyzer::Apply)
+      .def("ambiguity_reducer", &AmbiguityReducer::Apply)
       .def("grammar_optimizer", &GrammarOptimizer::Apply)
       .def("repetition_normalizer", &RepetitionNormalizer::Apply);
 
@@ -440,7 +640,16 @@ NB_MODULE(xgrammar_bindings, m) {
           "get_serialization_version",
           &GetSerializationVersion,
           nb::call_guard<nb::gil_scoped_release>()
-      );
+      )
+      .def("get_available_cpu_count", &GetAvailableCPUCount)
+      .def("set_worker_cpu_affinity", &SetWorkerCPUAffinity)
+      .def("get_worker_cpu_affinity", &GetWorkerCPUAffinity)
+      .def(
+          "set_executor_num_threads",
+          &SetExecutorNumThreads,
+          nb::call_guard<nb::gil_scoped_release>()
+      )
+      .def("get_executor_num_threads", &GetExecutorNumThreads);
 
   auto pyExceptionModule = m.def_submodule("exception");
   nb::exception<DeserializeFormatError>{
@@ -453,4 +662,23 @@ NB_MODULE(xgrammar_bindings, m) {
   nb::exception<InvalidStructuralTagError>{
       pyExceptionModule, "InvalidStructuralTagError", PyExc_RuntimeError
   };
+  auto pyCompileBudgetExceededError = nb::exception<CompileBudgetExceededError>{
+      pyExceptionModule, "CompileBudgetExceededError", PyExc_RuntimeError
+  };
+  // Attach the reason to the raised exception. This translator takes precedence over the default
+  // one registered above.
+  nb::register_exception_translator(
+      [](const std::exception_ptr& error_ptr, void* payload) {
+        try {
+          std::rethrow_exception(error_ptr);
+        } catch (const CompileBudgetExceededError& e) {
+          static const char* kReasons[] = {"cancelled", "deadline", "memory", "fsm_states"};
+          auto type = nb::handle(static_cast<PyObject*>(payload));
+          nb::object error = type(e.what());
+          nb::setattr(error, "reason", nb::str(kReasons[static_cast<int>(e.reason)]));
+          PyErr_SetObject(type.ptr(), error.ptr());
+        }
+      },
+      pyCompileBudgetExceededError.ptr()
+  );
 }
@@ -0,0 +1,279 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/shared_grammar_cache.cc
+ */
+
+#include "shared_grammar_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "support/logging.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#define XGRAMMAR_SHARED_CACHE_SUPPORTED 1
+#else
+#define XGRAMMAR_SHARED_CACHE_SUPPORTED 0
+#endif
+
+namespace xgrammar {
+
+// The atomics are accessed by several processes through different mappings of the region.
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+struct SharedGrammarCache::Impl::Header {
+  /*! \brief kMagic after the region is initialized by its creator. */
+  std::atomic<uint64_t> magic;
+  uint64_t num_slots;
+  uint64_t data_capacity;
+  /*! \brief The end of the reserved records, counted from the creation without wrapping. */
+  std::atomic<uint64_t> write_offset;
+};
+
+struct SharedGrammarCache::Impl::Slot {
+  /*! \brief Odd while the slot is being updated. */
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> key_hash;
+  /*! \brief The offset of the record, counted like Header::write_offset. */
+  std::atomic<uint64_t> offset;
+  /*! \brief The size of the record. 0 if the slot is empty. */
+  std::atomic<uint64_t> size;
+};
+
+namespace {
+
+constexpr uint64_t kMagic = 0x3165686361437258;  // "XrCache1"
+
+/*! \brief The header of a record, followed by the key and the value. */
+struct RecordHeader {
+  uint64_t key_size;
+  uint64_t value_size;
+};
+
+/*! \brief The bytes of the data ring for every slot of the index. */
+constexpr uint64_t kBytesPerSlot = 4096;
+constexpr uint64_t kMinNumSlots = 64;
+constexpr uint64_t kMaxNumSlots = uint64_t(1) << 20;
+
+uint64_t AlignUp(uint64_t value) { return (value + 7) & ~uint64_t(7); }
+
+uint64_t GetNumSlots(int64_t max_memory_bytes) {
+  return std::clamp(
+      static_cast<uint64_t>(max_memory_bytes) / kBytesPerSlot, kMinNumSlots, kMaxNumSlots
+  );
+}
+
+}  // namespace
+
+SharedGrammarCache::Impl::Impl(const std::string& name, int64_t max_memory_bytes) {
+#if XGRAMMAR_SHARED_CACHE_SUPPORTED
+  XGRAMMAR_CHECK(max_memory_bytes > 0) << "Invalid max_memory_bytes: " << max_memory_bytes;
+  bool is_creator = true;
+  int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST) {
+    is_creator = false;
+    fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+  }
+  XGRAMMAR_CHECK(fd >= 0) << "Failed to open the shared memory " << name << ": "
+                          << std::strerror(errno);
+
+  uint64_t num_slots = GetNumSlots(max_memory_bytes);
+  if (is_creator) {
+    region_size_ = std::max(
+        static_cast<std::size_t>(max_memory_bytes),
+        sizeof(Header) + num_slots * sizeof(Slot) + kBytesPerSlot
+    );
+    if (::ftruncate(fd, static_cast<off_t>(region_size_)) != 0) {
+      auto error = errno;
+      ::close(fd);
+      ::shm_unlink(name.c_str());
+      XGRAMMAR_LOG(FATAL) << "Failed to allocate the shared memory " << name << ": "
+                          << std::strerror(error);
+    }
+  } else {
+    // The creator may not have set the size yet.
+    struct stat status = {};
+    for (int i = 0; i < 1000; ++i) {
+      if (::fstat(fd, &status) == 0 && status.st_size > 0) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    region_size_ = static_cast<std::size_t>(status.st_size);
+    if (region_size_ < sizeof(Header)) {
+      ::close(fd);
+      XGRAMMAR_LOG(FATAL) << "The shared memory " << name << " is not a grammar cache";
+    }
+  }
+
+  region_ = ::mmap(nullptr, region_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  auto error = errno;
+  ::close(fd);
+  XGRAMMAR_CHECK(region_ != MAP_FAILED) << "Failed to map the shared memory " << name << ": "
+                                        << std::strerror(error);
+  header_ = static_cast<Header*>(region_);
+
+  if (is_creator) {
+    // ftruncate fills the region with zeros, which are the empty slots.
+    header_->num_slots = num_slots;
+    header_->data_capacity =
+        (region_size_ - sizeof(Header) - num_slots * sizeof(Slot)) & ~uint64_t(7);
+    header_->write_offset.store(0, std::memory_order_relaxed);
+    header_->magic.store(kMagic, std::memory_order_release);
+  } else {
+    for (int i = 0; i < 1000 && header_->magic.load(std::memory_order_acquire) != kMagic; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (header_->magic.load(std::memory_order_acquire) != kMagic ||
+        sizeof(Header) + header_->num_slots * sizeof(Slot) + header_->data_capacity >
+            region_size_) {
+      ::munmap(region_, region_size_);
+      region_ = nullptr;
+      XGRAMMAR_LOG(FATAL) << "The shared memory " << name << " is not a grammar cache";
+    }
+  }
+#else
+  XGRAMMAR_LOG(FATAL) << "The shared grammar cache is not supported on this platform";
+#endif
+}
+
+SharedGrammarCache::Impl::~Impl() {
+#if XGRAMMAR_SHARED_CACHE_SUPPORTED
+  if (region_ != nullptr) {
+    ::munmap(region_, region_size_);
+  }
+#endif
+}
+
+uint64_t SharedGrammarCache::Impl::HashKey(const std::string& key) {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325;
+  for (unsigned char c : key) {
+    hash = (hash ^ c) * 0x100000001b3;
+  }
+  return hash;
+}
+
+void SharedGrammarCache::Impl::Remove(const std::string& name) {
+#if XGRAMMAR_SHARED_CACHE_SUPPORTED
+  ::shm_unlink(name.c_str());
+#endif
+}
+
+SharedGrammarCache::Impl::Slot* SharedGrammarCache::Impl::GetSlot(uint64_t key_hash, int probe)
+    const {
+  auto slots = reinterpret_cast<Slot*>(static_cast<char*>(region_) + sizeof(Header));
+  return &slots[(key_hash + probe) % header_->num_slots];
+}
+
+char* SharedGrammarCache::Impl::GetData() const {
+  return static_cast<char*>(region_) + sizeof(Header) + header_->num_slots * sizeof(Slot);
+}
+
+std::optional<std::string> SharedGrammarCache::Impl::Get(const std::string& key) const {
+  auto key_hash = HashKey(key);
+  auto capacity = header_->data_capacity;
+  for (int probe = 0; probe < kNumProbes; ++probe) {
+    auto slot = GetSlot(key_hash, probe);
+    auto sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence % 2 == 1) continue;
+    auto slot_key_hash = slot->key_hash.load(std::memory_order_relaxed);
+    auto offset = slot->offset.load(std::memory_order_relaxed);
+    auto size = slot->size.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence) continue;
+    if (size == 0 || slot_key_hash != key_hash) continue;
+
+    // The record is overwritten once a reservation ends past its offset by the capacity.
+    auto is_valid = [&] {
+      return header_->write_offset.load(std::memory_order_acquire) <= offset + capacity;
+    };
+    if (!is_valid()) continue;
+    std::string record(size, '\0');
+    std::memcpy(record.data(), GetData() + offset % capacity, size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!is_valid()) continue;
+
+    RecordHeader record_header;
+    std::memcpy(&record_header, record.data(), sizeof(record_header));
+    auto payload_size = size - sizeof(record_header);
+    if (record_header.key_size > payload_size ||
+        record_header.value_size > payload_size - record_header.key_size ||
+        record.compare(sizeof(record_header), record_header.key_size, key) != 0) {
+      continue;
+    }
+    return record.substr(sizeof(record_header) + record_header.key_size, record_header.value_size);
+  }
+  return std::nullopt;
+}
+
+void SharedGrammarCache::Impl::Put(const std::string& key, const std::string& value) {
+  auto capacity = header_->data_capacity;
+  auto size = AlignUp(sizeof(RecordHeader) + key.size() + value.size());
+  if (size > capacity / 2) return;
+
+  // Reserve the space. A record does not wrap around the end of the ring, so the space before the
+  // end is skipped if it is too small.
+  auto begin = header_->write_offset.load(std::memory_order_relaxed);
+  uint64_t offset;
+  do {
+    auto position = begin % capacity;
+    offset = position + size > capacity ? begin + (capacity - position) : begin;
+  } while (!header_->write_offset.compare_exchange_weak(
+      begin, offset + size, std::memory_order_acq_rel, std::memory_order_relaxed
+  ));
+
+  auto data = GetData() + offset % capacity;
+  RecordHeader record_header{key.size(), value.size()};
+  std::memcpy(data, &record_header, sizeof(record_header));
+  std::memcpy(data + sizeof(record_header), key.data(), key.size());
+  std::memcpy(data + sizeof(record_header) + key.size(), value.data(), value.size());
+
+  // Index the record in the slot of the same key, or the empty slot, or the slot of the oldest
+  // record.
+  auto key_hash = HashKey(key);
+  Slot* target = nullptr;
+  for (int probe = 0; probe < kNumProbes; ++probe) {
+    auto slot = GetSlot(key_hash, probe);
+    if (slot->key_hash.load(std::memory_order_relaxed) == key_hash ||
+        slot->size.load(std::memory_order_relaxed) == 0) {
+      target = slot;
+      break;
+    }
+    if (target == nullptr || slot->offset.load(std::memory_order_relaxed) <
+                                 target->offset.load(std::memory_order_relaxed)) {
+      target = slot;
+    }
+  }
+
+  // The slot being updated by another process is skipped. The cache is best-effort.
+  auto sequence = target->sequence.load(std::memory_order_relaxed);
+  if (sequence % 2 == 1 ||
+      !target->sequence.compare_exchange_strong(
+          sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed
+      )) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  target->key_hash.store(key_hash, std::memory_order_relaxed);
+  target->offset.store(offset, std::memory_order_relaxed);
+  target->size.store(size, std::memory_order_relaxed);
+  target->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+/******************* SharedGrammarCache *******************/
+
+SharedGrammarCache::SharedGrammarCache(const std::string& name, int64_t max_memory_bytes)
+    : pimpl_(std::make_shared<Impl>(name, max_memory_bytes)) {}
+
+int64_t SharedGrammarCache::MemorySizeBytes() const { return pimpl_->MemorySizeBytes(); }
+
+void SharedGrammarCache::Remove(const std::string& name) { Impl::Remove(name); }
+
+}  // namespace xgrammar
@@ -0,0 +1,80 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/shared_grammar_cache.h
+ * \brief The cache of serialized compiled grammars in shared memory, shared by the processes of a
+ * host.
+ */
+
+#ifndef XGRAMMAR_SHARED_GRAMMAR_CACHE_H_
+#define XGRAMMAR_SHARED_GRAMMAR_CACHE_H_
+
+#include <xgrammar/compiler.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace xgrammar {
+
+/*!
+ * \brief The shared memory region of a SharedGrammarCache. It consists of the header, the index
+ * and the data ring.
+ *
+ * The records are appended to the data ring, and a new record overwrites the oldest ones. A
+ * record holds the key and the value, so readers verify the key instead of trusting its hash. A
+ * record is valid while the write offset has not advanced past its offset by the capacity. The
+ * readers copy the record and check it is still valid afterwards, since the writers reserve the
+ * space by advancing the write offset before writing to it.
+ *
+ * The index is a hash table of slots pointing to the records, probed linearly for a few slots.
+ * Every slot is a seqlock: the writer makes the sequence odd while updating the slot, and the
+ * readers retry on other slots if the sequence is odd or changes. No process waits for another,
+ * so a crashed process cannot block the others.
+ */
+class SharedGrammarCache::Impl {
+ public:
+  /*!
+   * \brief Open the region of the name, or create it with the capacity if it does not exist. The
+   * size of an existing region is kept.
+   */
+  Impl(const std::string& name, int64_t max_memory_bytes);
+  ~Impl();
+
+  Impl(const Impl&) = delete;
+  Impl& operator=(const Impl&) = delete;
+
+  /*! \brief Get the value of the key. std::nullopt if it is not found or overwritten. */
+  std::optional<std::string> Get(const std::string& key) const;
+
+  /*! \brief Put the value of the key. The values larger than half of the ring are skipped. */
+  void Put(const std::string& key, const std::string& value);
+
+  /*! \brief The size of the shared memory region in bytes. */
+  int64_t MemorySizeBytes() const { return static_cast<int64_t>(region_size_); }
+
+  /*! \brief The hash of the keys. Unlike std::hash, it is the same in all processes. */
+  static uint64_t HashKey(const std::string& key);
+
+  /*! \brief Remove the region of the name. The processes using it keep their mapping. */
+  static void Remove(const std::string& name);
+
+  struct Header;
+  struct Slot;
+
+ private:
+  /*! \brief The number of slots probed for a key. */
+  static constexpr int kNumProbes = 4;
+
+  Slot* GetSlot(uint64_t key_hash, int probe) const;
+  char* GetData() const;
+
+  void* region_ = nullptr;
+  std::size_t region_size_ = 0;
+  Header* header_ = nullptr;
+};
+
+}  // namespace xgrammar
+
+#endif  // XGRAMMAR_SHARED_GRAMMAR_CACHE_H_
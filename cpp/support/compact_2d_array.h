@@ -7,6 +7,7 @@
 
 #include <picojson.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <vector>
@@ -201,11 +202,13 @@ inline typename Compact2DArray<DataType>::Row Compact2DArray<DataType>::operator
 template <typename DataType>
 inline int32_t Compact2DArray<DataType>::PushBack(const DataType* new_data, int32_t new_data_len) {
   // TODO(yixin): whether to add a additional data_len
-  // If the new data is already in the Compact2DArray, we need to copy it to the new memory
-  // location.
+  // If the new data is already in the Compact2DArray, it is copied by its offset, since the
+  // pointer is invalidated when the memory grows.
   if (new_data >= data_.data() && new_data < data_.data() + data_.size()) {
-    std::vector<DataType> new_data_copied(new_data, new_data + new_data_len);
-    data_.insert(data_.end(), new_data_copied.begin(), new_data_copied.end());
+    auto offset = new_data - data_.data();
+    auto old_size = data_.size();
+    data_.resize(old_size + new_data_len);
+    std::copy_n(data_.begin() + offset, new_data_len, data_.begin() + old_size);
   } else {
     data_.insert(data_.end(), new_data, new_data + new_data_len);
   }
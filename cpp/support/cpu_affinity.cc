@@ -0,0 +1,118 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/support/cpu_affinity.cc
+ */
+
+#include "cpu_affinity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "logging.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace xgrammar {
+
+namespace {
+
+std::mutex worker_cpu_ids_mutex;
+std::vector<int32_t> worker_cpu_ids;
+
+#if defined(__linux__)
+/*!
+ * \brief Get the CPU quota of the cgroup of the process in number of CPUs, or -1 if there is no
+ * quota. Both cgroup v2 (cpu.max) and v1 (cpu.cfs_quota_us) are checked at the root of the cgroup
+ * mount, which is the cgroup of the container when running in one.
+ */
+double GetCgroupCPUQuota() {
+  std::ifstream cpu_max("/sys/fs/cgroup/cpu.max");
+  if (cpu_max) {
+    std::string quota;
+    double period = 0;
+    if (cpu_max >> quota >> period && quota != "max" && period > 0) {
+      return std::stod(quota) / period;
+    }
+    return -1;
+  }
+  std::ifstream cfs_quota("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+  std::ifstream cfs_period("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+  double quota = -1, period = 0;
+  if (cfs_quota >> quota && cfs_period >> period && quota > 0 && period > 0) {
+    return quota / period;
+  }
+  return -1;
+}
+#endif  // defined(__linux__)
+
+}  // namespace
+
+int32_t GetAvailableCPUCount() {
+  {
+    std::lock_guard<std::mutex> lock(worker_cpu_ids_mutex);
+    if (!worker_cpu_ids.empty()) {
+      return static_cast<int32_t>(worker_cpu_ids.size());
+    }
+  }
+  int32_t num_cpus = static_cast<int32_t>(std::thread::hardware_concurrency());
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+    num_cpus = CPU_COUNT(&cpu_set);
+  }
+  double quota = GetCgroupCPUQuota();
+  if (quota > 0) {
+    num_cpus = std::min(num_cpus, static_cast<int32_t>(std::ceil(quota)));
+  }
+#endif  // defined(__linux__)
+  return std::max(num_cpus, 1);
+}
+
+void SetWorkerCPUAffinity(const std::vector<int32_t>& cpu_ids) {
+  for (auto cpu_id : cpu_ids) {
+    XGRAMMAR_CHECK(cpu_id >= 0) << "The CPU id should be non-negative, but got " << cpu_id;
+  }
+  std::lock_guard<std::mutex> lock(worker_cpu_ids_mutex);
+  worker_cpu_ids = cpu_ids;
+}
+
+std::vector<int32_t> GetWorkerCPUAffinity() {
+  std::lock_guard<std::mutex> lock(worker_cpu_ids_mutex);
+  return worker_cpu_ids;
+}
+
+void PinWorkerThread(int32_t worker_index) {
+  int32_t cpu_id;
+  {
+    std::lock_guard<std::mutex> lock(worker_cpu_ids_mutex);
+    if (worker_cpu_ids.empty()) {
+      return;
+    }
+    cpu_id = worker_cpu_ids[worker_index % worker_cpu_ids.size()];
+  }
+#if defined(__linux__)
+  if (cpu_id >= CPU_SETSIZE) {
+    XGRAMMAR_LOG(WARNING) << "The CPU id " << cpu_id << " is out of range. The worker thread is "
+                          << "not pinned.";
+    return;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu_id, &cpu_set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+    XGRAMMAR_LOG(WARNING) << "Failed to pin the worker thread to CPU " << cpu_id << ".";
+  }
+#else
+  (void)cpu_id;
+#endif  // defined(__linux__)
+}
+
+}  // namespace xgrammar
@@ -0,0 +1,27 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/support/cpu_affinity.h
+ * \brief The CPU placement of the worker threads. The worker CPU list and the available CPU count
+ * are declared in xgrammar/config.h.
+ */
+
+#ifndef XGRAMMAR_SUPPORT_CPU_AFFINITY_H_
+#define XGRAMMAR_SUPPORT_CPU_AFFINITY_H_
+
+#include <xgrammar/config.h>
+
+#include <cstdint>
+
+namespace xgrammar {
+
+/*!
+ * \brief Pin the calling thread to the CPU of the worker_index-th worker. The memory the worker
+ * touches first, including its stack and scratch buffers, is then placed on the NUMA node of that
+ * CPU by the first-touch policy of the OS. No-op if no worker CPU list is set or the platform does
+ * not support thread affinity.
+ */
+void PinWorkerThread(int32_t worker_index);
+
+}  // namespace xgrammar
+
+#endif  // XGRAMMAR_SUPPORT_CPU_AFFINITY_H_
@@ -97,7 +97,7 @@ class DynamicBitset {
     size_ = other.size_;
     buffer_size_ = other.buffer_size_;
     if (is_internal_) {
-      internal_buffer_.reserve(buffer_size_);
+      internal_buffer_.resize(buffer_size_);
       data_ = internal_buffer_.data();
     }
     if (data_ != other.data_) {
@@ -154,6 +154,23 @@ class DynamicBitset {
   /*! \brief Set the bit at the given index to false. */
   void Reset(int index) { Set(index, false); }
 
+  /*! \brief Flip all the bits of the bitset. */
+  void Flip() {
+    XGRAMMAR_DCHECK(data_);
+    for (int i = 0; i < buffer_size_; ++i) {
+      data_[i] = ~data_[i];
+    }
+  }
+
+  /*! \brief Perform a bitwise AND operation between the current bitset and another bitset. */
+  DynamicBitset& operator&=(const DynamicBitset& other) {
+    XGRAMMAR_DCHECK(buffer_size_ <= other.buffer_size_);
+    for (int i = 0; i < buffer_size_; ++i) {
+      data_[i] &= other.data_[i];
+    }
+    return *this;
+  }
+
   /*! \brief Perform a bitwise OR operation between the current bitset and another bitset. */
   DynamicBitset& operator|=(const DynamicBitset& other) {
     XGRAMMAR_DCHECK(buffer_size_ <= other.buffer_size_);
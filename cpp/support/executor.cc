@@ -0,0 +1,213 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/support/executor.cc
+ */
+
+#include "executor.h"
+
+#include <utility>
+
+#include "cpu_affinity.h"
+#include "logging.h"
+
+namespace xgrammar {
+
+/******************* Executor *******************/
+
+Executor& Executor::Global() {
+  // Never destroyed, so the tasks running at the process exit do not see a destroyed executor.
+  static Executor* executor = new Executor();
+  return *executor;
+}
+
+Executor::Executor() : num_threads_(GetAvailableCPUCount()) {}
+
+void Executor::Execute(TaskPriority priority, std::function<void()> task) {
+  if (!is_started_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> workers_lock(workers_mutex_);
+    if (!is_started_.load(std::memory_order_relaxed)) {
+      StartWorkers();
+      is_started_.store(true, std::memory_order_release);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queues_[static_cast<int32_t>(priority)].push_back(std::move(task));
+  }
+  queue_condition_.notify_one();
+}
+
+void Executor::SetNumThreads(int32_t num_threads) {
+  XGRAMMAR_CHECK(num_threads >= 1) << "The number of executor threads should be at least 1, but "
+                                   << "got " << num_threads;
+  std::lock_guard<std::mutex> workers_lock(workers_mutex_);
+  bool is_started = is_started_.load(std::memory_order_relaxed);
+  if (is_started) {
+    StopWorkers();
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    num_threads_ = num_threads;
+  }
+  if (is_started) {
+    StartWorkers();
+  }
+}
+
+int32_t Executor::GetNumThreads() const {
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return num_threads_;
+}
+
+void Executor::StartWorkers() {
+  for (int32_t i = 0; i < num_threads_; ++i) {
+    workers_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+void Executor::StopWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_ = true;
+  }
+  queue_condition_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  stop_ = false;
+}
+
+void Executor::WorkerLoop(int32_t worker_index) {
+  PinWorkerThread(worker_index);
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_condition_.wait(lock, [this] {
+        if (stop_) return true;
+        for (const auto& queue : queues_) {
+          if (!queue.empty()) return true;
+        }
+        return false;
+      });
+      if (stop_) return;
+      for (auto& queue : queues_) {
+        if (!queue.empty()) {
+          task = std::move(queue.front());
+          queue.pop_front();
+          break;
+        }
+      }
+    }
+    task();
+  }
+}
+
+/******************* TaskGroup *******************/
+
+void TaskGroup::Execute(std::function<void()> task) {
+  if (max_parallelism_ <= 1) {
+    RunTask(state_.get(), task);
+    return;
+  }
+  bool add_runner = false;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->tasks.push_back(std::move(task));
+    if (state_->num_queued_runners + state_->num_running_runners < max_parallelism_) {
+      ++state_->num_queued_runners;
+      add_runner = true;
+    }
+  }
+  if (add_runner) {
+    QueueRunner(priority_, state_);
+  }
+}
+
+void TaskGroup::QueueRunner(TaskPriority priority, std::shared_ptr<State> state) {
+  Executor::Global().Execute(priority, [priority, state = std::move(state)] {
+    RunNext(priority, state);
+  });
+}
+
+void TaskGroup::RunNext(TaskPriority priority, const std::shared_ptr<State>& state) {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  // The runners are interchangeable, so a runner taken over by Wait() may still take the place
+  // of a runner queued later. Otherwise it has nothing to do.
+  if (state->num_queued_runners == 0) return;
+  --state->num_queued_runners;
+  if (state->tasks.empty()) {
+    state->done_condition.notify_all();
+    return;
+  }
+  auto task = std::move(state->tasks.front());
+  state->tasks.pop_front();
+  ++state->num_running_runners;
+  lock.unlock();
+  RunTask(state.get(), task);
+  lock.lock();
+  --state->num_running_runners;
+  bool requeue = !state->tasks.empty();
+  if (requeue) {
+    ++state->num_queued_runners;
+  }
+  state->done_condition.notify_all();
+  lock.unlock();
+  if (requeue) {
+    QueueRunner(priority, state);
+  }
+}
+
+void TaskGroup::RunTask(State* state, const std::function<void()>& task) {
+  try {
+    task();
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->error == nullptr) {
+      state->error = std::current_exception();
+    }
+  }
+}
+
+void TaskGroup::WaitAll() {
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  while (true) {
+    if (!state_->tasks.empty()) {
+      auto task = std::move(state_->tasks.front());
+      state_->tasks.pop_front();
+      lock.unlock();
+      RunTask(state_.get(), task);
+      lock.lock();
+      continue;
+    }
+    // The queued runners have no task left. They are taken over instead of waited for, since they
+    // may never start if all the workers are waiting, e.g. in nested groups.
+    state_->num_queued_runners = 0;
+    if (state_->num_running_runners == 0) return;
+    state_->done_condition.wait(lock);
+  }
+}
+
+void TaskGroup::Wait() {
+  WaitAll();
+  std::exception_ptr error;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    std::swap(error, state_->error);
+  }
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+/******************* Global configuration *******************/
+
+void SetExecutorNumThreads(int32_t num_threads) {
+  Executor::Global().SetNumThreads(num_threads);
+}
+
+int32_t GetExecutorNumThreads() { return Executor::Global().GetNumThreads(); }
+
+}  // namespace xgrammar
@@ -0,0 +1,149 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/support/executor.h
+ * \brief The process-level executor shared by the compiler and the batch matchers.
+ */
+
+#ifndef XGRAMMAR_SUPPORT_EXECUTOR_H_
+#define XGRAMMAR_SUPPORT_EXECUTOR_H_
+
+#include <xgrammar/config.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xgrammar {
+
+/*! \brief The priority classes of the tasks of the executor. */
+enum class TaskPriority : int32_t {
+  /*! \brief Latency-critical tasks of the decoding steps, e.g. filling the bitmasks. */
+  kDecode = 0,
+  /*! \brief Background tasks, e.g. computing the token mask cache in compiling. */
+  kCompile = 1,
+  /*! \brief Speculative tasks that run only when the workers are idle, e.g. pre-warming caches. */
+  kPrewarm = 2,
+};
+
+/*!
+ * \brief The executor of the worker threads shared by the whole process, so the compiler and the
+ * batch matchers together use at most GetExecutorNumThreads() cores. A worker always takes the
+ * queued task of the highest priority, so decoding tasks run before the queued compiling tasks.
+ * Running tasks are not interrupted. Tasks are usually submitted through TaskGroup.
+ */
+class Executor {
+ public:
+  /*! \brief Get the executor of the process. The workers are started on the first task. */
+  static Executor& Global();
+
+  /*! \brief Submit a task. */
+  void Execute(TaskPriority priority, std::function<void()> task);
+
+  /*!
+   * \brief Set the number of worker threads. The running tasks finish first, and the queued tasks
+   * are kept for the new workers.
+   */
+  void SetNumThreads(int32_t num_threads);
+
+  int32_t GetNumThreads() const;
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+ private:
+  Executor();
+
+  /*! \brief Start the workers. Requires workers_mutex_. */
+  void StartWorkers();
+
+  /*! \brief Stop the workers after their running tasks. Requires workers_mutex_. */
+  void StopWorkers();
+
+  void WorkerLoop(int32_t worker_index);
+
+  static constexpr int kNumPriorities = 3;
+
+  /*! \brief Serializes the start and the stop of the workers. */
+  std::mutex workers_mutex_;
+  std::atomic<bool> is_started_{false};
+  /*! \brief Protects the queues and the flags below. */
+  mutable std::mutex queue_mutex_;
+  std::condition_variable queue_condition_;
+  std::deque<std::function<void()>> queues_[kNumPriorities];
+  std::vector<std::thread> workers_;
+  int32_t num_threads_;
+  bool stop_ = false;
+};
+
+/*!
+ * \brief A group of tasks of the same priority submitted to the global executor, which can be
+ * waited on together. At most max_parallelism tasks of the group run on the executor at the same
+ * time. Each task returns to the executor queue after it finishes, so tasks of higher priority
+ * can take over the workers at the task boundaries.
+ *
+ * \note The thread calling Wait() runs the queued tasks of the group itself, and then takes over
+ * the runners of the group still queued on the executor, so it only waits for the tasks already
+ * running. Waiting from a worker thread does not deadlock even if all the workers are waiting.
+ */
+class TaskGroup {
+ public:
+  TaskGroup(TaskPriority priority, int32_t max_parallelism)
+      : priority_(priority), max_parallelism_(max_parallelism), state_(std::make_shared<State>()) {}
+
+  ~TaskGroup() { WaitAll(); }
+
+  /*! \brief Add a task to the group. */
+  void Execute(std::function<void()> task);
+
+  /*! \brief Wait for all tasks of the group. The first exception of the tasks is rethrown. */
+  void Wait();
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+ private:
+  /*!
+   * \brief The state of the group shared with its runners on the executor, since a runner taken
+   * over by Wait() may still start after the group is destroyed.
+   */
+  struct State {
+    std::mutex mutex;
+    std::condition_variable done_condition;
+    std::deque<std::function<void()>> tasks;
+    /*! \brief The number of runners queued on the executor and not taken over by Wait(). */
+    int32_t num_queued_runners = 0;
+    /*! \brief The number of runners running a task. */
+    int32_t num_running_runners = 0;
+    std::exception_ptr error;
+  };
+
+  /*! \brief Queue a runner of the group on the executor. */
+  static void QueueRunner(TaskPriority priority, std::shared_ptr<State> state);
+
+  /*!
+   * \brief Run the next queued task on the executor, and return to the executor queue. It does
+   * nothing if Wait() took over the queued runners.
+   */
+  static void RunNext(TaskPriority priority, const std::shared_ptr<State>& state);
+
+  /*! \brief Run a task and record its exception. */
+  static void RunTask(State* state, const std::function<void()>& task);
+
+  /*! \brief Wait for all tasks without throwing. */
+  void WaitAll();
+
+  TaskPriority priority_;
+  int32_t max_parallelism_;
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace xgrammar
+
+#endif  // XGRAMMAR_SUPPORT_EXECUTOR_H_
@@ -23,6 +23,15 @@
 #define XGRAMMAR_LOG_CUSTOMIZE 0
 #endif
 
+/*!
+ * \brief Whether or not the debug_print flags of the parser and the matcher print anything.
+ *  If disabled, the debug printing is compiled out of their hot loops entirely, and the flags
+ *  are ignored.
+ */
+#ifndef XGRAMMAR_ENABLE_DEBUG_PRINT
+#define XGRAMMAR_ENABLE_DEBUG_PRINT 1
+#endif
+
 namespace xgrammar {
 
 // Provide support for customized logging.
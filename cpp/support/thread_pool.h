@@ -15,6 +15,7 @@
 #include <type_traits>
 #include <vector>
 
+#include "cpu_affinity.h"
 #include "logging.h"
 
 namespace xgrammar {
@@ -36,7 +37,8 @@ class ThreadPool {
   ThreadPool(size_t num_threads = std::thread::hardware_concurrency()) {
     // Initialize thread pool with num_threads threads
     for (size_t i = 0; i < num_threads; ++i) {
-      workers_.emplace_back([this] {
+      workers_.emplace_back([this, i] {
+        PinWorkerThread(static_cast<int32_t>(i));
         while (true) {
           std::function<void()> task;
           {
@@ -6,6 +6,7 @@
 #ifndef XGRAMMAR_SUPPORT_THREAD_SAFE_CACHE_H_
 #define XGRAMMAR_SUPPORT_THREAD_SAFE_CACHE_H_
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>  // IWYU pragma: keep
 #include <cstddef>
@@ -14,8 +15,10 @@
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "container.h"
 
@@ -237,6 +240,45 @@ class LRUCacheImpl {
     } while (predicate() && iter != lru_list_.end());
   }
 
+  /*!
+   * \brief Visits the nodes from the least recently used one until the predicate returns false,
+   * without changing their order.
+   * \param predicate The function that returns true if the visit should continue.
+   * \param visit The function takes a value and can update it in place.
+   */
+  template <typename Predicate, typename Visit>
+  void LRUForEach(const Predicate& predicate, const Visit& visit) {
+    for (auto iter = lru_list_.begin(); iter != lru_list_.end() && predicate(); ++iter) {
+      visit((*iter)->second.value);
+    }
+  }
+
+  /*!
+   * \brief Visits the keys and values of the nodes from the least recently used one, without
+   * changing their order.
+   */
+  template <typename Visit>
+  void LRUForEachKey(const Visit& visit) {
+    for (auto iter = lru_list_.begin(); iter != lru_list_.end(); ++iter) {
+      visit((*iter)->first, (*iter)->second.value);
+    }
+  }
+
+  /*!
+   * \brief Erases the node of the key if the predicate returns true for its value.
+   * \param key The key of the node.
+   * \param predicate The function takes a value and returns true if the value should be erased.
+   */
+  template <typename Predicate>
+  void LRUErase(const Key& key, const Predicate& predicate) {
+    auto it = map_.find(key);
+    if (it == map_.end() || !predicate(it->second.value)) return;
+    lru_list_.Erase(typename List<std::pair<const Key, Entry>*>::iterator(
+        it->second.index, lru_list_
+    ));
+    map_.erase(it);
+  }
+
   std::unordered_map<Key, Entry>& GetMap() { return map_; }
 
  private:
@@ -246,21 +288,53 @@ class LRUCacheImpl {
 
 }  // namespace details
 
+/*!
+ * \brief The default compactor of ThreadSafeLRUCache, which never compacts the values.
+ * \details A compactor converts a value to a compact form that takes less memory and is slower to
+ * use, and restores it back. It provides:
+ * - std::optional<Value> Compact(const Value&): the compact form, or std::nullopt if the value
+ *   cannot be compacted.
+ * - bool IsCompacted(const Value&): whether the value is in the compact form.
+ * - Value Restore(const Value&): the value restored from the compact form.
+ */
+struct NoCompactor {
+  template <typename Value>
+  std::optional<Value> Compact(const Value&) const {
+    return std::nullopt;
+  }
+  template <typename Value>
+  bool IsCompacted(const Value&) const {
+    return false;
+  }
+  template <typename Value>
+  Value Restore(const Value& value) const {
+    return value;
+  }
+};
+
 /**
  * \brief A thread-safe key-value cache with on-demand computation and LRU eviction
  * \tparam Key The type of keys used to lookup values. Should be hashable.
  * \tparam Value The type of values stored in the cache
  * \tparam Computer The functor that computes values for uncached keys
  * \tparam SizeEstimator The functor that estimates the size of a value in bytes
+ * \tparam Compactor The functor that compacts and restores values. See NoCompactor.
  * \details This cache provides thread-safe access to computed values with the following features:
  * - Lazy computation: Values are only computed when first requested
- * - LRU eviction: When the cache is full, the least recently used value is evicted
+ * - LRU compaction: When the cache is full, the least recently used values are first converted to
+ *   their compact form, and restored when they are requested again
+ * - LRU eviction: When the cache is still full, the least recently used value is evicted
  * - Thread safety: Uses reader-writer locks for concurrent reads
  * \attention User should guarantee the following:
  * 1. The policy class should provide a compute method that takes a key and returns a value.
  * 2. The value type should have a MemorySize method that returns the size of the value in bytes.
  */
-template <typename Key, typename Value, typename Computer, typename SizeEstimator>
+template <
+    typename Key,
+    typename Value,
+    typename Computer,
+    typename SizeEstimator,
+    typename Compactor = NoCompactor>
 class ThreadSafeLRUCache {
  private:
   struct SizedValue {
@@ -274,18 +348,77 @@ class ThreadSafeLRUCache {
   explicit ThreadSafeLRUCache(
       std::size_t max_size = kUnlimitedSize,
       const Computer& computer = Computer{},
-      const SizeEstimator& size_estimator = SizeEstimator{}
+      const SizeEstimator& size_estimator = SizeEstimator{},
+      const Compactor& compactor = Compactor{}
   )
-      : max_size_(max_size), computer_(computer), size_estimator_(size_estimator), cache_() {}
+      : max_size_(max_size),
+        computer_(computer),
+        size_estimator_(size_estimator),
+        compactor_(compactor),
+        cache_() {}
 
   std::size_t MaxMemorySize() const { return max_size_; }
   std::size_t MemorySize() const { return current_size_; }
 
   Value Get(const Key& key) {
     auto future = GetFuture(key);
+    if constexpr (!std::is_same_v<Compactor, NoCompactor>) {
+      if (compactor_.IsCompacted(future.get().value)) return Restore(key, future.get().value);
+    }
     return future.get().value;
   }
 
+  /*!
+   * \brief Get the keys of the computed values, from the most recently used one. The keys being
+   * computed or failed are skipped. The order is arbitrary if the cache is unlimited, since no LRU
+   * order is kept then.
+   */
+  std::vector<Key> GetKeys() {
+    auto is_computed = [](const std::shared_future<SizedValue>& value) {
+      using namespace std::chrono_literals;
+      return value.wait_for(0s) == std::future_status::ready && !IsFailed(value);
+    };
+    std::vector<Key> keys;
+    const auto lock_map = std::shared_lock{map_mutex_};
+    if (this->max_size_ == kUnlimitedSize) {
+      for (const auto& [key, entry] : cache_.GetMap()) {
+        if (is_computed(entry.value)) keys.push_back(key);
+      }
+      return keys;
+    }
+    const auto lock_lru = std::lock_guard{lru_mutex_};
+    cache_.LRUForEachKey([&](const Key& key, const std::shared_future<SizedValue>& value) {
+      if (is_computed(value)) keys.push_back(key);
+    });
+    std::reverse(keys.begin(), keys.end());
+    return keys;
+  }
+
+  /*!
+   * \brief Recompute the sizes of the computed values satisfying the predicate, i.e. the values
+   * whose sizes can change after they are cached. If any size changes, compact or evict the values
+   * until the cache is not full.
+   */
+  template <typename Predicate>
+  void UpdateMemorySize(const Predicate& predicate) {
+    using namespace std::chrono_literals;
+    const auto lock_map = std::lock_guard{map_mutex_};
+    bool size_changed = false;
+    for (auto& [key, entry] : cache_.GetMap()) {
+      auto& value = entry.value;
+      if (value.wait_for(0s) != std::future_status::ready || IsFailed(value)) continue;
+      const auto& sized_value = value.get();
+      if (!predicate(sized_value.value)) continue;
+      auto size = size_estimator_(sized_value.value);
+      if (size == sized_value.size) continue;
+      current_size_ -= sized_value.size;
+      current_size_ += size;
+      value = MakeReadyFuture(SizedValue{sized_value.value, size});
+      size_changed = true;
+    }
+    if (size_changed) ReduceMemorySize();
+  }
+
   void Clear() {
     // Remove all the ready entries.
     const auto lock_map = std::lock_guard{map_mutex_};
@@ -337,26 +470,17 @@ class ThreadSafeLRUCache {
     // in this case, we insert the task, and we need to compute the value
     auto future = task.get_future().share();
 
-    // perform eviction if the cache is full
+    // perform compaction and eviction if the cache is full
     cache_.LRUInit(*it, future);
-    cache_.LRUEvict(
-        [&] { return current_size_ > max_size_; },
-        [&](const std::shared_future<SizedValue>& value) {
-          using namespace std::chrono_literals;
-          // if not ready, then do not wait and block here
-          if (value.wait_for(0s) != std::future_status::ready) return false;
-          try {
-            current_size_ -= value.get().size;
-          } catch (...) {
-            // fine, just ignore the exception, size is not updated
-          }
-          return true;
-        }
-    );
+    ReduceMemorySize();
 
     // perform the costly computation outside all locks
     lock_map.unlock();
     task();
+    if (IsFailed(future)) {
+      const auto lock_erase = std::lock_guard{map_mutex_};
+      cache_.LRUErase(key, IsFailed);
+    }
     return future;
   }
 
@@ -386,13 +510,104 @@ class ThreadSafeLRUCache {
     // perform the costly computation outside all locks
     lock_map.unlock();
     task();
+    if (IsFailed(future)) {
+      const auto lock_erase = std::lock_guard{map_mutex_};
+      auto it = map.find(key);
+      if (it != map.end() && IsFailed(it->second.value)) map.erase(it);
+    }
     return future;
   }
 
+  /*!
+   * \brief Compact and then evict the least recently used entries until the cache is not full.
+   * The entries waiting for computation are skipped. The unique lock of map_mutex_ should be held.
+   */
+  void ReduceMemorySize() {
+    using namespace std::chrono_literals;
+    if constexpr (!std::is_same_v<Compactor, NoCompactor>) {
+      cache_.LRUForEach(
+          [&] { return current_size_ > max_size_; },
+          [&](std::shared_future<SizedValue>& value) {
+            if (value.wait_for(0s) != std::future_status::ready || IsFailed(value)) return;
+            const auto& sized_value = value.get();
+            if (compactor_.IsCompacted(sized_value.value)) return;
+            auto compacted = compactor_.Compact(sized_value.value);
+            if (!compacted.has_value()) return;
+            auto compacted_size = size_estimator_(compacted.value());
+            current_size_ -= sized_value.size;
+            current_size_ += compacted_size;
+            value = MakeReadyFuture(SizedValue{std::move(compacted.value()), compacted_size});
+          }
+      );
+    }
+    cache_.LRUEvict(
+        [&] { return current_size_ > max_size_; },
+        [&](const std::shared_future<SizedValue>& value) {
+          // if not ready, then do not wait and block here
+          if (value.wait_for(0s) != std::future_status::ready) return false;
+          try {
+            current_size_ -= value.get().size;
+          } catch (...) {
+            // fine, just ignore the exception, size is not updated
+          }
+          return true;
+        }
+    );
+  }
+
+  /*!
+   * \brief Restore the compacted value of the key. The cached entry is replaced with the restored
+   * value, unless another thread has already restored or evicted it.
+   */
+  Value Restore(const Key& key, const Value& compacted) {
+    // perform the costly restoration outside all locks
+    auto restored = compactor_.Restore(compacted);
+    auto restored_size = size_estimator_(restored);
+
+    const auto lock_map = std::lock_guard{map_mutex_};
+    auto& map = cache_.GetMap();
+    auto it = map.find(key);
+    if (it == map.end() || IsFailed(it->second.value)) return restored;
+    auto& value = it->second.value;
+    using namespace std::chrono_literals;
+    if (value.wait_for(0s) != std::future_status::ready ||
+        !compactor_.IsCompacted(value.get().value)) {
+      return restored;
+    }
+    current_size_ -= value.get().size;
+    current_size_ += restored_size;
+    value = MakeReadyFuture(SizedValue{restored, restored_size});
+    ReduceMemorySize();
+    return restored;
+  }
+
+  static std::shared_future<SizedValue> MakeReadyFuture(SizedValue value) {
+    auto promise = std::promise<SizedValue>{};
+    promise.set_value(std::move(value));
+    return promise.get_future().share();
+  }
+
+  /*!
+   * \brief Whether the computation of the value failed with an exception, e.g. the compilation is
+   * cancelled or exceeds its budget. The failed entries are erased from the cache after the
+   * computation: the waiters still get the exception, while the later calls recompute the value.
+   */
+  static bool IsFailed(const std::shared_future<SizedValue>& value) {
+    using namespace std::chrono_literals;
+    if (value.wait_for(0s) != std::future_status::ready) return false;
+    try {
+      value.get();
+    } catch (...) {
+      return true;
+    }
+    return false;
+  }
+
  private:
   const std::size_t max_size_;
   const Computer computer_;
   const SizeEstimator size_estimator_;
+  const Compactor compactor_;
   details::LRUCacheImpl<Key, std::shared_future<SizedValue>> cache_;
   std::atomic_size_t current_size_{0};
   std::shared_mutex map_mutex_;
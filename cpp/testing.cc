@@ -11,6 +11,9 @@
 #include <string>
 #include <vector>
 
+#include "compiled_grammar_impl.h"
+#include "earley_parser.h"
+#include "grammar_functor.h"
 #include "grammar_impl.h"
 #include "grammar_parser.h"
 #include "support/encoding.h"
@@ -57,6 +60,32 @@ std::string _PrintGrammarFSMs(const Grammar& grammar) {
   return result;
 }
 
+double _GetAverageScanableStatesPerByte(
+    const Grammar& grammar, const std::vector<std::string>& inputs
+) {
+  Grammar optimized_grammar = grammar->optimized ? grammar : GrammarOptimizer::Apply(grammar);
+  int64_t total_states = 0;
+  int64_t total_bytes = 0;
+  for (const auto& input : inputs) {
+    EarleyParser parser(optimized_grammar, ParserState::GetInvalidState());
+    for (auto byte : input) {
+      XGRAMMAR_CHECK(parser.Advance(static_cast<uint8_t>(byte)))
+          << "The input is not accepted by the grammar: " << input;
+      total_states += parser.GetLatestScanableStates().size();
+      ++total_bytes;
+    }
+  }
+  return total_bytes == 0 ? 0.0 : static_cast<double>(total_states) / total_bytes;
+}
+
+int64_t _GetNumUncertainTokens(const CompiledGrammar& compiled_grammar) {
+  int64_t num_uncertain_tokens = 0;
+  for (const auto& [state, mask] : compiled_grammar->GetAdaptiveTokenMaskCache()) {
+    num_uncertain_tokens += mask.uncertain_indices.size();
+  }
+  return num_uncertain_tokens;
+}
+
 namespace details {
 
 void DFS(
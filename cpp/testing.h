@@ -25,6 +25,22 @@ Grammar _EBNFToGrammarNoNormalization(
 
 std::string _PrintGrammarFSMs(const Grammar& grammar);
 
+/*!
+ * \brief Get the average number of scanable Earley states alive after each byte when matching the
+ * inputs. It measures the ambiguity of the grammar. The grammar will be optimized if it is not.
+ * \param grammar The grammar to match.
+ * \param inputs The inputs, each of which should be accepted by the grammar byte by byte.
+ */
+double _GetAverageScanableStatesPerByte(
+    const Grammar& grammar, const std::vector<std::string>& inputs
+);
+
+/*!
+ * \brief Get the total number of uncertain tokens in the adaptive token mask cache of the compiled
+ * grammar. Uncertain tokens have to be checked by the parser at runtime.
+ */
+int64_t _GetNumUncertainTokens(const CompiledGrammar& compiled_grammar);
+
 /*!
  * \brief Traverse the tree constructed by the draft model to generate the logits mask.
  *
@@ -19,6 +19,7 @@
 #include "support/encoding.h"
 #include "support/json_serializer.h"
 #include "support/logging.h"
+#include "support/utils.h"
 #include "tokenizer_info_impl.h"
 #include "xgrammar/exception.h"
 
@@ -315,12 +316,31 @@ TokenizerInfo::Impl::Impl(
     trie_subtree_nodes_range_[top_pair.second] = sorted_decoded_vocab_.size();
     prefix_stack.pop();
   }
+  InitDerivedMembers();
+}
+
+void TokenizerInfo::Impl::InitDerivedMembers() {
+  stop_token_bitset_ = DynamicBitset(vocab_size_);
+  for (auto id : stop_token_ids_) {
+    if (id >= 0 && id < vocab_size_) {
+      stop_token_bitset_.Set(id, true);
+    }
+  }
 }
 
 std::string TokenizerInfo::Impl::DumpMetadata() const {
   return DumpMetadataValue().serialize(false);
 }
 
+std::size_t TokenizerInfo::Impl::ComputeVocabHash() const {
+  std::size_t hash = HashCombine(vocab_size_, sorted_decoded_vocab_.size());
+  for (const auto& [token_id, token] : sorted_decoded_vocab_) {
+    HashCombineBinary(hash, token_id);
+    HashCombineBinary(hash, std::hash<std::string>{}(token));
+  }
+  return hash;
+}
+
 picojson::value TokenizerInfo::Impl::DumpMetadataValue() const {
   picojson::object obj;
   obj["vocab_type"] = picojson::value(static_cast<int64_t>(vocab_type_));
@@ -494,6 +514,7 @@ std::variant<TokenizerInfo, SerializationError> TokenizerInfo::DeserializeJSON(
   if (auto err = AutoDeserializeJSON(&tokenizer_info, json_string, true, "TokenizerInfo")) {
     return err.value();
   }
+  tokenizer_info->InitDerivedMembers();
   return tokenizer_info;
 }
 
@@ -9,6 +9,7 @@
 #include <utility>
 #include <vector>
 
+#include "support/dynamic_bitset.h"
 #include "support/reflection.h"
 #include "xgrammar/tokenizer_info.h"
 
@@ -32,6 +33,8 @@ class TokenizerInfo::Impl {
   const std::vector<std::string>& GetDecodedVocab() { return decoded_vocab_; }
   const std::vector<int32_t>& GetStopTokenIds() const { return stop_token_ids_; }
   const std::vector<int32_t>& GetSpecialTokenIds() const { return special_token_ids_; }
+  /*! \brief Check if the token is a stop token in O(1). The token id should be in the vocab. */
+  bool IsStopToken(int32_t token_id) const { return stop_token_bitset_[token_id]; }
   const std::vector<std::pair<int32_t, std::string>>& GetSortedDecodedVocab() const {
     return sorted_decoded_vocab_;
   }
@@ -40,6 +43,14 @@ class TokenizerInfo::Impl {
   std::string DumpMetadata() const;
   picojson::value DumpMetadataValue() const;
 
+  /*!
+   * \brief Compute the hash of the vocabulary the token masks are computed on, i.e. the vocabulary
+   * size and sorted_decoded_vocab_. The tokenizers with the same hash have the same token masks
+   * for every grammar. They can differ in the stop tokens and the special tokens, which are
+   * applied by the GrammarMatcher, and in the metadata.
+   */
+  std::size_t ComputeVocabHash() const;
+
   static std::shared_ptr<TokenizerInfo::Impl> FromVocabAndMetadata(
       const std::vector<std::string>& encoded_vocab, const std::string& metadata
   );
@@ -50,6 +61,12 @@ class TokenizerInfo::Impl {
 
   bool operator==(const Impl& other) const;
 
+  /*!
+   * \brief Build the members derived from the serialized ones, i.e. stop_token_bitset_. Called by
+   * the constructor and after deserialization.
+   */
+  void InitDerivedMembers();
+
  private:
   static bool IsSpecialToken(const std::string& decoded_token);
 
@@ -74,6 +91,8 @@ class TokenizerInfo::Impl {
   /*! \brief The special tokens. These tokens are ignored (masked out) during the grammar-guided
    * generation. */
   std::vector<int32_t> special_token_ids_;
+  /*! \brief The stop tokens as a bitset over the vocabulary. Not serialized. */
+  DynamicBitset stop_token_bitset_;
 
   /*!
    * \brief The tokens used to detect stop tokens from the vocabulary.
@@ -0,0 +1,187 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/tools/bench_grammar_matcher.cc
+ * \brief Benchmark the per-token cost of GrammarMatcher::FillNextTokenBitmask and AcceptToken on
+ * the builtin JSON grammar and a JSON schema, with a synthetic vocabulary.
+ *
+ * Usage: xgrammar_bench_grammar_matcher [--num-iters N] [--num-warmup N]
+ */
+
+#include <xgrammar/xgrammar.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace xgrammar;
+
+/*!
+ * \brief Build a vocabulary of the single printable characters, all pairs of the characters
+ * common in JSON, and some longer JSON fragments, so that many tokens are uncertain in every
+ * state.
+ */
+std::vector<std::string> BuildVocab() {
+  std::vector<std::string> vocab = {"<eos>", "\n", "\t"};
+  for (char c = ' '; c <= '~'; ++c) {
+    vocab.push_back(std::string(1, c));
+  }
+  const std::string json_chars = " \n\"{}[],:0123456789.-eE+abcdefghijklmnopqrstuvwxyz\\";
+  for (char first : json_chars) {
+    for (char second : json_chars) {
+      vocab.push_back(std::string{first, second});
+    }
+  }
+  for (const auto& token :
+       {"{\"", "\":", "\": ", "\": \"", "\", \"", "\"}", "\"]", "},", "}]", "],", ", ", "true",
+        "false", "null", "name", "id", "tags", "\"name", "\"id", "\"tags", "\n  ", "\n    ", ",\n",
+        "12", "345", "0.", ".5", "e-", "xgrammar", "true}", "null,", "false]", "[{", "  \""}) {
+    vocab.push_back(token);
+  }
+  std::sort(vocab.begin() + 1, vocab.end());
+  vocab.erase(std::unique(vocab.begin() + 1, vocab.end()), vocab.end());
+  return vocab;
+}
+
+/*! \brief Split the text into the longest tokens of the vocabulary. */
+std::vector<int32_t> Tokenize(const std::string& text, const std::vector<std::string>& vocab) {
+  std::vector<int32_t> token_ids;
+  for (std::size_t pos = 0; pos < text.size();) {
+    int32_t best_id = -1;
+    for (int32_t id = 1; id < static_cast<int32_t>(vocab.size()); ++id) {
+      const auto& token = vocab[id];
+      if (text.compare(pos, token.size(), token) == 0 &&
+          (best_id == -1 || token.size() > vocab[best_id].size())) {
+        best_id = id;
+      }
+    }
+    if (best_id == -1) {
+      std::cerr << "Cannot tokenize " << text.substr(pos) << "\n";
+      std::exit(1);
+    }
+    token_ids.push_back(best_id);
+    pos += vocab[best_id].size();
+  }
+  return token_ids;
+}
+
+struct BenchmarkResult {
+  double fill_us_per_token = 0;
+  double accept_us_per_token = 0;
+};
+
+/*!
+ * \brief Match the tokens of the text and then the stop token for num_iters times, and return the
+ * average time of FillNextTokenBitmask and AcceptToken per token.
+ */
+BenchmarkResult RunBenchmark(
+    const CompiledGrammar& compiled_grammar,
+    const std::vector<int32_t>& token_ids,
+    int32_t vocab_size,
+    int num_iters,
+    int num_warmup
+) {
+  std::vector<int32_t> bitmask(GetBitmaskSize(vocab_size));
+  int64_t bitmask_size = bitmask.size();
+  DLTensor tensor{
+      bitmask.data(), DLDevice{kDLCPU, 0}, 1, GetBitmaskDLType(), &bitmask_size, nullptr, 0
+  };
+  GrammarMatcher matcher(compiled_grammar);
+  std::chrono::nanoseconds fill_time{0};
+  std::chrono::nanoseconds accept_time{0};
+  int64_t num_tokens = 0;
+
+  for (int iter = 0; iter < num_warmup + num_iters; ++iter) {
+    matcher.Reset();
+    bool is_measured = iter >= num_warmup;
+    for (std::size_t i = 0; i <= token_ids.size(); ++i) {
+      int32_t token_id = i < token_ids.size() ? token_ids[i] : 0;
+      auto start = std::chrono::steady_clock::now();
+      matcher.FillNextTokenBitmask(&tensor);
+      auto middle = std::chrono::steady_clock::now();
+      bool accepted = matcher.AcceptToken(token_id);
+      auto end = std::chrono::steady_clock::now();
+      if (!accepted) {
+        std::cerr << "Token " << token_id << " is rejected at position " << i << "\n";
+        std::exit(1);
+      }
+      if (is_measured) {
+        fill_time += middle - start;
+        accept_time += end - middle;
+        ++num_tokens;
+      }
+    }
+  }
+
+  BenchmarkResult result;
+  result.fill_us_per_token = fill_time.count() / 1e3 / num_tokens;
+  result.accept_us_per_token = accept_time.count() / 1e3 / num_tokens;
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int num_iters = 200;
+  int num_warmup = 10;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--num-iters") == 0 && i + 1 < argc) {
+      num_iters = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--num-warmup") == 0 && i + 1 < argc) {
+      num_warmup = std::atoi(argv[++i]);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--num-iters N] [--num-warmup N]\n";
+      return 1;
+    }
+  }
+
+  auto vocab = BuildVocab();
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+
+  struct Benchmark {
+    std::string name;
+    CompiledGrammar compiled_grammar;
+    std::string text;
+  };
+  std::vector<Benchmark> benchmarks = {
+      {"builtin_json",
+       compiler.CompileBuiltinJSONGrammar(),
+       "{\"name\": \"xgrammar\", \"ids\": [12, 3.5, -7e2], \"nested\": {\"ok\": true, \"none\": "
+       "null}, \"list\": [{\"a\": false}, {\"b\": \"\\u00e9\"}], \"text\": \"the quick brown fox "
+       "jumps over the lazy dog\"}"},
+      {"json_schema",
+       compiler.CompileJSONSchema(
+           R"({"type": "object", "properties": {"name": {"type": "string"}, "id": {"type":
+           "integer"}, "tags": {"type": "array", "items": {"type": "string"}}}, "required":
+           ["name", "id", "tags"]})"
+       ),
+       "{\"name\": \"a quick brown fox\", \"id\": 12345, \"tags\": [\"x\", \"yz\", \"lazy "
+       "dog\"]}"},
+  };
+
+  std::cout << "vocab size: " << vocab.size() << ", iters: " << num_iters << "\n";
+  std::cout << std::left << std::setw(16) << "benchmark" << std::setw(10) << "tokens"
+            << std::setw(16) << "fill us/token" << "accept us/token\n";
+  for (const auto& benchmark : benchmarks) {
+    auto token_ids = Tokenize(benchmark.text, vocab);
+    auto result = RunBenchmark(
+        benchmark.compiled_grammar,
+        token_ids,
+        static_cast<int32_t>(vocab.size()),
+        num_iters,
+        num_warmup
+    );
+    std::cout << std::left << std::setw(16) << benchmark.name << std::setw(10)
+              << token_ids.size() + 1 << std::setw(16) << std::fixed << std::setprecision(3)
+              << result.fill_us_per_token << result.accept_us_per_token << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,99 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/tools/bench_grammar_optimize_scaling.cc
+ * \brief Benchmark how the parsing and optimization time scales with the size of the grammar, on
+ * the tool-catalog grammars of examples/benchmark/bench_grammar_optimize_scaling.py.
+ *
+ * Usage: xgrammar_bench_grammar_optimize_scaling [--num-tools N ...] [--num-iters N]
+ */
+
+#include <xgrammar/xgrammar.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "grammar_impl.h"
+
+namespace {
+
+using namespace xgrammar;
+
+/*!
+ * \brief Generate a grammar like the ones of large tool catalogs: the root rule chooses one of the
+ * tools, and every tool has its own argument and value rules, which share a few common rules.
+ */
+std::string GenerateToolCatalogGrammar(int num_tools) {
+  std::string ebnf = "root ::= ";
+  for (int i = 0; i < num_tools; ++i) {
+    ebnf += (i == 0 ? "tool_" : " | tool_") + std::to_string(i);
+  }
+  ebnf += "\n";
+  for (int i = 0; i < num_tools; ++i) {
+    auto id = std::to_string(i);
+    ebnf += "tool_" + id + R"( ::= "{\"name\": \"tool_)" + id + R"(\", \"arguments\": " args_)" +
+            id + " \"}\"\n";
+    ebnf += "args_" + id + R"( ::= "{" ws "\"p\": " value_)" + id + R"( ws ("," ws "\"q)" + id +
+            R"(\": " num)? "}")" + "\n";
+    ebnf += "value_" + id + R"( ::= string | num | "null" | "[" (num ("," num)*)? "]")" + "\n";
+  }
+  ebnf += R"(string ::= "\"" [^"\\]* "\"")" "\n";
+  ebnf += R"(num ::= "-"? [0-9]+)" "\n";
+  ebnf += "ws ::= [ ]*\n";
+  return ebnf;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<int> num_tools_list;
+  int num_iters = 3;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--num-tools") == 0 && i + 1 < argc) {
+      while (i + 1 < argc && argv[i + 1][0] != '-') {
+        num_tools_list.push_back(std::atoi(argv[++i]));
+      }
+    } else if (std::strcmp(argv[i], "--num-iters") == 0 && i + 1 < argc) {
+      num_iters = std::max(1, std::atoi(argv[++i]));
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--num-tools N ...] [--num-iters N]\n";
+      return 1;
+    }
+  }
+  if (num_tools_list.empty()) {
+    num_tools_list = {100, 1000, 4000, 8000, 22300};
+  }
+
+  // The empty vocabulary computes no token masks, so only the parsing and optimization are timed.
+  TokenizerInfo tokenizer_info(std::vector<std::string>{});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+
+  std::cout << std::left << std::setw(10) << "tools" << std::setw(10) << "rules" << std::setw(12)
+            << "exprs" << std::setw(12) << "parse ms" << "optimize ms\n";
+  for (int num_tools : num_tools_list) {
+    auto ebnf = GenerateToolCatalogGrammar(num_tools);
+    std::chrono::nanoseconds parse_time{0};
+    std::chrono::nanoseconds optimize_time{0};
+    Grammar grammar{NullObj{}};
+    for (int iter = 0; iter < num_iters; ++iter) {
+      auto start = std::chrono::steady_clock::now();
+      grammar = Grammar::FromEBNF(ebnf);
+      auto middle = std::chrono::steady_clock::now();
+      compiler.CompileGrammar(grammar);
+      auto end = std::chrono::steady_clock::now();
+      parse_time += middle - start;
+      optimize_time += end - middle;
+    }
+    std::cout << std::left << std::setw(10) << num_tools << std::setw(10) << grammar->NumRules()
+              << std::setw(12) << grammar->NumGrammarExprs() << std::setw(12) << std::fixed
+              << std::setprecision(1) << parse_time.count() / 1e6 / num_iters
+              << optimize_time.count() / 1e6 / num_iters << std::endl;
+  }
+  return 0;
+}
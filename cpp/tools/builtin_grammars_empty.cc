@@ -0,0 +1,19 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/tools/builtin_grammars_empty.cc
+ * \brief The empty builtin grammars, used by the generator of the builtin grammars and when they
+ * are not embedded. The builtin grammars are then optimized at runtime.
+ */
+
+#include <cstddef>
+
+namespace xgrammar {
+
+// Declared before defined, so the constants have external linkage.
+extern const char kBuiltinJSONGrammarSerialized[];
+extern const std::size_t kBuiltinJSONGrammarSerializedSize;
+
+const char kBuiltinJSONGrammarSerialized[] = "";
+const std::size_t kBuiltinJSONGrammarSerializedSize = 0;
+
+}  // namespace xgrammar
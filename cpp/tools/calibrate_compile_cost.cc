@@ -0,0 +1,366 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/tools/calibrate_compile_cost.cc
+ * \brief Compare GrammarCompiler::EstimateCost with the real compilations of a corpus of grammars,
+ * and fit the accepted and uncertain ratios and the per-state and per-token times of the estimate.
+ *
+ * Usage: xgrammar_calibrate_compile_cost [--vocab FILE] [--schemas FILE] [--num-iters N]
+ *
+ * --vocab reads one token per line, with "\\", "\n", "\r", "\t" and "\xHH" escapes, the first
+ * token being the stop token. Without it a synthetic vocabulary is used.
+ * --schemas reads one JSON schema per line, replacing the builtin corpus.
+ */
+
+#include <xgrammar/xgrammar.h>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "compiled_grammar_impl.h"
+
+namespace {
+
+using namespace xgrammar;
+
+/*! \brief Must match kWideFirstBytes in GrammarCompiler::EstimateCost. */
+constexpr int kWideFirstBytes = 32;
+
+/*!
+ * \brief Build a vocabulary of the single bytes, the pairs of the characters common in JSON, and
+ * words with the prefixes of the BPE vocabularies, so the states see both short and long tokens.
+ */
+std::vector<std::string> BuildVocab() {
+  std::vector<std::string> vocab = {"<eos>"};
+  for (int c = 1; c < 256; ++c) {
+    vocab.push_back(std::string(1, static_cast<char>(c)));
+  }
+  const std::string json_chars = " \n\"{}[],:0123456789.-eE+abcdefghijklmnopqrstuvwxyz\\";
+  for (char first : json_chars) {
+    for (char second : json_chars) {
+      vocab.push_back(std::string{first, second});
+    }
+  }
+  for (const auto& word :
+       {"name", "id", "type", "value", "true", "false", "null", "string", "number", "object",
+        "array", "items", "email", "date", "address", "city", "country", "phone", "price",
+        "quantity", "description", "title", "status", "created", "the", "and", "of", "to", "in",
+        "is", "for", "with"}) {
+    for (const auto& prefix : {"", " ", "\"", " \"", "_", "\": \""}) {
+      vocab.push_back(prefix + std::string(word));
+    }
+    vocab.push_back(std::string(word) + "\":");
+    vocab.push_back(std::string(word) + "\",");
+  }
+  for (const auto& token : {"\xc3\xa9", "\xe4\xb8\xad", "\xe4\xb8", "\xf0\x9f\x98\x80", "\xad"}) {
+    vocab.push_back(token);
+  }
+  std::sort(vocab.begin() + 1, vocab.end());
+  vocab.erase(std::unique(vocab.begin() + 1, vocab.end()), vocab.end());
+  return vocab;
+}
+
+std::string Unescape(const std::string& line) {
+  std::string token;
+  for (std::size_t i = 0; i < line.size(); ++i) {
+    if (line[i] != '\\' || i + 1 == line.size()) {
+      token.push_back(line[i]);
+      continue;
+    }
+    char next = line[++i];
+    if (next == 'n') {
+      token.push_back('\n');
+    } else if (next == 'r') {
+      token.push_back('\r');
+    } else if (next == 't') {
+      token.push_back('\t');
+    } else if (next == 'x' && i + 2 < line.size()) {
+      token.push_back(static_cast<char>(std::stoi(line.substr(i + 1, 2), nullptr, 16)));
+      i += 2;
+    } else {
+      token.push_back(next);
+    }
+  }
+  return token;
+}
+
+std::vector<std::string> ReadLines(const char* path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot open " << path << "\n";
+    std::exit(1);
+  }
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(file, line);) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+std::vector<std::pair<std::string, Grammar>> BuiltinCorpus() {
+  std::vector<std::pair<std::string, Grammar>> corpus;
+  corpus.emplace_back("builtin_json", Grammar::BuiltinJSONGrammar());
+  corpus.emplace_back(
+      "schema_flat",
+      Grammar::FromJSONSchema(R"({"type": "object", "properties": {
+        "name": {"type": "string"}, "id": {"type": "integer"}, "price": {"type": "number"}
+      }, "required": ["name", "id"]})")
+  );
+  corpus.emplace_back(
+      "schema_nested",
+      Grammar::FromJSONSchema(R"({"type": "object", "properties": {
+        "title": {"type": "string", "maxLength": 20},
+        "status": {"enum": ["created", "shipped", "delivered"]},
+        "items": {"type": "array", "items": {"type": "object", "properties": {
+          "description": {"type": "string"}, "quantity": {"type": "integer", "minimum": 1},
+          "tags": {"type": "array", "items": {"type": "string"}}
+        }, "required": ["description"]}},
+        "address": {"type": "object", "properties": {
+          "city": {"type": "string"}, "country": {"type": "string"}, "phone": {"type": "string"}
+        }}
+      }, "required": ["title", "items"]})")
+  );
+  corpus.emplace_back(
+      "schema_formats",
+      Grammar::FromJSONSchema(R"({"type": "object", "properties": {
+        "email": {"type": "string", "format": "email"},
+        "created": {"type": "string", "format": "date"},
+        "value": {"anyOf": [{"type": "number"}, {"type": "boolean"}, {"type": "null"}]}
+      }, "required": ["email", "created", "value"]})")
+  );
+  corpus.emplace_back(
+      "schema_no_whitespace",
+      Grammar::FromJSONSchema(
+          R"({"type": "array", "items": {"type": "object", "properties": {
+            "name": {"type": "string"}, "value": {"type": "number"}
+          }}})",
+          false
+      )
+  );
+  corpus.emplace_back(
+      "regex_date", Grammar::FromRegex(R"([0-9]{4}-(0[1-9]|1[0-2])-(0[1-9]|[12][0-9]|3[01]))")
+  );
+  corpus.emplace_back("regex_words", Grammar::FromRegex(R"([a-z]+( [a-z]+)*\.)"));
+  corpus.emplace_back("ebnf_arithmetic", Grammar::FromEBNF(R"ebnf(
+    root ::= expr
+    expr ::= term (("+" | "-") term)*
+    term ::= factor (("*" | "/") factor)*
+    factor ::= [0-9]+ | "(" expr ")" | [a-z_]+
+  )ebnf"));
+  return corpus;
+}
+
+/*! \brief The totals over the corpus that the ratios are fitted from. */
+struct RatioTotals {
+  int64_t wide_checks = 0;
+  int64_t wide_accepted = 0;
+  int64_t narrow_checks = 0;
+  int64_t narrow_accepted = 0;
+  int64_t non_root_checks = 0;
+  int64_t non_root_uncertain = 0;
+};
+
+/*! \brief The measured costs of one grammar. */
+struct Sample {
+  double num_states = 0;
+  double wide_checks = 0;
+  double narrow_checks = 0;
+  double time_us = 0;
+};
+
+/*! \brief Solve the least squares problem time_us = x0 * states + x1 * wide + x2 * narrow. */
+std::array<double, 3> FitTimes(const std::vector<Sample>& samples) {
+  double a[3][4] = {};
+  for (const auto& sample : samples) {
+    double row[3] = {sample.num_states, sample.wide_checks, sample.narrow_checks};
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        a[i][j] += row[i] * row[j];
+      }
+      a[i][3] += row[i] * sample.time_us;
+    }
+  }
+  for (int col = 0; col < 3; ++col) {
+    int pivot = col;
+    for (int row = col + 1; row < 3; ++row) {
+      if (std::abs(a[row][col]) > std::abs(a[pivot][col])) {
+        pivot = row;
+      }
+    }
+    std::swap(a[col], a[pivot]);
+    if (a[col][col] == 0) {
+      continue;
+    }
+    for (int row = 0; row < 3; ++row) {
+      if (row == col) continue;
+      double factor = a[row][col] / a[col][col];
+      for (int k = col; k < 4; ++k) {
+        a[row][k] -= factor * a[col][k];
+      }
+    }
+  }
+  std::array<double, 3> result{};
+  for (int i = 0; i < 3; ++i) {
+    result[i] = a[i][i] == 0 ? 0 : a[i][3] / a[i][i];
+  }
+  return result;
+}
+
+double Ratio(int64_t numerator, int64_t denominator) {
+  return denominator == 0 ? 0 : static_cast<double>(numerator) / denominator;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* vocab_path = nullptr;
+  const char* schemas_path = nullptr;
+  int num_iters = 3;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--vocab") == 0 && i + 1 < argc) {
+      vocab_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--schemas") == 0 && i + 1 < argc) {
+      schemas_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--num-iters") == 0 && i + 1 < argc) {
+      num_iters = std::max(1, std::atoi(argv[++i]));
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--vocab FILE] [--schemas FILE] [--num-iters NUM_ITERS]\n";
+      return 1;
+    }
+  }
+
+  std::vector<std::string> vocab;
+  if (vocab_path != nullptr) {
+    for (const auto& line : ReadLines(vocab_path)) {
+      vocab.push_back(Unescape(line));
+    }
+  } else {
+    vocab = BuildVocab();
+  }
+  std::vector<std::pair<std::string, Grammar>> corpus;
+  if (schemas_path != nullptr) {
+    auto schemas = ReadLines(schemas_path);
+    for (std::size_t i = 0; i < schemas.size(); ++i) {
+      corpus.emplace_back("schema_" + std::to_string(i), Grammar::FromJSONSchema(schemas[i]));
+    }
+  } else {
+    corpus = BuiltinCorpus();
+  }
+
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  const auto& sorted_decoded_vocab = tokenizer_info.GetSortedDecodedVocab();
+  const int64_t num_tokens = static_cast<int64_t>(sorted_decoded_vocab.size());
+  std::array<int64_t, 256> num_tokens_by_first_byte{};
+  for (const auto& [id, token] : sorted_decoded_vocab) {
+    ++num_tokens_by_first_byte[static_cast<uint8_t>(token[0])];
+  }
+
+  std::cout << "Vocabulary size: " << vocab.size() << ", grammars: " << corpus.size() << "\n\n";
+  std::cout << std::left << std::setw(24) << "Grammar" << std::right << std::setw(16)
+            << "States est/real" << std::setw(24) << "Memory KB est/real" << std::setw(24)
+            << "Time ms est/real" << "\n";
+  std::cout << std::fixed;
+
+  RatioTotals totals;
+  std::vector<Sample> samples;
+  double max_memory_error = 1;
+  double max_time_error = 1;
+  for (const auto& [name, grammar] : corpus) {
+    auto estimate = compiler.EstimateCost(grammar);
+    double time_us = 0;
+    CompiledGrammar compiled_grammar{NullObj{}};
+    for (int iter = 0; iter < num_iters; ++iter) {
+      auto start = std::chrono::high_resolution_clock::now();
+      compiled_grammar = compiler.CompileGrammar(grammar);
+      auto end = std::chrono::high_resolution_clock::now();
+      double iter_us = std::chrono::duration<double, std::micro>(end - start).count();
+      time_us = iter == 0 ? iter_us : std::min(time_us, iter_us);
+    }
+
+    Sample sample;
+    const auto& optimized_grammar = compiled_grammar->grammar;
+    for (const auto& [state, mask] : compiled_grammar->adaptive_token_mask_cache) {
+      auto first_character_mask = GetFirstCharacterMask(optimized_grammar, state);
+      int64_t num_checks = 0;
+      for (int c = 0; c < 256; ++c) {
+        num_checks += first_character_mask[c] ? num_tokens_by_first_byte[c] : 0;
+      }
+      int64_t num_uncertain = static_cast<int64_t>(mask.uncertain_indices.size());
+      int64_t num_accepted = 0;
+      switch (mask.store_type) {
+        case AdaptiveTokenMask::StoreType::kAccepted:
+          num_accepted = static_cast<int64_t>(mask.accepted_indices.size());
+          break;
+        case AdaptiveTokenMask::StoreType::kRejected:
+          num_accepted =
+              num_tokens - static_cast<int64_t>(mask.rejected_indices.size()) - num_uncertain;
+          break;
+        case AdaptiveTokenMask::StoreType::kAcceptedBitset:
+          num_accepted = mask.accepted_bitset.Count();
+          break;
+      }
+      if (static_cast<int>(first_character_mask.count()) >= kWideFirstBytes) {
+        totals.wide_checks += num_checks;
+        totals.wide_accepted += num_accepted;
+        sample.wide_checks += num_checks;
+      } else {
+        totals.narrow_checks += num_checks;
+        totals.narrow_accepted += num_accepted;
+        sample.narrow_checks += num_checks;
+      }
+      if (state.rule_id != optimized_grammar->GetRootRuleId()) {
+        totals.non_root_checks += num_checks;
+        totals.non_root_uncertain += num_uncertain;
+      }
+    }
+    sample.num_states = static_cast<double>(compiled_grammar->adaptive_token_mask_cache.size());
+    sample.time_us = time_us;
+    samples.push_back(sample);
+
+    double memory_kb = compiled_grammar.MemorySizeBytes() / 1024.0;
+    double estimate_memory_kb = estimate.memory_bytes / 1024.0;
+    double time_ms = time_us / 1000;
+    max_memory_error = std::max(
+        max_memory_error,
+        std::max(estimate_memory_kb / memory_kb, memory_kb / estimate_memory_kb)
+    );
+    max_time_error = std::max(
+        max_time_error,
+        std::max(estimate.compile_time_ms / time_ms, time_ms / estimate.compile_time_ms)
+    );
+    std::cout << std::left << std::setw(24) << name << std::right << std::setw(8)
+              << estimate.num_mask_states << "/" << std::setw(7)
+              << compiled_grammar->adaptive_token_mask_cache.size() << std::setprecision(1)
+              << std::setw(12) << estimate_memory_kb << "/" << std::setw(11) << memory_kb
+              << std::setprecision(2) << std::setw(12) << estimate.compile_time_ms << "/"
+              << std::setw(11) << time_ms << "\n";
+  }
+
+  auto times = FitTimes(samples);
+  std::cout << "\nMax error factor: memory " << std::setprecision(2) << max_memory_error
+            << ", time " << max_time_error << "\n\n";
+  std::cout << "Fitted constants of GrammarCompiler::EstimateCost:\n"
+            << std::setprecision(3) << "  kWideAcceptedRatio      = "
+            << Ratio(totals.wide_accepted, totals.wide_checks) << "\n"
+            << "  kNarrowAcceptedRatio    = " << Ratio(totals.narrow_accepted, totals.narrow_checks)
+            << "\n"
+            << std::setprecision(4) << "  kUncertainRatio         = "
+            << Ratio(totals.non_root_uncertain, totals.non_root_checks) << "\n"
+            << std::setprecision(3) << "  kStateTimeUs            = " << times[0] << "\n"
+            << "  kWideTokenCheckTimeUs   = " << times[1] << "\n"
+            << "  kNarrowTokenCheckTimeUs = " << times[2] << "\n";
+  return 0;
+}
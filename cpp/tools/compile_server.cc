@@ -0,0 +1,94 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/tools/compile_server.cc
+ * \brief The compile server daemon shared by the inference worker processes of a host. See
+ * xgrammar::CompileServer.
+ *
+ * Usage: xgrammar_compile_server --socket PATH [--max-threads N] [--max-memory-bytes N]
+ *                                [--num-threads N] [--cpus ID,ID,...]
+ */
+
+#include <xgrammar/xgrammar.h>
+
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+
+namespace {
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program << " --socket PATH [--max-threads N] [--max-memory-bytes N] "
+            << "[--num-threads N] [--cpus ID,ID,...]\n"
+            << "  --socket            The path of the Unix domain socket to listen at.\n"
+            << "  --max-threads       The maximum number of threads to compile a grammar.\n"
+            << "  --max-memory-bytes  The maximum memory of the cache of every tokenizer.\n"
+            << "  --num-threads       The number of worker threads of the server.\n"
+            << "  --cpus              The CPUs to pin the worker threads to.\n";
+}
+
+std::vector<int32_t> ParseCPUList(const std::string& cpus) {
+  std::vector<int32_t> cpu_ids;
+  std::stringstream stream(cpus);
+  std::string cpu_id;
+  while (std::getline(stream, cpu_id, ',')) {
+    cpu_ids.push_back(std::stoi(cpu_id));
+  }
+  return cpu_ids;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string socket_path;
+  int max_threads = 8;
+  int64_t max_memory_bytes = -1;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+    std::string value = argv[++i];
+    if (arg == "--socket") {
+      socket_path = value;
+    } else if (arg == "--max-threads") {
+      max_threads = std::stoi(value);
+    } else if (arg == "--max-memory-bytes") {
+      max_memory_bytes = std::stoll(value);
+    } else if (arg == "--num-threads") {
+      xgrammar::SetExecutorNumThreads(std::stoi(value));
+    } else if (arg == "--cpus") {
+      xgrammar::SetWorkerCPUAffinity(ParseCPUList(value));
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (socket_path.empty()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // Handle the termination signals in the main thread, and serve in another thread.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  xgrammar::CompileServer server(socket_path, max_threads, max_memory_bytes);
+  std::thread serve_thread([&server] { server.Serve(); });
+  std::cerr << "Serving at " << socket_path << std::endl;
+
+  int signal = 0;
+  sigwait(&signals, &signal);
+  server.Shutdown();
+  serve_thread.join();
+  return 0;
+}
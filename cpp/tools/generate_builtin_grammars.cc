@@ -0,0 +1,61 @@
+/*!
+ *  Copyright (c) 2025 by Contributors
+ * \file xgrammar/tools/generate_builtin_grammars.cc
+ * \brief Optimize the builtin grammars, and write them to a C++ source file as serialized JSON, so
+ * they are embedded in the library and loaded without parsing or optimization.
+ * \details Usage: generate_builtin_grammars <output_path>
+ */
+
+#include <xgrammar/grammar.h>
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "grammar_functor.h"
+
+namespace {
+
+/*!
+ * \brief Write the bytes as a char array and its size. A char array is used instead of a string
+ * literal, since some compilers limit the length of string literals.
+ */
+void WriteCharArray(std::ostream& os, const std::string& name, const std::string& data) {
+  // Declared before defined, so the constants have external linkage.
+  os << "extern const char " << name << "[];\n";
+  os << "extern const std::size_t " << name << "Size;\n\n";
+  os << "const char " << name << "[] = {";
+  constexpr char kHexDigits[] = "0123456789abcdef";
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    if (i % 12 == 0) os << "\n   ";
+    auto byte = static_cast<unsigned char>(data[i]);
+    os << " '\\x" << kHexDigits[byte >> 4] << kHexDigits[byte & 0xF] << "',";
+  }
+  os << "\n    '\\0'};\n";
+  os << "const std::size_t " << name << "Size = " << data.size() << ";\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <output_path>" << std::endl;
+    return 1;
+  }
+
+  auto builtin_json_grammar =
+      xgrammar::GrammarOptimizer::Apply(xgrammar::Grammar::BuiltinJSONGrammar());
+
+  std::ofstream os(argv[1]);
+  if (!os) {
+    std::cerr << "Cannot open " << argv[1] << std::endl;
+    return 1;
+  }
+  os << "// Generated by cpp/tools/generate_builtin_grammars.cc. Do not edit.\n\n";
+  os << "#include <cstddef>\n\n";
+  os << "namespace xgrammar {\n\n";
+  WriteCharArray(os, "kBuiltinJSONGrammarSerialized", builtin_json_grammar.SerializeJSON());
+  os << "\n}  // namespace xgrammar\n";
+  return os ? 0 : 1;
+}
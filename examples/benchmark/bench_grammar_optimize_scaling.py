@@ -0,0 +1,75 @@
+"""This script benchmarks how the grammar optimization time scales with the size of the grammar.
+
+The grammars mimic the ones generated from large tool catalogs: the root rule chooses one of the
+tools, and every tool has its own argument and value rules, which share a few common rules. The
+grammar is compiled with an empty vocabulary, so only the parsing and the optimization passes are
+timed.
+"""
+
+import argparse
+import time
+
+from tabulate import tabulate
+
+import xgrammar as xgr
+
+
+def generate_tool_catalog_grammar(num_tools: int) -> str:
+    lines = ["root ::= " + " | ".join(f"tool_{i}" for i in range(num_tools))]
+    for i in range(num_tools):
+        lines.append(
+            f'tool_{i} ::= "{{\\"name\\": \\"tool_{i}\\", \\"arguments\\": " args_{i} "}}"'
+        )
+        lines.append(
+            f'args_{i} ::= "{{" ws "\\"p\\": " value_{i} ws ("," ws "\\"q{i}\\": " num)? "}}"'
+        )
+        lines.append(f'value_{i} ::= string | num | "null" | "[" (num ("," num)*)? "]"')
+    lines.append('string ::= "\\"" [^"\\\\]* "\\""')
+    lines.append('num ::= "-"? [0-9]+')
+    lines.append("ws ::= [ ]*")
+    return "\n".join(lines)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--num_tools", type=int, nargs="+", default=[100, 1000, 4000, 8000, 22300]
+    )
+    parser.add_argument("--num_iters", type=int, default=3)
+    args = parser.parse_args()
+
+    tokenizer_info = xgr.TokenizerInfo([])
+    compiler = xgr.GrammarCompiler(tokenizer_info, max_threads=1, cache_enabled=False)
+
+    results = []
+    for num_tools in args.num_tools:
+        ebnf = generate_tool_catalog_grammar(num_tools)
+        parse_time = optimize_time = 0.0
+        for _ in range(args.num_iters):
+            start = time.perf_counter()
+            grammar = xgr.Grammar.from_ebnf(ebnf)
+            parse_time += time.perf_counter() - start
+
+            start = time.perf_counter()
+            compiler.compile_grammar(grammar)
+            optimize_time += time.perf_counter() - start
+
+        num_rules = ebnf.count("::=")
+        results.append(
+            [
+                num_tools,
+                num_rules,
+                parse_time / args.num_iters * 1e3,
+                optimize_time / args.num_iters * 1e3,
+            ]
+        )
+        print(f"Finished {num_tools} tools", flush=True)
+
+    print(
+        tabulate(
+            results,
+            headers=["Tools", "Rules", "Parse ms", "Optimize ms"],
+            floatfmt=".1f",
+            tablefmt="github",
+        )
+    )
@@ -11,6 +11,7 @@
 #include <xgrammar/tokenizer_info.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -47,6 +48,114 @@ class CompiledGrammar {
   XGRAMMAR_DEFINE_PIMPL_METHODS(CompiledGrammar);
 };
 
+/*!
+ * \brief The tokenizer-independent stage of a compiled grammar: the optimized grammar with the
+ * FSMs of its rules, the bytes that can start and follow each rule, and the parser states whose
+ * token masks are computed. It is computed once and can be compiled for different tokenizers, e.g.
+ * by the GrammarCompilers of the models serving the same schemas, which only compute the token
+ * masks of their vocabularies.
+ */
+class PreparedGrammar {
+ public:
+  /*! \brief Run the tokenizer-independent stage of the compilation of a grammar. */
+  static PreparedGrammar FromGrammar(const Grammar& grammar);
+
+  /*! \brief Get the optimized grammar. */
+  Grammar GetGrammar() const;
+
+  /*! \brief The number of parser states whose token masks are computed for every tokenizer. */
+  int64_t NumTokenMaskStates() const;
+
+  /*! \brief Return the approximate memory usage of the prepared grammar in bytes. */
+  std::size_t MemorySizeBytes() const;
+
+  XGRAMMAR_DEFINE_PIMPL_METHODS(PreparedGrammar);
+};
+
+/*!
+ * \brief The cancellation token, deadline and resource budgets of grammar compilations. The
+ * budget is checked cooperatively in the JSON schema converter, the grammar optimizer, the FSM
+ * construction and the token mask computation. When it is exceeded, the compilation throws a
+ * CompileBudgetExceededError.
+ * \note The budget is applied to the compilations running in a CompileBudgetScope. One budget can
+ * be shared by multiple compilations, and the memory and FSM states are accumulated over them.
+ */
+class CompileBudget {
+ public:
+  /*!
+   * \brief Construct a compile budget.
+   * \param timeout_ms The timeout in milliseconds from the construction. -1 means no deadline.
+   * \param max_memory_bytes The maximum bytes of the token mask cache. -1 means unlimited.
+   * \param max_fsm_states The maximum number of states of the rule FSMs. -1 means unlimited.
+   */
+  CompileBudget(
+      int64_t timeout_ms = -1,
+      int64_t max_memory_bytes = -1,
+      int64_t max_fsm_states = -1
+  );
+
+  /*! \brief Cancel the compilations using this budget. It can be called from any thread. */
+  void Cancel();
+
+  /*! \brief Whether the budget is cancelled. */
+  bool IsCancelled() const;
+
+  /*! \brief The bytes of the token mask cache computed under this budget. */
+  int64_t GetMemoryBytes() const;
+
+  /*! \brief The number of FSM states built under this budget. */
+  int64_t GetFSMStates() const;
+
+  XGRAMMAR_DEFINE_PIMPL_METHODS(CompileBudget);
+};
+
+/*!
+ * \brief RAII scope that applies a CompileBudget to the compilations started in the current
+ * thread, including their tasks running in the worker threads. Scopes can be nested, and the
+ * previous budget is restored on destruction.
+ */
+class CompileBudgetScope {
+ public:
+  explicit CompileBudgetScope(const CompileBudget& budget);
+  ~CompileBudgetScope();
+
+  CompileBudgetScope(const CompileBudgetScope&) = delete;
+  CompileBudgetScope& operator=(const CompileBudgetScope&) = delete;
+
+ private:
+  /*! \brief The budget applied by this scope. */
+  CompileBudget budget_;
+  /*! \brief The budget applied before this scope. */
+  CompileBudget::Impl* prev_budget_;
+};
+
+/*!
+ * \brief The estimated cost of compiling a grammar, without computing the token masks. See
+ * GrammarCompiler::EstimateCost.
+ */
+struct CompileCostEstimate {
+  /*! \brief The number of parser states whose token masks are computed. */
+  int64_t num_mask_states = 0;
+  /*!
+   * \brief The number of tokens matched against the parser states, summed over the states. The
+   * tokens whose first byte cannot be accepted are skipped, so this is the main work of the
+   * compilation.
+   */
+  int64_t num_token_checks = 0;
+  /*!
+   * \brief The expected number of uncertain tokens, summed over the states. They are checked by
+   * the parser when generating the token masks.
+   */
+  int64_t num_uncertain_tokens = 0;
+  /*! \brief The estimated memory of the compiled grammar in bytes. */
+  int64_t memory_bytes = 0;
+  /*!
+   * \brief The estimated compilation time in milliseconds with a single thread. It comes from
+   * heuristic per-state and per-token costs, so it is only meaningful to compare grammars.
+   */
+  double compile_time_ms = 0;
+};
+
 /*!
  * \brief A cache to get the compiled grammar for grammar or schema. This class avoids
  * redundant preprocessing of the grammar or schema when constructing a CompiledGrammar.
@@ -54,6 +163,8 @@ class CompiledGrammar {
  * create every compiled grammar. If multiple toke tables are used to create init
  * contexts, an instance of this class for each vocabulary should be created.
  */
+class SharedGrammarCache;
+
 class GrammarCompiler {
  public:
   /*!
@@ -92,12 +203,92 @@ class GrammarCompiler {
       const std::string& ebnf_str, const std::string& root_rule_name = "root"
   );
 
+  /*!
+   * \brief Get the compiled grammar for a prepared grammar. Only the token masks of the vocabulary
+   * are computed, and the optimized grammar is shared with the prepared grammar.
+   */
+  CompiledGrammar CompileGrammar(const PreparedGrammar& prepared_grammar);
+
+  /*!
+   * \brief Compile a prepared grammar for several tokenizers in one run. The token masks of all
+   * the vocabularies are computed in the same task group. The results are not cached.
+   * \param prepared_grammar The prepared grammar.
+   * \param tokenizer_infos The tokenizer infos of the vocabularies.
+   * \param max_threads The maximum number of threads to use.
+   * \return The compiled grammars, one for each tokenizer info.
+   */
+  static std::vector<CompiledGrammar> CompileGrammarForTokenizers(
+      const PreparedGrammar& prepared_grammar,
+      const std::vector<TokenizerInfo>& tokenizer_infos,
+      int max_threads = 8
+  );
+
   /*! \brief Get the compiled grammar for a structural tag. */
   CompiledGrammar CompileStructuralTag(const std::string& structural_tag_json);
 
   /*! \brief Get the compiled grammar for a regex. */
   CompiledGrammar CompileRegex(const std::string& regex);
 
+  /*!
+   * \brief Estimate the cost of compiling a grammar. It only runs the grammar optimization, and
+   * estimates the token masks from the first bytes accepted by every parser state, so it is much
+   * cheaper than the compilation. Useful to queue, reject or route expensive grammars before
+   * compiling them.
+   */
+  CompileCostEstimate EstimateCost(const Grammar& grammar) const;
+
+  /*!
+   * \brief Compile the grammars of a cache manifest into the cache in the background, e.g. the hot
+   * set of the previous deployment exported by ExportCacheManifest. The grammars are compiled by
+   * the executor with the lowest priority, so they only take the idle workers. The entries of
+   * higher priorities are started first. The failed entries are skipped with a warning.
+   *
+   * The manifest is a JSON array of entries. Each entry has a "type" and the fields of the key:
+   * - "json_schema": "schema", "any_whitespace", "indent", "separators", "strict_mode" and
+   *   "max_whitespace_cnt", with the same meaning as the arguments of CompileJSONSchema.
+   * - "structural_tag": "structural_tag_json".
+   * - "grammar": "ebnf_str" and "root_rule_name".
+   * - "regex": "regex".
+   * - "builtin_json_grammar": no fields.
+   * An entry can also have a numeric "priority", e.g. its observed frequency. The default is 0.
+   *
+   * \param manifest_json The JSON string of the manifest.
+   * \throws SerializationError if the manifest is invalid. Nothing is compiled then.
+   * \note Nothing is compiled if the cache is disabled.
+   */
+  void Prewarm(const std::string& manifest_json);
+
+  /*! \brief Wait until the grammars of the previous Prewarm calls are compiled. */
+  void WaitForPrewarm();
+
+  /*!
+   * \brief Export the keys of the compiled grammars in the cache as a manifest for Prewarm. The
+   * entries are ordered from the most recently used one if the cache is limited. The grammars
+   * compiled from PreparedGrammar are not exported.
+   */
+  std::string ExportCacheManifest() const;
+
+  /*!
+   * \brief Compile the grammars with the CompileServer listening at the Unix domain socket, instead
+   * of in this process. The cache of this compiler still applies on top of the cache of the
+   * server. The grammars are compiled in this process if the server is unavailable or fails to
+   * compile them, and the prepared grammars and the compilations under a CompileBudget are always
+   * compiled in this process.
+   * \param socket_path The path of the Unix domain socket of the server.
+   * \param timeout_ms The timeout of every send and receive on the socket. If the server does not
+   * answer in time, e.g. it hangs, the grammar is compiled in this process. 0 means no timeout.
+   * \note It should be called before the compiler is used by other threads.
+   */
+  void SetCompileServer(const std::string& socket_path, int64_t timeout_ms = 60000);
+
+  /*!
+   * \brief Look up the compiled grammars in the SharedGrammarCache before compiling them, and store
+   * the compiled ones into it, so the processes of a host compile a grammar once. It is consulted
+   * after the cache of this compiler. The prepared grammars are not shared.
+   * \note It should be called before the compiler is used by other threads.
+   */
+  void SetSharedCache(const SharedGrammarCache& shared_cache);
+
   /*! \brief Clear the internal cache of compiled grammars. */
   void ClearCache();
 
@@ -110,6 +301,72 @@ class GrammarCompiler {
   XGRAMMAR_DEFINE_PIMPL_METHODS(GrammarCompiler);
 };
 
+/*!
+ * \brief A server compiling grammars for the GrammarCompilers of other processes over a Unix domain
+ * socket, so the worker processes of a host share one compile pool and one cache, and the
+ * compilation does not compete for the cores of the workers. The compiled grammars are returned
+ * in their serialized JSON form. The server keeps a GrammarCompiler for every tokenizer of its
+ * clients. See GrammarCompiler::SetCompileServer.
+ * \note Only supported on POSIX platforms.
+ */
+class CompileServer {
+ public:
+  /*!
+   * \brief Construct a compile server and start listening at the socket. The clients can connect
+   * before Serve() is called.
+   * \param socket_path The path of the Unix domain socket. An existing socket is replaced.
+   * \param max_threads The maximum number of threads to use for compiling a grammar.
+   * \param max_memory_bytes The maximum memory usage of the cache of every tokenizer in bytes. -1
+   * means unlimited.
+   */
+  CompileServer(
+      const std::string& socket_path,
+      int max_threads = 8,
+      int64_t max_memory_bytes = -1  // unlimited
+  );
+
+  /*! \brief Serve the clients until Shutdown() is called. It blocks the calling thread. */
+  void Serve();
+
+  /*!
+   * \brief Stop serving. It can be called from any thread. Serve() returns after the running
+   * compilations finish.
+   */
+  void Shutdown();
+
+  XGRAMMAR_DEFINE_PIMPL_METHODS(CompileServer);
+};
+
+/*!
+ * \brief A cache of compiled grammars in a named POSIX shared memory region, shared by the
+ * GrammarCompilers of all processes of a host. The grammars are stored in their serialized JSON
+ * form and deserialized by the processes reading them. The region has a fixed size, which bounds
+ * the memory of the cache on the host: the newly stored grammars overwrite the oldest ones.
+ * Lookups and insertions are lock-free across processes. See GrammarCompiler::SetSharedCache.
+ * \note Only supported on POSIX platforms.
+ */
+class SharedGrammarCache {
+ public:
+  /*!
+   * \brief Open the shared cache of the name, or create it if it does not exist.
+   * \param name The name of the shared memory region, e.g. "/xgrammar_cache".
+   * \param max_memory_bytes The size of the region in bytes when it is created. An existing region
+   * keeps its size.
+   */
+  SharedGrammarCache(const std::string& name, int64_t max_memory_bytes);
+
+  /*! \brief The size of the shared memory region in bytes. */
+  int64_t MemorySizeBytes() const;
+
+  /*!
+   * \brief Remove the shared cache of the name. The processes that opened it can still use it, and
+   * the memory is released after all of them close it.
+   */
+  static void Remove(const std::string& name);
+
+  XGRAMMAR_DEFINE_PIMPL_METHODS(SharedGrammarCache);
+};
+
 }  // namespace xgrammar
 
 #endif  // XGRAMMAR_COMPILER_H_
@@ -7,7 +7,9 @@
 #ifndef XGRAMMAR_CONFIG_H_
 #define XGRAMMAR_CONFIG_H_
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace xgrammar {
 
@@ -30,6 +32,42 @@ int GetMaxRecursionDepth();
  */
 std::string GetSerializationVersion();
 
+/*!
+ * \brief Get the number of CPUs the process can use. On Linux, it is the number of CPUs in the
+ * affinity mask of the process, further limited by the CPU quota of the cgroup. If a worker CPU
+ * list is set, it is the size of the list. Falls back to std::thread::hardware_concurrency(). The
+ * result is at least 1. The "auto" thread counts are derived from it.
+ */
+int32_t GetAvailableCPUCount();
+
+/*!
+ * \brief Set the CPUs the worker threads of XGrammar are pinned to. The i-th worker of a thread
+ * pool is pinned to cpu_ids[i % cpu_ids.size()]. An empty list disables pinning. It only affects
+ * the thread pools created afterwards.
+ * \param cpu_ids The CPU ids.
+ */
+void SetWorkerCPUAffinity(const std::vector<int32_t>& cpu_ids);
+
+/*!
+ * \brief Get the CPUs the worker threads are pinned to.
+ * \return The CPU ids. Empty if the worker threads are not pinned.
+ */
+std::vector<int32_t> GetWorkerCPUAffinity();
+
+/*!
+ * \brief Set the number of worker threads of the executor shared by the compilers and the batch
+ * matchers of the process, i.e. their total core budget. The decoding tasks of the batch matchers
+ * take priority over the queued compiling tasks. Default is GetAvailableCPUCount().
+ * \param num_threads The number of worker threads.
+ */
+void SetExecutorNumThreads(int32_t num_threads);
+
+/*!
+ * \brief Get the number of worker threads of the shared executor.
+ * \return The number of worker threads.
+ */
+int32_t GetExecutorNumThreads();
+
 }  // namespace xgrammar
 
 #endif  // XGRAMMAR_CONFIG_H_
@@ -50,6 +50,27 @@ struct InvalidStructuralTagError : std::runtime_error {
       : std::runtime_error(std::string("Invalid structural tag error: ") + message) {}
 };
 
+/*!
+ * \brief Exception thrown when a compilation is cancelled, passes its deadline or exceeds its
+ * memory or FSM state budget. See CompileBudget.
+ */
+struct CompileBudgetExceededError : std::runtime_error {
+  /*! \brief The reason why the compilation is stopped. */
+  enum class Reason : int {
+    kCancelled = 0,
+    kDeadline = 1,
+    kMemory = 2,
+    kFSMStates = 3,
+  };
+
+  CompileBudgetExceededError(Reason reason, const std::string& message)
+      : std::runtime_error(std::string("Compile budget exceeded error: ") + message),
+        reason(reason) {}
+
+  /*! \brief The reason why the compilation is stopped. */
+  Reason reason;
+};
+
 /************** Union Exceptions **************/
 
 /*!
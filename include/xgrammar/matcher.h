@@ -91,6 +91,16 @@ class GrammarMatcher {
    */
   bool AcceptToken(int32_t token_id, bool debug_print = false);
 
+  /*!
+   * \brief Accept a sequence of tokens in order, e.g. the draft tokens in speculative decoding.
+   * Stops at the first rejected token. Each accepted token is one step in rollback, so the
+   * accepted prefix can be rolled back by Rollback(num_accepted).
+   * \param token_ids The ids of the tokens to accept.
+   * \param debug_print Whether to print information about the internal state of the matcher.
+   * \return The number of accepted tokens, i.e. the length of the accepted prefix.
+   */
+  int32_t AcceptTokens(const std::vector<int32_t>& token_ids, bool debug_print = false);
+
   /*!
    * \brief Accept a string and update the state of the matcher. The whole string is considered
    * as one step in rollback. It is used to complement the functionality of AcceptToken, and
@@ -138,6 +148,12 @@ class GrammarMatcher {
 
   const std::vector<int>& GetStopTokenIds() const;
 
+  /*!
+   * \brief Return the approximate memory usage of the matcher in bytes. The compiled grammar and
+   * the tokenizer info shared with other matchers are not counted.
+   */
+  std::size_t MemorySizeBytes() const;
+
   /*! \brief Print the internal state of the matcher. This is only used for debugging. The
    * representation of the internal state is subject to change.
    */
@@ -146,6 +162,25 @@ class GrammarMatcher {
   XGRAMMAR_DEFINE_PIMPL_METHODS(GrammarMatcher);
 };
 
+/*!
+ * \brief The completion handle of an asynchronous operation submitted to BatchGrammarMatcher.
+ * \sa BatchGrammarMatcher::SubmitAcceptAndFill
+ */
+class BatchCompletionHandle {
+ public:
+  /*!
+   * \brief Block until the operation finishes. The error raised by the operation, if any, is
+   * rethrown here.
+   * \return A vector of bytes indicating whether each token is accepted.
+   */
+  std::vector<uint8_t> Wait() const;
+
+  /*! \brief Check whether the operation has finished without blocking. */
+  bool IsReady() const;
+
+  XGRAMMAR_DEFINE_PIMPL_METHODS(BatchCompletionHandle);
+};
+
 /*!
  * \brief A batched version of GrammarMatcher for better efficiency. It supports batch processing
  * of multiple GrammarMatcher objects in parallel.
@@ -201,9 +236,123 @@ class BatchGrammarMatcher {
       bool debug_print = false
   );
 
+  /*!
+   * \brief A batched version of AcceptTokens. The matchers accept their tokens in parallel with
+   * up to max_threads threads.
+   * \param matchers The array of GrammarMatcher objects.
+   * \param token_ids The token sequences to be accepted, one for each matcher.
+   * \param debug_print Whether to print debug information. Default is false.
+   * \return The number of accepted tokens of each matcher.
+   */
+  std::vector<int32_t> BatchAcceptTokens(
+      std::vector<GrammarMatcher>* matchers,
+      const std::vector<std::vector<int32_t>>& token_ids,
+      bool debug_print = false
+  );
+
+  /*!
+   * \brief Accept the sampled tokens and fill the bitmasks of the next step without blocking, so
+   * the grammar work overlaps with the model. The operations submitted to the same
+   * BatchGrammarMatcher run one after another in the order of submission, so each matcher sees
+   * its tokens in order. The matchers should not be used elsewhere until the operation finishes.
+   * \param matchers The array of GrammarMatcher objects.
+   * \param token_ids The token to accept for each matcher.
+   * \param next_token_bitmask The pre-allocated DLTensor to store the result bitmasks. Its data
+   * must stay valid until the operation finishes. With two bitmask buffers used in turn, the
+   * bitmask of the current step can be applied while the next one is being filled.
+   * \param indices The optional array of indices of the bitmask rows, same as
+   * BatchFillNextTokenBitmask.
+   * \param debug_print Whether to print debug information. Default is false.
+   * \return The handle to wait on or poll. The matchers terminated by their tokens do not fill
+   * the bitmask; the matchers rejecting their tokens fill the bitmask from the unchanged state.
+   */
+  BatchCompletionHandle SubmitAcceptAndFill(
+      const std::vector<GrammarMatcher>& matchers,
+      const std::vector<int32_t>& token_ids,
+      DLTensor* next_token_bitmask,
+      const std::optional<std::vector<int32_t>>& indices = std::nullopt,
+      bool debug_print = false
+  );
+
   XGRAMMAR_DEFINE_PIMPL_METHODS(BatchGrammarMatcher);
 };
 
+/*!
+ * \brief A persistent group of GrammarMatcher objects for batched serving.
+ *
+ * \details Matchers are added to the group once and addressed by their slot ids afterwards, so the
+ * batched methods do not rebuild the list of matchers on every decoding step. The slot ids, token
+ * ids and bitmask indices are passed as 1D int32 DLTensors on CPU, and are read without copying.
+ * The slots of removed matchers are reused by later added matchers. The group itself is not
+ * thread-safe.
+ */
+class MatcherGroup {
+ public:
+  /*!
+   * \brief Construct the matcher group.
+   * \param max_threads The maximum number of threads used by BatchFillNextTokenBitmask. "auto"
+   * means half of GetAvailableCPUCount().
+   */
+  MatcherGroup(std::variant<std::string, int32_t> max_threads = "auto");
+
+  /*!
+   * \brief Add a matcher to the group.
+   * \return The slot id of the matcher.
+   */
+  int32_t AddMatcher(const GrammarMatcher& matcher);
+
+  /*! \brief Replace the matcher in the given slot. */
+  void SetMatcher(int32_t slot, const GrammarMatcher& matcher);
+
+  /*! \brief Remove the matcher in the given slot. The slot can be reused by AddMatcher. */
+  void RemoveMatcher(int32_t slot);
+
+  /*! \brief Get the matcher in the given slot. It shares the state with the one in the group. */
+  GrammarMatcher GetMatcher(int32_t slot) const;
+
+  /*! \brief Get the number of matchers in the group. */
+  int32_t NumMatchers() const;
+
+  /*!
+   * \brief Fill the next token bitmasks of the matchers in the given slots in parallel.
+   * \param slots The slot ids of the matchers. A slot can appear at most once.
+   * \param next_token_bitmask The pre-allocated DLTensor to store the result bitmasks.
+   * \param indices The optional rows of the bitmask to fill for each slot. If not provided,
+   * slots[i] fills the row i.
+   * \param debug_print Whether to print debug information. Default is false.
+   */
+  void BatchFillNextTokenBitmask(
+      const DLTensor& slots,
+      DLTensor* next_token_bitmask,
+      const DLTensor* indices = nullptr,
+      bool debug_print = false
+  );
+
+  /*!
+   * \brief Accept a token for each of the matchers in the given slots.
+   * \param slots The slot ids of the matchers. A slot can appear at most once.
+   * \param token_ids The token ids to accept, one for each slot.
+   * \param debug_print Whether to print debug information. Default is false.
+   * \return A vector of bytes indicating whether each token is accepted.
+   */
+  std::vector<uint8_t> BatchAcceptToken(
+      const DLTensor& slots, const DLTensor& token_ids, bool debug_print = false
+  );
+
+  /*!
+   * \brief Accept a string for each of the matchers in the given slots.
+   * \param slots The slot ids of the matchers. A slot can appear at most once.
+   * \param input_strs The strings to accept, one for each slot.
+   * \param debug_print Whether to print debug information. Default is false.
+   * \return A vector of bytes indicating whether each string is accepted.
+   */
+  std::vector<uint8_t> BatchAcceptString(
+      const DLTensor& slots, const std::vector<std::string>& input_strs, bool debug_print = false
+  );
+
+  XGRAMMAR_DEFINE_PIMPL_METHODS(MatcherGroup);
+};
+
 }  // namespace xgrammar
 
 #endif  // XGRAMMAR_MATCHER_H_
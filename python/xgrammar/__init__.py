@@ -1,13 +1,27 @@
 from . import exception, structural_tag, testing
-from .compiler import CompiledGrammar, GrammarCompiler
+from .compiler import (
+    CompileBudget,
+    CompileCostEstimate,
+    CompiledGrammar,
+    CompileServer,
+    GrammarCompiler,
+    PreparedGrammar,
+    SharedGrammarCache,
+)
 from .config import (
+    get_available_cpu_count,
+    get_executor_num_threads,
     get_max_recursion_depth,
     get_serialization_version,
+    get_worker_cpu_affinity,
     max_recursion_depth,
+    set_executor_num_threads,
     set_max_recursion_depth,
+    set_worker_cpu_affinity,
 )
 from .contrib import hf
 from .exception import (
+    CompileBudgetExceededError,
     DeserializeFormatError,
     DeserializeVersionError,
     InvalidJSONError,
@@ -15,8 +29,10 @@ from .exception import (
 )
 from .grammar import Grammar, StructuralTagItem
 from .matcher import (
+    BatchCompletionHandle,
     BatchGrammarMatcher,
     GrammarMatcher,
+    MatcherGroup,
     allocate_token_bitmask,
     apply_token_bitmask_inplace,
     bitmask_dtype,
@@ -30,21 +46,32 @@ __all__ = [
     "exception",
     "structural_tag",
     "testing",
+    "CompileBudget",
+    "CompileCostEstimate",
     "CompiledGrammar",
     "GrammarCompiler",
+    "PreparedGrammar",
+    "get_available_cpu_count",
+    "get_executor_num_threads",
     "get_max_recursion_depth",
     "get_serialization_version",
+    "get_worker_cpu_affinity",
     "max_recursion_depth",
+    "set_executor_num_threads",
     "set_max_recursion_depth",
+    "set_worker_cpu_affinity",
     "hf",
+    "CompileBudgetExceededError",
     "DeserializeFormatError",
     "DeserializeVersionError",
     "InvalidJSONError",
     "InvalidStructuralTagError",
     "Grammar",
     "StructuralTagItem",
+    "BatchCompletionHandle",
     "BatchGrammarMatcher",
     "GrammarMatcher",
+    "MatcherGroup",
     "allocate_token_bitmask",
     "apply_token_bitmask_inplace",
     "bitmask_dtype",
@@ -1,6 +1,8 @@
 """Compiling grammar for efficient token mask generation."""
 
-from typing import Any, Dict, List, Optional, Tuple, Type, Union, overload
+import json
+import threading
+from typing import Any, Dict, List, NamedTuple, Optional, Tuple, Type, Union, overload
 
 from pydantic import BaseModel
 from typing_extensions import deprecated
@@ -97,6 +99,228 @@ class CompiledGrammar(XGRObject):
         )
 
 
+class PreparedGrammar(XGRObject):
+    """The tokenizer-independent stage of a compiled grammar: the optimized grammar with the FSMs
+    of its rules, the bytes that can start and follow each rule, and the parser states whose token
+    masks are computed.
+
+    It is computed once and can be compiled by the :class:`GrammarCompiler` of every tokenizer,
+    e.g. when several models with different tokenizers serve the same schemas. Then the
+    conversion and the optimization of the grammar are not repeated for every model, and only the
+    token masks are computed.
+
+    Examples
+    --------
+    >>> prepared_grammar = xgr.PreparedGrammar.from_grammar(xgr.Grammar.from_json_schema(schema))
+    >>> compiled_grammar_a = compiler_a.compile_grammar(prepared_grammar)
+    >>> compiled_grammar_b = compiler_b.compile_grammar(prepared_grammar)
+    """
+
+    @staticmethod
+    def from_grammar(grammar: Grammar) -> "PreparedGrammar":
+        """Run the tokenizer-independent stage of the compilation of a grammar.
+
+        Parameters
+        ----------
+        grammar : Grammar
+            The grammar to prepare.
+
+        Returns
+        -------
+        prepared_grammar : PreparedGrammar
+            The prepared grammar.
+        """
+        return PreparedGrammar._create_from_handle(
+            _core.PreparedGrammar.from_grammar(grammar._handle)
+        )
+
+    @property
+    def grammar(self) -> Grammar:
+        """The optimized grammar."""
+        return Grammar._create_from_handle(self._handle.grammar)
+
+    @property
+    def num_token_mask_states(self) -> int:
+        """The number of parser states whose token masks are computed for every tokenizer."""
+        return self._handle.num_token_mask_states
+
+    @property
+    def memory_size_bytes(self) -> int:
+        """The approximate memory usage of the prepared grammar in bytes."""
+        return self._handle.memory_size_bytes
+
+
+class CompileCostEstimate(NamedTuple):
+    """The estimated cost of compiling a grammar. See :meth:`GrammarCompiler.estimate_cost`."""
+
+    num_mask_states: int
+    """The number of parser states whose token masks are computed."""
+
+    num_token_checks: int
+    """The number of tokens matched against the parser states, summed over the states. This is
+    the main work of the compilation."""
+
+    num_uncertain_tokens: int
+    """The expected number of uncertain tokens, summed over the states. They are checked by the
+    parser when generating the token masks."""
+
+    memory_bytes: int
+    """The estimated memory of the compiled grammar in bytes."""
+
+    compile_time_ms: float
+    """The estimated compilation time in milliseconds with a single thread. It comes from heuristic
+    per-state and per-token costs, so it is only meaningful to compare grammars."""
+
+
+class CompileBudget(XGRObject):
+    """The cancellation token, deadline and resource budgets of grammar compilations.
+
+    The budget is applied to the compilations started in the ``with`` block in the current thread,
+    and is checked cooperatively in the JSON schema converter, the grammar optimizer, the FSM
+    construction and the token mask computation. When the budget is cancelled or exceeded, the
+    compilation raises :class:`xgrammar.exception.CompileBudgetExceededError`, whose ``reason``
+    attribute is one of ``"cancelled"``, ``"deadline"``, ``"memory"`` and ``"fsm_states"``. The
+    failed compilation is not cached, so it can be compiled again with a new budget.
+
+    Examples
+    --------
+    >>> budget = xgr.CompileBudget(timeout_ms=1000)
+    >>> with budget:
+    ...     compiled_grammar = compiler.compile_json_schema(schema)
+    >>> # In another thread: budget.cancel()
+    """
+
+    def __init__(
+        self, *, timeout_ms: int = -1, max_memory_bytes: int = -1, max_fsm_states: int = -1
+    ):
+        """Construct the budget.
+
+        Parameters
+        ----------
+        timeout_ms : int, default: -1
+            The timeout in milliseconds from the construction. -1 means no deadline.
+
+        max_memory_bytes : int, default: -1
+            The maximum bytes of the token mask cache. -1 means unlimited.
+
+        max_fsm_states : int, default: -1
+            The maximum number of states of the rule FSMs. -1 means unlimited.
+        """
+        self._init_handle(_core.CompileBudget(timeout_ms, max_memory_bytes, max_fsm_states))
+        self._scopes = threading.local()
+
+    def cancel(self) -> None:
+        """Cancel the compilations using this budget. It can be called from any thread."""
+        self._handle.cancel()
+
+    def is_cancelled(self) -> bool:
+        """Whether the budget is cancelled."""
+        return self._handle.is_cancelled()
+
+    @property
+    def memory_bytes(self) -> int:
+        """The bytes of the token mask cache computed under this budget."""
+        return self._handle.memory_bytes
+
+    @property
+    def fsm_states(self) -> int:
+        """The number of FSM states built under this budget."""
+        return self._handle.fsm_states
+
+    def __enter__(self) -> "CompileBudget":
+        if not hasattr(self._scopes, "stack"):
+            self._scopes.stack = []
+        self._scopes.stack.append(_core.CompileBudgetScope(self._handle))
+        return self
+
+    def __exit__(self, *args) -> None:
+        # Destroying the scope restores the previous budget of the current thread.
+        self._scopes.stack.pop()
+
+
+class CompileServer(XGRObject):
+    """A server compiling grammars for the :class:`GrammarCompiler` of other processes over a
+    Unix domain socket, so the worker processes of a host share one compile pool and one cache,
+    and the compilation does not compete for the cores of the workers. The server keeps a
+    compiler for every tokenizer of its clients. See :meth:`GrammarCompiler.set_compile_server`.
+    Only supported on POSIX platforms.
+
+    The server can also be started with the ``xgrammar_compile_server`` executable, built with
+    the ``XGRAMMAR_BUILD_COMPILE_SERVER`` CMake option.
+
+    Examples
+    --------
+    >>> server = xgr.CompileServer("/tmp/xgrammar.sock")
+    >>> threading.Thread(target=server.serve).start()
+    >>> # In the worker processes:
+    >>> compiler.set_compile_server("/tmp/xgrammar.sock")
+    """
+
+    def __init__(self, socket_path: str, *, max_threads: int = 8, max_memory_bytes: int = -1):
+        """Construct the server and start listening at the socket.
+
+        Parameters
+        ----------
+        socket_path : str
+            The path of the Unix domain socket. An existing socket is replaced.
+
+        max_threads : int, default: 8
+            The maximum number of threads to use for compiling a grammar.
+
+        max_memory_bytes : int, default: -1
+            The maximum memory usage of the cache of every tokenizer in bytes. -1 means
+            unlimited.
+        """
+        self._init_handle(_core.CompileServer(socket_path, max_threads, max_memory_bytes))
+
+    def serve(self) -> None:
+        """Serve the clients until :meth:`shutdown` is called. It blocks the calling thread."""
+        self._handle.serve()
+
+    def shutdown(self) -> None:
+        """Stop serving. It can be called from any thread."""
+        self._handle.shutdown()
+
+
+class SharedGrammarCache(XGRObject):
+    """A cache of compiled grammars in a named POSIX shared memory region, shared by the
+    :class:`GrammarCompiler` of all processes of a host, so a grammar is compiled once per host.
+    The grammars are stored in their serialized form. The region has a fixed size, which bounds the
+    memory of the cache on the host: the newly stored grammars overwrite the oldest ones. See
+    :meth:`GrammarCompiler.set_shared_cache`. Only supported on POSIX platforms.
+
+    Examples
+    --------
+    >>> # In every worker process:
+    >>> shared_cache = xgr.SharedGrammarCache("/xgrammar_cache", 1 << 30)
+    >>> compiler.set_shared_cache(shared_cache)
+    """
+
+    def __init__(self, name: str, max_memory_bytes: int):
+        """Open the shared cache of the name, or create it if it does not exist.
+
+        Parameters
+        ----------
+        name : str
+            The name of the shared memory region, e.g. ``"/xgrammar_cache"``.
+
+        max_memory_bytes : int
+            The size of the region in bytes when it is created. An existing region keeps its size.
+        """
+        self._init_handle(_core.SharedGrammarCache(name, max_memory_bytes))
+
+    @property
+    def memory_size_bytes(self) -> int:
+        """The size of the shared memory region in bytes."""
+        return self._handle.memory_size_bytes
+
+    @staticmethod
+    def remove(name: str) -> None:
+        """Remove the shared cache of the name. The processes that opened it can still use it,
+        and the memory is released after all of them close it."""
+        _core.SharedGrammarCache.remove(name)
+
+
 class GrammarCompiler(XGRObject):
     """The compiler for grammars. It is associated with a certain tokenizer info, and compiles
     grammars into CompiledGrammar with the tokenizer info. It allows parallel compilation with
@@ -120,7 +344,9 @@ class GrammarCompiler(XGRObject):
             The tokenizer info.
 
         max_threads : int, default: 8
-            The maximum number of threads used to compile the grammar.
+            The maximum number of threads used to compile the grammar. The threads are taken from
+            the executor shared with the batch matchers (see xgrammar.set_executor_num_threads),
+            with a lower priority than the bitmask generation.
 
         cache_enabled : bool, default: True
             Whether to enable the cache.
@@ -287,8 +513,11 @@ class GrammarCompiler(XGRObject):
     @overload
     def compile_grammar(self, grammar: Grammar) -> CompiledGrammar: ...
 
+    @overload
+    def compile_grammar(self, grammar: PreparedGrammar) -> CompiledGrammar: ...
+
     def compile_grammar(
-        self, grammar: Union[str, Grammar], *, root_rule_name: str = "root"
+        self, grammar: Union[str, Grammar, PreparedGrammar], *, root_rule_name: str = "root"
     ) -> CompiledGrammar:
         """Compile a grammar object.
 
@@ -301,14 +530,17 @@ class GrammarCompiler(XGRObject):
         2. ``compile_grammar(grammar: Grammar) -> CompiledGrammar``
             - Compile a grammar from a Grammar object.
 
+        3. ``compile_grammar(grammar: PreparedGrammar) -> CompiledGrammar``
+            - Compile a prepared grammar. Only the token masks of the tokenizer are computed.
+
         Parameters
         ----------
         ebnf_string : str
             The grammar string in EBNF format.
         root_rule_name : str, default: "root"
             The name of the root rule in the grammar.
-        grammar : Union[str, Grammar]
-            The grammar string or Grammar object.
+        grammar : Union[str, Grammar, PreparedGrammar]
+            The grammar string, Grammar object or PreparedGrammar object.
 
         Returns
         -------
@@ -319,11 +551,164 @@ class GrammarCompiler(XGRObject):
             return CompiledGrammar._create_from_handle(
                 self._handle.compile_grammar(grammar, root_rule_name)
             )
+        elif isinstance(grammar, PreparedGrammar):
+            return CompiledGrammar._create_from_handle(
+                self._handle.compile_prepared_grammar(grammar._handle)
+            )
         else:
             return CompiledGrammar._create_from_handle(
                 self._handle.compile_grammar(grammar._handle)
             )
 
+    @staticmethod
+    def compile_grammar_for_tokenizers(
+        grammar: Union[Grammar, PreparedGrammar],
+        tokenizer_infos: List[TokenizerInfo],
+        *,
+        max_threads: int = 8,
+    ) -> List[CompiledGrammar]:
+        """Compile a grammar for several tokenizers in one run. The tokenizer-independent stage
+        runs once, and the token masks of all the tokenizers are computed in the same task group.
+        The results are not cached.
+
+        Parameters
+        ----------
+        grammar : Union[Grammar, PreparedGrammar]
+            The grammar, or the prepared grammar.
+
+        tokenizer_infos : List[TokenizerInfo]
+            The tokenizer infos of the vocabularies.
+
+        max_threads : int, default: 8
+            The maximum number of threads used to compute the token masks.
+
+        Returns
+        -------
+        compiled_grammars : List[CompiledGrammar]
+            The compiled grammars, one for each tokenizer info.
+        """
+        if isinstance(grammar, Grammar):
+            grammar = PreparedGrammar.from_grammar(grammar)
+        return [
+            CompiledGrammar._create_from_handle(handle)
+            for handle in _core.GrammarCompiler.compile_grammar_for_tokenizers(
+                grammar._handle, [info._handle for info in tokenizer_infos], max_threads
+            )
+        ]
+
+    def estimate_cost(
+        self, grammar: Union[str, Grammar], *, root_rule_name: str = "root"
+    ) -> CompileCostEstimate:
+        """Estimate the cost of compiling a grammar without computing the token masks. It only
+        runs the grammar optimization, so it is much cheaper than the compilation. Useful to queue,
+        reject or route expensive grammars before compiling them. Use
+        :meth:`Grammar.from_json_schema` etc. to estimate other kinds of grammars.
+
+        Parameters
+        ----------
+        grammar : Union[str, Grammar]
+            The grammar string in EBNF format, or the Grammar object.
+
+        root_rule_name : str, default: "root"
+            The name of the root rule when the grammar is an EBNF string.
+
+        Returns
+        -------
+        estimate : CompileCostEstimate
+            The estimated cost.
+        """
+        if isinstance(grammar, str):
+            grammar = Grammar.from_ebnf(grammar, root_rule_name=root_rule_name)
+        estimate = self._handle.estimate_cost(grammar._handle)
+        return CompileCostEstimate(
+            estimate.num_mask_states,
+            estimate.num_token_checks,
+            estimate.num_uncertain_tokens,
+            estimate.memory_bytes,
+            estimate.compile_time_ms,
+        )
+
+    def prewarm(self, manifest: Union[str, List[Dict[str, Any]]]) -> None:
+        """Compile the grammars of a cache manifest into the cache in the background, e.g. the
+        hot set of the previous deployment exported by :meth:`export_cache_manifest`. The grammars
+        are compiled by the idle worker threads with the lowest priority. The entries of higher
+        priorities are started first, and the failed entries are skipped with a warning.
+
+        Each entry of the manifest has a ``"type"`` and the fields of the key:
+
+        - ``"json_schema"``: ``"schema"``, ``"any_whitespace"``, ``"indent"``, ``"separators"``,
+          ``"strict_mode"`` and ``"max_whitespace_cnt"``, as in :meth:`compile_json_schema`.
+        - ``"structural_tag"``: ``"structural_tag_json"``.
+        - ``"grammar"``: ``"ebnf_str"`` and ``"root_rule_name"``.
+        - ``"regex"``: ``"regex"``.
+        - ``"builtin_json_grammar"``: no fields.
+
+        An entry can also have a numeric ``"priority"``, e.g. its observed frequency. The default
+        is 0. Nothing is compiled if the cache is disabled.
+
+        Parameters
+        ----------
+        manifest : Union[str, List[Dict[str, Any]]]
+            The manifest, or its JSON string.
+
+        Raises
+        ------
+        RuntimeError
+            When the manifest is invalid. Nothing is compiled then.
+        """
+        if not isinstance(manifest, str):
+            manifest = json.dumps(manifest)
+        self._handle.prewarm(manifest)
+
+    def wait_for_prewarm(self) -> None:
+        """Wait until the grammars of the previous :meth:`prewarm` calls are compiled."""
+        self._handle.wait_for_prewarm()
+
+    def export_cache_manifest(self) -> str:
+        """Export the keys of the compiled grammars in the cache as a manifest for
+        :meth:`prewarm`, so a running instance can snapshot its hot set for the next deployment.
+        The entries are ordered from the most recently used one if the cache has a memory limit.
+        The grammars compiled from :class:`PreparedGrammar` are not exported.
+
+        Returns
+        -------
+        manifest : str
+            The JSON string of the manifest.
+        """
+        return self._handle.export_cache_manifest()
+
+    def set_compile_server(self, socket_path: str, timeout_ms: int = 60000) -> None:
+        """Compile the grammars with the :class:`CompileServer` listening at the Unix domain
+        socket, instead of in this process. The cache of this compiler still applies. The grammars
+        are compiled in this process if the server is unavailable or fails to compile them, and
+        the prepared grammars and the compilations under a :class:`CompileBudget` are always
+        compiled in this process. It should be called before the compiler is used by other
+        threads.
+
+        Parameters
+        ----------
+        socket_path : str
+            The path of the Unix domain socket of the server.
+
+        timeout_ms : int, default: 60000
+            The timeout of every send and receive on the socket. If the server does not answer in
+            time, e.g. it hangs, the grammar is compiled in this process. 0 means no timeout.
+        """
+        self._handle.set_compile_server(socket_path, timeout_ms)
+
+    def set_shared_cache(self, shared_cache: SharedGrammarCache) -> None:
+        """Look up the compiled grammars in the :class:`SharedGrammarCache` before compiling them,
+        and store the compiled ones into it, so the processes of a host compile a grammar once. It
+        is consulted after the cache of this compiler. The prepared grammars are not shared. It
+        should be called before the compiler is used by other threads.
+
+        Parameters
+        ----------
+        shared_cache : SharedGrammarCache
+            The shared cache.
+        """
+        self._handle.set_shared_cache(shared_cache._handle)
+
     def clear_cache(self) -> None:
         """Clear all cached compiled grammars."""
         self._handle.clear_cache()
@@ -1,6 +1,7 @@
 """Global configuration for XGrammar."""
 
 from contextlib import contextmanager
+from typing import List
 
 from .base import _core
 
@@ -62,3 +63,70 @@ def get_serialization_version() -> str:
         The serialization version number.
     """
     return _core.config.get_serialization_version()
+
+
+def get_available_cpu_count() -> int:
+    """Get the number of CPUs the process can use. On Linux, it is the number of CPUs in the
+    affinity mask of the process, further limited by the CPU quota of the cgroup. If a worker
+    CPU list is set via :py:func:`set_worker_cpu_affinity`, it is the size of the list. The
+    "auto" thread counts of the batch matchers are derived from it.
+
+    Returns
+    -------
+    available_cpu_count : int
+        The number of available CPUs. At least 1.
+    """
+    return _core.config.get_available_cpu_count()
+
+
+def set_worker_cpu_affinity(cpu_ids: List[int]) -> None:
+    """Pin the worker threads of XGrammar, i.e. the threads of GrammarCompiler,
+    BatchGrammarMatcher and MatcherGroup, to the given CPUs. The i-th worker of a thread pool is
+    pinned to ``cpu_ids[i % len(cpu_ids)]``, so the memory it touches first is placed on the NUMA
+    node of that CPU. It only affects the thread pools created afterwards. Pinning is only
+    supported on Linux, and is ignored on the other platforms.
+
+    Parameters
+    ----------
+    cpu_ids : List[int]
+        The CPU ids. An empty list disables pinning.
+    """
+    _core.config.set_worker_cpu_affinity(cpu_ids)
+
+
+def get_worker_cpu_affinity() -> List[int]:
+    """Get the CPUs the worker threads are pinned to.
+
+    Returns
+    -------
+    cpu_ids : List[int]
+        The CPU ids. Empty if the worker threads are not pinned.
+    """
+    return _core.config.get_worker_cpu_affinity()
+
+
+def set_executor_num_threads(num_threads: int) -> None:
+    """Set the number of worker threads of the executor shared by all GrammarCompiler,
+    BatchGrammarMatcher and MatcherGroup objects of the process, i.e. their total core budget.
+    The max_threads of each object limits how many of the workers it uses at the same time.
+    The decoding tasks of the batch matchers take priority over the queued compiling tasks, so a
+    large background compilation does not delay the bitmask generation. The default is
+    :py:func:`get_available_cpu_count`.
+
+    Parameters
+    ----------
+    num_threads : int
+        The number of worker threads. Should be at least 1.
+    """
+    _core.config.set_executor_num_threads(num_threads)
+
+
+def get_executor_num_threads() -> int:
+    """Get the number of worker threads of the shared executor.
+
+    Returns
+    -------
+    num_threads : int
+        The number of worker threads.
+    """
+    return _core.config.get_executor_num_threads()
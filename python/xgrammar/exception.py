@@ -18,9 +18,17 @@ if TYPE_CHECKING or isinstance(_core, str):
     class InvalidStructuralTagError(RuntimeError):
         """Raised when the structural tag is invalid."""
 
+    class CompileBudgetExceededError(RuntimeError):
+        """Raised when the compilation is cancelled, passes its deadline or exceeds its budget.
+        The ``reason`` attribute is one of ``"cancelled"``, ``"deadline"``, ``"memory"`` and
+        ``"fsm_states"``."""
+
+        reason: str
+
 else:
     # real implementation here
     DeserializeFormatError = _core.exception.DeserializeFormatError
     DeserializeVersionError = _core.exception.DeserializeVersionError
     InvalidJSONError = _core.exception.InvalidJSONError
     InvalidStructuralTagError = _core.exception.InvalidStructuralTagError
+    CompileBudgetExceededError = _core.exception.CompileBudgetExceededError
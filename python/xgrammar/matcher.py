@@ -287,6 +287,29 @@ class GrammarMatcher(XGRObject):
         """
         return self._handle.accept_token(token_id, debug_print)
 
+    def accept_tokens(self, token_ids: List[int], *, debug_print: bool = False) -> int:
+        """Accept a sequence of tokens in order, e.g. the draft tokens in speculative decoding.
+        Accepting stops at the first token that is not accepted (see accept_token).
+
+        Every accepted token is one step in rollback, so the accepted tokens can be rolled back
+        with rollback(num_accepted).
+
+        Parameters
+        ----------
+        token_ids : List[int]
+            The ids of the tokens to accept.
+
+        debug_print : bool, default: False
+            Whether to print information about the internal state of the matcher. Helpful
+            for debugging.
+
+        Returns
+        -------
+        num_accepted : int
+            The number of accepted tokens, i.e. the length of the accepted prefix of token_ids.
+        """
+        return self._handle.accept_tokens(token_ids, debug_print)
+
     def accept_string(self, input_str: Union[str, bytes], *, debug_print: bool = False) -> bool:
         """Accept a string and update the state of the matcher. The whole string is considered
         as one step in rollback. It is used to complement the functionality of accept_token, and
@@ -408,6 +431,13 @@ class GrammarMatcher(XGRObject):
         """
         return self._handle.stop_token_ids
 
+    @property
+    def memory_size_bytes(self) -> int:
+        """The approximate memory usage of the matcher in bytes. The compiled grammar and the
+        tokenizer info shared with other matchers are not counted.
+        """
+        return self._handle.memory_size_bytes
+
     def _debug_print_internal_state(self) -> str:
         """Print the internal state of the matcher. This is used for debugging. The
         representation of the internal state is subject to change.
@@ -420,6 +450,33 @@ class GrammarMatcher(XGRObject):
         return self._handle._debug_print_internal_state()
 
 
+class BatchCompletionHandle(XGRObject):
+    """The completion handle of an asynchronous operation of BatchGrammarMatcher. It keeps the
+    bitmask written by the operation alive until the operation finishes.
+    """
+
+    def __init__(self, handle, bitmask: ArrayLike) -> None:
+        self._init_handle(handle)
+        self._bitmask = bitmask
+
+    def wait(self) -> List[bool]:
+        """Block until the operation finishes. The error raised by the operation, if any, is
+        raised here.
+
+        Returns
+        -------
+        accepted : List[bool]
+            Whether each token was accepted by its corresponding matcher.
+        """
+        accepted = self._handle.wait()
+        self._bitmask = None
+        return accepted
+
+    def is_ready(self) -> bool:
+        """Check whether the operation has finished without blocking."""
+        return self._handle.is_ready()
+
+
 class BatchGrammarMatcher(XGRObject):
     """A batch version of GrammarMatcher that can fill the next token bitmask for multiple
     matchers in parallel. It utilizes multiple threads to speed up the computation. It is
@@ -433,7 +490,8 @@ class BatchGrammarMatcher(XGRObject):
         ----------
         max_threads : Union[int, Literal["auto"]], default: "auto"
             The maximum number of threads to use for parallel processing. If set to "auto", the
-            max_threads will be set to std::thread::hardware_concurrency() / 2.
+            max_threads will be set to half of xgrammar.get_available_cpu_count(), which respects
+            the CPU affinity and the cgroup CPU quota of the process.
         """
 
         self._init_handle(_core.BatchGrammarMatcher(max_threads))
@@ -474,6 +532,52 @@ class BatchGrammarMatcher(XGRObject):
 
         self._handle.batch_fill_next_token_bitmask(matcher_handles, bitmask, indices, debug_print)
 
+    def submit_accept_and_fill(
+        self,
+        matchers: List["GrammarMatcher"],
+        tokens: List[int],
+        bitmask: ArrayLike,
+        indices: Optional[List[int]] = None,
+        debug_print: bool = False,
+    ) -> BatchCompletionHandle:
+        """Accept the sampled tokens and fill the bitmasks of the next step in the background,
+        so the grammar work overlaps with the model forward. The operations submitted to the same
+        BatchGrammarMatcher run in the order of submission. The matchers should not be used
+        elsewhere until the operation finishes.
+
+        Two bitmasks can be used in turn: the bitmask of the current step is applied to the
+        logits while the bitmask of the next step is being filled.
+
+        Parameters
+        ----------
+        matchers : List[GrammarMatcher]
+            The list of matchers.
+
+        tokens : List[int]
+            The token to accept for each matcher.
+
+        bitmask : ArrayLike
+            The bitmask to fill, same as batch_fill_next_token_bitmask. The matchers terminated by
+            their tokens do not fill their rows. The matchers rejecting their tokens fill their
+            rows from the unchanged state.
+
+        indices : Optional[List[int]], default: None
+            The rows in the bitmask to fill. If None, fill the bitmask [0:len(matchers)).
+
+        debug_print : bool, default: False
+            Whether to print information about generated bitmask. Helpful for debugging.
+
+        Returns
+        -------
+        handle : BatchCompletionHandle
+            The handle to wait on or poll.
+        """
+        matcher_handles = [matcher._handle for matcher in matchers]
+        handle = self._handle.submit_accept_and_fill(
+            matcher_handles, tokens, bitmask, indices, debug_print
+        )
+        return BatchCompletionHandle(handle, bitmask)
+
     @staticmethod
     def batch_accept_token(
         matchers: List["GrammarMatcher"], tokens: List[int], debug_print: bool = False
@@ -535,3 +639,182 @@ class BatchGrammarMatcher(XGRObject):
         """
         matcher_handles = [matcher._handle for matcher in matchers]
         return _core.BatchGrammarMatcher.batch_accept_string(matcher_handles, strings, debug_print)
+
+    def batch_accept_tokens(
+        self,
+        matchers: List["GrammarMatcher"],
+        tokens: List[List[int]],
+        debug_print: bool = False,
+    ) -> List[int]:
+        """Accept a sequence of tokens for each of the matchers. See GrammarMatcher.accept_tokens.
+        The matchers accept their tokens in parallel with up to max_threads threads.
+
+        Parameters
+        ----------
+        matchers : List[GrammarMatcher]
+            The list of matchers to accept tokens for.
+
+        tokens : List[List[int]]
+            The token sequences to accept, one for each matcher.
+
+        debug_print : bool, default: False
+            Whether to print information about the internal state. Helpful for debugging.
+
+        Returns
+        -------
+        num_accepted : List[int]
+            The number of accepted tokens of each matcher.
+
+        Raises
+        ------
+        RuntimeError
+            If the sizes of matchers and tokens do not match.
+        """
+        matcher_handles = [matcher._handle for matcher in matchers]
+        return self._handle.batch_accept_tokens(matcher_handles, tokens, debug_print)
+
+
+def _to_int32_array(values: Union[List[int], ArrayLike]) -> ArrayLike:
+    """Convert a list of ints to an int32 tensor. Tensors and arrays are passed as is, so they are
+    accessed without copying."""
+    if isinstance(values, (list, tuple)):
+        return torch.tensor(values, dtype=torch.int32)
+    return values
+
+
+class MatcherGroup(XGRObject):
+    """A group of matchers held persistently in slots. Compared to BatchGrammarMatcher, the
+    matchers are registered once, and every batch operation selects them by an int32 tensor of
+    slots, so no list of matchers is converted per step. The slots, token ids and indices are
+    accessed without copying, and all the batch operations run with the GIL released.
+    """
+
+    def __init__(self, max_threads: Union[int, Literal["auto"]] = "auto") -> None:
+        """Construct the matcher group.
+
+        Parameters
+        ----------
+        max_threads : Union[int, Literal["auto"]], default: "auto"
+            The maximum number of threads to fill the bitmasks in parallel. If set to "auto", the
+            max_threads will be set to half of xgrammar.get_available_cpu_count(). The tasks run
+            on the executor shared with GrammarCompiler (see xgrammar.set_executor_num_threads).
+        """
+        self._init_handle(_core.MatcherGroup(max_threads))
+
+    def add_matcher(self, matcher: GrammarMatcher) -> int:
+        """Add a matcher to the group. The matcher is shared, not copied.
+
+        Returns
+        -------
+        slot : int
+            The slot of the matcher. The slots of the removed matchers are reused.
+        """
+        return self._handle.add_matcher(matcher._handle)
+
+    def set_matcher(self, slot: int, matcher: GrammarMatcher) -> None:
+        """Replace the matcher in a slot."""
+        self._handle.set_matcher(slot, matcher._handle)
+
+    def remove_matcher(self, slot: int) -> None:
+        """Remove the matcher in a slot. The slot can be reused by later added matchers."""
+        self._handle.remove_matcher(slot)
+
+    def get_matcher(self, slot: int) -> GrammarMatcher:
+        """Get the matcher in a slot."""
+        return GrammarMatcher._create_from_handle(self._handle.get_matcher(slot))
+
+    @property
+    def num_matchers(self) -> int:
+        """The number of matchers in the group."""
+        return self._handle.num_matchers
+
+    def batch_fill_next_token_bitmask(
+        self,
+        slots: Union[List[int], ArrayLike],
+        bitmask: ArrayLike,
+        indices: Optional[Union[List[int], ArrayLike]] = None,
+        debug_print: bool = False,
+    ) -> None:
+        """Fill the next token bitmask for the matchers in the slots.
+
+        Parameters
+        ----------
+        slots : Union[List[int], ArrayLike]
+            The slots of the matchers. Should be a 1D int32 tensor on CPU, or a list of ints. A
+            slot can appear at most once.
+
+        bitmask : ArrayLike
+            Must be a 2-dimensional int32 tensor with shape (bitmask_batch_size, bitmask_size).
+            Bitmask_batch_size could be larger than the actual batch size to allow padding.
+
+        indices : Optional[Union[List[int], ArrayLike]], default: None
+            The rows in the bitmask to fill. Should be a 1D int32 tensor on CPU, or a list of
+            ints. If None, fill the bitmask [0:len(slots)).
+
+        debug_print : bool, default: False
+            Whether to print information about generated bitmask. Helpful for debugging.
+
+        Raises
+        ------
+        RuntimeError
+            If the slots, the indices or the bitmask are invalid.
+        """
+        if indices is not None:
+            indices = _to_int32_array(indices)
+        self._handle.batch_fill_next_token_bitmask(
+            _to_int32_array(slots), bitmask, indices, debug_print
+        )
+
+    def batch_accept_token(
+        self,
+        slots: Union[List[int], ArrayLike],
+        tokens: Union[List[int], ArrayLike],
+        debug_print: bool = False,
+    ) -> List[bool]:
+        """Accept a token for each of the matchers in the slots.
+
+        Parameters
+        ----------
+        slots : Union[List[int], ArrayLike]
+            The slots of the matchers. Should be a 1D int32 tensor on CPU, or a list of ints.
+
+        tokens : Union[List[int], ArrayLike]
+            The tokens to accept. Should be a 1D int32 tensor on CPU, or a list of ints.
+
+        debug_print : bool, default: False
+            Whether to print information about the internal state. Helpful for debugging.
+
+        Returns
+        -------
+        accepted : List[bool]
+            Whether each token was accepted by its corresponding matcher.
+        """
+        return self._handle.batch_accept_token(
+            _to_int32_array(slots), _to_int32_array(tokens), debug_print
+        )
+
+    def batch_accept_string(
+        self,
+        slots: Union[List[int], ArrayLike],
+        strings: List[Union[str, bytes]],
+        debug_print: bool = False,
+    ) -> List[bool]:
+        """Accept a string for each of the matchers in the slots.
+
+        Parameters
+        ----------
+        slots : Union[List[int], ArrayLike]
+            The slots of the matchers. Should be a 1D int32 tensor on CPU, or a list of ints.
+
+        strings : List[Union[str, bytes]]
+            The strings to accept.
+
+        debug_print : bool, default: False
+            Whether to print information about the internal state. Helpful for debugging.
+
+        Returns
+        -------
+        accepted : List[bool]
+            Whether each string was accepted by its corresponding matcher.
+        """
+        return self._handle.batch_accept_string(_to_int32_array(slots), strings, debug_print)
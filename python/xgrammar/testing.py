@@ -344,6 +344,19 @@ def _print_grammar_fsms(grammar: Grammar) -> str:
     return _core.testing._print_grammar_fsms(grammar._handle)
 
 
+def _get_average_scanable_states_per_byte(grammar: Grammar, inputs: List[str]) -> float:
+    """Get the average number of scanable Earley states alive after each byte when matching the
+    inputs. It measures the ambiguity of the grammar. The grammar will be optimized if it is
+    not."""
+    return _core.testing._get_average_scanable_states_per_byte(grammar._handle, inputs)
+
+
+def _get_num_uncertain_tokens(compiled_grammar: CompiledGrammar) -> int:
+    """Get the total number of uncertain tokens in the adaptive token mask cache of the compiled
+    grammar. Uncertain tokens have to be checked by the parser at runtime."""
+    return _core.testing._get_num_uncertain_tokens(compiled_grammar._handle)
+
+
 def _qwen_xml_tool_calling_to_ebnf(schema: Union[str, Type[BaseModel], Dict[str, Any]]) -> str:
     """Convert Qwen XML tool calling schema to EBNF."""
     schema_str = _convert_schema_to_str(schema)
@@ -422,6 +435,13 @@ class GrammarFunctor:
             _core.testing.grammar_functor.lookahead_assertion_analyzer(grammar._handle)
         )
 
+    @staticmethod
+    def ambiguity_reducer(grammar: Grammar) -> Grammar:
+        """Reduce the local ambiguity of the grammar."""
+        return Grammar._create_from_handle(
+            _core.testing.grammar_functor.ambiguity_reducer(grammar._handle)
+        )
+
     @staticmethod
     def grammar_optimizer(grammar: Grammar) -> Grammar:
         """Optimize the grammar."""
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include <xgrammar/xgrammar.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace xgrammar;
+
+namespace {
+
+/*!
+ * \brief Whether the heap allocations of the current thread are counted. Only set by
+ * AllocationCounter, so the replaced operator new below is a plain malloc everywhere else.
+ */
+thread_local bool count_allocations = false;
+/*! \brief The number of heap allocations of the current thread while they are counted. */
+thread_local int64_t num_allocations = 0;
+
+/*! \brief Count the heap allocations of the current thread in its scope. */
+class AllocationCounter {
+ public:
+  AllocationCounter() {
+    num_allocations = 0;
+    count_allocations = true;
+  }
+  ~AllocationCounter() { count_allocations = false; }
+  int64_t NumAllocations() const { return num_allocations; }
+};
+
+/*! \brief Split the text into the longest tokens of the vocabulary. */
+std::vector<int32_t> Tokenize(const std::string& text, const std::vector<std::string>& vocab) {
+  std::vector<int32_t> token_ids;
+  for (std::size_t pos = 0; pos < text.size();) {
+    int32_t best_id = -1;
+    for (int32_t id = 0; id < static_cast<int32_t>(vocab.size()); ++id) {
+      const auto& token = vocab[id];
+      if (!token.empty() && text.compare(pos, token.size(), token) == 0 &&
+          (best_id == -1 || token.size() > vocab[best_id].size())) {
+        best_id = id;
+      }
+    }
+    EXPECT_NE(best_id, -1) << "Cannot tokenize " << text.substr(pos);
+    if (best_id == -1) return token_ids;
+    token_ids.push_back(best_id);
+    pos += vocab[best_id].size();
+  }
+  return token_ids;
+}
+
+/*!
+ * \brief Fill the bitmask and accept the token for every token of the text, and then the stop
+ * token.
+ */
+void MatchTokens(
+    GrammarMatcher* matcher,
+    const std::vector<int32_t>& token_ids,
+    int32_t stop_token_id,
+    std::vector<int32_t>* bitmask
+) {
+  int64_t bitmask_size = bitmask->size();
+  DLTensor tensor{
+      bitmask->data(), DLDevice{kDLCPU, 0}, 1, GetBitmaskDLType(), &bitmask_size, nullptr, 0
+  };
+  for (auto token_id : token_ids) {
+    matcher->FillNextTokenBitmask(&tensor, 0);
+    ASSERT_TRUE((*bitmask)[token_id / 32] >> (token_id % 32) & 1) << token_id;
+    ASSERT_TRUE(matcher->AcceptToken(token_id));
+  }
+  matcher->FillNextTokenBitmask(&tensor, 0);
+  ASSERT_TRUE(matcher->AcceptToken(stop_token_id));
+}
+
+}  // namespace
+
+// The global operator new is replaced for the whole executable, so this test is built as its own
+// executable, and not linked into xgrammar_test.
+void* operator new(std::size_t size) {
+  if (count_allocations) {
+    ++num_allocations;
+  }
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+// GCC warns on the inlined new and delete expressions when they are replaced by malloc and free.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+TEST(XGrammarMatcherAllocationTest, NoAllocationAfterWarmUp) {
+  std::vector<std::string> vocab = {"<eos>"};
+  for (char c = ' '; c <= '~'; ++c) {
+    vocab.push_back(std::string(1, c));
+  }
+  for (const auto& token :
+       {"{\"", "\":", "\": ", "\", \"", ", ", "true", "false", "null", "name", "id", "12", "\"}",
+        "}]", "[{", "\n  ", "  \""}) {
+    vocab.push_back(token);
+  }
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+
+  std::vector<std::pair<CompiledGrammar, std::string>> benchmarks = {
+      {compiler.CompileBuiltinJSONGrammar(),
+       "{\"name\": \"xgrammar\", \"ids\": [12, 3.5, -7e2], \"nested\": {\"ok\": true, \"none\": "
+       "null}, \"list\": [{\"a\": false}, {\"b\": \"\\u00e9\"}]}"},
+      {compiler.CompileJSONSchema(
+           R"({"type": "object", "properties": {"name": {"type": "string"}, "id": {"type":
+           "integer"}, "tags": {"type": "array", "items": {"type": "string"}}}, "required":
+           ["name", "id", "tags"]})"
+       ),
+       "{\"name\": \"a b\", \"id\": 12, \"tags\": [\"x\", \"yz\"]}"},
+  };
+
+  for (const auto& [compiled_grammar, text] : benchmarks) {
+    auto token_ids = Tokenize(text, vocab);
+    std::vector<int32_t> bitmask(GetBitmaskSize(tokenizer_info.GetVocabSize()));
+    GrammarMatcher matcher(compiled_grammar);
+    // The first pass warms up the memory of the matcher and the workspaces of the thread.
+    MatchTokens(&matcher, token_ids, 0, &bitmask);
+    matcher.Reset();
+    {
+      AllocationCounter counter;
+      MatchTokens(&matcher, token_ids, 0, &bitmask);
+      EXPECT_EQ(counter.NumAllocations(), 0) << text;
+    }
+    EXPECT_TRUE(matcher.IsTerminated());
+  }
+}
@@ -5,7 +5,13 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "fsm.h"
@@ -414,3 +420,73 @@ TEST(XGrammarFSMBuilderTest, TestChoicesFSMBuilder) {
   EXPECT_TRUE(fsm_rule2_result.has_value());
   EXPECT_EQ(fsm_rule2_result->ToString(), expected_fsm_rule2);
 }
+
+TEST(XGrammarFSMBuilderTest, TestRuleFSMFusion) {
+  std::string test_grammar = R"(
+      root ::= rule1 | rule2
+      rule1 ::= "" | "hello" rule3
+      rule2 ::= [a-z]* "A" | "B" rule2
+      rule3 ::= "x" | "y" rule2
+  )";
+  auto grammar = Grammar::FromEBNF(test_grammar);
+  GrammarFSMBuilder::Apply(&grammar);
+
+  // rule1 and rule3 are not recursive, so they are fused into the FSM of root. The recursive rule2
+  // is still referenced by rule edges.
+  auto get_referenced_rules = [&](int rule_id) {
+    const auto& rule_fsm = grammar->per_rule_fsms[rule_id];
+    std::unordered_set<int> reachable_states;
+    rule_fsm->GetReachableStates(&reachable_states);
+    std::set<int> referenced_rules;
+    for (int state : reachable_states) {
+      for (const auto& edge : rule_fsm->GetFsm().GetEdges(state)) {
+        if (edge.IsRuleRef()) {
+          referenced_rules.insert(edge.GetRefRuleId());
+        }
+      }
+    }
+    return referenced_rules;
+  };
+  EXPECT_EQ(get_referenced_rules(0), std::set<int>({2}));
+  EXPECT_EQ(get_referenced_rules(1), std::set<int>({2}));
+  EXPECT_EQ(get_referenced_rules(2), std::set<int>({2}));
+
+  const auto& root_fsm = grammar->per_rule_fsms[0];
+  EXPECT_TRUE(root_fsm->IsEndState(root_fsm->GetStart()));
+  for (const auto& [input, accepted] : std::vector<std::pair<std::string, bool>>{
+           {"hellox", true}, {"helloy", false}, {"hello", false}, {"x", false}
+       }) {
+    EXPECT_EQ(root_fsm->AcceptString(input), accepted) << input;
+  }
+}
+
+TEST(XGrammarFSMBuilderTest, TestTagDispatchManyRules) {
+  // The rule ids of the tags exceed the range of int16_t.
+  constexpr int kNumTags = 33000;
+  std::string test_grammar = "root ::= TagDispatch(";
+  for (int i = 0; i < kNumTags; ++i) {
+    test_grammar += (i == 0 ? "(\"<t" : ", (\"<t") + std::to_string(i) + ">\", r" +
+                    std::to_string(i) + ")";
+  }
+  test_grammar += ")\n";
+  for (int i = 0; i < kNumTags; ++i) {
+    test_grammar += "r" + std::to_string(i) + " ::= \"v" + std::to_string(i) + "\" [0-9]*\n";
+  }
+  auto grammar = Grammar::FromEBNF(test_grammar);
+  GrammarFSMBuilder::Apply(&grammar);
+
+  const auto& root_fsm = grammar->per_rule_fsms[0];
+  ASSERT_TRUE(root_fsm.has_value());
+  std::unordered_set<int> reachable_states;
+  root_fsm->GetReachableStates(&reachable_states);
+  int max_referenced_rule = -1;
+  for (int state : reachable_states) {
+    for (const auto& edge : root_fsm->GetFsm().GetEdges(state)) {
+      if (edge.IsRuleRef()) {
+        max_referenced_rule = std::max(max_referenced_rule, edge.GetRefRuleId());
+      }
+    }
+  }
+  EXPECT_GT(max_referenced_rule, std::numeric_limits<int16_t>::max());
+  EXPECT_EQ(grammar->GetRule(max_referenced_rule).name, "r" + std::to_string(kNumTags - 1));
+}
@@ -0,0 +1,343 @@
+#include <gtest/gtest.h>
+#include <xgrammar/xgrammar.h>
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+#include "builtin_grammars.h"
+#include "compiled_grammar_impl.h"
+#include "grammar_functor.h"
+#include "grammar_impl.h"
+#include "testing.h"
+
+using namespace xgrammar;
+
+namespace {
+
+// The optimization pipeline without the ambiguity reducer.
+Grammar OptimizeWithoutAmbiguityReducer(const Grammar& grammar) {
+  Grammar result = ByteStringFuser::Apply(grammar);
+  result = RuleInliner::Apply(result);
+  result = DeadCodeEliminator::Apply(result);
+  result = LookaheadAssertionAnalyzer::Apply(result);
+  result->allow_empty_rule_ids = AllowEmptyRuleAnalyzer::Apply(result);
+  RepetitionNormalizer::Apply(&result);
+  GrammarFSMBuilder::Apply(&result);
+  result->optimized = true;
+  return result;
+}
+
+}  // namespace
+
+TEST(XGrammarAmbiguityReducerTest, MergeAlternatives) {
+  auto grammar = Grammar::FromEBNF(R"(root ::= "x" | "y" | [a-c] | "x" | [0-9]* [0-9]* "z")");
+  EXPECT_EQ(
+      AmbiguityReducer::Apply(grammar).ToString(), "root ::= (([a-cx-y]) | ([0-9]* \"z\"))\n"
+  );
+
+  grammar = Grammar::FromEBNF(R"(root ::= "" | [a]* | "b" root)");
+  EXPECT_EQ(AmbiguityReducer::Apply(grammar).ToString(), "root ::= (([a]*) | (\"b\" root))\n");
+}
+
+TEST(XGrammarAmbiguityReducerTest, ExpandNullableRules) {
+  auto grammar = Grammar::FromEBNF(R"(root ::= "a" ws "b"
+ws ::= "" | [ \t] | [ \t] [ \t])");
+  EXPECT_EQ(
+      AmbiguityReducer::Apply(grammar).ToString(),
+      "root ::= ((\"a\" \"b\") | (\"a\" [ \\t] \"b\") | (\"a\" [ \\t] [ \\t] \"b\"))\n"
+  );
+
+  // A rule with a lookahead assertion is not expanded, since the assertion would be lost.
+  grammar = Grammar::FromEBNF(R"(root ::= "a" ws "b"
+ws ::= ("" | [ \t]) (= "b"))");
+  EXPECT_EQ(AmbiguityReducer::Apply(grammar).ToString(), grammar.ToString());
+
+  // The unchanged grammar is returned as is.
+  grammar = Grammar::FromEBNF(R"(root ::= "a" root | "b")");
+  EXPECT_EQ(AmbiguityReducer::Apply(grammar).ToString(), grammar.ToString());
+}
+
+TEST(XGrammarAmbiguityReducerTest, LeftFactorRulesWithRepetition) {
+  // The rule with repetitions has no FSM, so the common prefix "ab" is factored out.
+  auto grammar = Grammar::FromEBNF(
+      R"(root ::= "abc" [a]{300,1000} | "abd" [b]{300,1000} | "ab" | [c]{300,1000} "x")"
+  );
+  auto optimized = GrammarOptimizer::Apply(grammar);
+  auto root_body = optimized->GetGrammarExpr(optimized->GetRootRule().body_expr_id);
+  EXPECT_EQ(root_body.size(), 2);
+  auto result = optimized.ToString();
+  EXPECT_NE(
+      result.find("root ::= ((\"ab\" root_1) | (root_repeat_1_2{172, 872} "), std::string::npos
+  );
+  EXPECT_NE(
+      result.find("root_1 ::= (\"\" | (\"c\" root_repeat_1_inner \"aaa"), std::string::npos
+  );
+}
+
+TEST(XGrammarAmbiguityReducerTest, ReduceScanableStates) {
+  std::string schema = R"({"type": "object", "properties": {
+    "name": {"type": "string"}, "age": {"type": "integer"},
+    "tags": {"type": "array", "items": {"type": "string"}}
+  }, "required": ["name", "age", "tags"]})";
+  std::vector<std::string> inputs = {
+      R"({"name": "Bob", "age": -42, "tags": ["a", "bc"]})",
+      R"({ "name" : "Alice",  "age":7,"tags":[ ]})",
+  };
+  auto grammar = Grammar::FromJSONSchema(schema, true, std::nullopt, std::nullopt, true, 2);
+  auto reduced = _GetAverageScanableStatesPerByte(GrammarOptimizer::Apply(grammar), inputs);
+  auto baseline =
+      _GetAverageScanableStatesPerByte(OptimizeWithoutAmbiguityReducer(grammar), inputs);
+  EXPECT_LT(reduced, baseline);
+}
+
+TEST(XGrammarLookaheadAssertionAnalyzerTest, InferFollowLookahead) {
+  auto grammar = Grammar::FromEBNF(R"(root ::= "[" value "]" | "{" value "}" | "<" pair ">"
+value ::= "a" | "b" num
+num ::= [0-9] num | [0-9]
+pair ::= "k" ":" key
+key ::= "x" | "y" key)");
+  auto result = LookaheadAssertionAnalyzer::Apply(grammar);
+  EXPECT_EQ(
+      result.ToString(),
+      "root ::= ((\"[\" value \"]\") | (\"{\" value \"}\") | (\"<\" pair \">\"))\n"
+      "value ::= ((\"a\") | (\"b\" num)) (=([\\]}]))\n"
+      "num ::= (([0-9] num) | ([0-9])) (=([\\]}]))\n"
+      "pair ::= ((\"k\" \":\" key)) (=(\">\"))\n"
+      "key ::= ((\"x\") | (\"y\" key)) (=(\">\"))\n"
+  );
+  // Different follow sequences only give an inexact lookahead of their first characters.
+  EXPECT_FALSE(result->GetRule(1).is_exact_lookahead);
+  EXPECT_FALSE(result->GetRule(2).is_exact_lookahead);
+  // The follow sequence of key is inherited from pair, which is referenced only once.
+  EXPECT_TRUE(result->GetRule(3).is_exact_lookahead);
+  EXPECT_TRUE(result->GetRule(4).is_exact_lookahead);
+}
+
+TEST(XGrammarLookaheadAssertionAnalyzerTest, ReduceUncertainTokens) {
+  std::vector<std::string> vocab = {"<eos>", "a", "b", "x", "y", "k", "1", ":", "]", "}", ">"};
+  for (const auto& token : std::vector<std::string>{"a]", "a}", "a>", "1]", "1>", "x>", "x]"}) {
+    vocab.push_back(token);
+  }
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  auto compiled_grammar =
+      compiler.CompileGrammar(R"(root ::= "[" value "]" | "{" value "}" | "<" pair ">"
+value ::= "a" | "b" num
+num ::= [0-9] num | [0-9]
+pair ::= "k" ":" key
+key ::= "x" | "y" key)");
+  // value and pair are fused into the FSM of root, so the tokens crossing their ends like "a]" are
+  // decided in root. Only "1]" passing the inexact lookahead of num and "x>" completing the
+  // lookahead of key are uncertain. "1>" is rejected by the lookahead.
+  EXPECT_EQ(_GetNumUncertainTokens(compiled_grammar), 2);
+}
+
+TEST(XGrammarFirstFollowBytesAnalyzerTest, FirstFollowBytes) {
+  auto grammar = GrammarOptimizer::Apply(Grammar::FromEBNF(R"(root ::= "<" list ">"
+list ::= item ws | item ws "," list
+item ::= "a" | "b" num
+num ::= [0-9] num | [0-9]
+ws ::= [ ]*)"));
+  auto result = FirstFollowBytesAnalyzer::Apply(grammar);
+  auto get_rule_id = [&](const std::string& name) {
+    for (int i = 0; i < static_cast<int>(grammar->NumRules()); ++i) {
+      if (grammar->GetRule(i).name == name) {
+        return i;
+      }
+    }
+    return -1;
+  };
+  auto to_bitset = [](const std::string& bytes) {
+    std::bitset<256> result;
+    for (char ch : bytes) {
+      result.set(static_cast<uint8_t>(ch));
+    }
+    return result;
+  };
+  EXPECT_EQ(result.first_bytes[get_rule_id("root")], to_bitset("<"));
+  EXPECT_EQ(result.first_bytes[get_rule_id("list")], to_bitset("ab"));
+  EXPECT_EQ(result.first_bytes[get_rule_id("num")], to_bitset("0123456789"));
+  EXPECT_EQ(result.follow_bytes[get_rule_id("root")], to_bitset(""));
+  EXPECT_EQ(result.follow_bytes[get_rule_id("list")], to_bitset(">"));
+  // item is fused into the FSM of list, so nothing references it anymore.
+  EXPECT_EQ(result.follow_bytes[get_rule_id("item")], to_bitset(""));
+  // The whitespaces after num can be empty, so the FOLLOW set of list is inherited.
+  EXPECT_EQ(result.follow_bytes[get_rule_id("num")], to_bitset(" ,>"));
+}
+
+TEST(XGrammarFirstFollowBytesAnalyzerTest, ReduceUncertainTokens) {
+  std::vector<std::string> vocab = {"<eos>", "<", "a", "b", "1", " ", ",", ">"};
+  for (const auto& token : std::vector<std::string>{"1,", "1>", "1;", "1]", "12;", "b1 ", "b1x"}) {
+    vocab.push_back(token);
+  }
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  auto compiled_grammar = compiler.CompileGrammar(R"(root ::= "<" list ">"
+list ::= item ws | item ws "," list
+item ::= "a" | "b" num
+num ::= [0-9] num | [0-9]
+ws ::= [ ]*)");
+  // Only "1," and "1>" are uncertain. The bytes after the end of num in "1;", "1]" and "12;" cannot
+  // follow num, so they are rejected when compiling. item is fused into the FSM of list, so "b1 "
+  // and "b1x" are decided in list.
+  EXPECT_EQ(_GetNumUncertainTokens(compiled_grammar), 2);
+}
+
+TEST(XGrammarCompileBudgetTest, StopCompilation) {
+  std::vector<std::string> vocab = {"<eos>", "a", "b", "ab", "\"", "{", "}", ":", ",", "1"};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, true);
+  std::string schema = R"({"type": "object", "properties": {"a": {"type": "string"}}})";
+
+  auto get_reason = [&](const CompileBudget& budget) {
+    CompileBudgetScope scope(budget);
+    try {
+      compiler.CompileJSONSchema(schema, true, std::nullopt, std::nullopt, true, std::nullopt);
+    } catch (const CompileBudgetExceededError& e) {
+      return static_cast<int>(e.reason);
+    }
+    return -1;
+  };
+
+  CompileBudget cancelled;
+  cancelled.Cancel();
+  EXPECT_EQ(
+      get_reason(cancelled), static_cast<int>(CompileBudgetExceededError::Reason::kCancelled)
+  );
+  EXPECT_EQ(
+      get_reason(CompileBudget(0)),
+      static_cast<int>(CompileBudgetExceededError::Reason::kDeadline)
+  );
+  EXPECT_EQ(
+      get_reason(CompileBudget(-1, 0)),
+      static_cast<int>(CompileBudgetExceededError::Reason::kMemory)
+  );
+  EXPECT_EQ(
+      get_reason(CompileBudget(-1, -1, 2)),
+      static_cast<int>(CompileBudgetExceededError::Reason::kFSMStates)
+  );
+
+  // The failed compilations are not cached, so the compilation within the budget succeeds.
+  CompileBudget budget(60000);
+  EXPECT_EQ(get_reason(budget), -1);
+  EXPECT_GT(budget.GetMemoryBytes(), 0);
+  EXPECT_GT(budget.GetFSMStates(), 0);
+  EXPECT_GT(compiler.GetCacheSizeBytes(), 0);
+}
+
+TEST(XGrammarCompileCostTest, EstimateCost) {
+  std::vector<std::string> vocab = {"<eos>", "a", "b", "ab", "\"", "{", "}", ":", ",", "1", "12"};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  auto small =
+      Grammar::FromJSONSchema(R"({"type": "object", "properties": {"a": {"type": "string"}}})");
+  auto large = Grammar::FromJSONSchema(R"({"type": "object", "properties": {
+    "a": {"type": "string"}, "b": {"type": "integer"},
+    "c": {"type": "array", "items": {"type": "object", "properties": {"d": {"type": "string"}}}}
+  }})");
+
+  // The number of states is exact, and the other costs grow with the grammar.
+  auto small_estimate = compiler.EstimateCost(small);
+  auto large_estimate = compiler.EstimateCost(large);
+  EXPECT_EQ(
+      small_estimate.num_mask_states,
+      static_cast<int64_t>(compiler.CompileGrammar(small)->adaptive_token_mask_cache.size())
+  );
+  EXPECT_EQ(
+      large_estimate.num_mask_states,
+      static_cast<int64_t>(compiler.CompileGrammar(large)->adaptive_token_mask_cache.size())
+  );
+  EXPECT_GT(large_estimate.num_mask_states, small_estimate.num_mask_states);
+  EXPECT_GT(large_estimate.num_token_checks, small_estimate.num_token_checks);
+  EXPECT_GT(large_estimate.memory_bytes, small_estimate.memory_bytes);
+  EXPECT_GT(large_estimate.compile_time_ms, small_estimate.compile_time_ms);
+}
+
+TEST(XGrammarCompileCostTest, EstimateErrorBound) {
+  // A vocabulary of the printable characters and the pairs of the characters common in JSON. See
+  // cpp/tools/calibrate_compile_cost.cc for the comparison over a larger corpus.
+  std::vector<std::string> vocab = {"<eos>"};
+  for (char c = ' '; c <= '~'; ++c) {
+    vocab.push_back(std::string(1, c));
+  }
+  const std::string json_chars = " \"{}[],:0123456789.-eabcdefghijklmnopqrstuvwxyz";
+  for (char first : json_chars) {
+    for (char second : json_chars) {
+      vocab.push_back(std::string{first, second});
+    }
+  }
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  std::vector<Grammar> grammars = {
+      Grammar::BuiltinJSONGrammar(),
+      Grammar::FromJSONSchema(R"({"type": "object", "properties": {
+        "name": {"type": "string"}, "id": {"type": "integer"},
+        "tags": {"type": "array", "items": {"type": "string"}}
+      }, "required": ["name"]})"),
+      Grammar::FromRegex(R"([0-9]{4}-(0[1-9]|1[0-2])-(0[1-9]|[12][0-9]|3[01]))"),
+  };
+
+  // The number of states is exact, and the memory is within a factor of 2 of the compiled one.
+  for (const auto& grammar : grammars) {
+    auto estimate = compiler.EstimateCost(grammar);
+    auto compiled_grammar = compiler.CompileGrammar(grammar);
+    EXPECT_EQ(
+        estimate.num_mask_states,
+        static_cast<int64_t>(compiled_grammar->adaptive_token_mask_cache.size())
+    );
+    double memory_ratio =
+        static_cast<double>(estimate.memory_bytes) / compiled_grammar.MemorySizeBytes();
+    EXPECT_GT(memory_ratio, 0.5) << grammar;
+    EXPECT_LT(memory_ratio, 2) << grammar;
+  }
+}
+
+TEST(XGrammarPreparedGrammarTest, CompileForTokenizers) {
+  std::vector<std::string> vocab_a = {"<eos>", "a", "b", "ab", "\"", "{", "}", ":", ",", "1"};
+  std::vector<std::string> vocab_b = {"{\"", "\"", "a", "b", "ba", "}", ":", ",", "12", "</s>"};
+  std::vector<TokenizerInfo> tokenizer_infos = {
+      TokenizerInfo(vocab_a, VocabType::RAW, std::nullopt, std::vector<int32_t>{0}),
+      TokenizerInfo(vocab_b, VocabType::RAW, std::nullopt, std::vector<int32_t>{9})
+  };
+  auto grammar = Grammar::FromJSONSchema(R"({"type": "object", "properties": {
+    "a": {"type": "string"}, "b": {"type": "integer"}
+  }})");
+  auto prepared_grammar = PreparedGrammar::FromGrammar(grammar);
+  auto compiled_grammars =
+      GrammarCompiler::CompileGrammarForTokenizers(prepared_grammar, tokenizer_infos, 2);
+  ASSERT_EQ(compiled_grammars.size(), 2);
+
+  for (int i = 0; i < 2; ++i) {
+    GrammarCompiler compiler(tokenizer_infos[i], 1);
+    auto expected = compiler.CompileGrammar(grammar);
+    EXPECT_EQ(
+        static_cast<int64_t>(expected->adaptive_token_mask_cache.size()),
+        prepared_grammar.NumTokenMaskStates()
+    );
+    // The prepared grammar gives the same masks, and its optimized grammar is shared.
+    auto compiled_grammar = compiler.CompileGrammar(prepared_grammar);
+    EXPECT_EQ(compiled_grammar.SerializeJSON(), expected.SerializeJSON());
+    EXPECT_EQ(compiled_grammars[i].SerializeJSON(), expected.SerializeJSON());
+    EXPECT_EQ(compiled_grammar->grammar.ImplPtr(), prepared_grammar->grammar.ImplPtr());
+    EXPECT_EQ(compiled_grammars[i]->grammar.ImplPtr(), prepared_grammar->grammar.ImplPtr());
+    // The compiled grammar of the prepared grammar is cached.
+    EXPECT_EQ(compiler.CompileGrammar(prepared_grammar).ImplPtr(), compiled_grammar.ImplPtr());
+  }
+}
+
+TEST(XGrammarBuiltinGrammarTest, EmbeddedJSONGrammar) {
+  auto embedded = BuiltinJSONGrammarOptimized();
+  EXPECT_TRUE(embedded->optimized);
+  auto expected = GrammarOptimizer::Apply(Grammar::BuiltinJSONGrammar());
+  EXPECT_EQ(embedded.SerializeJSON(), expected.SerializeJSON());
+
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", ":", ",", "1", "true", " "};
+  GrammarCompiler compiler(
+      TokenizerInfo(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0}), 1, false
+  );
+  EXPECT_EQ(
+      compiler.CompileBuiltinJSONGrammar().SerializeJSON(),
+      compiler.CompileGrammar(Grammar::BuiltinJSONGrammar()).SerializeJSON()
+  );
+}
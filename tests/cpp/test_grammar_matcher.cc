@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <xgrammar/xgrammar.h>
+
+#include <cstdint>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "compiled_grammar_impl.h"
+
+using namespace xgrammar;
+
+TEST(XGrammarGrammarMatcherTest, StopTokenLookup) {
+  std::vector<std::string> vocab = {"<eos>", "a", "b", "<end>"};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  auto deserialized = TokenizerInfo::DeserializeJSON(tokenizer_info.SerializeJSON());
+  ASSERT_TRUE(std::holds_alternative<TokenizerInfo>(deserialized));
+
+  for (const auto& info : {tokenizer_info, std::get<TokenizerInfo>(deserialized)}) {
+    GrammarCompiler compiler(info, 1, false);
+    auto compiled_grammar = compiler.CompileGrammar("root ::= \"a\"");
+
+    GrammarMatcher matcher(compiled_grammar);
+    EXPECT_TRUE(matcher.AcceptToken(1));
+    EXPECT_FALSE(matcher.AcceptToken(3));
+    EXPECT_TRUE(matcher.AcceptToken(0));
+    EXPECT_TRUE(matcher.IsTerminated());
+
+    GrammarMatcher override_matcher(compiled_grammar, std::vector<int>{3});
+    EXPECT_TRUE(override_matcher.AcceptToken(1));
+    EXPECT_FALSE(override_matcher.AcceptToken(0));
+    EXPECT_TRUE(override_matcher.AcceptToken(3));
+    EXPECT_TRUE(override_matcher.IsTerminated());
+  }
+}
+
+TEST(XGrammarGrammarMatcherTest, AcceptTokensMatchesAcceptToken) {
+  std::vector<std::string> vocab = {"<eos>", "{\"", "a", "\": ", "1", "2", "}", "\"", "<end>"};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  auto compiled_grammar = compiler.CompileBuiltinJSONGrammar();
+  std::vector<int32_t> bitmask(GetBitmaskSize(tokenizer_info.GetVocabSize()));
+  std::vector<int32_t> expected_bitmask(bitmask.size());
+  int64_t bitmask_size = bitmask.size();
+  DLTensor tensor{
+      bitmask.data(), DLDevice{kDLCPU, 0}, 1, GetBitmaskDLType(), &bitmask_size, nullptr, 0
+  };
+  DLTensor expected_tensor{
+      expected_bitmask.data(), DLDevice{kDLCPU, 0}, 1, GetBitmaskDLType(), &bitmask_size, nullptr, 0
+  };
+
+  // {"a": 12} with a rejected token, an out-of-range token, or the stop token in the middle.
+  std::vector<std::vector<int32_t>> drafts = {
+      {1, 2, 3, 4, 5, 6, 0}, {1, 2, 3, 4, 1, 5}, {1, 2, 3, 100, 4}, {1, 2, 0, 3}, {1, 2, 3, 4, 6, 0}
+  };
+  for (const auto& draft : drafts) {
+    GrammarMatcher matcher(compiled_grammar);
+    GrammarMatcher expected_matcher(compiled_grammar);
+    int32_t expected_num_accepted = 0;
+    while (expected_num_accepted < static_cast<int32_t>(draft.size()) &&
+           expected_matcher.AcceptToken(draft[expected_num_accepted])) {
+      ++expected_num_accepted;
+    }
+    int32_t num_accepted = matcher.AcceptTokens(draft);
+    EXPECT_EQ(num_accepted, expected_num_accepted);
+    EXPECT_EQ(matcher.IsTerminated(), expected_matcher.IsTerminated());
+    if (!matcher.IsTerminated()) {
+      matcher.FillNextTokenBitmask(&tensor, 0);
+      expected_matcher.FillNextTokenBitmask(&expected_tensor, 0);
+      EXPECT_EQ(bitmask, expected_bitmask);
+    }
+    // Each accepted token is one step in rollback.
+    if (num_accepted > 1 && !matcher.IsTerminated()) {
+      matcher.Rollback(num_accepted - 1);
+      EXPECT_TRUE(matcher.AcceptTokens({draft.begin() + 1, draft.end()}) == num_accepted - 1);
+    }
+  }
+}
+
+TEST(XGrammarGrammarMatcherTest, InitialMatcherState) {
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " ", "{\""};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  auto compiled_grammar = compiler.CompileJSONSchema(R"({"type": "object"})");
+
+  int64_t bitmask_size = GetBitmaskSize(tokenizer_info.GetVocabSize());
+  auto fill_next_token_bitmask = [&](GrammarMatcher* matcher, bool debug_print) {
+    std::vector<int32_t> bitmask(bitmask_size);
+    DLTensor tensor{
+        bitmask.data(), DLDevice{kDLCPU, 0}, 1, GetBitmaskDLType(), &bitmask_size, nullptr, 0
+    };
+    matcher->FillNextTokenBitmask(&tensor, 0, debug_print);
+    return bitmask;
+  };
+
+  // The initial bitmask is the one computed by the matcher. debug_print skips the initial bitmask.
+  const auto& initial_matcher_state = compiled_grammar->GetInitialMatcherState();
+  GrammarMatcher matcher(compiled_grammar);
+  auto computed_bitmask = fill_next_token_bitmask(&matcher, true);
+  EXPECT_EQ(initial_matcher_state.token_bitmask, computed_bitmask);
+  EXPECT_EQ(fill_next_token_bitmask(&matcher, false), computed_bitmask);
+
+  ASSERT_TRUE(matcher.AcceptString("{"));
+  EXPECT_NE(fill_next_token_bitmask(&matcher, false), computed_bitmask);
+  matcher.Reset();
+  EXPECT_EQ(fill_next_token_bitmask(&matcher, false), computed_bitmask);
+  ASSERT_TRUE(matcher.AcceptString("{\"a\": 1}"));
+  EXPECT_TRUE(matcher.AcceptToken(0));
+
+  // The matchers of a deserialized grammar compute the initial state on their construction.
+  auto result = CompiledGrammar::DeserializeJSON(compiled_grammar.SerializeJSON(), tokenizer_info);
+  ASSERT_TRUE(std::holds_alternative<CompiledGrammar>(result));
+  GrammarMatcher deserialized_matcher(std::get<CompiledGrammar>(result));
+  EXPECT_EQ(fill_next_token_bitmask(&deserialized_matcher, false), computed_bitmask);
+
+  // The initial bitmask is not used with other stop tokens.
+  GrammarMatcher override_matcher(compiled_grammar, std::vector<int>{10});
+  auto override_bitmask = fill_next_token_bitmask(&override_matcher, false);
+  EXPECT_EQ(override_bitmask, fill_next_token_bitmask(&override_matcher, true));
+}
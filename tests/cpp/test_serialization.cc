@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <picojson.h>
+#include <xgrammar/xgrammar.h>
 
 #include <algorithm>
 #include <cstddef>
@@ -7,6 +8,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "compiled_grammar_impl.h"
 #include "fsm.h"
 #include "support/compact_2d_array.h"
 #include "support/dynamic_bitset.h"
@@ -562,6 +564,42 @@ TEST(XGrammarSerializationTest, TestCompactFSM) {
   }
 }
 
+TEST(XGrammarSerializationTest, TestCompactFSMWithStartEnd) {
+  using namespace xgrammar;
+
+  // The FSM of the second rule in the complete FSM only keeps the end states of its own states.
+  FSM complete_fsm;
+  std::vector<int> state_mapping;
+  FSMWithStartEnd rule_fsm(FSM(2), 0, {false, true});
+  rule_fsm.GetFsm().AddEdge(0, 1, 'a', 'a');
+  rule_fsm.AddToCompleteFSM(&complete_fsm, &state_mapping);
+  auto added_fsm = rule_fsm.AddToCompleteFSM(&complete_fsm, &state_mapping);
+  ASSERT_EQ(added_fsm.GetEndsOffset(), 2);
+  ASSERT_EQ(added_fsm.GetEnds().size(), 2);
+  ASSERT_FALSE(added_fsm.IsEndState(1));
+  ASSERT_TRUE(added_fsm.IsEndState(3));
+
+  auto compact_fsm = added_fsm.ToCompact();
+  ASSERT_TRUE(compact_fsm.AcceptString("a"));
+  auto json_value = AutoSerializeJSONValue(compact_fsm);
+
+  // The end states are serialized with the state ids in the complete FSM.
+  std::string expected =
+      "[{\"data_\":[[97,97,1],[97,97,3]],\"indptr_\":[0,1,1,2,2]},2,[3],false]";
+  ASSERT_EQ(json_value.serialize(), expected);
+
+  CompactFSMWithStartEnd deserialized;
+  auto error = AutoDeserializeJSONValue(&deserialized, json_value);
+  ASSERT_FALSE(error.has_value());
+  ASSERT_FALSE(deserialized.IsEndState(2));
+  ASSERT_TRUE(deserialized.IsEndState(3));
+  ASSERT_TRUE(deserialized.AcceptString("a"));
+
+  // Test roundtrip
+  auto json_value2 = AutoSerializeJSONValue(deserialized);
+  ASSERT_EQ(json_value.serialize(), json_value2.serialize());
+}
+
 TEST(XGrammarSerializationTest, TestComplexStructures) {
   using namespace xgrammar;
 
@@ -614,3 +652,67 @@ TEST(XGrammarSerializationTest, TestComplexStructures) {
     ASSERT_EQ(json_value.serialize(), json_value2.serialize());
   }
 }
+
+TEST(XGrammarSerializationTest, TestCompiledGrammarLazyMasks) {
+  using namespace xgrammar;
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " ", "{\""};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  auto compiled_grammar = compiler.CompileJSONSchema(R"({"type": "object"})");
+  auto serialized = compiled_grammar.SerializeJSON();
+
+  auto result = CompiledGrammar::DeserializeJSON(serialized, tokenizer_info);
+  ASSERT_TRUE(std::holds_alternative<CompiledGrammar>(result));
+  auto deserialized = std::get<CompiledGrammar>(result);
+  // The masks are left serialized until they are looked up.
+  ASSERT_NE(deserialized->serialized_json, nullptr);
+  ASSERT_EQ(
+      deserialized->serialized_adaptive_token_masks.size(),
+      compiled_grammar->adaptive_token_mask_cache.size()
+  );
+  for (const auto& [state, mask] : compiled_grammar->adaptive_token_mask_cache) {
+    const auto* deserialized_mask = deserialized->GetAdaptiveTokenMask(state);
+    ASSERT_NE(deserialized_mask, nullptr);
+    ASSERT_EQ(
+        AutoSerializeJSONValue(*deserialized_mask).serialize(),
+        AutoSerializeJSONValue(mask).serialize()
+    );
+  }
+  ASSERT_EQ(deserialized.SerializeJSON(), serialized);
+
+  // The structure of the masks is checked on deserialization, before any lookup.
+  // Insert the text after the first occurrence of the pattern.
+  auto expect_corrupted_mask_rejected = [&](const std::string& pattern, const std::string& insert) {
+    auto corrupted = serialized;
+    auto position = corrupted.find(pattern);
+    ASSERT_NE(position, std::string::npos) << pattern;
+    corrupted.insert(position + pattern.size(), insert);
+    auto result = CompiledGrammar::DeserializeJSON(corrupted, tokenizer_info);
+    EXPECT_TRUE(std::holds_alternative<SerializationError>(result)) << pattern << insert;
+  };
+  // A token index out of the vocabulary.
+  expect_corrupted_mask_rejected("\"accepted_indices\":[", "1000,");
+  expect_corrupted_mask_rejected("\"rejected_indices\":[", "-1,");
+  expect_corrupted_mask_rejected("\"uncertain_indices\":[", "11,");
+  // A boundary mask without its uncertain token.
+  expect_corrupted_mask_rejected("\"uncertain_boundary_masks\":[", "0,");
+  // A bitset whose buffer does not match its size.
+  expect_corrupted_mask_rejected("\"accepted_bitset\":[", "64,");
+  // A store type out of range, and a non-integer index.
+  expect_corrupted_mask_rejected("\"store_type\":", "7");
+  expect_corrupted_mask_rejected("\"accepted_indices\":[", "0.5,");
+
+  // A missing member.
+  auto corrupted = serialized;
+  auto position = corrupted.find("\"store_type\":");
+  ASSERT_NE(position, std::string::npos);
+  corrupted.replace(position, std::string("\"store_type\":").size(), "\"store_typo\":");
+  result = CompiledGrammar::DeserializeJSON(corrupted, tokenizer_info);
+  EXPECT_TRUE(std::holds_alternative<SerializationError>(result));
+
+  // The syntax errors of the masks are still reported on deserialization.
+  auto invalid = serialized;
+  invalid.replace(position, 1, "[");
+  result = CompiledGrammar::DeserializeJSON(invalid, tokenizer_info);
+  EXPECT_TRUE(std::holds_alternative<SerializationError>(result));
+}
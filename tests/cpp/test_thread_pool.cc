@@ -1,7 +1,21 @@
 #include <gtest/gtest.h>
+#include <xgrammar/xgrammar.h>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "support/cpu_affinity.h"
+#include "support/executor.h"
 #include "support/thread_pool.h"
 using namespace xgrammar;
 
@@ -37,6 +51,134 @@ TEST(XGramamrThreadPoolTest, FunctionalTest) {
   pool.Join();
 }
 
+TEST(XGramamrThreadPoolTest, WorkerCPUAffinity) {
+  int32_t num_cpus = GetAvailableCPUCount();
+  EXPECT_GE(num_cpus, 1);
+
+  // Pin to the first CPU the process may run on, which is not CPU 0 under a restricted cpuset.
+  int32_t cpu = 0;
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(cpu_set), &cpu_set), 0);
+  while (cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &cpu_set)) {
+    ++cpu;
+  }
+  ASSERT_LT(cpu, CPU_SETSIZE);
+#endif
+
+  SetWorkerCPUAffinity({cpu});
+  EXPECT_EQ(GetWorkerCPUAffinity(), std::vector<int32_t>{cpu});
+  EXPECT_EQ(GetAvailableCPUCount(), 1);
+  {
+    ThreadPool pool(2);
+    for (int i = 0; i < 4; ++i) {
+      pool.Execute([cpu] {
+#if defined(__linux__)
+        EXPECT_EQ(sched_getcpu(), cpu);
+#endif
+      });
+    }
+    pool.Join();
+  }
+
+  SetWorkerCPUAffinity({});
+  EXPECT_TRUE(GetWorkerCPUAffinity().empty());
+  EXPECT_EQ(GetAvailableCPUCount(), num_cpus);
+}
+
+TEST(XGramamrThreadPoolTest, ExecutorPriority) {
+  int32_t num_threads = GetExecutorNumThreads();
+  SetExecutorNumThreads(1);
+
+  // Block the only worker, then queue the compiling tasks before the decoding tasks.
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool is_released = false;
+  std::vector<std::string> order;
+  Executor::Global().Execute(TaskPriority::kCompile, [&] {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return is_released; });
+  });
+  TaskGroup compile_group(TaskPriority::kCompile, 2);
+  TaskGroup decode_group(TaskPriority::kDecode, 2);
+  auto record = [&](std::string name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    order.push_back(name);
+    condition.notify_all();
+  };
+  for (int i = 0; i < 3; ++i) {
+    compile_group.Execute([&record, i] { record("compile" + std::to_string(i)); });
+  }
+  for (int i = 0; i < 3; ++i) {
+    decode_group.Execute([&record, i] { record("decode" + std::to_string(i)); });
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    is_released = true;
+    condition.notify_all();
+    condition.wait(lock, [&] { return order.size() == 6; });
+  }
+  decode_group.Wait();
+  compile_group.Wait();
+  EXPECT_EQ(
+      order,
+      std::vector<std::string>(
+          {"decode0", "decode1", "decode2", "compile0", "compile1", "compile2"}
+      )
+  );
+
+  // The exceptions of the tasks are rethrown by Wait.
+  TaskGroup error_group(TaskPriority::kDecode, 2);
+  error_group.Execute([] { throw std::runtime_error("error"); });
+  EXPECT_THROW(error_group.Wait(), std::runtime_error);
+
+  SetExecutorNumThreads(num_threads);
+  EXPECT_EQ(GetExecutorNumThreads(), num_threads);
+}
+
+TEST(XGramamrThreadPoolTest, WaitOnExecutorWorker) {
+  int32_t num_threads = GetExecutorNumThreads();
+  SetExecutorNumThreads(1);
+
+  // The only worker compiles with several threads, so the runners of its task group are queued
+  // behind the task waiting for them.
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " ", "{\""};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  std::promise<std::string> compiled;
+  auto compiled_future = compiled.get_future();
+  Executor::Global().Execute(TaskPriority::kCompile, [&] {
+    GrammarCompiler compiler(tokenizer_info, 8, false);
+    compiled.set_value(compiler.CompileBuiltinJSONGrammar().SerializeJSON());
+  });
+  ASSERT_EQ(compiled_future.wait_for(std::chrono::seconds(60)), std::future_status::ready);
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  EXPECT_EQ(compiled_future.get(), compiler.CompileBuiltinJSONGrammar().SerializeJSON());
+
+  // The nested groups on the worker do not wait for each other's queued runners either.
+  std::promise<int> counted;
+  auto counted_future = counted.get_future();
+  Executor::Global().Execute(TaskPriority::kCompile, [&] {
+    std::atomic<int> count{0};
+    TaskGroup outer_group(TaskPriority::kCompile, 4);
+    for (int i = 0; i < 4; ++i) {
+      outer_group.Execute([&count] {
+        TaskGroup inner_group(TaskPriority::kDecode, 4);
+        for (int j = 0; j < 4; ++j) {
+          inner_group.Execute([&count] { ++count; });
+        }
+        inner_group.Wait();
+      });
+    }
+    outer_group.Wait();
+    counted.set_value(count.load());
+  });
+  ASSERT_EQ(counted_future.wait_for(std::chrono::seconds(60)), std::future_status::ready);
+  EXPECT_EQ(counted_future.get(), 16);
+
+  SetExecutorNumThreads(num_threads);
+}
+
 // TEST(XGramamrThreadPoolTest, PressureTest) {
 //   const size_t num_threads = std::thread::hardware_concurrency();
 //   ThreadPool pool(num_threads);
@@ -7,18 +7,456 @@
 #include <future>
 #include <iostream>
 #include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <unordered_set>
+#include <variant>
 #include <vector>
 
+#include "compiled_grammar_impl.h"
+#include "shared_grammar_cache.h"
 #include "support/logging.h"
 #include "support/thread_safe_cache.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#endif
+
 using namespace xgrammar;
 
 namespace {
 
+struct SizeEstimatorOne {
+  template <typename T>
+  std::size_t operator()(const T&) const {
+    return 1;
+  }
+};
+
+// Fails for the first computation of every key.
+struct FailOnceComputer {
+  inline static auto num_computed = std::atomic_int{};
+  int operator()(int key) const {
+    if (num_computed++ == 0) {
+      throw std::runtime_error("The computation is cancelled");
+    }
+    return key * 2;
+  }
+};
+
+}  // namespace
+
+TEST(XGrammarThreadSafeCacheTest, FailedComputationIsNotCached) {
+  for (auto max_size : {std::size_t(-1), std::size_t(10)}) {
+    FailOnceComputer::num_computed = 0;
+    auto cache = ThreadSafeLRUCache<int, int, FailOnceComputer, SizeEstimatorOne>{max_size};
+    EXPECT_THROW(cache.Get(1), std::runtime_error);
+    // The failed entry is erased, so the value is recomputed instead of rethrowing the error.
+    EXPECT_EQ(cache.Get(1), 2);
+    EXPECT_EQ(cache.Get(1), 2);
+    EXPECT_EQ(FailOnceComputer::num_computed, 2);
+    EXPECT_EQ(cache.MemorySize(), 1);
+  }
+}
+
+namespace {
+
+struct PlusOneComputer {
+  inline static auto num_computed = std::atomic_int{};
+  int operator()(int key) const {
+    ++num_computed;
+    return key + 1;
+  }
+};
+
+// Compacts the even values to their negation, which take 1 byte instead of 10 bytes.
+struct EvenCompactor {
+  inline static auto num_restored = std::atomic_int{};
+  std::optional<int> Compact(int value) const {
+    if (value % 2 != 0) return std::nullopt;
+    return -value;
+  }
+  bool IsCompacted(int value) const { return value < 0; }
+  int Restore(int value) const {
+    ++num_restored;
+    return -value;
+  }
+};
+
+struct CompactSizeEstimator {
+  std::size_t operator()(int value) const { return value < 0 ? 1 : 10; }
+};
+
+}  // namespace
+
+TEST(XGrammarThreadSafeCacheTest, CompactBeforeEvict) {
+  PlusOneComputer::num_computed = 0;
+  EvenCompactor::num_restored = 0;
+  auto cache =
+      ThreadSafeLRUCache<int, int, PlusOneComputer, CompactSizeEstimator, EvenCompactor>{15};
+  EXPECT_EQ(cache.Get(1), 2);
+  EXPECT_EQ(cache.Get(3), 4);
+  EXPECT_EQ(cache.MemorySize(), 20);
+
+  // The least recently used value is compacted instead of evicted.
+  EXPECT_EQ(cache.Get(5), 6);
+  EXPECT_EQ(cache.MemorySize(), 21);
+
+  // The compacted value is restored on reuse, and the older values are compacted.
+  EXPECT_EQ(cache.Get(1), 2);
+  EXPECT_EQ(cache.MemorySize(), 12);
+  EXPECT_EQ(EvenCompactor::num_restored, 1);
+  EXPECT_EQ(PlusOneComputer::num_computed, 3);
+
+  // The values are evicted when compaction is not enough.
+  EXPECT_EQ(cache.Get(2), 3);
+  EXPECT_EQ(cache.Get(4), 5);
+  EXPECT_EQ(cache.Get(6), 7);
+  EXPECT_EQ(cache.MemorySize(), 20);
+  EXPECT_EQ(cache.Get(1), 2);
+  EXPECT_EQ(PlusOneComputer::num_computed, 7);
+}
+
+TEST(XGrammarThreadSafeCacheTest, CompiledGrammarCompaction) {
+  // Both the digit tokens and the other tokens are many, so the masks are stored as bitsets.
+  std::vector<std::string> vocab = {"<eos>"};
+  for (int i = 0; i < 3000; ++i) {
+    vocab.push_back(std::to_string(i));
+    vocab.push_back("x" + std::to_string(i));
+  }
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  const std::vector<std::string> ebnfs = {
+      R"(root ::= [0-9]+ "x")", R"(root ::= [0-9]+ "y")", R"(root ::= [0-9]+ "z")"
+  };
+  GrammarCompiler no_cache_compiler(tokenizer_info, 1, false);
+  std::vector<std::string> serialized;
+  int64_t total_size = 0;
+  for (const auto& ebnf : ebnfs) {
+    auto compiled_grammar = no_cache_compiler.CompileGrammar(ebnf, "root");
+    serialized.push_back(compiled_grammar.SerializeJSON());
+    total_size += static_cast<int64_t>(compiled_grammar.MemorySizeBytes());
+  }
+  auto size = total_size / 3;
+
+  GrammarCompiler compiler(tokenizer_info, 1, true, size * 2 - 1);
+  for (const auto& ebnf : ebnfs) {
+    compiler.CompileGrammar(ebnf, "root");
+  }
+  // The first grammar is compacted instead of evicted.
+  EXPECT_GT(compiler.GetCacheSizeBytes(), size * 2);
+  EXPECT_LT(compiler.GetCacheSizeBytes(), total_size);
+
+  // It is restored on reuse, and the other grammars are compacted.
+  auto restored = compiler.CompileGrammar(ebnfs[0], "root");
+  EXPECT_EQ(restored.SerializeJSON(), serialized[0]);
+  EXPECT_EQ(static_cast<int64_t>(restored.MemorySizeBytes()), size);
+  EXPECT_GT(compiler.GetCacheSizeBytes(), size);
+  EXPECT_LT(compiler.GetCacheSizeBytes(), size * 2);
+  for (int i = 1; i < 3; ++i) {
+    EXPECT_EQ(compiler.CompileGrammar(ebnfs[i], "root").SerializeJSON(), serialized[i]);
+  }
+}
+
+TEST(XGrammarThreadSafeCacheTest, CompactSharedAndSerializedMasks) {
+  std::vector<std::string> vocab = {"<eos>", ""};
+  for (int i = 0; i < 3000; ++i) {
+    vocab.push_back(std::to_string(i));
+    vocab.push_back("x" + std::to_string(i));
+  }
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  auto compiled_grammar = compiler.CompileGrammar(R"(root ::= [0-9]+ "x")", "root");
+  ASSERT_TRUE(compiled_grammar->Compact().has_value());
+
+  // The masks shared with another tokenizer are not copied.
+  TokenizerInfo variant_tokenizer_info(
+      vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0, 1}
+  );
+  auto shared = compiled_grammar->WithTokenizerInfo(variant_tokenizer_info);
+  auto shared_size = shared.MemorySizeBytes();
+  EXPECT_FALSE(shared->Compact().has_value());
+  EXPECT_EQ(shared.MemorySizeBytes(), shared_size);
+
+  // The masks left serialized are not decoded.
+  auto result = CompiledGrammar::DeserializeJSON(compiled_grammar.SerializeJSON(), tokenizer_info);
+  ASSERT_TRUE(std::holds_alternative<CompiledGrammar>(result));
+  auto deserialized = std::get<CompiledGrammar>(result);
+  auto deserialized_size = deserialized.MemorySizeBytes();
+  EXPECT_FALSE(deserialized->Compact().has_value());
+  EXPECT_EQ(deserialized.MemorySizeBytes(), deserialized_size);
+}
+
+TEST(XGrammarThreadSafeCacheTest, PrewarmFromCacheManifest) {
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " "};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, true, 1 << 30);
+  compiler.CompileRegex("a+b");
+  compiler.CompileGrammar(R"(root ::= "{" [0-9]+ "}")", "root");
+  compiler.CompileJSONSchema(R"({"type": "object"})", false, 2);
+  compiler.CompileBuiltinJSONGrammar();
+  compiler.CompileGrammar(PreparedGrammar::FromGrammar(Grammar::FromRegex("b+")));
+  auto manifest = compiler.ExportCacheManifest();
+  // The prepared grammar is not exported, and the most recently used entry comes first.
+  EXPECT_EQ(manifest.find("b+"), std::string::npos);
+  EXPECT_LT(manifest.find("builtin_json_grammar"), manifest.find("json_schema"));
+  EXPECT_LT(manifest.find("json_schema"), manifest.find("a+b"));
+
+  GrammarCompiler prewarmed_compiler(tokenizer_info, 1, true, 1 << 30);
+  prewarmed_compiler.Prewarm(manifest);
+  prewarmed_compiler.WaitForPrewarm();
+  auto prewarmed_size = prewarmed_compiler.GetCacheSizeBytes();
+  EXPECT_GT(prewarmed_size, 0);
+  prewarmed_compiler.CompileRegex("a+b");
+  prewarmed_compiler.CompileJSONSchema(R"({"type": "object"})", false, 2);
+  EXPECT_EQ(prewarmed_compiler.GetCacheSizeBytes(), prewarmed_size);
+
+  // The failed entries are skipped, and an invalid manifest is rejected.
+  GrammarCompiler another_compiler(tokenizer_info, 1, true, 1 << 30);
+  another_compiler.Prewarm(
+      R"([{"type": "regex", "regex": "(", "priority": 2}, {"type": "regex", "regex": "a"}])"
+  );
+  another_compiler.WaitForPrewarm();
+  EXPECT_EQ(another_compiler.ExportCacheManifest(), R"([{"regex":"a","type":"regex"}])");
+  EXPECT_ANY_THROW(another_compiler.Prewarm(R"([{"type": "regex"}])"));
+  EXPECT_ANY_THROW(another_compiler.Prewarm(R"([{"type": "unknown"}])"));
+}
+
+TEST(XGrammarThreadSafeCacheTest, PrewarmOnSingleExecutorThread) {
+  int32_t num_threads = GetExecutorNumThreads();
+  SetExecutorNumThreads(1);
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " "};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  const std::string manifest =
+      R"([{"type": "builtin_json_grammar"}, {"type": "regex", "regex": "a+b"},)"
+      R"( {"type": "regex", "regex": "[0-9]+"}])";
+
+  // The compiler with several threads compiles the entries on the only worker of the executor,
+  // and a foreground compilation of the same key waits for the prewarm.
+  GrammarCompiler compiler(tokenizer_info, 8, true);
+  compiler.Prewarm(manifest);
+  auto compiled = std::async(std::launch::async, [&] {
+    auto compiled_grammar = compiler.CompileBuiltinJSONGrammar();
+    compiler.WaitForPrewarm();
+    return compiled_grammar.SerializeJSON();
+  });
+  ASSERT_EQ(compiled.wait_for(std::chrono::seconds(60)), std::future_status::ready);
+  GrammarCompiler local_compiler(tokenizer_info, 1, false);
+  EXPECT_EQ(compiled.get(), local_compiler.CompileBuiltinJSONGrammar().SerializeJSON());
+  EXPECT_NE(compiler.ExportCacheManifest().find("a+b"), std::string::npos);
+
+  SetExecutorNumThreads(num_threads);
+}
+
+TEST(XGrammarThreadSafeCacheTest, CompileServer) {
+#if defined(_WIN32)
+  GTEST_SKIP() << "The compile server is only supported on POSIX platforms";
+#endif
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " "};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  const std::string socket_path = ::testing::TempDir() + "xgrammar_compile_server.sock";
+  GrammarCompiler local_compiler(tokenizer_info, 1, false);
+  auto expected = local_compiler.CompileJSONSchema(R"({"type": "object"})").SerializeJSON();
+
+  std::optional<CompileServer> server;
+  server.emplace(socket_path, 1);
+  std::thread serve_thread([&] { server->Serve(); });
+  for (bool cache_enabled : {true, false}) {
+    GrammarCompiler compiler(tokenizer_info, 1, cache_enabled);
+    compiler.SetCompileServer(socket_path);
+    EXPECT_EQ(compiler.CompileJSONSchema(R"({"type": "object"})").SerializeJSON(), expected);
+    EXPECT_EQ(
+        compiler.CompileRegex("a+b").SerializeJSON(),
+        local_compiler.CompileRegex("a+b").SerializeJSON()
+    );
+    // The errors of the server are raised by compiling in this process.
+    EXPECT_ANY_THROW(compiler.CompileRegex("("));
+  }
+  server->Shutdown();
+  serve_thread.join();
+  server.reset();
+
+  // The grammars are compiled in this process if the server is unavailable.
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  compiler.SetCompileServer(socket_path);
+  EXPECT_EQ(compiler.CompileJSONSchema(R"({"type": "object"})").SerializeJSON(), expected);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(XGrammarThreadSafeCacheTest, CompileServerTimeout) {
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " "};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler local_compiler(tokenizer_info, 1, false);
+
+  // A hung server: it answers the handshake of the first connection, but never the requests.
+  const std::string socket_path = ::testing::TempDir() + "xgrammar_hung_compile_server.sock";
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  ASSERT_LT(socket_path.size(), sizeof(address.sun_path));
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  ::unlink(socket_path.c_str());
+  int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(listen_fd, 0);
+  ASSERT_EQ(::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+  ASSERT_EQ(::listen(listen_fd, 4), 0);
+  std::thread server_thread([listen_fd] {
+    int connection = ::accept(listen_fd, nullptr, nullptr);
+    if (connection < 0) return;
+    uint64_t size = 0;
+    if (::recv(connection, &size, sizeof(size), MSG_WAITALL) == sizeof(size)) {
+      std::string tokenizer_info_json(size, '\0');
+      ::recv(connection, tokenizer_info_json.data(), size, MSG_WAITALL);
+      uint64_t empty_frame_size = 0;
+      ::send(connection, &empty_frame_size, sizeof(empty_frame_size), 0);
+    }
+    // Read the requests without answering them, until the client closes the connection.
+    char buffer[4096];
+    while (::recv(connection, buffer, sizeof(buffer), 0) > 0) {
+    }
+    ::close(connection);
+  });
+
+  // The requests time out, and the grammars are compiled in this process. The second one times
+  // out in the handshake of a new connection, which the server never accepts.
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  compiler.SetCompileServer(socket_path, 200);
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(
+      compiler.CompileJSONSchema(R"({"type": "object"})").SerializeJSON(),
+      local_compiler.CompileJSONSchema(R"({"type": "object"})").SerializeJSON()
+  );
+  EXPECT_EQ(
+      compiler.CompileRegex("a+b").SerializeJSON(),
+      local_compiler.CompileRegex("a+b").SerializeJSON()
+  );
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(400));
+  EXPECT_LT(elapsed, std::chrono::seconds(30));
+
+  server_thread.join();
+  ::close(listen_fd);
+  ::unlink(socket_path.c_str());
+}
+#endif
+
+TEST(XGrammarThreadSafeCacheTest, SharedGrammarCache) {
+#if defined(_WIN32)
+  GTEST_SKIP() << "The shared grammar cache is only supported on POSIX platforms";
+#endif
+  const std::string name = "/xgrammar_test_shared_grammar_cache";
+  SharedGrammarCache::Remove(name);
+  SharedGrammarCache shared_cache(name, 1 << 20);
+  // Another process opens the same region.
+  SharedGrammarCache other_shared_cache(name, 1 << 10);
+  EXPECT_EQ(other_shared_cache.MemorySizeBytes(), shared_cache.MemorySizeBytes());
+
+  shared_cache->Put("key", "value");
+  EXPECT_EQ(other_shared_cache->Get("key"), "value");
+  EXPECT_EQ(other_shared_cache->Get("other key"), std::nullopt);
+  other_shared_cache->Put("key", "new value");
+  EXPECT_EQ(shared_cache->Get("key"), "new value");
+
+  // The oldest values are overwritten when the ring is full.
+  std::string large_value(64 << 10, 'x');
+  for (int i = 0; i < 64; ++i) {
+    shared_cache->Put("large " + std::to_string(i), large_value);
+  }
+  EXPECT_EQ(shared_cache->Get("key"), std::nullopt);
+  EXPECT_EQ(shared_cache->Get("large 0"), std::nullopt);
+  EXPECT_EQ(shared_cache->Get("large 63"), large_value);
+
+  // A compiler gets the grammars compiled by the compiler of another process.
+  std::vector<std::string> vocab = {"<eos>", "{", "}", "\"", "a", "b", ":", ",", "1", " "};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler compiler(tokenizer_info, 1, false);
+  compiler.SetSharedCache(shared_cache);
+  auto expected = compiler.CompileJSONSchema(R"({"type": "object"})").SerializeJSON();
+  GrammarCompiler other_compiler(tokenizer_info, 1, true);
+  other_compiler.SetSharedCache(other_shared_cache);
+  EXPECT_EQ(other_compiler.CompileJSONSchema(R"({"type": "object"})").SerializeJSON(), expected);
+
+  // The grammars of another tokenizer are not shared.
+  TokenizerInfo other_tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{1});
+  GrammarCompiler compiler_of_other_tokenizer(other_tokenizer_info, 1, false);
+  compiler_of_other_tokenizer.SetSharedCache(shared_cache);
+  EXPECT_NE(
+      compiler_of_other_tokenizer.CompileJSONSchema(R"({"type": "object"})").SerializeJSON(),
+      expected
+  );
+  SharedGrammarCache::Remove(name);
+}
+
+TEST(XGrammarThreadSafeCacheTest, ShareGrammarsOfSameVocabulary) {
+  // The two tokenizers only differ in whether the empty token is a special token or a stop token.
+  std::vector<std::string> vocab = {"<eos>", "", "{", "}", "\"", "a", ":", ",", "1", " "};
+  TokenizerInfo tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  TokenizerInfo variant_tokenizer_info(
+      vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0, 1}
+  );
+  GrammarCompiler compiler(tokenizer_info, 1, true);
+  GrammarCompiler variant_compiler(variant_tokenizer_info, 1, true);
+
+  auto compiled_grammar = compiler.CompileJSONSchema(R"({"type": "object"})");
+  auto variant_compiled_grammar = variant_compiler.CompileJSONSchema(R"({"type": "object"})");
+  // The masks are shared, and the stop tokens are the ones of the variant.
+  EXPECT_EQ(variant_compiled_grammar->mask_owner.get(), compiled_grammar.ImplPtr());
+  EXPECT_EQ(
+      variant_compiled_grammar.GetTokenizerInfo().GetStopTokenIds(), std::vector<int32_t>({0, 1})
+  );
+  auto result = CompiledGrammar::DeserializeJSON(
+      variant_compiled_grammar.SerializeJSON(), variant_tokenizer_info
+  );
+  ASSERT_TRUE(std::holds_alternative<CompiledGrammar>(result));
+  EXPECT_EQ(
+      std::get<CompiledGrammar>(result).SerializeJSON(), variant_compiled_grammar.SerializeJSON()
+  );
+
+  // The compilers of the same tokenizer share the compiled grammars.
+  GrammarCompiler other_compiler(tokenizer_info, 1, true);
+  EXPECT_EQ(
+      other_compiler.CompileJSONSchema(R"({"type": "object"})").ImplPtr(),
+      compiled_grammar.ImplPtr()
+  );
+
+  // The compilers without cache do not share.
+  GrammarCompiler no_cache_compiler(tokenizer_info, 1, false);
+  auto no_cache_compiled_grammar = no_cache_compiler.CompileJSONSchema(R"({"type": "object"})");
+  EXPECT_NE(no_cache_compiled_grammar.ImplPtr(), compiled_grammar.ImplPtr());
+  EXPECT_EQ(no_cache_compiled_grammar->mask_owner, nullptr);
+
+  // The masks are counted by the owner while its compilers cache it, and then by one sharer.
+  TokenizerInfo second_variant_tokenizer_info(
+      vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0, 1}
+  );
+  GrammarCompiler second_variant_compiler(second_variant_tokenizer_info, 1, true);
+  second_variant_compiler.CompileJSONSchema(R"({"type": "object"})");
+  EXPECT_LT(variant_compiled_grammar.MemorySizeBytes(), compiled_grammar.MemorySizeBytes());
+  auto variant_cache_size = variant_compiler.GetCacheSizeBytes();
+  auto second_variant_cache_size = second_variant_compiler.GetCacheSizeBytes();
+  EXPECT_EQ(variant_cache_size, second_variant_cache_size);
+  compiled_grammar = CompiledGrammar(NullObj{});
+  compiler.ClearCache();
+  other_compiler.ClearCache();
+  EXPECT_GT(variant_compiler.GetCacheSizeBytes(), variant_cache_size);
+  EXPECT_EQ(variant_compiler.GetCacheSizeBytes(), variant_compiled_grammar.MemorySizeBytes());
+  EXPECT_EQ(second_variant_compiler.GetCacheSizeBytes(), second_variant_cache_size);
+
+  // The tokenizers of different vocabularies do not share.
+  vocab.push_back("b");
+  TokenizerInfo other_tokenizer_info(vocab, VocabType::RAW, std::nullopt, std::vector<int32_t>{0});
+  GrammarCompiler other_vocab_compiler(other_tokenizer_info, 1, true);
+  EXPECT_EQ(other_vocab_compiler.CompileJSONSchema(R"({"type": "object"})")->mask_owner, nullptr);
+}
+
+namespace {
+
 // static_assert(
 //     sizeof(CompiledGrammar) >= sizeof(std::size_t),
 //     "Our test requires that CompiledGrammar is at least as large as std::size_t"
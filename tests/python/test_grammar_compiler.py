@@ -1,5 +1,6 @@
 """This test uses the optimized JSON grammar provided by the grammar library."""
 
+import json
 import sys
 import threading
 import time
@@ -147,14 +148,14 @@ grammar_expected_test_get_allow_empty_rule_ids = [
     rule2 ::= "def" rule3 | ""
     rule3 ::= "ghi"
     """,
-        [0, 1, 2],
+        [0, 1],
     ),
     (
         r"""root ::= rule1 rule2 [a-z]*
     rule1 ::= "abc" | ""
     rule2 ::= "def" | ""
     """,
-        [0, 1, 2],
+        [0],
     ),
     (
         r"""root ::= rule1 rule3
@@ -162,13 +163,13 @@ grammar_expected_test_get_allow_empty_rule_ids = [
     rule2 ::= "def" | ""
     rule3 ::= rule1 rule2
     """,
-        [0, 1, 2, 3],
+        [0],
     ),
     (
         r"""root ::= [a]* [b]* rule1
 rule1 ::= [abc]* [def]*
 """,
-        [0, 1],
+        [0],
     ),
 ]
 
@@ -329,5 +330,180 @@ def test_grammar_compiler_cache_limited():
     assert grammar_compiler.get_cache_size_bytes() == 0
 
 
+def test_compile_budget():
+    vocab = ["<eos>", "a", "b", "ab", '"', "{", "}", ":", ",", "1"]
+    tokenizer_info = xgr.TokenizerInfo(vocab, stop_token_ids=[0])
+    compiler = xgr.GrammarCompiler(tokenizer_info, max_threads=2)
+    schema = {"type": "object", "properties": {"a": {"type": "string"}}}
+
+    def get_reason(budget: xgr.CompileBudget):
+        with budget:
+            try:
+                compiler.compile_json_schema(schema)
+            except xgr.CompileBudgetExceededError as e:
+                return e.reason
+        return None
+
+    cancelled = xgr.CompileBudget()
+    cancelled.cancel()
+    assert cancelled.is_cancelled()
+    assert get_reason(cancelled) == "cancelled"
+    assert get_reason(xgr.CompileBudget(timeout_ms=0)) == "deadline"
+    assert get_reason(xgr.CompileBudget(max_memory_bytes=0)) == "memory"
+    assert get_reason(xgr.CompileBudget(max_fsm_states=2)) == "fsm_states"
+
+    # The failed compilations are not cached, and the budget does not apply outside the block.
+    budget = xgr.CompileBudget(timeout_ms=60000)
+    assert get_reason(budget) is None
+    assert budget.memory_bytes > 0 and budget.fsm_states > 0
+    assert compiler.get_cache_size_bytes() > 0
+    with xgr.CompileBudget(max_memory_bytes=0):
+        pass
+    compiler.clear_cache()
+    compiler.compile_json_schema(schema)
+
+
+def test_estimate_cost():
+    vocab = ["<eos>", "a", "b", "ab", '"', "{", "}", ":", ",", "1", "12"]
+    tokenizer_info = xgr.TokenizerInfo(vocab, stop_token_ids=[0])
+    compiler = xgr.GrammarCompiler(tokenizer_info)
+    small = xgr.Grammar.from_json_schema(
+        {"type": "object", "properties": {"a": {"type": "string"}}}
+    )
+    large = xgr.Grammar.from_json_schema(
+        {
+            "type": "object",
+            "properties": {
+                "a": {"type": "string"},
+                "b": {"type": "integer"},
+                "c": {"type": "array", "items": {"type": "string"}},
+            },
+        }
+    )
+    small_estimate = compiler.estimate_cost(small)
+    large_estimate = compiler.estimate_cost(large)
+    assert isinstance(small_estimate, xgr.CompileCostEstimate)
+    assert 0 < small_estimate.num_mask_states < large_estimate.num_mask_states
+    assert small_estimate.num_token_checks < large_estimate.num_token_checks
+    assert small_estimate.memory_bytes < large_estimate.memory_bytes
+    assert small_estimate.compile_time_ms < large_estimate.compile_time_ms
+
+    # The estimate does not compile or cache the grammar.
+    assert compiler.get_cache_size_bytes() == 0
+    assert compiler.estimate_cost('root ::= "a" [0-9]*').num_mask_states > 0
+
+    # Without a vocabulary, no token mask is computed.
+    empty_compiler = xgr.GrammarCompiler(xgr.TokenizerInfo([]))
+    assert empty_compiler.estimate_cost(small).num_mask_states == 0
+
+
+def test_prepared_grammar():
+    vocab_a = ["<eos>", "a", "b", "ab", '"', "{", "}", ":", ",", "1"]
+    vocab_b = ['{"', '"', "a", "b", "ba", "}", ":", ",", "12", "</s>"]
+    tokenizer_infos = [
+        xgr.TokenizerInfo(vocab_a, stop_token_ids=[0]),
+        xgr.TokenizerInfo(vocab_b, stop_token_ids=[9]),
+    ]
+    grammar = xgr.Grammar.from_json_schema(
+        {"type": "object", "properties": {"a": {"type": "string"}, "b": {"type": "integer"}}}
+    )
+    prepared_grammar = xgr.PreparedGrammar.from_grammar(grammar)
+    assert prepared_grammar.num_token_mask_states > 0
+    assert prepared_grammar.memory_size_bytes > 0
+
+    compiled_grammars = xgr.GrammarCompiler.compile_grammar_for_tokenizers(
+        prepared_grammar, tokenizer_infos
+    )
+    assert len(compiled_grammars) == 2
+    for tokenizer_info, compiled_grammar in zip(tokenizer_infos, compiled_grammars):
+        compiler = xgr.GrammarCompiler(tokenizer_info)
+        expected = compiler.compile_grammar(grammar).serialize_json()
+        assert compiled_grammar.serialize_json() == expected
+        assert compiler.compile_grammar(prepared_grammar).serialize_json() == expected
+
+    # The grammar is prepared once when compiling for several tokenizers.
+    compiled_grammars = xgr.GrammarCompiler.compile_grammar_for_tokenizers(
+        grammar, tokenizer_infos, max_threads=1
+    )
+    assert [c.tokenizer_info.vocab_size for c in compiled_grammars] == [10, 10]
+
+
+def test_prewarm_from_cache_manifest():
+    vocab = ["<eos>", "{", "}", '"', "a", "b", ":", ",", "1", " "]
+    tokenizer_info = xgr.TokenizerInfo(vocab, stop_token_ids=[0])
+    compiler = xgr.GrammarCompiler(tokenizer_info, max_memory_bytes=1 << 30)
+    compiler.compile_regex("a+b")
+    compiler.compile_json_schema({"type": "object"}, indent=2)
+    compiler.compile_builtin_json_grammar()
+    manifest = json.loads(compiler.export_cache_manifest())
+    assert [entry["type"] for entry in manifest] == ["builtin_json_grammar", "json_schema", "regex"]
+
+    prewarmed_compiler = xgr.GrammarCompiler(tokenizer_info, max_memory_bytes=1 << 30)
+    prewarmed_compiler.prewarm(manifest)
+    prewarmed_compiler.wait_for_prewarm()
+    assert prewarmed_compiler.get_cache_size_bytes() == compiler.get_cache_size_bytes()
+
+    # The entries of higher priorities are compiled first, and the failed ones are skipped.
+    another_compiler = xgr.GrammarCompiler(tokenizer_info, max_memory_bytes=1 << 30)
+    another_compiler.prewarm(
+        [
+            {"type": "regex", "regex": "("},
+            {"type": "regex", "regex": "a", "priority": 10},
+        ]
+    )
+    another_compiler.wait_for_prewarm()
+    assert json.loads(another_compiler.export_cache_manifest()) == [{"type": "regex", "regex": "a"}]
+    with pytest.raises(RuntimeError):
+        another_compiler.prewarm('[{"type": "unknown"}]')
+
+
+@pytest.mark.skipif(sys.platform == "win32", reason="The compile server requires Unix sockets")
+def test_compile_server(tmp_path):
+    tokenizer_info = xgr.TokenizerInfo(["<eos>", "a", "b", "{", "}", '"'], stop_token_ids=[0])
+    expected = (
+        xgr.GrammarCompiler(tokenizer_info, cache_enabled=False)
+        .compile_json_schema({"type": "object"})
+        .serialize_json()
+    )
+    socket_path = str(tmp_path / "compile_server.sock")
+    server = xgr.CompileServer(socket_path, max_threads=1)
+    serve_thread = threading.Thread(target=server.serve)
+    serve_thread.start()
+    try:
+        compiler = xgr.GrammarCompiler(tokenizer_info)
+        compiler.set_compile_server(socket_path)
+        assert compiler.compile_json_schema({"type": "object"}).serialize_json() == expected
+        with pytest.raises(RuntimeError):
+            compiler.compile_regex("(")
+    finally:
+        server.shutdown()
+        serve_thread.join()
+
+    # The grammars are compiled in this process when the server is unavailable.
+    compiler = xgr.GrammarCompiler(tokenizer_info, cache_enabled=False)
+    compiler.set_compile_server(socket_path)
+    assert compiler.compile_json_schema({"type": "object"}).serialize_json() == expected
+
+
+@pytest.mark.skipif(sys.platform == "win32", reason="Shared memory is only supported on POSIX")
+def test_shared_grammar_cache():
+    tokenizer_info = xgr.TokenizerInfo(["<eos>", "a", "b", "{", "}", '"'], stop_token_ids=[0])
+    name = "/xgrammar_test_shared_grammar_cache_py"
+    xgr.SharedGrammarCache.remove(name)
+    try:
+        shared_cache = xgr.SharedGrammarCache(name, 1 << 20)
+        assert shared_cache.memory_size_bytes >= 1 << 20
+        compiler = xgr.GrammarCompiler(tokenizer_info, cache_enabled=False)
+        compiler.set_shared_cache(shared_cache)
+        expected = compiler.compile_json_schema({"type": "object"}).serialize_json()
+
+        # A compiler of another process gets the grammar from the shared cache.
+        other_compiler = xgr.GrammarCompiler(tokenizer_info)
+        other_compiler.set_shared_cache(xgr.SharedGrammarCache(name, 1 << 10))
+        assert other_compiler.compile_json_schema({"type": "object"}).serialize_json() == expected
+    finally:
+        xgr.SharedGrammarCache.remove(name)
+
+
 if __name__ == "__main__":
     pytest.main(sys.argv)
@@ -176,6 +176,30 @@ def test_token_operations():
     assert result == expected
 
 
+def test_fill_next_token_bitmask_follow_bytes():
+    """The uncertain tokens leaving the rule are checked against the bytes that can follow the
+    live parent states."""
+    vocab = ["<s>", "</s>", "[", "{", "]", "}", "1", "1]", "1}", "1]]", "12}"]
+    grammar = xgr.Grammar.from_ebnf('root ::= "[" num "]" | "{" num "}"\nnum ::= [0-9] num | [0-9]')
+    tokenizer_info = xgr.TokenizerInfo(vocab, stop_token_ids=[1])
+    matcher = _get_matcher_from_grammar_and_tokenizer_info(grammar, tokenizer_info)
+    token_bitmask = xgr.allocate_token_bitmask(1, tokenizer_info.vocab_size)
+
+    expected = [["[", "{"], ["1", "1]"], ["1", "1]", "]"], ["</s>"]]
+    result = []
+    for token in ["[", "1", "]", None]:
+        matcher.fill_next_token_bitmask(token_bitmask)
+        rejected_token_ids = _get_masked_tokens_from_bitmask(
+            token_bitmask, tokenizer_info.vocab_size
+        )
+        accepted = set(range(len(vocab))) - set(rejected_token_ids)
+        result.append(sorted(vocab[i] for i in accepted))
+        if token is not None:
+            assert matcher.accept_token(vocab.index(token))
+
+    assert result == expected
+
+
 def test_rollback():
     vocab = [
         # fmt: off
@@ -312,6 +336,29 @@ def test_termination():
     assert matcher.accept_token(input_ids[-2])
 
 
+def test_accept_tokens():
+    vocab = [
+        # fmt: off
+        "<s>", "</s>", "a", "abc", 'b"', '"', ':"', "{", " }", ", ", "6", ":", "\n", " ", '"a"', ':true',
+        # fmt: on
+    ]
+    input_splitted = ["{", '"', "abc", 'b"', ":", "6", ", ", " ", '"a"', ":true", " }", "</s>"]
+    input_ids = [vocab.index(t) for t in input_splitted]
+    tokenizer_info = xgr.TokenizerInfo(vocab)
+    matcher = _get_matcher_from_grammar_and_tokenizer_info(json_grammar, tokenizer_info)
+
+    # The accepting stops at the first rejected token "}" of the draft.
+    assert matcher.accept_tokens(input_ids[:4] + [vocab.index(" }")] + input_ids[4:]) == 4
+    assert matcher.accept_tokens(input_ids[4:]) == len(input_ids) - 4
+    assert matcher.is_terminated()
+    assert matcher.accept_tokens([vocab.index("a")]) == 0
+
+    # Each accepted token is one step in rollback.
+    matcher.rollback(3)
+    assert matcher.accept_tokens(input_ids[-3:] + [vocab.index("a")]) == 3
+    assert matcher.is_terminated()
+
+
 def test_get_jump_forward_string():
     grammar_ebnf = r"""root ::= "abb" | "abbd" | other_rule
 other_rule ::= "a" sub_rule "b"
@@ -340,7 +387,25 @@ def test_vocab_size():
     assert rejected_tokens == [i for i in range(64) if i != 7]
 
 
-tokenizer_path_override_stop_tokens = [
+
+def test_matcher_memory_size_bytes():
+    vocab = [
+        # fmt: off
+        "<s>", "</s>", "a", "abc", 'b"', '"', ':"', "{", "}", ", ", "6", ":", "\n", " ", '"a":true',
+        # fmt: on
+    ]
+    tokenizer_info = xgr.TokenizerInfo(vocab, vocab_size=4096)
+    compiled_grammar = xgr.GrammarCompiler(tokenizer_info).compile_grammar(json_grammar)
+    matcher = xgr.GrammarMatcher(compiled_grammar)
+    # The matcher does not hold a copy of the vocabulary-sized data.
+    assert 0 < matcher.memory_size_bytes < tokenizer_info.vocab_size // 8
+
+    token_bitmask = xgr.allocate_token_bitmask(1, tokenizer_info.vocab_size)
+    matcher.fill_next_token_bitmask(token_bitmask)
+    initial_size = matcher.memory_size_bytes
+    assert matcher.accept_string('{"a":true}')
+    assert matcher.memory_size_bytes > initial_size
+
     ("meta-llama/Llama-2-7b-chat-hf", [2]),
     ("meta-llama/Meta-Llama-3-8B-Instruct", [128001, 128009]),
     ("deepseek-ai/DeepSeek-Coder-V2-Lite-Instruct", [100001]),
@@ -458,6 +523,23 @@ def test_batch_accept_token(grammars: List[str], inputs: List[int], expecteds: L
     assert results == expecteds
 
 
+def test_batch_accept_tokens():
+    vocab = [
+        # fmt: off
+        "<s>", "</s>", "a", "b", "c", "1", "2", "3", "123a", "ab",
+        # fmt: on
+    ]
+    tokenizer_info = xgr.TokenizerInfo(vocab)
+    grammars = ['root ::= "ab"', "root ::= [0-9]+", 'root ::= "a" [a-c]*']
+    matchers = [
+        _get_matcher_from_grammar_and_tokenizer_info(xgr.Grammar.from_ebnf(grammar), tokenizer_info)
+        for grammar in grammars
+    ]
+    inputs = [[2, 3, 1, 2], [5, 6, 8, 7], [9, 4, 4]]
+    assert xgr.BatchGrammarMatcher().batch_accept_tokens(matchers, inputs) == [3, 2, 3]
+    assert [matcher.is_terminated() for matcher in matchers] == [True, False, False]
+
+
 def test_batch_fill_next_token_bitmask():
     grammars = ['root ::= "a"', "root ::= [0-9]+", 'root ::= "ab"', "root ::= [a-z0-9]+"]
     vocab = [
@@ -511,6 +593,167 @@ def test_batch_fill_next_token_bitmask():
         assert accepted == expected_accepted_tokens[1][i]
 
 
+def test_worker_cpu_affinity():
+    num_cpus = xgr.get_available_cpu_count()
+    assert num_cpus >= 1
+
+    xgr.set_worker_cpu_affinity([0])
+    try:
+        assert xgr.get_worker_cpu_affinity() == [0]
+        assert xgr.get_available_cpu_count() == 1
+        # The pinned workers produce the same results.
+        tokenizer_info = xgr.TokenizerInfo(["a", "b", "</s>"])
+        matchers = [
+            _get_matcher_from_grammar_and_tokenizer_info(
+                xgr.Grammar.from_ebnf('root ::= "a"'), tokenizer_info
+            )
+            for _ in range(4)
+        ]
+        token_bitmask = xgr.allocate_token_bitmask(4, tokenizer_info.vocab_size)
+        xgr.BatchGrammarMatcher().batch_fill_next_token_bitmask(matchers, token_bitmask)
+        for i in range(4):
+            assert _get_masked_tokens_from_bitmask(
+                token_bitmask[i : i + 1], tokenizer_info.vocab_size
+            ) == [1, 2]
+    finally:
+        xgr.set_worker_cpu_affinity([])
+    assert xgr.get_worker_cpu_affinity() == []
+    assert xgr.get_available_cpu_count() == num_cpus
+
+
+def test_executor_num_threads():
+    num_threads = xgr.get_executor_num_threads()
+    assert num_threads >= 1
+    xgr.set_executor_num_threads(2)
+    try:
+        assert xgr.get_executor_num_threads() == 2
+        tokenizer_info = xgr.TokenizerInfo(["a", "b", "</s>"])
+        compiled_grammar = xgr.GrammarCompiler(
+            tokenizer_info, max_threads=4, cache_enabled=False
+        ).compile_grammar('root ::= "a" | "b" root')
+        matchers = [xgr.GrammarMatcher(compiled_grammar) for _ in range(4)]
+        token_bitmask = xgr.allocate_token_bitmask(4, tokenizer_info.vocab_size)
+        xgr.BatchGrammarMatcher(4).batch_fill_next_token_bitmask(matchers, token_bitmask)
+        for i in range(4):
+            assert _get_masked_tokens_from_bitmask(
+                token_bitmask[i : i + 1], tokenizer_info.vocab_size
+            ) == [2]
+    finally:
+        xgr.set_executor_num_threads(num_threads)
+    with pytest.raises(RuntimeError):
+        xgr.set_executor_num_threads(0)
+
+
+def test_submit_accept_and_fill():
+    vocab = [
+        # fmt: off
+        "<s>", "</s>", "a", "b", "c", "1", "2", "3", "123a", "ab",
+        # fmt: on
+    ]
+    tokenizer_info = xgr.TokenizerInfo(vocab)
+    grammars = ['root ::= "ab"', "root ::= [0-9]+", 'root ::= "a" [a-c]*']
+    matchers = [
+        _get_matcher_from_grammar_and_tokenizer_info(xgr.Grammar.from_ebnf(grammar), tokenizer_info)
+        for grammar in grammars
+    ]
+    sync_matchers = [
+        _get_matcher_from_grammar_and_tokenizer_info(xgr.Grammar.from_ebnf(grammar), tokenizer_info)
+        for grammar in grammars
+    ]
+    steps = [[2, 5, 2], [3, 6, 4], [1, 8, 4]]
+
+    # Submit all the steps without waiting, using two bitmasks in turn.
+    batch_grammar_matcher = xgr.BatchGrammarMatcher(2)
+    bitmasks = [xgr.allocate_token_bitmask(3, tokenizer_info.vocab_size) for _ in range(2)]
+    handles = [
+        batch_grammar_matcher.submit_accept_and_fill(matchers, tokens, bitmasks[i % 2])
+        for i, tokens in enumerate(steps)
+    ]
+    assert [handle.wait() for handle in handles] == [
+        [True, True, True],
+        [True, True, True],
+        [True, False, True],
+    ]
+    assert all(handle.is_ready() for handle in handles)
+
+    # The results are the same as the synchronous APIs. The terminated matcher does not fill its
+    # row, so the row of the first matcher keeps the bitmask of the first step.
+    expected_bitmask = xgr.allocate_token_bitmask(3, tokenizer_info.vocab_size)
+    for i, tokens in enumerate(steps):
+        xgr.BatchGrammarMatcher.batch_accept_token(sync_matchers, tokens)
+        if i == 0:
+            batch_grammar_matcher.batch_fill_next_token_bitmask(sync_matchers, expected_bitmask)
+            first_row = expected_bitmask[0].clone()
+        else:
+            batch_grammar_matcher.batch_fill_next_token_bitmask(
+                sync_matchers[1:], expected_bitmask, indices=[1, 2]
+            )
+    expected_bitmask[0] = first_row
+    torch.testing.assert_close(bitmasks[0], expected_bitmask)
+    assert [matcher.is_terminated() for matcher in matchers] == [True, False, False]
+
+
+def test_matcher_group():
+    grammars = ['root ::= "a"', "root ::= [0-9]+", 'root ::= "ab"', "root ::= [a-z0-9]+"]
+    vocab = [
+        # fmt: off
+        "ab", "</s>", "a", "b", "c", "1", "2", "3", "123a"
+        # fmt: on
+    ]
+    tokenizer_info = xgr.TokenizerInfo(vocab)
+    matchers = [
+        _get_matcher_from_grammar_and_tokenizer_info(xgr.Grammar.from_ebnf(grammar), tokenizer_info)
+        for grammar in grammars
+    ]
+
+    group = xgr.MatcherGroup(2)
+    slots = [group.add_matcher(matcher) for matcher in matchers]
+    assert slots == [0, 1, 2, 3]
+    assert group.num_matchers == 4
+
+    # Fill the rows in reverse order with the tensors of slots and indices.
+    token_bitmask = xgr.allocate_token_bitmask(4, tokenizer_info.vocab_size)
+    slot_tensor = torch.tensor(slots, dtype=torch.int32)
+    group.batch_fill_next_token_bitmask(
+        slot_tensor, token_bitmask, torch.tensor([3, 2, 1, 0], dtype=torch.int32)
+    )
+    expected_accepted_tokens = [[2], [5, 6, 7], [0, 2], [0, 2, 3, 4, 5, 6, 7, 8]]
+    for i in range(4):
+        rejected_token_ids = _get_masked_tokens_from_bitmask(
+            token_bitmask[3 - i : 4 - i], tokenizer_info.vocab_size
+        )
+        accepted = sorted(set(range(len(vocab))) - set(rejected_token_ids))
+        assert accepted == expected_accepted_tokens[i]
+
+    # The matchers are shared with the group.
+    assert group.batch_accept_token(slot_tensor, torch.tensor([2, 5, 2, 8], dtype=torch.int32)) == [
+        True,
+        True,
+        True,
+        True,
+    ]
+    assert matchers[0].is_terminated() is False
+    assert group.batch_accept_token([0, 2], [1, 1]) == [True, False]
+    assert matchers[0].is_terminated()
+
+    # The slot of a removed matcher is reused.
+    group.remove_matcher(0)
+    assert group.num_matchers == 3
+    new_matcher = _get_matcher_from_grammar_and_tokenizer_info(
+        xgr.Grammar.from_ebnf(grammars[0]), tokenizer_info
+    )
+    assert group.add_matcher(new_matcher) == 0
+    assert group.batch_accept_string([0, 3], ["a", "bc"]) == [True, True]
+    assert group.get_matcher(0).is_terminated() is False
+
+    with pytest.raises(RuntimeError):
+        group.batch_accept_token([1, 1], [5, 5])
+    with pytest.raises(RuntimeError):
+        group.batch_accept_token([4], [5])
+    with pytest.raises(RuntimeError):
+        group.batch_fill_next_token_bitmask([0, 1], token_bitmask, [0, 4])
+
+
 @pytest.mark.hf_token_required
 def test_batch_fill_next_token_bitmask_pressure():
     tokenizer_path = "meta-llama/Llama-2-7b-chat-hf"
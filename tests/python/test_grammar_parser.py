@@ -464,7 +464,28 @@ rule1 ::= (("b")) (=("b" rule3 rule5 rule2))
 rule2 ::= (("c"))
 rule3 ::= (("") | ("d" rule3)) (=(rule5 rule2))
 rule4 ::= (("") | ("e" rule4 "f")) (=("f"))
-rule5 ::= (("") | ("g" rule5 "h"))
+rule5 ::= (("") | ("g" rule5 "h")) (=([ch]))
+"""
+    grammar = _ebnf_to_grammar_no_normalization(before)
+    grammar = GrammarFunctor.lookahead_assertion_analyzer(grammar)
+    after = str(grammar)
+    assert after == expected
+
+
+def test_lookahead_assertion_analyzer_follow():
+    """Rules referenced at the end of another rule inherit its lookahead assertion, and rules
+    followed by different sequences get the union of their first characters."""
+    before = r"""root ::= "[" value "]" | "{" value "}" | "(" pair ")"
+value ::= "a" | "b" num
+num ::= [0-9] num | [0-9]
+pair ::= "k" ":" key
+key ::= "x" | "y" key
+"""
+    expected = r"""root ::= (("[" value "]") | ("{" value "}") | ("(" pair ")"))
+value ::= (("a") | ("b" num)) (=([\]}]))
+num ::= (([0-9] num) | ([0-9])) (=([\]}]))
+pair ::= (("k" ":" key)) (=(")"))
+key ::= (("x") | ("y" key)) (=(")"))
 """
     grammar = _ebnf_to_grammar_no_normalization(before)
     grammar = GrammarFunctor.lookahead_assertion_analyzer(grammar)
@@ -580,6 +601,54 @@ def test_dead_code_eliminator(before: str, expected: str):
     assert str(after) == expected
 
 
+before__expected__test_ambiguity_reducer = [
+    # Test merging single-character and duplicated alternatives
+    (
+        r"""root ::= "x" | "y" | [a-c] | "x" | [0-9]* [0-9]* "z"
+""",
+        r"""root ::= (([a-cx-y]) | ([0-9]* "z"))
+""",
+    ),
+    # Test removing the redundant empty alternative
+    (
+        r"""root ::= "" | [a]* | "b" root
+""",
+        r"""root ::= (([a]*) | ("b" root))
+""",
+    ),
+    # Test expanding nullable rules
+    (
+        r"""root ::= "a" ws "b"
+ws ::= "" | [ \t] | [ \t] [ \t]
+""",
+        r"""root ::= (("a" "b") | ("a" [ \t] "b") | ("a" [ \t] [ \t] "b"))
+""",
+    ),
+    (
+        r"""root ::= sign [0-9]+ | "0"
+sign ::= "" | "-" | "+"
+""",
+        r"""root ::= ((root_1) | ("-" root_1) | ("+" root_1) | ("0"))
+root_1 ::= (([0-9] root_1) | ([0-9]))
+""",
+    ),
+    # Test the grammar without ambiguity
+    (
+        r"""root ::= "a" root | "b"
+""",
+        r"""root ::= (("a" root) | ("b"))
+""",
+    ),
+]
+
+
+@pytest.mark.parametrize("before, expected", before__expected__test_ambiguity_reducer)
+def test_ambiguity_reducer(before: str, expected: str):
+    grammar = xgr.Grammar.from_ebnf(before)
+    after = xgr.testing.GrammarFunctor.ambiguity_reducer(grammar)
+    assert str(after) == expected
+
+
 def test_e2e_json_grammar():
     before = r"""root ::= (
     "{" [ \n\t]* members_and_embrace |
@@ -662,21 +731,19 @@ sign ::= "" | "+" | "-"
 """
 
     expected = r"""root ::= (("{" [ \n\t]* members_and_embrace) | ("[" [ \n\t]* elements_or_embrace))
-value_non_str ::= (("{" [ \n\t]* members_and_embrace) | ("[" [ \n\t]* elements_or_embrace) | ("0" fraction exponent) | ([1-9] [0-9]* fraction exponent) | ("-" [0-9] fraction exponent) | ("-" [1-9] [0-9]* fraction exponent) | ("true") | ("false") | ("null")) (=([ \n\t,}\]]))
+value_non_str ::= (("{" [ \n\t]* members_and_embrace) | ("[" [ \n\t]* elements_or_embrace) | ("0" exponent) | ("0" "." [0-9] [0-9]* exponent) | ([1-9] [0-9]* exponent) | ([1-9] [0-9]* "." [0-9] [0-9]* exponent) | ("-" [0-9] exponent) | ("-" [0-9] "." [0-9] [0-9]* exponent) | ("-" [1-9] [0-9]* exponent) | ("-" [1-9] [0-9]* "." [0-9] [0-9]* exponent) | ("true") | ("false") | ("null")) (=([ \n\t,}\]]))
 members_and_embrace ::= (("\"" characters_and_colon [ \n\t]* members_suffix) | ("}")) (=([ \n\t,}\]]))
 members_suffix ::= ((value_non_str [ \n\t]* member_suffix_suffix) | ("\"" characters_and_embrace) | ("\"" characters_and_comma [ \n\t]* "\"" characters_and_colon [ \n\t]* members_suffix)) (=([ \n\t,}\]]))
 member_suffix_suffix ::= (("}") | ("," [ \n\t]* "\"" characters_and_colon [ \n\t]* members_suffix)) (=([ \n\t,}\]]))
-elements_or_embrace ::= (("{" [ \n\t]* members_and_embrace elements_rest [ \n\t]* "]") | ("[" [ \n\t]* elements_or_embrace elements_rest [ \n\t]* "]") | ("\"" characters_item elements_rest [ \n\t]* "]") | ("0" fraction exponent elements_rest [ \n\t]* "]") | ([1-9] [0-9]* fraction exponent elements_rest [ \n\t]* "]") | ("-0" fraction exponent elements_rest [ \n\t]* "]") | ("-" [1-9] [0-9]* fraction exponent elements_rest [ \n\t]* "]") | ("true" elements_rest [ \n\t]* "]") | ("false" elements_rest [ \n\t]* "]") | ("null" elements_rest [ \n\t]* "]") | ("]"))
-elements ::= (("{" [ \n\t]* members_and_embrace elements_rest) | ("[" [ \n\t]* elements_or_embrace elements_rest) | ("\"" characters_item elements_rest) | ("0" fraction exponent elements_rest) | ([1-9] [0-9]* fraction exponent elements_rest) | ("-" [0-9] fraction exponent elements_rest) | ("-" [1-9] [0-9]* fraction exponent elements_rest) | ("true" elements_rest) | ("false" elements_rest) | ("null" elements_rest))
+elements_or_embrace ::= (("{" [ \n\t]* members_and_embrace elements_rest [ \n\t]* "]") | ("[" [ \n\t]* elements_or_embrace elements_rest [ \n\t]* "]") | ("\"" characters_item elements_rest [ \n\t]* "]") | ("0" exponent elements_rest [ \n\t]* "]") | ("0" "." [0-9] [0-9]* exponent elements_rest [ \n\t]* "]") | ([1-9] [0-9]* exponent elements_rest [ \n\t]* "]") | ([1-9] [0-9]* "." [0-9] [0-9]* exponent elements_rest [ \n\t]* "]") | ("-0" exponent elements_rest [ \n\t]* "]") | ("-0" "." [0-9] [0-9]* exponent elements_rest [ \n\t]* "]") | ("-" [1-9] [0-9]* exponent elements_rest [ \n\t]* "]") | ("-" [1-9] [0-9]* "." [0-9] [0-9]* exponent elements_rest [ \n\t]* "]") | ("true" elements_rest [ \n\t]* "]") | ("false" elements_rest [ \n\t]* "]") | ("null" elements_rest [ \n\t]* "]") | ("]"))
+elements ::= (("{" [ \n\t]* members_and_embrace elements_rest) | ("[" [ \n\t]* elements_or_embrace elements_rest) | ("\"" characters_item elements_rest) | ("0" exponent elements_rest) | ("0" "." [0-9] [0-9]* exponent elements_rest) | ([1-9] [0-9]* exponent elements_rest) | ([1-9] [0-9]* "." [0-9] [0-9]* exponent elements_rest) | ("-" [0-9] exponent elements_rest) | ("-" [0-9] "." [0-9] [0-9]* exponent elements_rest) | ("-" [1-9] [0-9]* exponent elements_rest) | ("-" [1-9] [0-9]* "." [0-9] [0-9]* exponent elements_rest) | ("true" elements_rest) | ("false" elements_rest) | ("null" elements_rest))
 elements_rest ::= ("" | ([ \n\t]* "," [ \n\t]* elements))
 characters_and_colon ::= (("\"" [ \n\t]* ":") | ([^\"\\\0-\x1f] characters_and_colon) | ("\\" escape characters_and_colon)) (=([ \n\t]* [\"{[0-9tfn\-]))
 characters_and_comma ::= (("\"" [ \n\t]* ",") | ([^\"\\\0-\x1f] characters_and_comma) | ("\\" escape characters_and_comma)) (=([ \n\t]* "\""))
 characters_and_embrace ::= (("\"" [ \n\t]* "}") | ([^\"\\\0-\x1f] characters_and_embrace) | ("\\" escape characters_and_embrace)) (=([ \n\t]* [},]))
 characters_item ::= (("\"") | ([^\"\\\0-\x1f] characters_item) | ("\\" escape characters_item)) (=([ \n\t]* [,\]]))
 escape ::= (([\"\\/bfnrt]) | ("u" [A-Fa-f0-9] [A-Fa-f0-9] [A-Fa-f0-9] [A-Fa-f0-9]))
-fraction ::= ("" | ("." [0-9] [0-9]*))
-exponent ::= ("" | ("e" sign [0-9] [0-9]*) | ("E" sign [0-9] [0-9]*))
-sign ::= ("" | ("+") | ("-"))
+exponent ::= ("" | ("e" [0-9] [0-9]*) | ("e" "+" [0-9] [0-9]*) | ("e" "-" [0-9] [0-9]*) | ("E" [0-9] [0-9]*) | ("E" "+" [0-9] [0-9]*) | ("E" "-" [0-9] [0-9]*))
 """
 
     grammar = xgr.Grammar.from_ebnf(before)
@@ -778,7 +845,7 @@ def test_error_consecutive_quantifiers():
 def test_repetition_normalizer():
     """Test the repetition normalizer. If the context is nullable, then the min repetition time will be reduced to 0."""
     before = "root ::= ([0-9]*){200, 1000}"
-    expected_grammar = r"""root ::= ((root_repeat_1{0, 872} [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]*))
+    expected_grammar = r"""root ::= ((root_repeat_1{0, 872} [0-9]*))
 root_repeat_1 ::= (([0-9]*)) (=([0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]* [0-9]*))
 """
     grammar = xgr.Grammar.from_ebnf(before)
@@ -2179,17 +2179,10 @@ def test_limited_whitespace_cnt():
     expected_grammar = r"""basic_escape ::= (([\"\\/bfnrt]) | ("u" [A-Fa-f0-9] [A-Fa-f0-9] [A-Fa-f0-9] [A-Fa-f0-9])) (=(basic_string_sub))
 basic_string_sub ::= (("\"") | ([^\0-\x1f\"\\\r\n] basic_string_sub) | ("\\" basic_escape basic_string_sub)) (=(basic_string_sub_1 [,}\]:]))
 basic_string ::= (("\"" basic_string_sub)) (=(root_7 "}"))
-root ::= (("{" root_1 "\"key\"" root_3 ":" root_5 basic_string root_7 "}"))
-basic_string_sub_1 ::= ("" | ([ \n\t] basic_string_sub_2))
-basic_string_sub_2 ::= ("" | ([ \n\t]))
-root_1 ::= ("" | ([ \n\t] root_2)) (=("\"key\"" root_3 ":" root_5 basic_string root_7 "}"))
-root_2 ::= ("" | ([ \n\t]))
-root_3 ::= ("" | ([ \n\t] root_4)) (=(":" root_5 basic_string root_7 "}"))
-root_4 ::= ("" | ([ \n\t]))
-root_5 ::= ("" | ([ \n\t] root_6)) (=(basic_string root_7 "}"))
-root_6 ::= ("" | ([ \n\t]))
-root_7 ::= ("" | ([ \n\t] root_8)) (=("}"))
-root_8 ::= ("" | ([ \n\t]))
+root ::= (("{" "\"key\"" ":" basic_string root_7 "}") | ("{" "\"key\"" ":" [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" ":" [ \n\t] [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] ":" basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] ":" [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] ":" [ \n\t] [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] [ \n\t] ":" basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] [ \n\t] ":" [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] [ \n\t] ":" [ \n\t] [ \n\t] basic_string root_7 "}") | ("{" [ \n\t] "\"key\"" ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] "\"key\"" [ \n\t] ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] "\"key\"" [ \n\t] [ \n\t] ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] [ \n\t] "\"key\"" ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] [ \n\t] "\"key\"" [ \n\t] ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] [ \n\t] "\"key\"" [ \n\t] [ \n\t] ":" root_5 basic_string root_7 "}"))
+basic_string_sub_1 ::= ("" | ([ \n\t]) | ([ \n\t] [ \n\t]))
+root_5 ::= ("" | ([ \n\t]) | ([ \n\t] [ \n\t])) (=(basic_string root_7 "}"))
+root_7 ::= ("" | ([ \n\t]) | ([ \n\t] [ \n\t])) (=("}"))
 """
     schema = {"type": "object", "properties": {"key": {"type": "string"}}, "required": ["key"]}
     grammar = xgr.Grammar.from_json_schema(schema, any_whitespace=True, max_whitespace_cnt=2)
@@ -2206,17 +2199,10 @@ def test_limited_whitespace_compile():
     expected_grammar = r"""basic_escape ::= (([\"\\/bfnrt]) | ("u" [A-Fa-f0-9] [A-Fa-f0-9] [A-Fa-f0-9] [A-Fa-f0-9])) (=(basic_string_sub))
 basic_string_sub ::= (("\"") | ([^\0-\x1f\"\\\r\n] basic_string_sub) | ("\\" basic_escape basic_string_sub)) (=(basic_string_sub_1 [,}\]:]))
 basic_string ::= (("\"" basic_string_sub)) (=(root_7 "}"))
-root ::= (("{" root_1 "\"key\"" root_3 ":" root_5 basic_string root_7 "}"))
-basic_string_sub_1 ::= ("" | ([ \n\t] basic_string_sub_2))
-basic_string_sub_2 ::= ("" | ([ \n\t]))
-root_1 ::= ("" | ([ \n\t] root_2)) (=("\"key\"" root_3 ":" root_5 basic_string root_7 "}"))
-root_2 ::= ("" | ([ \n\t]))
-root_3 ::= ("" | ([ \n\t] root_4)) (=(":" root_5 basic_string root_7 "}"))
-root_4 ::= ("" | ([ \n\t]))
-root_5 ::= ("" | ([ \n\t] root_6)) (=(basic_string root_7 "}"))
-root_6 ::= ("" | ([ \n\t]))
-root_7 ::= ("" | ([ \n\t] root_8)) (=("}"))
-root_8 ::= ("" | ([ \n\t]))
+root ::= (("{" "\"key\"" ":" basic_string root_7 "}") | ("{" "\"key\"" ":" [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" ":" [ \n\t] [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] ":" basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] ":" [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] ":" [ \n\t] [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] [ \n\t] ":" basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] [ \n\t] ":" [ \n\t] basic_string root_7 "}") | ("{" "\"key\"" [ \n\t] [ \n\t] ":" [ \n\t] [ \n\t] basic_string root_7 "}") | ("{" [ \n\t] "\"key\"" ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] "\"key\"" [ \n\t] ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] "\"key\"" [ \n\t] [ \n\t] ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] [ \n\t] "\"key\"" ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] [ \n\t] "\"key\"" [ \n\t] ":" root_5 basic_string root_7 "}") | ("{" [ \n\t] [ \n\t] "\"key\"" [ \n\t] [ \n\t] ":" root_5 basic_string root_7 "}"))
+basic_string_sub_1 ::= ("" | ([ \n\t]) | ([ \n\t] [ \n\t]))
+root_5 ::= ("" | ([ \n\t]) | ([ \n\t] [ \n\t])) (=(basic_string root_7 "}"))
+root_7 ::= ("" | ([ \n\t]) | ([ \n\t] [ \n\t])) (=("}"))
 """
     schema = {"type": "object", "properties": {"key": {"type": "string"}}, "required": ["key"]}
     tokenizer_info = xgr.TokenizerInfo([])